@@ -1,21 +1,27 @@
 #include "NaiveTensor.hpp"
+#include "PerfCounters.hpp"
 #include "Tensor.hpp"
 #include "TensorOperations.hpp"
 #include <benchmark/benchmark.h>
 
 static const size_t SIZE = 4;
 
+// Six products and five sums for each component of the rank 4 result
+static const double FLOPS = 11. * SIZE * SIZE * SIZE * SIZE;
+
 static void run_naive(benchmark::State &state) {
   tensoralgebra::NaiveTensor<4, double, SIZE> tensor;
   const tensoralgebra::NaiveTensor<2, double, SIZE> tensor1 = 1.;
   const tensoralgebra::NaiveTensor<2, double, SIZE> tensor2 = 2.;
   const tensoralgebra::NaiveTensor<2, double, SIZE> tensor3 = 3.;
+  tensoralgebra::PerfCounters perf_counters;
   while (state.KeepRunning()) {
     tensor = outer(tensor1, tensor2) + outer(tensor2, tensor1) +
              outer(tensor1, tensor3) + outer(tensor3, tensor1) +
              outer(tensor2, tensor3) + outer(tensor3, tensor2);
     benchmark::DoNotOptimize(tensor);
   }
+  perf_counters.report(state, FLOPS);
 }
 
 static void run_expression(benchmark::State &state) {
@@ -23,12 +29,14 @@ static void run_expression(benchmark::State &state) {
   const tensoralgebra::Tensor<2, double, SIZE> tensor1 = 1.;
   const tensoralgebra::Tensor<2, double, SIZE> tensor2 = 2.;
   const tensoralgebra::Tensor<2, double, SIZE> tensor3 = 3.;
+  tensoralgebra::PerfCounters perf_counters;
   while (state.KeepRunning()) {
     tensor = outer(tensor1, tensor2) + outer(tensor2, tensor1) +
              outer(tensor1, tensor3) + outer(tensor3, tensor1) +
              outer(tensor2, tensor3) + outer(tensor3, tensor2);
     benchmark::DoNotOptimize(tensor);
   }
+  perf_counters.report(state, FLOPS);
 }
 
 static void run_loop(benchmark::State &state) {
@@ -36,6 +44,7 @@ static void run_loop(benchmark::State &state) {
   const tensoralgebra::Tensor<2, double, SIZE> tensor1 = 1.;
   const tensoralgebra::Tensor<2, double, SIZE> tensor2 = 2.;
   const tensoralgebra::Tensor<2, double, SIZE> tensor3 = 3.;
+  tensoralgebra::PerfCounters perf_counters;
   while (state.KeepRunning()) {
     for (size_t i = 0; i < SIZE; ++i) {
       for (size_t j = 0; j < SIZE; ++j) {
@@ -51,6 +60,7 @@ static void run_loop(benchmark::State &state) {
     }
     benchmark::DoNotOptimize(tensor);
   }
+  perf_counters.report(state, FLOPS);
 }
 
 BENCHMARK(run_naive)->Repetitions(10)->ReportAggregatesOnly(true);
@@ -0,0 +1,108 @@
+#include "Complex.hpp"
+#include "PerfCounters.hpp"
+#include "Tensor.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+// Complex arithmetic on 4096 rank 2 tensors, as for Weyl scalars on the points
+// of a grid block: tensors of std::complex numbers, whose products go through
+// the checks for infinities and NaNs and work on interleaved real and
+// imaginary parts, against ComplexTensor with split parts. The expression is
+// a * conj(b) + 0.5 * r with a real tensor r, and the contraction dot(a, b).
+
+static const size_t POINTS = 4096;
+
+using Complex = std::complex<double>;
+using Interleaved = tensoralgebra::Tensor<2, Complex>;
+using Split = tensoralgebra::ComplexTensor<2>;
+
+template <typename TensorType> struct Data {
+  std::vector<TensorType> a, b, result;
+  std::vector<tensoralgebra::Tensor<2>> r;
+
+  Data() : a(POINTS), b(POINTS), result(POINTS), r(POINTS) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          set(a[p], i, j, Complex(std::sin(p + i), std::cos(p - j)));
+          set(b[p], i, j, Complex(std::cos(p * j), 1. + i * j));
+          r[p][i][j] = 1e-3 * p + i - j;
+        }
+      }
+    }
+  }
+
+  static void set(Interleaved &tensor, size_t i, size_t j, Complex value) {
+    tensor[i][j] = value;
+  }
+  static void set(Split &tensor, size_t i, size_t j, Complex value) {
+    tensor.real()[i][j] = value.real();
+    tensor.imag()[i][j] = value.imag();
+  }
+};
+
+static void run_interleaved_product(benchmark::State &state) {
+  Data<Interleaved> data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          data.result[p][i][j] = data.a[p][i][j] * std::conj(data.b[p][i][j]) +
+                                 0.5 * data.r[p][i][j];
+        }
+      }
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 7 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_split_product(benchmark::State &state) {
+  Data<Split> data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = data.a[p] * conj(data.b[p]) + 0.5 * data.r[p];
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 7 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_interleaved_dot(benchmark::State &state) {
+  Data<Interleaved> data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = tensoralgebra::dot(data.a[p], data.b[p]);
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 22 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_split_dot(benchmark::State &state) {
+  Data<Split> data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = tensoralgebra::dot(data.a[p], data.b[p]);
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 22 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+BENCHMARK(run_interleaved_product);
+BENCHMARK(run_split_product);
+BENCHMARK(run_interleaved_dot);
+BENCHMARK(run_split_dot);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include "DynamicTensor.hpp"
+#include "Parallel.hpp"
+#include "PerfCounters.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include <benchmark/benchmark.h>
+#include <thread>
+
+// Scaling of the DynamicTensor kernels from Size=4 to Size=4096, on one thread
+// and on all hardware threads. The fixed size Tensor is included at Size=4 for
+// comparison. Arguments are {size, number of threads}.
+
+static void size_and_thread_arguments(benchmark::internal::Benchmark *b) {
+  const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int size = 4; size <= 4096; size *= 4) {
+    b->Args({size, 1});
+    if (max_threads > 1) {
+      b->Args({size, max_threads});
+    }
+  }
+}
+
+static void set_flops(benchmark::State &state,
+                      tensoralgebra::PerfCounters &perf_counters,
+                      double flops_per_iteration) {
+  perf_counters.report(state, flops_per_iteration);
+  state.counters["flops"] = benchmark::Counter(
+      flops_per_iteration, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void run_dynamic_dot_matrix(benchmark::State &state) {
+  const size_t size = state.range(0);
+  tensoralgebra::set_default_num_threads(state.range(1));
+  tensoralgebra::DynamicTensor<2> tensor1(size, 1.), tensor2(size, 2.);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    auto product = dot(tensor1, tensor2);
+    benchmark::DoNotOptimize(product.data());
+  }
+  set_flops(state, perf_counters, 2. * size * size * size);
+}
+
+static void run_dynamic_dot_matrix_vector(benchmark::State &state) {
+  const size_t size = state.range(0);
+  tensoralgebra::set_default_num_threads(state.range(1));
+  tensoralgebra::DynamicTensor<2> matrix(size, 1.);
+  tensoralgebra::DynamicTensor<1> vector(size, 2.);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    auto product = dot(matrix, vector);
+    benchmark::DoNotOptimize(product.data());
+  }
+  set_flops(state, perf_counters, 2. * size * size);
+}
+
+static void run_dynamic_outer(benchmark::State &state) {
+  const size_t size = state.range(0);
+  tensoralgebra::set_default_num_threads(state.range(1));
+  tensoralgebra::DynamicTensor<1> vector1(size, 1.), vector2(size, 2.);
+  tensoralgebra::DynamicTensor<2> result(size);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    result = outer(vector1, vector2) + outer(vector2, vector1);
+    benchmark::DoNotOptimize(result.data());
+  }
+  set_flops(state, perf_counters, 3. * size * size);
+}
+
+static void run_dynamic_trace(benchmark::State &state) {
+  const size_t size = state.range(0);
+  tensoralgebra::set_default_num_threads(state.range(1));
+  tensoralgebra::DynamicTensor<2> tensor(size, 1.), inverse_metric(size, 2.);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(trace(tensor, inverse_metric));
+  }
+  set_flops(state, perf_counters, 2. * size * size);
+}
+
+static void run_fixed_dot_matrix(benchmark::State &state) {
+  const tensoralgebra::Tensor<2, double, 4> tensor1 = 1.;
+  const tensoralgebra::Tensor<2, double, 4> tensor2 = 2.;
+  tensoralgebra::Tensor<2, double, 4> product;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    product = dot(tensor1, tensor2);
+    benchmark::DoNotOptimize(product);
+  }
+  set_flops(state, perf_counters, 2. * 4 * 4 * 4);
+}
+
+BENCHMARK(run_dynamic_dot_matrix)->Apply(size_and_thread_arguments);
+BENCHMARK(run_dynamic_dot_matrix_vector)->Apply(size_and_thread_arguments);
+BENCHMARK(run_dynamic_outer)->Apply(size_and_thread_arguments);
+BENCHMARK(run_dynamic_trace)->Apply(size_and_thread_arguments);
+BENCHMARK(run_fixed_dot_matrix);
+
+BENCHMARK_MAIN();
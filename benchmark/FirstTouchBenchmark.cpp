@@ -0,0 +1,74 @@
+#include "FirstTouch.hpp"
+#include "Parallel.hpp"
+#include "PerfCounters.hpp"
+#include "TensorField.hpp"
+#include <benchmark/benchmark.h>
+
+// A bandwidth bound component wise expression, result = a + 2 b, swept in
+// parallel over fields of 2^19 rank 2 tensors (36 MiB each): fields allocated
+// and initialised by the main thread, and fields whose pages are first touched
+// by the threads of the sweep, with the threads unbound or bound to the CPUs
+// node by node. On a machine with a single NUMA node all variants should run
+// at the same speed.
+
+static const size_t NUM_POINTS = size_t(1) << 19;
+
+template <typename Field> struct Fields {
+  Field a, b, result;
+
+  template <typename... Allocator>
+  explicit Fields(const Allocator &...allocator)
+      : a(NUM_POINTS, 1, 1, allocator...), b(NUM_POINTS, 1, 1, allocator...),
+        result(NUM_POINTS, 1, 1, allocator...) {
+    // Written in parallel, as a simulation would set its initial data
+    tensoralgebra::parallel_for(0, NUM_POINTS, [&](size_t begin, size_t end) {
+      for (size_t p = begin; p < end; ++p) {
+        a[p] = 1e-3 * p;
+        b[p] = 2.;
+      }
+    });
+  }
+
+  void sweep() {
+    tensoralgebra::parallel_for(0, NUM_POINTS, [&](size_t begin, size_t end) {
+      result.assign(begin, end, [&](size_t p) { return a[p] + 2. * b[p]; });
+    });
+  }
+};
+
+template <typename Field>
+static void run_sweep(Fields<Field> &fields, benchmark::State &state) {
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    fields.sweep();
+    benchmark::DoNotOptimize(fields.result.data());
+  }
+  perf_counters.report(state, 2. * 9. * NUM_POINTS);
+  state.SetBytesProcessed(state.iterations() * 3 * NUM_POINTS *
+                          sizeof(tensoralgebra::Tensor<2>));
+}
+
+static void run_main_thread_touch(benchmark::State &state) {
+  // The vector constructor zeroes the fields on the main thread
+  Fields<tensoralgebra::TensorField<2>> fields;
+  run_sweep(fields, state);
+}
+
+static void run_first_touch(benchmark::State &state) {
+  if (state.range(0)) {
+    tensoralgebra::set_thread_cpus(tensoralgebra::cpus_by_numa_node());
+  }
+  {
+    const tensoralgebra::FirstTouchAllocator<tensoralgebra::Tensor<2>>
+        allocator;
+    Fields<tensoralgebra::FirstTouchTensorField<2>> fields(allocator);
+    run_sweep(fields, state);
+  }
+  tensoralgebra::set_thread_cpus({});
+}
+
+BENCHMARK(run_main_thread_touch)->UseRealTime();
+// The argument is whether the threads are bound to CPUs node by node
+BENCHMARK(run_first_touch)->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
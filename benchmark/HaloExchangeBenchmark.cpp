@@ -0,0 +1,96 @@
+#include "HaloExchange.hpp"
+#include "PerfCounters.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Exchange of three ghost planes of a metric and a shift field of a 64^3 box
+// on either side, for a single periodic rank (which exchanges with itself, so
+// no time is spent waiting): packing and unpacking component by component
+// through a buffer, as in framework code, against HaloExchange, which copies
+// whole planes of all components into and out of shared memory.
+
+static const size_t N = 64, GHOSTS = 3;
+
+struct Data {
+  tensoralgebra::SlabDecomposition slabs{{{N, N, N}}, 1, GHOSTS, true};
+  tensoralgebra::TensorField<2> metric{slabs.local_extent(0)};
+  tensoralgebra::TensorField<1> shift{slabs.local_extent(0)};
+
+  Data() {
+    for (size_t p = 0; p < metric.num_points(); ++p) {
+      metric[p] = 1e-3 * p;
+      shift[p] = 2e-3 * p;
+    }
+  }
+};
+
+// Copies planes [from, from + GHOSTS) to [to, to + GHOSTS) through buffer
+template <typename Field>
+static void copy_planes(Field &field, size_t from, size_t to,
+                        std::vector<double> &buffer) {
+  size_t n = 0;
+  for (size_t k = from; k < from + GHOSTS; ++k) {
+    for (size_t j = 0; j < N; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        for (size_t c = 0; c < Field::num_components(); ++c) {
+          buffer[n++] = field.components()[field.index(i, j, k) *
+                                               Field::num_components() +
+                                           c];
+        }
+      }
+    }
+  }
+  n = 0;
+  for (size_t k = to; k < to + GHOSTS; ++k) {
+    for (size_t j = 0; j < N; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        for (size_t c = 0; c < Field::num_components(); ++c) {
+          field.components()[field.index(i, j, k) * Field::num_components() +
+                             c] = buffer[n++];
+        }
+      }
+    }
+  }
+}
+
+static void run_componentwise(benchmark::State &state) {
+  Data data;
+  std::vector<double> buffer(GHOSTS * N * N * 9);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    copy_planes(data.metric, GHOSTS, N + GHOSTS, buffer);
+    copy_planes(data.metric, N, 0, buffer);
+    copy_planes(data.shift, GHOSTS, N + GHOSTS, buffer);
+    copy_planes(data.shift, N, 0, buffer);
+    benchmark::DoNotOptimize(data.metric.components());
+    benchmark::DoNotOptimize(data.shift.components());
+  }
+  perf_counters.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * GHOSTS * N * N * 12 *
+                          sizeof(double));
+}
+
+static void run_halo_exchange(benchmark::State &state) {
+  Data data;
+  tensoralgebra::HaloExchange halo(
+      "/tensoralgebra_halo_benchmark_" + std::to_string(getpid()), data.slabs,
+      0, data.metric, data.shift);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    halo.exchange();
+    benchmark::DoNotOptimize(data.metric.components());
+    benchmark::DoNotOptimize(data.shift.components());
+  }
+  perf_counters.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * GHOSTS * N * N * 12 *
+                          sizeof(double));
+}
+
+BENCHMARK(run_componentwise);
+BENCHMARK(run_halo_exchange);
+
+BENCHMARK_MAIN();
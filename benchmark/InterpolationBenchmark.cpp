@@ -0,0 +1,123 @@
+#include "Interpolation.hpp"
+#include "PerfCounters.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Cubic Lagrange interpolation of a metric-like field on a 64^3 grid at 10^4 to
+// 10^6 random points or points on spheres, on one thread: point by point, with
+// the weights of each point computed and applied to whole tensors, and in
+// batches with LagrangeInterpolator.
+
+using Point = std::array<double, 3>;
+static const size_t N = 64;
+static const Point ORIGIN = {{0., 0., 0.}}, SPACING = {{0.1, 0.1, 0.1}};
+
+struct Data {
+  tensoralgebra::TensorField<2> field{N, N, N};
+  std::vector<Point> points;
+  std::vector<tensoralgebra::Tensor<2>> values;
+
+  // Random points (spheres == false), or points on 10 concentric spheres
+  // ordered by angle as on extraction spheres
+  Data(size_t num_points, bool spheres) {
+    for (size_t p = 0; p < field.num_points(); ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          field[p][i][j] = std::sin(1e-3 * p + i) + (i == j ? 1. : 0.1 * j);
+        }
+      }
+    }
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> coordinate(0., (N - 1) * 0.1);
+    const double centre = 0.5 * (N - 1) * 0.1;
+    const size_t per_sphere = num_points / 10;
+    const size_t num_phi = std::sqrt(2. * per_sphere);
+    for (size_t n = 0; n < num_points; ++n) {
+      if (spheres) {
+        const double radius = 1. + 0.2 * (n / per_sphere);
+        const size_t m = n % per_sphere;
+        const double theta =
+            M_PI * (m / num_phi + 0.5) / (per_sphere / num_phi);
+        const double phi = 2. * M_PI * (m % num_phi) / num_phi;
+        points.push_back({{centre + radius * std::sin(theta) * std::cos(phi),
+                           centre + radius * std::sin(theta) * std::sin(phi),
+                           centre + radius * std::cos(theta)}});
+      } else {
+        points.push_back({{coordinate(generator), coordinate(generator),
+                           coordinate(generator)}});
+      }
+    }
+    values.resize(num_points);
+  }
+};
+
+// Cubic interpolation of one point, as a straightforward implementation would
+// write it
+static tensoralgebra::Tensor<2>
+interpolate_point(const tensoralgebra::TensorField<2> &field,
+                  const Point &point) {
+  size_t first[3];
+  double weights[3][4];
+  for (size_t dir = 0; dir < 3; ++dir) {
+    const double u = (point[dir] - ORIGIN[dir]) / SPACING[dir];
+    const double start =
+        std::min(std::max(std::floor(u) - 1., 0.), double(N - 4));
+    const double t = u - start;
+    first[dir] = static_cast<size_t>(start);
+    weights[dir][0] = -(t - 1.) * (t - 2.) * (t - 3.) / 6.;
+    weights[dir][1] = t * (t - 2.) * (t - 3.) / 2.;
+    weights[dir][2] = -t * (t - 1.) * (t - 3.) / 2.;
+    weights[dir][3] = t * (t - 1.) * (t - 2.) / 6.;
+  }
+  tensoralgebra::Tensor<2> value = 0.;
+  for (size_t k = 0; k < 4; ++k) {
+    for (size_t j = 0; j < 4; ++j) {
+      for (size_t i = 0; i < 4; ++i) {
+        value = value + weights[0][i] * weights[1][j] * weights[2][k] *
+                            field(first[0] + i, first[1] + j, first[2] + k);
+      }
+    }
+  }
+  return value;
+}
+
+// A multiply and an add per component and stencil point
+static double flops(size_t num_points) { return num_points * 64. * 9. * 2.; }
+
+static void run_point_by_point(benchmark::State &state) {
+  Data data(state.range(0), state.range(1));
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t n = 0; n < data.points.size(); ++n) {
+      data.values[n] = interpolate_point(data.field, data.points[n]);
+    }
+    benchmark::DoNotOptimize(data.values.data());
+  }
+  perf_counters.report(state, flops(data.points.size()));
+  state.SetItemsProcessed(state.iterations() * data.points.size());
+}
+
+static void run_batched(benchmark::State &state) {
+  Data data(state.range(0), state.range(1));
+  tensoralgebra::LagrangeInterpolator<4> interpolator(ORIGIN, SPACING);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    interpolator.interpolate(data.field, data.points, data.values, 1);
+    benchmark::DoNotOptimize(data.values.data());
+  }
+  perf_counters.report(state, flops(data.points.size()));
+  state.SetItemsProcessed(state.iterations() * data.points.size());
+}
+
+// The arguments are the number of points and whether they lie on spheres
+BENCHMARK(run_point_by_point)
+    ->ArgsProduct({{10000, 100000, 1000000}, {0, 1}});
+BENCHMARK(run_batched)->ArgsProduct({{10000, 100000, 1000000}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include "Interpreter.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include <benchmark/benchmark.h>
+
+// The same expressions evaluated over a field by compiled expression templates
+// and by the interpreter (on one thread, like the compiled version).
+
+static const size_t NUM_POINTS = 4096;
+
+struct Fields {
+  tensoralgebra::TensorField<2> metric{NUM_POINTS};
+  tensoralgebra::TensorField<2> curvature{NUM_POINTS};
+  tensoralgebra::TensorField<1> vector{NUM_POINTS};
+  tensoralgebra::TensorField<2> result{NUM_POINTS};
+  tensoralgebra::Interpreter<3> interpreter;
+
+  Fields() {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        vector[p][i] = 0.5 + i;
+        for (size_t j = 0; j < 3; ++j) {
+          metric[p][i][j] = (i == j ? 1. + 1e-4 * p : 0.1);
+          curvature[p][i][j] = 0.01 * (i + j) + 1e-5 * p;
+        }
+      }
+    }
+    interpreter.bind("g", metric);
+    interpreter.bind("K", curvature);
+    interpreter.bind("v", vector);
+  }
+};
+
+static void run_compiled_arithmetic(benchmark::State &state) {
+  Fields fields;
+  while (state.KeepRunning()) {
+    fields.result.assign([&](size_t p) {
+      return 2. * fields.metric[p] * fields.curvature[p] - fields.metric[p] +
+             0.5 * fields.curvature[p];
+    });
+    benchmark::DoNotOptimize(fields.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+static void run_interpreted_arithmetic(benchmark::State &state) {
+  Fields fields;
+  auto program = fields.interpreter.compile("2 * g * K - g + 0.5 * K");
+  while (state.KeepRunning()) {
+    program.run(fields.result, 1);
+    benchmark::DoNotOptimize(fields.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+static void run_compiled_contractions(benchmark::State &state) {
+  Fields fields;
+  while (state.KeepRunning()) {
+    fields.result.assign([&](size_t p) -> tensoralgebra::Tensor<2> {
+      const tensoralgebra::Tensor<2> raised =
+          dot(fields.metric[p], dot(fields.curvature[p], fields.metric[p]));
+      return dot(fields.curvature[p], raised) -
+             trace(fields.curvature[p], fields.metric[p]) *
+                 fields.curvature[p] +
+             outer(fields.vector[p], fields.vector[p]);
+    });
+    benchmark::DoNotOptimize(fields.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+static void run_interpreted_contractions(benchmark::State &state) {
+  Fields fields;
+  auto program = fields.interpreter.compile(
+      "dot(K, raise_all(K, g)) - trace(K, g) * K + outer(v, v)");
+  while (state.KeepRunning()) {
+    program.run(fields.result, 1);
+    benchmark::DoNotOptimize(fields.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+BENCHMARK(run_compiled_arithmetic);
+BENCHMARK(run_interpreted_arithmetic);
+BENCHMARK(run_compiled_contractions);
+BENCHMARK(run_interpreted_contractions);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+#include "LinearSolve.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <benchmark/benchmark.h>
+
+// Solving one small system per grid point: system by system with solve() and
+// solve_spd() on tensors, and with the batched versions for fields.
+
+static const size_t NUM_POINTS = 4096;
+
+template <size_t Size> struct Systems {
+  tensoralgebra::TensorField<2, double, Size> matrices{NUM_POINTS};
+  tensoralgebra::TensorField<1, double, Size> rhs{NUM_POINTS};
+  tensoralgebra::TensorField<1, double, Size> solutions{NUM_POINTS};
+
+  Systems() {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      for (size_t i = 0; i < Size; ++i) {
+        rhs[p][i] = 1. + i;
+        for (size_t j = 0; j < Size; ++j) {
+          matrices[p][i][j] = (i == j ? Size + 1. + 1e-3 * p : 0.5);
+        }
+      }
+    }
+  }
+};
+
+template <size_t Size>
+static void run_solve_per_point(benchmark::State &state) {
+  Systems<Size> systems;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      systems.solutions[p] =
+          tensoralgebra::solve(systems.matrices[p], systems.rhs[p]);
+    }
+    benchmark::DoNotOptimize(systems.solutions.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+template <size_t Size> static void run_solve_batched(benchmark::State &state) {
+  Systems<Size> systems;
+  while (state.KeepRunning()) {
+    tensoralgebra::solve(systems.matrices, systems.rhs, systems.solutions);
+    benchmark::DoNotOptimize(systems.solutions.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+template <size_t Size>
+static void run_solve_spd_per_point(benchmark::State &state) {
+  Systems<Size> systems;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      systems.solutions[p] =
+          tensoralgebra::solve_spd(systems.matrices[p], systems.rhs[p]);
+    }
+    benchmark::DoNotOptimize(systems.solutions.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+template <size_t Size>
+static void run_solve_spd_batched(benchmark::State &state) {
+  Systems<Size> systems;
+  while (state.KeepRunning()) {
+    tensoralgebra::solve_spd(systems.matrices, systems.rhs, systems.solutions);
+    benchmark::DoNotOptimize(systems.solutions.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+BENCHMARK_TEMPLATE(run_solve_per_point, 3);
+BENCHMARK_TEMPLATE(run_solve_batched, 3);
+BENCHMARK_TEMPLATE(run_solve_spd_per_point, 3);
+BENCHMARK_TEMPLATE(run_solve_spd_batched, 3);
+BENCHMARK_TEMPLATE(run_solve_per_point, 4);
+BENCHMARK_TEMPLATE(run_solve_batched, 4);
+BENCHMARK_TEMPLATE(run_solve_spd_per_point, 4);
+BENCHMARK_TEMPLATE(run_solve_spd_batched, 4);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+#include "PaddedTensor.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Component wise expressions and dot products over arrays of tensors of ranks
+// 1 to 4, stored unpadded (Tensor) and with padded, aligned rows
+// (PaddedTensor). Compile with e.g. -march=native to see the effect of the
+// vector width.
+
+static const size_t NUM_TENSORS = 512;
+
+template <size_t Rank>
+using Unpadded = std::vector<tensoralgebra::Tensor<Rank>>;
+template <size_t Rank> using Padded = tensoralgebra::PaddedArray<Rank>;
+
+template <typename Array> struct Operands {
+  Array a, b, c, result;
+
+  Operands()
+      : a(NUM_TENSORS), b(NUM_TENSORS), c(NUM_TENSORS), result(NUM_TENSORS) {
+    for (size_t n = 0; n < NUM_TENSORS; ++n) {
+      a[n] = 1. + 1e-3 * n;
+      b[n] = 2.;
+      c[n] = 0.5;
+    }
+  }
+};
+
+template <typename Array>
+static void run_component_wise(benchmark::State &state) {
+  Operands<Array> operands;
+  while (state.KeepRunning()) {
+    for (size_t n = 0; n < NUM_TENSORS; ++n) {
+      operands.result[n] =
+          2. * operands.a[n] + operands.b[n] * operands.c[n] - operands.a[n];
+    }
+    benchmark::DoNotOptimize(operands.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_TENSORS);
+}
+
+// dot of a rank 2 tensor with a tensor of rank Rank (rank 1 rows are not
+// padded in the result, see PaddedTensor.hpp)
+template <typename Matrices, typename Array>
+static void run_dot(benchmark::State &state) {
+  Operands<Matrices> matrices;
+  Operands<Array> operands;
+  while (state.KeepRunning()) {
+    for (size_t n = 0; n < NUM_TENSORS; ++n) {
+      operands.result[n] = tensoralgebra::dot(matrices.a[n], operands.b[n]);
+    }
+    benchmark::DoNotOptimize(operands.result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_TENSORS);
+}
+
+BENCHMARK_TEMPLATE(run_component_wise, Unpadded<1>);
+BENCHMARK_TEMPLATE(run_component_wise, Padded<1>);
+BENCHMARK_TEMPLATE(run_component_wise, Unpadded<2>);
+BENCHMARK_TEMPLATE(run_component_wise, Padded<2>);
+BENCHMARK_TEMPLATE(run_component_wise, Unpadded<3>);
+BENCHMARK_TEMPLATE(run_component_wise, Padded<3>);
+BENCHMARK_TEMPLATE(run_component_wise, Unpadded<4>);
+BENCHMARK_TEMPLATE(run_component_wise, Padded<4>);
+
+BENCHMARK_TEMPLATE(run_dot, Unpadded<2>, Unpadded<1>);
+BENCHMARK_TEMPLATE(run_dot, Padded<2>, Padded<1>);
+BENCHMARK_TEMPLATE(run_dot, Unpadded<2>, Unpadded<2>);
+BENCHMARK_TEMPLATE(run_dot, Padded<2>, Padded<2>);
+BENCHMARK_TEMPLATE(run_dot, Unpadded<2>, Unpadded<3>);
+BENCHMARK_TEMPLATE(run_dot, Padded<2>, Padded<3>);
+
+BENCHMARK_MAIN();
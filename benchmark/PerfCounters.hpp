@@ -0,0 +1,217 @@
+#ifndef _TENSORALGEBRA_BENCHMARK_PERFCOUNTERS_HPP
+#define _TENSORALGEBRA_BENCHMARK_PERFCOUNTERS_HPP
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+// Hardware performance counters for the benchmarks, read with the Linux
+// perf_event interface. A PerfCounters object counts (for the calling thread
+// and all threads it starts) from its construction until report(), which adds
+// per iteration counts and the derived quantities to the benchmark's counters:
+//   cycles, instructions, LLC_misses, L1D_misses  per iteration
+//   scalar_double, packed_double_*, fp_ops  per iteration, where available
+//   IPC          instructions per cycle
+//   flops/cycle  floating point operations per cycle
+//   bytes/flop   LLC misses (64 byte lines) per floating point operation
+// Floating point operations are the number passed to report(), unless they are
+// counted by the hardware (see below: FP_ARITH_INST_RETIRED on Intel, split by
+// vector width, and retired SSE/AVX flops on AMD Zen).
+//
+// The environment variable TENSORALGEBRA_PERF_COUNTERS selects the events:
+//   memory (default)  cycles, instructions, L1D and LLC misses
+//   flops             cycles, instructions and the flop events
+//   0                 no counters
+// Each set fits into four programmable counters (the AMD flop event occupies
+// two), which all x86 PMUs have; some virtual PMUs return garbage instead of
+// multiplexing when more events are opened.
+// Counters which can't be opened (no PMU in a virtual machine, seccomp in a
+// container, perf_event_paranoid > 2, ...) are left out, and if none can be
+// opened the benchmark is labelled "no perf counters".
+
+namespace tensoralgebra {
+
+class PerfCounters {
+  struct Event {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    double flops_per_count; // 0 unless the event counts flops
+    int fd;
+    double value;
+  };
+  std::vector<Event> m_events;
+
+  static std::string event_set() {
+    const char *setting = std::getenv("TENSORALGEBRA_PERF_COUNTERS");
+    return setting == nullptr ? "memory" : setting;
+  }
+
+  static bool is_disabled() { return event_set() == "0"; }
+
+  // "GenuineIntel" or "AuthenticAMD" and the CPU family, from /proc/cpuinfo
+  static void cpu_vendor(std::string &vendor, int &family) {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    family = 0;
+    while (std::getline(cpuinfo, line) && (vendor.empty() || family == 0)) {
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos || colon + 2 > line.size()) {
+        continue;
+      }
+      if (line.compare(0, 9, "vendor_id") == 0) {
+        vendor = line.substr(colon + 2);
+      } else if (line.compare(0, 10, "cpu family") == 0) {
+        family = std::atoi(line.c_str() + colon + 2);
+      }
+    }
+  }
+
+  static std::vector<Event> available_events() {
+    std::vector<Event> events = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0., -1, 0.},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0., -1,
+         0.}};
+    if (event_set() != "flops") {
+      const Event misses[] = {
+          {"L1D_misses", PERF_TYPE_HW_CACHE,
+           PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+           0., -1, 0.},
+          {"LLC_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0., -1,
+           0.}};
+      events.insert(events.end(), std::begin(misses), std::end(misses));
+      return events;
+    }
+    std::string vendor;
+    int family;
+    cpu_vendor(vendor, family);
+    if (vendor == "GenuineIntel") {
+      // FP_ARITH_INST_RETIRED (event 0xc7) for doubles, i.e. the number of
+      // instructions per vector width; FMAs count twice
+      const Event fp_arith[] = {
+          {"scalar_double", PERF_TYPE_RAW, 0x01c7, 1., -1, 0.},
+          {"packed_double_128", PERF_TYPE_RAW, 0x04c7, 2., -1, 0.},
+          {"packed_double_256", PERF_TYPE_RAW, 0x10c7, 4., -1, 0.}};
+      events.insert(events.end(), std::begin(fp_arith), std::end(fp_arith));
+    } else if (vendor == "AuthenticAMD" && family >= 0x17) {
+      // Retired SSE/AVX flops (event 0x03, all operation types)
+      events.push_back({"fp_ops", PERF_TYPE_RAW, 0x0f03, 1., -1, 0.});
+    }
+    return events;
+  }
+
+  static int open_event(const Event &event) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = event.type;
+    attributes.config = event.config;
+    attributes.disabled = 1;
+    attributes.inherit = 1; // Count threads started while counting, too
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    // The events are not grouped, so each one may be multiplexed separately
+    attributes.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+  }
+
+public:
+  /// Opens the counters and starts counting
+  PerfCounters() {
+    if (is_disabled()) {
+      return;
+    }
+    for (Event &event : available_events()) {
+      event.fd = open_event(event);
+      if (event.fd >= 0) {
+        m_events.push_back(event);
+      }
+    }
+    for (const Event &event : m_events) {
+      ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+    }
+    for (const Event &event : m_events) {
+      ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters() {
+    for (const Event &event : m_events) {
+      close(event.fd);
+    }
+  }
+
+  bool is_available() const { return !m_events.empty(); }
+
+  /// Stops counting and adds the counts per iteration and the derived
+  /// quantities to the counters of state
+  /** flops_per_iteration is used for flops/cycle and bytes/flop if the
+   * hardware doesn't count floating point operations (0 if unknown). */
+  void report(benchmark::State &state, double flops_per_iteration = 0.) {
+    for (Event &event : m_events) {
+      ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    if (!is_available()) {
+      if (!is_disabled()) {
+        state.SetLabel("no perf counters");
+      }
+      return;
+    }
+
+    const double iterations = state.iterations() > 0 ? state.iterations() : 1;
+    double cycles = 0., instructions = 0., llc_misses = -1., flops = 0.;
+    bool counts_flops = false;
+    for (Event &event : m_events) {
+      uint64_t values[3]; // value, time enabled, time running
+      if (read(event.fd, values, sizeof(values)) != sizeof(values) ||
+          values[2] == 0) {
+        continue;
+      }
+      // Extrapolate if the event was multiplexed with others
+      event.value = values[0] * (double(values[1]) / values[2]) / iterations;
+      if (event.flops_per_count > 0.) {
+        flops += event.flops_per_count * event.value;
+        counts_flops = true;
+      }
+      state.counters[event.name] = event.value;
+      if (std::strcmp(event.name, "cycles") == 0) {
+        cycles = event.value;
+      } else if (std::strcmp(event.name, "instructions") == 0) {
+        instructions = event.value;
+      } else if (std::strcmp(event.name, "LLC_misses") == 0) {
+        llc_misses = event.value;
+      }
+    }
+    if (!counts_flops) {
+      flops = flops_per_iteration;
+    }
+
+    if (cycles > 0.) {
+      state.counters["IPC"] = instructions / cycles;
+      if (flops > 0.) {
+        state.counters["flops/cycle"] = flops / cycles;
+      }
+    }
+    if (flops > 0. && llc_misses >= 0.) {
+      state.counters["bytes/flop"] = 64. * llc_misses / flops;
+    }
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,109 @@
+#include "PerfCounters.hpp"
+#include "Tensor.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+// Fourth power of a sum and a quartic polynomial of 4096 rank 2 tensors:
+// std::pow component by component, the product (a + b) * (a + b) * (a + b) *
+// (a + b) of expression templates, which evaluates a + b four times, and
+// pow<4>, which evaluates it once and squares it twice. The polynomial is
+// written out as a sum of products and with polyval.
+
+static const size_t POINTS = 4096;
+
+struct Data {
+  std::vector<tensoralgebra::Tensor<2>> a, b, result;
+
+  Data() : a(POINTS), b(POINTS), result(POINTS) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          a[p][i][j] = std::sin(1e-3 * p + i - j);
+          b[p][i][j] = 0.5 + 1e-4 * p * j;
+        }
+      }
+    }
+  }
+};
+
+static void run_std_pow(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          data.result[p][i][j] =
+              std::pow(data.a[p][i][j] + data.b[p][i][j], 4);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 3 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_product(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = (data.a[p] + data.b[p]) * (data.a[p] + data.b[p]) *
+                       (data.a[p] + data.b[p]) * (data.a[p] + data.b[p]);
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 3 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_pow(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = tensoralgebra::pow<4>(data.a[p] + data.b[p]);
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 3 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_polynomial_sum(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      const auto &x = data.a[p];
+      data.result[p] = 0.5 * x * x * x * x - 2. * x * x * x + 3. * x * x -
+                       x + 1.;
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 8 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+static void run_polyval(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t p = 0; p < POINTS; ++p) {
+      data.result[p] = tensoralgebra::polyval(data.a[p], 0.5, -2., 3., -1., 1.);
+    }
+    benchmark::DoNotOptimize(data.result.data());
+  }
+  perf_counters.report(state, 9 * 8 * POINTS);
+  state.SetItemsProcessed(state.iterations() * POINTS);
+}
+
+BENCHMARK(run_std_pow);
+BENCHMARK(run_product);
+BENCHMARK(run_pow);
+BENCHMARK(run_polynomial_sum);
+BENCHMARK(run_polyval);
+
+BENCHMARK_MAIN();
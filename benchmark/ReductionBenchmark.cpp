@@ -0,0 +1,99 @@
+#include "Parallel.hpp"
+#include "PerfCounters.hpp"
+#include "Reduction.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+// L2 norm of trace(curvature, inverse_metric) over a 64^3 field, the typical
+// constraint monitor: a serial loop with one running sum, the usual parallel
+// sum with one partial sum per thread (whose result depends on the number of
+// threads) and field_l2_norm, with the default number of threads.
+
+static const size_t N = 64;
+
+struct Data {
+  tensoralgebra::TensorField<2> curvature{N, N, N};
+  tensoralgebra::TensorField<2> inverse_metric{N, N, N};
+
+  Data() {
+    for (size_t p = 0; p < curvature.num_points(); ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          curvature[p][i][j] = std::sin(1e-3 * p + i * j);
+          inverse_metric[p][i][j] = (i == j ? 1. : 0.1) + 1e-7 * p;
+        }
+      }
+    }
+  }
+
+  double constraint(size_t p) const {
+    return tensoralgebra::trace(curvature[p], inverse_metric[p]);
+  }
+};
+
+// trace of two rank 2 tensors, then its square and the sum
+static const size_t FLOPS_PER_POINT = 17 + 2;
+
+static void run_serial(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    double sum = 0.;
+    for (size_t p = 0; p < N * N * N; ++p) {
+      const double value = data.constraint(p);
+      sum += value * value;
+    }
+    benchmark::DoNotOptimize(std::sqrt(sum));
+  }
+  perf_counters.report(state, FLOPS_PER_POINT * N * N * N);
+  state.SetItemsProcessed(state.iterations() * N * N * N);
+}
+
+static void run_per_thread_sums(benchmark::State &state) {
+  Data data;
+  const size_t num_threads = tensoralgebra::default_num_threads();
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    std::vector<double> sums(num_threads, 0.);
+    tensoralgebra::parallel_for(
+        0, num_threads,
+        [&](size_t begin, size_t end) {
+          for (size_t t = begin; t < end; ++t) {
+            for (size_t p = t * N * N * N / num_threads;
+                 p < (t + 1) * N * N * N / num_threads; ++p) {
+              const double value = data.constraint(p);
+              sums[t] += value * value;
+            }
+          }
+        },
+        num_threads);
+    double sum = 0.;
+    for (const double partial : sums) {
+      sum += partial;
+    }
+    benchmark::DoNotOptimize(std::sqrt(sum));
+  }
+  perf_counters.report(state, FLOPS_PER_POINT * N * N * N);
+  state.SetItemsProcessed(state.iterations() * N * N * N);
+}
+
+static void run_field_l2_norm(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(tensoralgebra::field_l2_norm(
+        N * N * N, [&](size_t p) { return data.constraint(p); }));
+  }
+  perf_counters.report(state, FLOPS_PER_POINT * N * N * N);
+  state.SetItemsProcessed(state.iterations() * N * N * N);
+}
+
+BENCHMARK(run_serial);
+BENCHMARK(run_per_thread_sums);
+BENCHMARK(run_field_l2_norm);
+
+BENCHMARK_MAIN();
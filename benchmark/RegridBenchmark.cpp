@@ -0,0 +1,151 @@
+#include "PerfCounters.hpp"
+#include "Regrid.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+// Transfer of a symmetric metric-like field between a 35^3 coarse box and a
+// 64^3 fine box on one thread: cubic prolongation and full weighting
+// restriction, written as scalar loops over points and components as in
+// regridding code outside the library, and with prolong_field and
+// restrict_field (with and without the symmetric mode).
+
+static const size_t COARSE = 35, FINE = 64;
+static const std::array<size_t, 3> OFFSET = {{2, 2, 2}};
+
+struct Data {
+  tensoralgebra::TensorField<2> coarse{COARSE, COARSE, COARSE};
+  tensoralgebra::TensorField<2> fine{FINE, FINE, FINE};
+
+  Data() {
+    for (size_t p = 0; p < coarse.num_points(); ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = i; j < 3; ++j) {
+          coarse[p][i][j] = coarse[p][j][i] =
+              std::sin(1e-3 * p + i + j) + (i == j ? 1. : 0.);
+        }
+      }
+    }
+    tensoralgebra::prolong_field(coarse, fine, OFFSET);
+  }
+};
+
+// The cubic stencil of a fine point in one direction
+static void stencil(size_t fine_index, size_t &first, double weights[4]) {
+  const size_t twice = OFFSET[0] + fine_index;
+  if (twice % 2 == 0) {
+    first = twice / 2 - 1;
+    weights[0] = weights[2] = weights[3] = 0.;
+    weights[1] = 1.;
+  } else {
+    first = twice / 2 - 1;
+    weights[0] = weights[3] = -1. / 16.;
+    weights[1] = weights[2] = 9. / 16.;
+  }
+}
+
+static void run_scalar_prolongation(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    for (size_t k = 0; k < FINE; ++k) {
+      for (size_t j = 0; j < FINE; ++j) {
+        for (size_t i = 0; i < FINE; ++i) {
+          size_t first[3];
+          double weights[3][4];
+          stencil(i, first[0], weights[0]);
+          stencil(j, first[1], weights[1]);
+          stencil(k, first[2], weights[2]);
+          for (size_t a = 0; a < 3; ++a) {
+            for (size_t b = 0; b < 3; ++b) {
+              double sum = 0.;
+              for (size_t n = 0; n < 4; ++n) {
+                for (size_t m = 0; m < 4; ++m) {
+                  for (size_t l = 0; l < 4; ++l) {
+                    sum += weights[0][l] * weights[1][m] * weights[2][n] *
+                           data.coarse(first[0] + l, first[1] + m,
+                                       first[2] + n)[a][b];
+                  }
+                }
+              }
+              data.fine(i, j, k)[a][b] = sum;
+            }
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(data.fine.components());
+  }
+  perf_counters.report(state);
+  state.SetItemsProcessed(state.iterations() * data.fine.num_points());
+}
+
+static void run_prolong_field(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    tensoralgebra::prolong_field(data.coarse, data.fine, OFFSET,
+                                 state.range(0));
+    benchmark::DoNotOptimize(data.fine.components());
+  }
+  perf_counters.report(state);
+  state.SetItemsProcessed(state.iterations() * data.fine.num_points());
+}
+
+static void run_scalar_restriction(benchmark::State &state) {
+  Data data;
+  const double weights[3] = {0.25, 0.5, 0.25};
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    // The coarse points covered by the fine box, except at its edges
+    for (size_t k = 2; k <= FINE / 2; ++k) {
+      for (size_t j = 2; j <= FINE / 2; ++j) {
+        for (size_t i = 2; i <= FINE / 2; ++i) {
+          for (size_t a = 0; a < 3; ++a) {
+            for (size_t b = 0; b < 3; ++b) {
+              double sum = 0.;
+              for (size_t n = 0; n < 3; ++n) {
+                for (size_t m = 0; m < 3; ++m) {
+                  for (size_t l = 0; l < 3; ++l) {
+                    sum += weights[l] * weights[m] * weights[n] *
+                           data.fine(2 * i - 3 + l, 2 * j - 3 + m,
+                                     2 * k - 3 + n)[a][b];
+                  }
+                }
+              }
+              data.coarse(i, j, k)[a][b] = sum;
+            }
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(data.coarse.components());
+  }
+  perf_counters.report(state);
+  state.SetItemsProcessed(state.iterations() * (FINE / 2 - 1) *
+                          (FINE / 2 - 1) * (FINE / 2 - 1));
+}
+
+static void run_restrict_field(benchmark::State &state) {
+  Data data;
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    tensoralgebra::restrict_field(data.fine, data.coarse, OFFSET,
+                                  tensoralgebra::Restriction::full_weighting,
+                                  state.range(0));
+    benchmark::DoNotOptimize(data.coarse.components());
+  }
+  perf_counters.report(state);
+  state.SetItemsProcessed(state.iterations() * (FINE / 2) * (FINE / 2) *
+                          (FINE / 2));
+}
+
+BENCHMARK(run_scalar_prolongation);
+// The argument is whether the symmetric mode is used
+BENCHMARK(run_prolong_field)->Arg(0)->Arg(1);
+BENCHMARK(run_scalar_restriction);
+BENCHMARK(run_restrict_field)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
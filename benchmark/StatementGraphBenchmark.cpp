@@ -0,0 +1,146 @@
+#include "PerfCounters.hpp"
+#include "StatementGraph.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include <benchmark/benchmark.h>
+
+// A chain of dependent statements like those of a time step (inverse metric,
+// Christoffel symbols, the quadratic terms of the Ricci tensor, a right hand
+// side), executed statement by statement over the whole grid and fused tile by
+// tile. Only the metric, its derivatives, the extrinsic curvature and the
+// right hand side are fields; everything else is an intermediate, which is
+// materialised for the whole grid without fusion.
+
+static const size_t NUM_POINTS = 32 * 32 * 32;
+
+using Tensor2 = tensoralgebra::Tensor<2, double, 3>;
+using Tensor3 = tensoralgebra::Tensor<3, double, 3>;
+
+static Tensor2 inverse_of(const Tensor2 &m) {
+  Tensor2 inverse;
+  inverse[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  inverse[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+  inverse[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+  inverse[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  inverse[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+  inverse[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+  inverse[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  inverse[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+  inverse[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+  const double determinant =
+      m[0][0] * inverse[0][0] + m[0][1] * inverse[1][0] +
+      m[0][2] * inverse[2][0];
+  return Tensor2(inverse / determinant);
+}
+
+// Gamma_kij = (d_i g_kj + d_j g_ki - d_k g_ij) / 2 from d[k][i][j] = d_k g_ij
+static Tensor3 christoffel_first_kind(const Tensor3 &d) {
+  Tensor3 gamma;
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        gamma[k][i][j] = 0.5 * (d[i][k][j] + d[j][k][i] - d[k][i][j]);
+      }
+    }
+  }
+  return gamma;
+}
+
+// Gamma^k_ij Gamma^l_kl - Gamma^l_ik Gamma^k_jl
+static Tensor2 ricci_quadratic(const Tensor3 &gamma) {
+  Tensor2 ricci;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      double sum = 0.;
+      for (size_t k = 0; k < 3; ++k) {
+        for (size_t l = 0; l < 3; ++l) {
+          sum += gamma[k][i][j] * gamma[l][k][l] -
+                 gamma[l][i][k] * gamma[k][j][l];
+        }
+      }
+      ricci[i][j] = sum;
+    }
+  }
+  return ricci;
+}
+
+struct TimeStep {
+  tensoralgebra::TensorField<2> metric{NUM_POINTS};
+  tensoralgebra::TensorField<3> metric_derivatives{NUM_POINTS};
+  tensoralgebra::TensorField<2> curvature{NUM_POINTS};
+  tensoralgebra::TensorField<2> rhs{NUM_POINTS};
+  tensoralgebra::StatementGraph graph{NUM_POINTS};
+
+  TimeStep() {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          metric[p][i][j] = (i == j ? 1. + 1e-6 * p : 0.01 * (i + j));
+          curvature[p][i][j] = 0.1 * (i + 1) * (j + 1);
+          for (size_t k = 0; k < 3; ++k) {
+            metric_derivatives[p][k][i][j] = 1e-3 * (i + j + k + 1);
+          }
+        }
+      }
+    }
+
+    using tensoralgebra::reads;
+    auto &inverse = graph.intermediate<2>();
+    auto &first_kind = graph.intermediate<3>();
+    auto &christoffel = graph.intermediate<3>();
+    auto &ricci = graph.intermediate<2>();
+    graph.assign(inverse, {reads(metric)},
+                 [this](size_t p) { return inverse_of(metric[p]); });
+    graph.assign(first_kind, {reads(metric_derivatives)}, [this](size_t p) {
+      return christoffel_first_kind(metric_derivatives[p]);
+    });
+    graph.assign(christoffel, {reads(inverse), reads(first_kind)},
+                 [&](size_t p) {
+                   return tensoralgebra::dot(inverse[p], first_kind[p]);
+                 });
+    graph.assign(ricci, {reads(christoffel)},
+                 [&](size_t p) { return ricci_quadratic(christoffel[p]); });
+    graph.assign(rhs, {reads(ricci), reads(inverse), reads(curvature)},
+                 [&](size_t p) {
+                   return ricci[p] -
+                          2. * tensoralgebra::dot(curvature[p],
+                                                  tensoralgebra::dot(
+                                                      inverse[p],
+                                                      curvature[p])) +
+                          tensoralgebra::trace(curvature[p], inverse[p]) *
+                              curvature[p];
+                 });
+  }
+};
+
+static void run_unfused(benchmark::State &state) {
+  TimeStep step;
+  step.graph.set_tile_points(NUM_POINTS);
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    step.graph.run(1);
+    benchmark::DoNotOptimize(step.rhs.data());
+  }
+  perf_counters.report(state);
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+static void run_fused(benchmark::State &state) {
+  TimeStep step;
+  step.graph.set_tile_points(state.range(0));
+  tensoralgebra::PerfCounters perf_counters;
+  while (state.KeepRunning()) {
+    step.graph.run(1);
+    benchmark::DoNotOptimize(step.rhs.data());
+  }
+  perf_counters.report(state);
+  state.counters["tile_points"] = step.graph.stages()[0].tile_points;
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+BENCHMARK(run_unfused);
+// 0 chooses the tile size from the cache size
+BENCHMARK(run_fused)->Arg(0)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+#include "SymmetricEigen.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+// Eigenvalues and eigensystems of one symmetric 3x3 tensor per grid point.
+
+static const size_t NUM_POINTS = 4096;
+
+struct SymmetricTensors {
+  tensoralgebra::TensorField<2, double, 3> matrices{NUM_POINTS};
+  tensoralgebra::TensorField<1, double, 3> values{NUM_POINTS};
+  tensoralgebra::TensorField<2, double, 3> vectors{NUM_POINTS};
+
+  SymmetricTensors() {
+    for (size_t p = 0; p < NUM_POINTS; ++p) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = i; j < 3; ++j) {
+          matrices[p][i][j] = std::sin(1. + p + 3. * i + j);
+          matrices[p][j][i] = matrices[p][i][j];
+        }
+      }
+    }
+  }
+};
+
+static void run_eigenvalues(benchmark::State &state) {
+  SymmetricTensors tensors;
+  while (state.KeepRunning()) {
+    tensoralgebra::eigenvalues(tensors.matrices, tensors.values);
+    benchmark::DoNotOptimize(tensors.values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+static void run_eigensystem(benchmark::State &state) {
+  SymmetricTensors tensors;
+  while (state.KeepRunning()) {
+    tensoralgebra::eigensystem(tensors.matrices, tensors.values,
+                               tensors.vectors);
+    benchmark::DoNotOptimize(tensors.vectors.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+
+BENCHMARK(run_eigenvalues);
+BENCHMARK(run_eigensystem);
+
+BENCHMARK_MAIN();
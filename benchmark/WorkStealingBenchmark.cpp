@@ -0,0 +1,84 @@
+#include "Parallel.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "WorkStealing.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Evaluating an expression over the boxes of an adaptive mesh level, whose
+// sizes range from 4^3 to 32^3 points: boxes split statically between the
+// threads with parallel_for, and scheduled with work stealing.
+
+struct Level {
+  std::vector<tensoralgebra::TensorField<2>> metrics;
+  std::vector<tensoralgebra::TensorField<2>> curvatures;
+  std::vector<tensoralgebra::TensorField<2>> results;
+  size_t num_points = 0;
+
+  Level() {
+    // A few large boxes among many small ones, in no particular order
+    for (size_t box = 0; box < 200; ++box) {
+      const size_t n = ((box * 37) % 23 == 0 ? 32 : 4 + (box * 7) % 9);
+      metrics.emplace_back(n, n, n);
+      curvatures.emplace_back(n, n, n);
+      results.emplace_back(n, n, n);
+      num_points += n * n * n;
+      for (size_t p = 0; p < metrics.back().num_points(); ++p) {
+        for (size_t i = 0; i < 3; ++i) {
+          for (size_t j = 0; j < 3; ++j) {
+            metrics.back()[p][i][j] = (i == j ? 1. : 0.1);
+            curvatures.back()[p][i][j] = 1e-3 * (p + i + j);
+          }
+        }
+      }
+    }
+  }
+
+  tensoralgebra::Tensor<2> evaluate(size_t box, size_t p) const {
+    return tensoralgebra::dot(curvatures[box][p],
+                              tensoralgebra::dot(metrics[box][p],
+                                                 curvatures[box][p])) -
+           tensoralgebra::trace(curvatures[box][p], metrics[box][p]) *
+               curvatures[box][p];
+  }
+};
+
+static void run_static(benchmark::State &state) {
+  Level level;
+  while (state.KeepRunning()) {
+    tensoralgebra::parallel_for(
+        0, level.results.size(), [&](size_t box_begin, size_t box_end) {
+          for (size_t box = box_begin; box < box_end; ++box) {
+            level.results[box].assign(
+                [&](size_t p) { return level.evaluate(box, p); });
+          }
+        });
+    benchmark::DoNotOptimize(level.results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * level.num_points);
+}
+
+static void run_work_stealing(benchmark::State &state) {
+  Level level;
+  tensoralgebra::WorkStealingScheduler scheduler(
+      tensoralgebra::default_num_threads(), state.range(0));
+  double steals = 0., idle_fraction = 0.;
+  while (state.KeepRunning()) {
+    scheduler.assign(level.results, [&](size_t box, size_t p) {
+      return level.evaluate(box, p);
+    });
+    benchmark::DoNotOptimize(level.results.data());
+    steals += scheduler.statistics().steals();
+    idle_fraction += scheduler.statistics().idle_fraction();
+  }
+  state.counters["steals"] = steals / state.iterations();
+  state.counters["idle_fraction"] = idle_fraction / state.iterations();
+  state.SetItemsProcessed(state.iterations() * level.num_points);
+}
+
+BENCHMARK(run_static)->UseRealTime();
+// The argument is the minimum number of points per task
+BENCHMARK(run_work_stealing)->Arg(512)->Arg(4096)->UseRealTime();
+
+BENCHMARK_MAIN();
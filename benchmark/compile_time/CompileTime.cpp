@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Build time benchmark: compiles a translation unit several times and reports
+// the wall clock time, the CPU time and the peak memory use of the compiler.
+//
+// Usage (from this directory):
+//   g++ -O2 CompileTime.cpp -o compile_time
+//   ./compile_time [repetitions] [compiler command ...]
+// The default command compiles LargeExpressions.cpp with $CXX (or g++) at -O3;
+// the extra flags in $CXXFLAGS are appended to it.
+
+struct Measurement {
+  double wall_seconds;
+  double cpu_seconds;
+  long max_rss_kilobytes;
+};
+
+static bool run(const std::vector<std::string> &command,
+                Measurement &measurement) {
+  std::vector<char *> arguments;
+  for (const auto &argument : command) {
+    arguments.push_back(const_cast<char *>(argument.c_str()));
+  }
+  arguments.push_back(nullptr);
+
+  const auto start = std::chrono::steady_clock::now();
+  const pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    execvp(arguments[0], arguments.data());
+    std::perror(arguments[0]);
+    _exit(127);
+  }
+  int status = 0;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid) {
+    return false;
+  }
+  const auto stop = std::chrono::steady_clock::now();
+
+  measurement.wall_seconds =
+      std::chrono::duration<double>(stop - start).count();
+  measurement.cpu_seconds =
+      usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+      1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  measurement.max_rss_kilobytes = usage.ru_maxrss; // kilobytes on Linux
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static std::vector<std::string> default_command() {
+  const char *compiler = std::getenv("CXX");
+  std::vector<std::string> command = {compiler ? compiler : "g++",
+                                      "-std=c++14",
+                                      "-O3",
+                                      "-I../../include",
+                                      "-c",
+                                      "LargeExpressions.cpp",
+                                      "-o",
+                                      "/dev/null"};
+  if (const char *flags = std::getenv("CXXFLAGS")) {
+    std::string flag;
+    for (const char *c = flags;; ++c) {
+      if (*c == ' ' || *c == '\0') {
+        if (!flag.empty()) {
+          command.push_back(flag);
+        }
+        flag.clear();
+        if (*c == '\0') {
+          break;
+        }
+      } else {
+        flag += *c;
+      }
+    }
+  }
+  return command;
+}
+
+int main(int argc, char **argv) {
+  const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+  std::vector<std::string> command =
+      argc > 2 ? std::vector<std::string>(argv + 2, argv + argc)
+               : default_command();
+
+  std::printf("Command:");
+  for (const auto &argument : command) {
+    std::printf(" %s", argument.c_str());
+  }
+  std::printf("\n%10s %10s %14s\n", "wall [s]", "cpu [s]", "max RSS [MB]");
+
+  std::vector<Measurement> measurements;
+  for (int repetition = 0; repetition < repetitions; ++repetition) {
+    Measurement measurement;
+    if (!run(command, measurement)) {
+      std::fprintf(stderr, "Compilation failed.\n");
+      return 1;
+    }
+    std::printf("%10.2f %10.2f %14.1f\n", measurement.wall_seconds,
+                measurement.cpu_seconds,
+                measurement.max_rss_kilobytes / 1024.);
+    measurements.push_back(measurement);
+  }
+
+  // The minimum is the least noisy estimate of the cost of compilation
+  auto fastest = std::min_element(
+      measurements.begin(), measurements.end(),
+      [](const Measurement &m1, const Measurement &m2) {
+        return m1.wall_seconds < m2.wall_seconds;
+      });
+  std::printf("min: %.2f s wall, %.2f s cpu, %.1f MB\n", fastest->wall_seconds,
+              fastest->cpu_seconds, fastest->max_rss_kilobytes / 1024.);
+  return 0;
+}
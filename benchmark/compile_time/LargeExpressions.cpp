@@ -0,0 +1,95 @@
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+
+// A translation unit with right hand sides of the size found in numerical
+// relativity codes (Christoffel symbols, Ricci tensor, a long source term),
+// instantiated for several sizes and element types. It is only compiled (by
+// CompileTime.cpp) to measure how expensive the expression templates are for
+// the compiler; running it does nothing useful.
+
+namespace {
+
+template <typename T, size_t Size> struct RightHandSide {
+  using Scalar = T;
+  using Vector = tensoralgebra::Tensor<1, T, Size>;
+  using Matrix = tensoralgebra::Tensor<2, T, Size>;
+  using Rank3 = tensoralgebra::Tensor<3, T, Size>;
+  using Rank4 = tensoralgebra::Tensor<4, T, Size>;
+
+  Matrix metric, inverse_metric, extrinsic_curvature, matrix;
+  Vector shift, vector;
+  Rank3 d_metric;
+  Rank4 dd_metric;
+
+  // Christoffel symbols of the first kind from the metric derivatives
+  Rank3 christoffel() const {
+    Rank3 result;
+    for (size_t i = 0; i < Size; ++i) {
+      for (size_t j = 0; j < Size; ++j) {
+        for (size_t k = 0; k < Size; ++k) {
+          result[i][j][k] = 0.5 * (d_metric[j][i][k] + d_metric[k][i][j] -
+                                   d_metric[i][j][k]);
+        }
+      }
+    }
+    return tensoralgebra::dot(inverse_metric, result);
+  }
+
+  Matrix ricci(const Rank3 &chris) const {
+    const Matrix dd_metric_01 = dd_metric[0][1];
+    Matrix result = 0.5 * tensoralgebra::dot(
+                              tensoralgebra::dot(inverse_metric, dd_metric_01),
+                              metric) -
+                    tensoralgebra::dot(tensoralgebra::dot(chris[0], metric),
+                                       tensoralgebra::dot(metric, chris[1])) +
+                    tensoralgebra::dot(chris[2], chris[1]) -
+                    tensoralgebra::outer(vector, shift) / trace(metric);
+    return result;
+  }
+
+  Matrix extrinsic_curvature_rhs(const Matrix &ricci) const {
+    const Matrix k_dot_k = tensoralgebra::dot(
+        extrinsic_curvature,
+        tensoralgebra::dot(inverse_metric, extrinsic_curvature));
+    Matrix result =
+        -2. * k_dot_k + ricci +
+        trace(extrinsic_curvature, inverse_metric) * extrinsic_curvature -
+        tensoralgebra::outer(shift, vector) * exp(-1. * metric) +
+        sqrt(abs(metric)) * sin(extrinsic_curvature) / (1. + cos(matrix)) -
+        tensoralgebra::dot(matrix, tensoralgebra::outer(shift, shift)) +
+        tanh(ricci) * log(1. + metric * metric) -
+        tensoralgebra::dot(metric, extrinsic_curvature, inverse_metric);
+    return result;
+  }
+
+  Rank4 riemann_like(const Rank3 &chris) const {
+    Rank4 result =
+        tensoralgebra::outer(chris, vector) -
+        tensoralgebra::outer(vector, chris) +
+        tensoralgebra::outer(metric, extrinsic_curvature) -
+        tensoralgebra::outer(extrinsic_curvature, metric) +
+        tensoralgebra::dot(dd_metric, inverse_metric) * 0.25 +
+        tensoralgebra::outer(tensoralgebra::dot(chris, shift),
+                             tensoralgebra::dot(matrix, matrix));
+    return result;
+  }
+
+  Scalar evaluate() const {
+    const Rank3 chris = christoffel();
+    const Matrix ricci_tensor = ricci(chris);
+    const Matrix k_rhs = extrinsic_curvature_rhs(ricci_tensor);
+    const Rank4 riemann = riemann_like(chris);
+    return trace(k_rhs) + riemann[0][0][0][0];
+  }
+};
+
+} // namespace
+
+int main() {
+  double result = 0.;
+  result += RightHandSide<double, 3>().evaluate();
+  result += RightHandSide<double, 4>().evaluate();
+  result += RightHandSide<float, 3>().evaluate();
+  result += RightHandSide<float, 4>().evaluate();
+  return result > 0.;
+}
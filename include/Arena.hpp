@@ -0,0 +1,178 @@
+#ifndef _TENSORALGEBRA_ARENA_HPP
+#define _TENSORALGEBRA_ARENA_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// This file defines an arena (bump) allocator for short-lived tensors and
+// fields, e.g. the intermediate results materialised for each box of a grid.
+// Allocation just advances a pointer, deallocation is a no-op, and reset()
+// makes all the memory available again in O(1) without returning it to the
+// system, so after the first box or time step no more calls to malloc are
+// made.
+
+namespace tensoralgebra {
+
+/// Statistics of an Arena
+struct ArenaStatistics {
+  size_t bytes_in_use = 0;    // bytes handed out since the last reset
+  size_t high_water_mark = 0; // maximum of bytes_in_use over the lifetime
+  size_t bytes_reserved = 0;  // total size of the blocks owned by the arena
+  size_t num_allocations = 0; // allocations over the lifetime
+  size_t num_blocks = 0;      // number of blocks owned by the arena
+  size_t num_resets = 0;      // calls to reset() over the lifetime
+};
+
+/// Bump allocator handing out memory from a list of large blocks
+/** Not thread safe: use one arena per thread (see thread_arena()). Objects
+ * placed in an arena are never destroyed, so only trivially destructible types
+ * can be constructed with construct(). */
+class Arena {
+  struct Block {
+    std::unique_ptr<char[]> memory;
+    size_t size;
+  };
+
+  std::vector<Block> m_blocks;
+  size_t m_block_size;
+  size_t m_current_block = 0;
+  size_t m_offset = 0; // into the current block
+  ArenaStatistics m_statistics;
+
+  static size_t align_up(uintptr_t address, size_t alignment) {
+    return (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  }
+
+  // Returns the aligned address in the current block, or nullptr if the
+  // allocation does not fit
+  void *try_allocate(size_t bytes, size_t alignment) {
+    if (m_current_block == m_blocks.size()) {
+      return nullptr;
+    }
+    Block &block = m_blocks[m_current_block];
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(block.memory.get());
+    const uintptr_t aligned = align_up(begin + m_offset, alignment);
+    if (aligned + bytes > begin + block.size) {
+      return nullptr;
+    }
+    m_offset = aligned + bytes - begin;
+    return reinterpret_cast<void *>(aligned);
+  }
+
+public:
+  /// Memory is requested from the system in blocks of (at least) block_size
+  explicit Arena(size_t block_size = size_t(1) << 20)
+      : m_block_size(block_size) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    void *pointer = try_allocate(bytes, alignment);
+    // Move on to the next block (reused after a reset, or a new one)
+    while (!pointer) {
+      if (m_current_block < m_blocks.size()) {
+        ++m_current_block;
+        m_offset = 0;
+      }
+      if (m_current_block == m_blocks.size()) {
+        const size_t size = std::max(m_block_size, bytes + alignment);
+        m_blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        m_statistics.bytes_reserved += size;
+        m_statistics.num_blocks = m_blocks.size();
+      }
+      pointer = try_allocate(bytes, alignment);
+    }
+    m_statistics.bytes_in_use += bytes;
+    m_statistics.high_water_mark =
+        std::max(m_statistics.high_water_mark, m_statistics.bytes_in_use);
+    ++m_statistics.num_allocations;
+    return pointer;
+  }
+
+  /// Memory is only reclaimed by reset()
+  void deallocate(void *, size_t) noexcept {}
+
+  /// Constructs an object (e.g. a Tensor evaluated from an expression) in the
+  /// arena
+  template <typename T, typename... Args> T *construct(Args &&... args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Objects in an arena are never destroyed.");
+    return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  /// Makes all memory available again; keeps the blocks for reuse
+  /** Everything allocated from the arena before is invalidated. */
+  void reset() {
+    m_current_block = 0;
+    m_offset = 0;
+    m_statistics.bytes_in_use = 0;
+    ++m_statistics.num_resets;
+  }
+
+  /// Returns all blocks to the system
+  void release() {
+    reset();
+    m_blocks.clear();
+    m_statistics.bytes_reserved = 0;
+    m_statistics.num_blocks = 0;
+  }
+
+  const ArenaStatistics &statistics() const { return m_statistics; }
+};
+
+/// The arena of the calling thread
+/** Each thread has its own arena, so threads never contend for memory. */
+inline Arena &thread_arena() {
+  thread_local Arena arena;
+  return arena;
+}
+
+/// Standard allocator interface to an Arena, e.g. for std::vector
+/** A default constructed allocator uses the arena of the constructing thread.
+ */
+template <typename T> class ArenaAllocator {
+  Arena *m_arena;
+
+  template <typename U> friend class ArenaAllocator;
+
+public:
+  using value_type = T;
+
+  ArenaAllocator() : m_arena(&thread_arena()) {}
+  ArenaAllocator(Arena &arena) : m_arena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.m_arena) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, size_t) noexcept {}
+
+  Arena &arena() const { return *m_arena; }
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &other) const {
+    return m_arena == other.m_arena;
+  }
+  template <typename U> bool operator!=(const ArenaAllocator<U> &other) const {
+    return m_arena != other.m_arena;
+  }
+};
+
+/// A TensorField whose storage is drawn from an Arena
+template <size_t Rank, typename T = double, size_t Size = 3>
+using ArenaTensorField =
+    TensorField<Rank, T, Size, ArenaAllocator<Tensor<Rank, T, Size>>>;
+
+} // namespace tensoralgebra
+
+#endif
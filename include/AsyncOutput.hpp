@@ -0,0 +1,207 @@
+#ifndef _TENSORALGEBRA_ASYNCOUTPUT_HPP
+#define _TENSORALGEBRA_ASYNCOUTPUT_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tensoralgebra {
+
+/// Statistics of an AsyncFieldWriter
+struct AsyncOutputStatistics {
+  size_t snapshots = 0;      // number of snapshots submitted
+  size_t stalls = 0;         // number of submissions waiting for a buffer
+  double stall_seconds = 0.; // time spent waiting for a free buffer
+  double copy_seconds = 0.;  // time spent copying snapshots into buffers
+  double write_seconds = 0.; // time spent in the sink on the writer thread
+};
+
+/// Overlaps writing tensor fields with computation
+/** submit() copies a snapshot of a field into one of a fixed pool of
+ * preallocated buffers and returns immediately; a background thread passes the
+ * buffers to the sink (e.g. a function writing a checkpoint) and then returns
+ * them to the pool. If all buffers are in use, submit() blocks until one is
+ * free (back-pressure); the time spent waiting is recorded in the statistics.
+ * With the default of two buffers the evaluation thread can fill one buffer
+ * while the other is being written.
+ * Exceptions thrown by the sink are rethrown by the next call to submit() or
+ * flush(). The destructor cannot throw, so call flush() before destroying the
+ * writer to see errors from the last snapshots; the destructor drops them.
+ */
+template <size_t Rank, typename T = double, size_t Size = 3>
+class AsyncFieldWriter {
+public:
+  using TensorType = Tensor<Rank, T, Size>;
+  /// Called on the writer thread with the contents of a snapshot and the tag
+  /// given to submit()
+  using Sink = std::function<void(const TensorType *tensors, size_t num_points,
+                                  size_t tag)>;
+
+private:
+  struct Snapshot {
+    size_t buffer;
+    size_t num_points;
+    size_t tag;
+  };
+
+  using clock = std::chrono::steady_clock;
+
+  Sink m_sink;
+  std::vector<std::vector<TensorType>> m_buffers;
+  std::vector<size_t> m_free_buffers;
+  std::deque<Snapshot> m_pending;
+  bool m_writing = false;
+  bool m_stop = false;
+  std::exception_ptr m_error;
+  AsyncOutputStatistics m_statistics;
+
+  std::mutex m_mutex;
+  std::condition_variable m_buffer_freed;
+  std::condition_variable m_snapshot_submitted;
+  std::thread m_writer;
+
+  static double seconds_since(clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  // Must be called with the mutex held
+  void rethrow_error() {
+    if (m_error) {
+      std::exception_ptr error = m_error;
+      m_error = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  void write_loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      m_snapshot_submitted.wait(
+          lock, [this] { return m_stop || !m_pending.empty(); });
+      if (m_pending.empty()) {
+        return; // Only stop once everything has been written
+      }
+      const Snapshot snapshot = m_pending.front();
+      m_pending.pop_front();
+      m_writing = true;
+      lock.unlock();
+
+      const auto start = clock::now();
+      std::exception_ptr error;
+      try {
+        m_sink(m_buffers[snapshot.buffer].data(), snapshot.num_points,
+               snapshot.tag);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      const double write_seconds = seconds_since(start);
+
+      lock.lock();
+      m_statistics.write_seconds += write_seconds;
+      if (error && !m_error) {
+        m_error = error;
+      }
+      m_writing = false;
+      m_free_buffers.push_back(snapshot.buffer);
+      m_buffer_freed.notify_all();
+    }
+  }
+
+public:
+  /// Creates num_buffers buffers of buffer_points tensors each and starts the
+  /// writer thread
+  AsyncFieldWriter(Sink sink, size_t buffer_points, size_t num_buffers = 2)
+      : m_sink(std::move(sink)),
+        m_buffers(num_buffers, std::vector<TensorType>(buffer_points)) {
+    if (num_buffers == 0) {
+      throw std::invalid_argument("AsyncFieldWriter needs at least one buffer");
+    }
+    for (size_t i = 0; i < num_buffers; ++i) {
+      m_free_buffers.push_back(num_buffers - 1 - i);
+    }
+    m_writer = std::thread(&AsyncFieldWriter::write_loop, this);
+  }
+
+  AsyncFieldWriter(const AsyncFieldWriter &) = delete;
+  AsyncFieldWriter &operator=(const AsyncFieldWriter &) = delete;
+
+  /// Writes all outstanding snapshots before returning
+  /** Errors thrown by the sink which have not been rethrown yet are discarded;
+   * call flush() first to receive them. */
+  ~AsyncFieldWriter() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_snapshot_submitted.notify_all();
+    m_writer.join();
+  }
+
+  /// Copies num_points tensors into a free buffer and queues them for writing
+  void submit(const TensorType *tensors, size_t num_points, size_t tag = 0) {
+    if (num_points > m_buffers.front().size()) {
+      throw std::invalid_argument("Snapshot larger than the output buffers");
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    rethrow_error();
+    if (m_free_buffers.empty()) {
+      // Counted before waiting, so the stall can be observed while it lasts
+      ++m_statistics.stalls;
+      const auto start = clock::now();
+      m_buffer_freed.wait(lock, [this] { return !m_free_buffers.empty(); });
+      m_statistics.stall_seconds += seconds_since(start);
+    }
+    const size_t buffer = m_free_buffers.back();
+    m_free_buffers.pop_back();
+    lock.unlock();
+
+    // Only this thread touches a buffer between taking it and queueing it
+    const auto start = clock::now();
+    std::copy(tensors, tensors + num_points, m_buffers[buffer].begin());
+    const double copy_seconds = seconds_since(start);
+
+    lock.lock();
+    ++m_statistics.snapshots;
+    m_statistics.copy_seconds += copy_seconds;
+    m_pending.push_back({buffer, num_points, tag});
+    lock.unlock();
+    m_snapshot_submitted.notify_one();
+  }
+
+  template <typename Allocator>
+  void submit(const TensorField<Rank, T, Size, Allocator> &field,
+              size_t tag = 0) {
+    submit(field.data(), field.num_points(), tag);
+  }
+
+  /// Blocks until all submitted snapshots have been written
+  void flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_buffer_freed.wait(
+        lock, [this] { return m_pending.empty() && !m_writing; });
+    rethrow_error();
+  }
+
+  AsyncOutputStatistics statistics() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+  }
+
+  size_t num_buffers() const { return m_buffers.size(); }
+  size_t buffer_points() const { return m_buffers.front().size(); }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef _TENSORALGEBRA_BITTENSOR_HPP
+#define _TENSORALGEBRA_BITTENSOR_HPP
+
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// This file defines packed boolean tensors and fields, e.g. to keep the results
+// of relational expressions as masks. Tensor<Rank, bool, Size> needs a byte per
+// component; a BitTensor stores one bit per component in 64 bit words, and a
+// BitField stores the bits of all points of a box contiguously. Masks are
+// combined with &, |, ^ and ~ and summarised with count, any, all and none, a
+// word (64 components) at a time. assign_where evaluates an expression only
+// where a mask is set:
+//
+//   tensoralgebra::BitField<0> excised(nx, ny, nz);
+//   excised.assign([&](size_t p) { return lapse[p] < 0.1; });
+//   tensoralgebra::assign_where(metric, ~excised, [&](size_t p) {
+//     return metric[p] + dt * rhs[p];
+//   });
+//
+// Components are numbered in row-major order, as in Tensor. Bits beyond the
+// last component of the last word are always zero.
+
+namespace tensoralgebra {
+
+namespace bit_tensor_detail {
+constexpr size_t num_words(size_t num_bits) { return (num_bits + 63) / 64; }
+
+inline size_t popcount(uint64_t word) { return __builtin_popcountll(word); }
+
+// Calls function(row, offset) for each row (rank one subexpression) of
+// expression, where offset is the flat index of the row's first component
+template <typename T1, size_t Size, typename Function>
+void for_each_row(const TensorExpression<1, T1, Size> &row, size_t offset,
+                  Function &&function) {
+  function(row, offset);
+}
+
+template <size_t Rank, typename T1, size_t Size, typename Function>
+void for_each_row(const TensorExpression<Rank, T1, Size> &expression,
+                  size_t offset, Function &&function) {
+  for (size_t i = 0; i < Size; ++i) {
+    for_each_row(expression[i], (offset + i) * Size, function);
+  }
+}
+
+template <size_t Size> constexpr size_t flat_index(size_t offset) {
+  return offset;
+}
+
+template <size_t Size, typename... Indices>
+constexpr size_t flat_index(size_t offset, size_t i, Indices... is) {
+  return flat_index<Size>(offset * Size + i, is...);
+}
+} // namespace bit_tensor_detail
+
+/// A tensor of booleans stored as one bit per component
+template <size_t Rank, size_t Size = 3>
+class BitTensor : public TensorExpression<Rank, BitTensor<Rank, Size>, Size> {
+  static_assert(Rank > 0, "Rank zero tensors are forbidden.");
+
+public:
+  static constexpr size_t num_components() {
+    return component_count(Rank, Size);
+  }
+  static constexpr size_t num_words() {
+    return bit_tensor_detail::num_words(num_components());
+  }
+  using Words = std::array<uint64_t, num_words()>;
+
+private:
+  Words m_words;
+
+  // Clears the bits beyond the last component
+  void clear_tail() {
+    if (num_components() % 64 != 0) {
+      m_words.back() &= (uint64_t(1) << num_components() % 64) - 1;
+    }
+  }
+
+public:
+  /// All components false
+  BitTensor() : m_words() {}
+
+  /// All components equal to value
+  explicit BitTensor(bool value) : m_words() {
+    if (value) {
+      m_words.fill(~uint64_t(0));
+      clear_tail();
+    }
+  }
+
+  /// A tensor with the given words (bits beyond the last component are
+  /// ignored)
+  static BitTensor from_words(const Words &words) {
+    BitTensor result;
+    result.m_words = words;
+    result.clear_tail();
+    return result;
+  }
+
+  /// Packs the components of an expression, e.g. tensor > 0.
+  template <typename T1>
+  BitTensor(const TensorExpression<Rank, T1, Size> &expression) : m_words() {
+    bit_tensor_detail::for_each_row(
+        expression, 0, [this](const auto &row, size_t offset) {
+          for (size_t i = 0; i < Size; ++i) {
+            set(offset + i, static_cast<bool>(row.eval(i)));
+          }
+        });
+  }
+
+  static constexpr size_t size() { return Size; }
+  static constexpr size_t rank() { return Rank; }
+
+  /// Component with the given flat (row-major) index
+  bool test(size_t component) const {
+    return (m_words[component / 64] >> (component % 64)) & 1;
+  }
+
+  void set(size_t component, bool value = true) {
+    const uint64_t bit = uint64_t(1) << (component % 64);
+    if (value) {
+      m_words[component / 64] |= bit;
+    } else {
+      m_words[component / 64] &= ~bit;
+    }
+  }
+
+  template <typename... Indices> bool eval(Indices... is) const {
+    static_assert(sizeof...(Indices) == Rank, "One index per rank expected.");
+    return test(bit_tensor_detail::flat_index<Size>(0, is...));
+  }
+
+  const Words &words() const { return m_words; }
+
+  /// Number of true components
+  size_t count() const {
+    size_t total = 0;
+    for (uint64_t word : m_words) {
+      total += bit_tensor_detail::popcount(word);
+    }
+    return total;
+  }
+
+  bool any() const {
+    return std::any_of(m_words.begin(), m_words.end(),
+                       [](uint64_t word) { return word != 0; });
+  }
+  bool all() const { return count() == num_components(); }
+  bool none() const { return !any(); }
+
+  BitTensor &operator&=(const BitTensor &other) {
+    for (size_t w = 0; w < num_words(); ++w) {
+      m_words[w] &= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitTensor &operator|=(const BitTensor &other) {
+    for (size_t w = 0; w < num_words(); ++w) {
+      m_words[w] |= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitTensor &operator^=(const BitTensor &other) {
+    for (size_t w = 0; w < num_words(); ++w) {
+      m_words[w] ^= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitTensor operator~() const {
+    BitTensor result;
+    for (size_t w = 0; w < num_words(); ++w) {
+      result.m_words[w] = ~m_words[w];
+    }
+    result.clear_tail();
+    return result;
+  }
+
+  friend BitTensor operator&(BitTensor a, const BitTensor &b) {
+    return a &= b;
+  }
+  friend BitTensor operator|(BitTensor a, const BitTensor &b) {
+    return a |= b;
+  }
+  friend BitTensor operator^(BitTensor a, const BitTensor &b) {
+    return a ^= b;
+  }
+};
+
+/// Assigns the components of expression to target where mask is true
+/** The other components of target are left unchanged and the corresponding
+ * components of expression are not evaluated. */
+template <size_t Rank, typename T, size_t Size, typename T1>
+void assign_where(Tensor<Rank, T, Size> &target,
+                  const BitTensor<Rank, Size> &mask,
+                  const TensorExpression<Rank, T1, Size> &expression) {
+  static_assert(sizeof(target) == component_count(Rank, Size) * sizeof(T),
+                "Tensor components must be stored without padding.");
+  T *components = reinterpret_cast<T *>(&target);
+  bit_tensor_detail::for_each_row(
+      expression, 0, [&](const auto &row, size_t offset) {
+        for (size_t i = 0; i < Size; ++i) {
+          if (mask.test(offset + i)) {
+            components[offset + i] = row.eval(i);
+          }
+        }
+      });
+}
+
+/// BitField<Rank, Size> stores a BitTensor<Rank, Size> (a single bit for
+/// Rank 0) per point of a box of grid points
+/** The points are numbered as in TensorField. The bits of all points are
+ * stored contiguously, point after point, so operations on whole fields work a
+ * word of 64 bits at a time. */
+template <size_t Rank, size_t Size = 3> class BitField {
+  std::array<size_t, 3> m_extent = {{0, 0, 0}};
+  std::vector<uint64_t> m_words;
+
+  size_t num_bits() const { return num_points() * num_components(); }
+
+  void clear_tail() {
+    if (num_bits() % 64 != 0) {
+      m_words.back() &= (uint64_t(1) << num_bits() % 64) - 1;
+    }
+  }
+
+  // count <= 64 bits starting at bit
+  uint64_t extract(size_t bit, size_t count) const {
+    const size_t shift = bit % 64;
+    uint64_t word = m_words[bit / 64] >> shift;
+    if (shift + count > 64) {
+      word |= m_words[bit / 64 + 1] << (64 - shift);
+    }
+    return count == 64 ? word : word & ((uint64_t(1) << count) - 1);
+  }
+
+  void check_extent(const BitField &other) const {
+    if (other.m_extent != m_extent) {
+      throw std::invalid_argument("BitField: the extents differ");
+    }
+  }
+
+  // Packs the bits produced by point_bits(point, bits) for all points, where
+  // bits is an array of words holding the point's components
+  template <typename PointBits> void pack(PointBits &&point_bits) {
+    constexpr size_t point_words = bit_tensor_detail::num_words(
+        component_count(Rank, Size));
+    std::array<uint64_t, point_words> bits;
+    uint64_t word = 0;
+    size_t shift = 0, w = 0;
+    for (size_t point = 0; point < num_points(); ++point) {
+      point_bits(point, bits);
+      for (size_t b = 0; b < point_words; ++b) {
+        const size_t count =
+            std::min<size_t>(64, num_components() - 64 * b);
+        word |= bits[b] << shift;
+        if (shift + count >= 64) {
+          m_words[w++] = word;
+          word = (shift == 0 ? 0 : bits[b] >> (64 - shift));
+        }
+        shift = (shift + count) % 64;
+      }
+    }
+    if (shift != 0) {
+      m_words[w] = word;
+    }
+  }
+
+public:
+  BitField() = default;
+
+  /// A field of nx * ny * nz points whose components are all false
+  explicit BitField(size_t nx, size_t ny = 1, size_t nz = 1)
+      : m_extent{{nx, ny, nz}},
+        m_words(bit_tensor_detail::num_words(nx * ny * nz *
+                                             component_count(Rank, Size)),
+                0) {}
+
+  explicit BitField(const std::array<size_t, 3> &extent)
+      : BitField(extent[0], extent[1], extent[2]) {}
+
+  static constexpr size_t rank() { return Rank; }
+  static constexpr size_t tensor_size() { return Size; }
+  static constexpr size_t num_components() {
+    return component_count(Rank, Size);
+  }
+
+  size_t num_points() const { return m_extent[0] * m_extent[1] * m_extent[2]; }
+  const std::array<size_t, 3> &extent() const { return m_extent; }
+  const std::vector<uint64_t> &words() const { return m_words; }
+
+  /// Component (flat index) of the tensor at point
+  bool test(size_t point, size_t component = 0) const {
+    const size_t bit = point * num_components() + component;
+    return (m_words[bit / 64] >> (bit % 64)) & 1;
+  }
+
+  void set(size_t point, size_t component = 0, bool value = true) {
+    const size_t bit = point * num_components() + component;
+    const uint64_t mask = uint64_t(1) << (bit % 64);
+    if (value) {
+      m_words[bit / 64] |= mask;
+    } else {
+      m_words[bit / 64] &= ~mask;
+    }
+  }
+
+  /// The tensor at point
+  template <size_t R = Rank>
+  std::enable_if_t<(R > 0), BitTensor<Rank, Size>>
+  operator[](size_t point) const {
+    typename BitTensor<Rank, Size>::Words words;
+    for (size_t b = 0; b < words.size(); ++b) {
+      words[b] = extract(point * num_components() + 64 * b,
+                         std::min<size_t>(64, num_components() - 64 * b));
+    }
+    return BitTensor<Rank, Size>::from_words(words);
+  }
+
+  /// Packs point_expression(point) for all points
+  /** point_expression returns a relational expression of rank Rank (or
+   * anything convertible to bool for Rank 0); the bits are stored a word at a
+   * time. */
+  template <typename F, size_t R = Rank>
+  std::enable_if_t<R == 0> assign(F &&point_expression) {
+    pack([&](size_t point, std::array<uint64_t, 1> &bits) {
+      bits[0] = static_cast<bool>(point_expression(point));
+    });
+  }
+
+  template <typename F, size_t R = Rank>
+  std::enable_if_t<(R > 0)> assign(F &&point_expression) {
+    pack([&](size_t point, auto &bits) {
+      bits = BitTensor<Rank, Size>(point_expression(point)).words();
+    });
+  }
+
+  /// Number of true components over all points
+  size_t count() const {
+    size_t total = 0;
+    for (uint64_t word : m_words) {
+      total += bit_tensor_detail::popcount(word);
+    }
+    return total;
+  }
+
+  bool any() const {
+    return std::any_of(m_words.begin(), m_words.end(),
+                       [](uint64_t word) { return word != 0; });
+  }
+  bool all() const { return count() == num_bits(); }
+  bool none() const { return !any(); }
+
+  BitField &operator&=(const BitField &other) {
+    check_extent(other);
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      m_words[w] &= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitField &operator|=(const BitField &other) {
+    check_extent(other);
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      m_words[w] |= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitField &operator^=(const BitField &other) {
+    check_extent(other);
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      m_words[w] ^= other.m_words[w];
+    }
+    return *this;
+  }
+
+  BitField operator~() const {
+    BitField result(m_extent);
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      result.m_words[w] = ~m_words[w];
+    }
+    result.clear_tail();
+    return result;
+  }
+
+  friend BitField operator&(BitField a, const BitField &b) {
+    return a &= b;
+  }
+  friend BitField operator|(BitField a, const BitField &b) {
+    return a |= b;
+  }
+  friend BitField operator^(BitField a, const BitField &b) {
+    return a ^= b;
+  }
+
+  /// Calls function(point) for the points whose bit is set (Rank 0 only),
+  /// skipping 64 unset points at a time
+  template <typename Function, size_t R = Rank>
+  std::enable_if_t<R == 0> for_each_set(Function &&function) const {
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      for (uint64_t word = m_words[w]; word != 0; word &= word - 1) {
+        function(64 * w + __builtin_ctzll(word));
+      }
+    }
+  }
+};
+
+/// Assigns point_expression(point) to target at the points where mask is set
+/** point_expression is only evaluated at those points. */
+template <size_t Rank, typename T, size_t Size, typename Allocator,
+          size_t MaskSize, typename F>
+void assign_where(TensorField<Rank, T, Size, Allocator> &target,
+                  const BitField<0, MaskSize> &mask, F &&point_expression) {
+  if (mask.extent() != target.extent()) {
+    throw std::invalid_argument("assign_where: the extents differ");
+  }
+  mask.for_each_set(
+      [&](size_t point) { target[point] = point_expression(point); });
+}
+
+/// Assigns the components of point_expression(point) to target where mask is
+/// true
+/** Only points with at least one true component are evaluated. */
+template <size_t Rank, typename T, size_t Size, typename Allocator,
+          typename F>
+std::enable_if_t<(Rank > 0)>
+assign_where(TensorField<Rank, T, Size, Allocator> &target,
+             const BitField<Rank, Size> &mask, F &&point_expression) {
+  if (mask.extent() != target.extent()) {
+    throw std::invalid_argument("assign_where: the extents differ");
+  }
+  for (size_t point = 0; point < target.num_points(); ++point) {
+    const BitTensor<Rank, Size> bits = mask[point];
+    if (bits.any()) {
+      assign_where(target[point], bits, point_expression(point));
+    }
+  }
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef _TENSORALGEBRA_CHECKPOINT_HPP
+#define _TENSORALGEBRA_CHECKPOINT_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+// This file defines a versioned binary checkpoint format for arrays and fields
+// of tensors. A checkpoint consists of a fixed size header followed by the raw
+// tensor components, exactly as they are laid out in memory. Checkpoints are
+// written with one large sequential write and can be reopened via mmap, in
+// which case the tensors are used in place without copying or parsing.
+
+namespace tensoralgebra {
+
+/// Element types recognised by the checkpoint format
+/** Other trivially copyable types can be checkpointed too; they are stored as
+ * ElementType::other and only their size is checked when reading. */
+enum class ElementType : uint32_t {
+  other = 0,
+  float32 = 1,
+  float64 = 2,
+  int32 = 3,
+  int64 = 4,
+  uint32 = 5,
+  uint64 = 6
+};
+
+template <typename T> struct element_type {
+  static constexpr ElementType value = ElementType::other;
+};
+template <> struct element_type<float> {
+  static constexpr ElementType value = ElementType::float32;
+};
+template <> struct element_type<double> {
+  static constexpr ElementType value = ElementType::float64;
+};
+template <> struct element_type<int32_t> {
+  static constexpr ElementType value = ElementType::int32;
+};
+template <> struct element_type<int64_t> {
+  static constexpr ElementType value = ElementType::int64;
+};
+template <> struct element_type<uint32_t> {
+  static constexpr ElementType value = ElementType::uint32;
+};
+template <> struct element_type<uint64_t> {
+  static constexpr ElementType value = ElementType::uint64;
+};
+
+/// Layout of the payload: the only one currently written is row-major
+/// components within a tensor and points with x running fastest (see
+/// TensorField)
+enum class CheckpointLayout : uint32_t { row_major_x_fastest = 0 };
+
+/// The header at the start of every checkpoint file
+// Padded to 128 bytes so that the payload is suitably aligned for any element
+// type when the file is mapped.
+struct CheckpointHeader {
+  static constexpr uint32_t current_version = 1;
+  static constexpr uint32_t endianness_marker = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t endianness; // endianness_marker in the byte order of the writer
+  uint32_t rank;
+  uint32_t size;
+  uint32_t element_type;
+  uint32_t element_bytes;
+  uint32_t layout;
+  uint32_t reserved;
+  uint64_t extent[3];
+  uint64_t payload_bytes;
+  uint64_t checksum;
+  char padding[48];
+};
+static_assert(sizeof(CheckpointHeader) == 128,
+              "Checkpoint header must be 128 bytes.");
+
+static constexpr char checkpoint_magic[8] = {'T', 'E', 'N', 'S',
+                                             'A', 'L', 'G', '\0'};
+
+/// Fletcher-style checksum over 64 bit words
+// Cheap enough to be computed at memory bandwidth, but (unlike a plain sum)
+// sensitive to the order of the words.
+inline uint64_t checkpoint_checksum(const void *buffer, size_t bytes) {
+  const char *data = static_cast<const char *>(buffer);
+  uint64_t sum = 0;
+  uint64_t sum_of_sums = 0;
+  const size_t num_words = bytes / sizeof(uint64_t);
+  for (size_t i = 0; i < num_words; ++i) {
+    uint64_t word;
+    std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+    sum += word;
+    sum_of_sums += sum;
+  }
+  const size_t tail_bytes = bytes - num_words * sizeof(uint64_t);
+  if (tail_bytes > 0) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + num_words * sizeof(uint64_t), tail_bytes);
+    sum += word;
+    sum_of_sums += sum;
+  }
+  return sum ^ ((sum_of_sums << 32) | (sum_of_sums >> 32));
+}
+
+/// Writes num_points tensors starting at tensors to a checkpoint file
+/** extent describes the box the tensors belong to; for a plain array of
+ * tensors it is {num_points, 1, 1}. Throws std::runtime_error on failure. */
+template <size_t Rank, typename T, size_t Size>
+void write_checkpoint(const std::string &filename,
+                      const Tensor<Rank, T, Size> *tensors, size_t num_points,
+                      const std::array<size_t, 3> &extent) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable element types can be checkpointed.");
+  if (extent[0] * extent[1] * extent[2] != num_points) {
+    throw std::runtime_error("Checkpoint extent does not match the number of "
+                             "points.");
+  }
+
+  CheckpointHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+  header.version = CheckpointHeader::current_version;
+  header.endianness = CheckpointHeader::endianness_marker;
+  header.rank = Rank;
+  header.size = Size;
+  header.element_type = static_cast<uint32_t>(element_type<T>::value);
+  header.element_bytes = sizeof(T);
+  header.layout = static_cast<uint32_t>(CheckpointLayout::row_major_x_fastest);
+  for (size_t dir = 0; dir < 3; ++dir) {
+    header.extent[dir] = extent[dir];
+  }
+  header.payload_bytes = num_points * sizeof(Tensor<Rank, T, Size>);
+  header.checksum = checkpoint_checksum(tensors, header.payload_bytes);
+
+  std::FILE *file = std::fopen(filename.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("Could not open checkpoint " + filename);
+  }
+  // Unbuffered: both writes go straight to the file in one call each
+  std::setvbuf(file, nullptr, _IONBF, 0);
+  bool failed = (std::fwrite(&header, sizeof(header), 1, file) != 1);
+  if (!failed && header.payload_bytes > 0) {
+    failed = (std::fwrite(tensors, header.payload_bytes, 1, file) != 1);
+  }
+  failed |= (std::fclose(file) != 0);
+  if (failed) {
+    throw std::runtime_error("Could not write checkpoint " + filename);
+  }
+}
+
+template <size_t Rank, typename T, size_t Size>
+void write_checkpoint(const std::string &filename,
+                      const Tensor<Rank, T, Size> *tensors,
+                      size_t num_points) {
+  write_checkpoint(filename, tensors, num_points, {{num_points, 1, 1}});
+}
+
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+void write_checkpoint(const std::string &filename,
+                      const TensorField<Rank, T, Size, Allocator> &field) {
+  write_checkpoint(filename, field.data(), field.num_points(), field.extent());
+}
+
+/// Throws if the header does not describe a checkpoint of
+/// Tensor<Rank, T, Size> with the given payload size
+template <size_t Rank, typename T, size_t Size>
+void validate_checkpoint_header(const CheckpointHeader &header,
+                                size_t payload_bytes,
+                                const std::string &filename) {
+  auto fail = [&filename](const std::string &reason) {
+    throw std::runtime_error("Invalid checkpoint " + filename + ": " + reason);
+  };
+  if (std::memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0) {
+    fail("not a tensoralgebra checkpoint");
+  }
+  if (header.endianness != CheckpointHeader::endianness_marker) {
+    fail("written on a machine with different endianness");
+  }
+  if (header.version != CheckpointHeader::current_version) {
+    fail("unsupported version " + std::to_string(header.version));
+  }
+  if (header.rank != Rank || header.size != Size) {
+    fail("rank/size mismatch");
+  }
+  if (header.element_type != static_cast<uint32_t>(element_type<T>::value) ||
+      header.element_bytes != sizeof(T)) {
+    fail("element type mismatch");
+  }
+  if (header.layout !=
+      static_cast<uint32_t>(CheckpointLayout::row_major_x_fastest)) {
+    fail("unsupported layout");
+  }
+  const uint64_t num_points =
+      header.extent[0] * header.extent[1] * header.extent[2];
+  if (header.payload_bytes != payload_bytes ||
+      header.payload_bytes != num_points * sizeof(Tensor<Rank, T, Size>)) {
+    fail("truncated or inconsistent payload");
+  }
+}
+
+/// Read-only, zero-copy view of a checkpoint file mapped into memory
+/** The tensors returned by operator[] live in the mapping, so they can be used
+ * directly in expressions (e.g. 2. * checkpoint[p] + field[p]) without
+ * reading the file first. Pages are only faulted in when they are used,
+ * unless the checksum is verified on construction (the default). */
+template <size_t Rank, typename T = double, size_t Size = 3>
+class MappedCheckpoint {
+public:
+  using TensorType = Tensor<Rank, T, Size>;
+
+private:
+  void *m_mapping = nullptr;
+  size_t m_mapping_bytes = 0;
+  std::array<size_t, 3> m_extent = {{0, 0, 0}};
+  const TensorType *m_data = nullptr;
+
+  void unmap() {
+    if (m_mapping) {
+      munmap(m_mapping, m_mapping_bytes);
+    }
+    m_mapping = nullptr;
+    m_data = nullptr;
+  }
+
+public:
+  explicit MappedCheckpoint(const std::string &filename,
+                            bool verify_checksum = true) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Could not open checkpoint " + filename);
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 ||
+        static_cast<size_t>(file_status.st_size) < sizeof(CheckpointHeader)) {
+      close(fd);
+      throw std::runtime_error("Invalid checkpoint " + filename +
+                               ": file too small");
+    }
+    m_mapping_bytes = file_status.st_size;
+    m_mapping = mmap(nullptr, m_mapping_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid after closing the file
+    if (m_mapping == MAP_FAILED) {
+      m_mapping = nullptr;
+      throw std::runtime_error("Could not map checkpoint " + filename);
+    }
+
+    const char *bytes = static_cast<const char *>(m_mapping);
+    CheckpointHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    const void *payload = bytes + sizeof(CheckpointHeader);
+    try {
+      validate_checkpoint_header<Rank, T, Size>(
+          header, m_mapping_bytes - sizeof(CheckpointHeader), filename);
+      if (verify_checksum &&
+          checkpoint_checksum(payload, header.payload_bytes) !=
+              header.checksum) {
+        throw std::runtime_error("Invalid checkpoint " + filename +
+                                 ": checksum mismatch");
+      }
+    } catch (...) {
+      unmap();
+      throw;
+    }
+    for (size_t dir = 0; dir < 3; ++dir) {
+      m_extent[dir] = header.extent[dir];
+    }
+    m_data = static_cast<const TensorType *>(payload);
+  }
+
+  MappedCheckpoint(const MappedCheckpoint &) = delete;
+  MappedCheckpoint &operator=(const MappedCheckpoint &) = delete;
+
+  MappedCheckpoint(MappedCheckpoint &&other) noexcept
+      : m_mapping(other.m_mapping), m_mapping_bytes(other.m_mapping_bytes),
+        m_extent(other.m_extent), m_data(other.m_data) {
+    other.m_mapping = nullptr;
+    other.m_data = nullptr;
+  }
+
+  MappedCheckpoint &operator=(MappedCheckpoint &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      std::swap(m_mapping, other.m_mapping);
+      std::swap(m_data, other.m_data);
+      m_mapping_bytes = other.m_mapping_bytes;
+      m_extent = other.m_extent;
+    }
+    return *this;
+  }
+
+  ~MappedCheckpoint() { unmap(); }
+
+  size_t num_points() const { return m_extent[0] * m_extent[1] * m_extent[2]; }
+  const std::array<size_t, 3> &extent() const { return m_extent; }
+
+  const TensorType &operator[](size_t point) const { return m_data[point]; }
+  const TensorType &operator()(size_t i, size_t j = 0, size_t k = 0) const {
+    return m_data[(k * m_extent[1] + j) * m_extent[0] + i];
+  }
+
+  const TensorType *data() const { return m_data; }
+  const TensorType *begin() const { return m_data; }
+  const TensorType *end() const { return m_data + num_points(); }
+};
+
+/// Reads a checkpoint into a (mutable) TensorField
+template <size_t Rank, typename T = double, size_t Size = 3>
+TensorField<Rank, T, Size> load_checkpoint(const std::string &filename) {
+  std::FILE *file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    throw std::runtime_error("Could not open checkpoint " + filename);
+  }
+  std::setvbuf(file, nullptr, _IONBF, 0);
+  CheckpointHeader header;
+  bool failed = (std::fread(&header, sizeof(header), 1, file) != 1);
+  TensorField<Rank, T, Size> field;
+  if (!failed) {
+    try {
+      validate_checkpoint_header<Rank, T, Size>(header, header.payload_bytes,
+                                                filename);
+    } catch (...) {
+      std::fclose(file);
+      throw;
+    }
+    field = TensorField<Rank, T, Size>(header.extent[0], header.extent[1],
+                                       header.extent[2]);
+    if (header.payload_bytes > 0) {
+      failed = (std::fread(field.data(), header.payload_bytes, 1, file) != 1);
+    }
+  }
+  std::fclose(file);
+  if (failed) {
+    throw std::runtime_error("Could not read checkpoint " + filename);
+  }
+  if (checkpoint_checksum(field.data(), header.payload_bytes) !=
+      header.checksum) {
+    throw std::runtime_error("Invalid checkpoint " + filename +
+                             ": checksum mismatch");
+  }
+  return field;
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef _TENSORALGEBRA_COMPLEX_HPP
+#define _TENSORALGEBRA_COMPLEX_HPP
+
+#include "ComponentOperations.hpp"
+#include "Dot.hpp"
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TypeChecks.hpp"
+#include <complex>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// This file defines complex tensors whose real and imaginary parts are stored
+// as two separate real tensors, e.g. for Weyl scalars and mode decompositions.
+// A Tensor<Rank, std::complex<double>> interleaves the two parts, so its
+// operations work on pairs of numbers (and complex products and quotients
+// check for infinities and NaNs) rather than on vectors of doubles.
+//
+// A complex expression is a pair of real expressions, one for each part, built
+// from the operands with the usual component wise operations: the product of
+// a and b is (re a * re b - im a * im b, re a * im b + im a * re b). Assigning
+// it to a ComplexTensor evaluates the two parts one after the other, each as
+// a component wise loop over real tensors which the compiler vectorizes.
+// Complex expressions can be combined with each other, with real tensor
+// expressions and with real or std::complex numbers, and support conj, abs,
+// norm, real, imag and dot. They are tensor expressions whose components are
+// std::complex numbers, so they can also be read component by component:
+//
+//   tensoralgebra::ComplexTensor<2> psi4(real_part, imaginary_part);
+//   tensoralgebra::ComplexTensor<2> product = conj(psi4) * psi4 + 2. * metric;
+//   tensoralgebra::ComplexTensor<1> contracted = dot(psi4, vector);
+//   std::complex<double> component = product[0][1];
+
+namespace tensoralgebra {
+
+/// Compile time check whether the template parameter is a std::complex number
+template <typename T> struct is_std_complex : public std::false_type {};
+template <typename T>
+struct is_std_complex<std::complex<T>> : public std::true_type {};
+
+namespace complex_detail {
+/// Operands with real and imaginary parts: complex expressions and numbers
+template <typename T>
+using is_complex_operand =
+    std::integral_constant<bool, is_split_complex<T>::value ||
+                                     is_std_complex<std::decay_t<T>>::value>;
+
+/// Real operands: real tensor expressions and numbers
+template <typename T>
+using is_real_operand = std::integral_constant<
+    bool, (is_tensor_expression<T>::value && !is_split_complex<T>::value) ||
+              std::is_arithmetic<std::decay_t<T>>::value>;
+
+/// An operand used more than once: lvalues are referenced, rvalues copied
+template <typename T>
+using shared_t = std::conditional_t<std::is_lvalue_reference<T>::value, T,
+                                    std::decay_t<T>>;
+
+template <typename T> shared_t<T> share(std::remove_reference_t<T> &t) {
+  return t;
+}
+
+/// The real and imaginary parts of a complex operand, referenced if they are
+/// lvalues of an lvalue operand and copied otherwise
+template <typename T>
+using real_part_t = std::conditional_t<
+    std::is_lvalue_reference<T>::value,
+    decltype(std::declval<T>().real()),
+    std::decay_t<decltype(std::declval<T>().real())>>;
+template <typename T>
+using imag_part_t = std::conditional_t<
+    std::is_lvalue_reference<T>::value,
+    decltype(std::declval<T>().imag()),
+    std::decay_t<decltype(std::declval<T>().imag())>>;
+
+template <typename T> real_part_t<T> real_part(std::remove_reference_t<T> &t) {
+  return t.real();
+}
+template <typename T> imag_part_t<T> imag_part(std::remove_reference_t<T> &t) {
+  return t.imag();
+}
+
+/// -expression
+template <typename T,
+          typename = std::enable_if_t<is_tensor_expression<T>::value>>
+auto negate(T &&expression) {
+  return expression_value_t<T>(-1) * std::forward<T>(expression);
+}
+} // namespace complex_detail
+
+/// A complex tensor expression given by the expressions of its real and
+/// imaginary parts
+template <typename TReal, typename TImag>
+class ComplexExpression
+    : public TensorExpression<std::decay_t<TReal>::rank(),
+                              ComplexExpression<TReal, TImag>,
+                              std::decay_t<TReal>::size()> {
+  static_assert(are_same_rank<TReal, TImag>::value &&
+                    are_same_size<TReal, TImag>::value,
+                "The real and imaginary parts must have the same shape.");
+
+  TReal m_real;
+  TImag m_imag;
+
+public:
+  using SplitComplexType = ComplexExpression;
+
+  ComplexExpression(TReal &&real, TImag &&imag)
+      : m_real(std::forward<TReal>(real)), m_imag(std::forward<TImag>(imag)) {}
+
+  /// The parts, referenced if they are references and copied otherwise
+  TReal real() const { return m_real; }
+  TImag imag() const { return m_imag; }
+
+  template <typename... Indices> auto eval(Indices... js) const {
+    using T = std::common_type_t<expression_value_t<TReal>,
+                                 expression_value_t<TImag>>;
+    return std::complex<T>(m_real.eval(js...), m_imag.eval(js...));
+  }
+};
+
+/// The complex expression with the given real and imaginary parts, or the
+/// complex number if they are numbers (e.g. contractions to a scalar)
+template <typename TReal, typename TImag>
+std::enable_if_t<is_tensor_expression<TReal>::value,
+                 ComplexExpression<TReal, TImag>>
+make_complex(TReal &&real, TImag &&imag) {
+  return ComplexExpression<TReal, TImag>(std::forward<TReal>(real),
+                                         std::forward<TImag>(imag));
+}
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic<T>::value, std::complex<T>>
+make_complex(const T &real, const T &imag) {
+  return std::complex<T>(real, imag);
+}
+
+/// Complex tensor with separately stored real and imaginary parts
+template <size_t Rank, typename T = double, size_t Size = 3>
+class ComplexTensor
+    : public TensorExpression<Rank, ComplexTensor<Rank, T, Size>, Size> {
+public:
+  using RealTensor = Tensor<Rank, T, Size>;
+
+private:
+  RealTensor m_real;
+  RealTensor m_imag;
+
+  // Both parts are evaluated before either is assigned, as the expression
+  // may contain this tensor
+  template <typename T1>
+  void assign(const T1 &expression, std::true_type /*is_split_complex*/) {
+    const RealTensor real = expression.real();
+    const RealTensor imag = expression.imag();
+    m_real = real;
+    m_imag = imag;
+  }
+
+  template <typename T1>
+  void assign(const T1 &expression, std::false_type /*is_split_complex*/) {
+    assign_interleaved(expression,
+                       is_std_complex<expression_value_t<T1>>());
+  }
+
+  // A tensor expression of complex numbers is evaluated and split
+  template <typename T1>
+  void assign_interleaved(const T1 &expression, std::true_type) {
+    const Tensor<Rank, expression_value_t<T1>, Size> values = expression;
+    const auto *numbers = reinterpret_cast<const expression_value_t<T1> *>(
+        &values);
+    T *real = reinterpret_cast<T *>(&m_real);
+    T *imag = reinterpret_cast<T *>(&m_imag);
+    for (size_t i = 0; i < sizeof(values) / sizeof(numbers[0]); ++i) {
+      real[i] = numbers[i].real();
+      imag[i] = numbers[i].imag();
+    }
+  }
+
+  template <typename T1>
+  void assign_interleaved(const T1 &expression, std::false_type) {
+    m_real = expression;
+    m_imag = T(0);
+  }
+
+public:
+  using SplitComplexType = ComplexTensor;
+
+  ComplexTensor() = default;
+  ComplexTensor(const RealTensor &real, const RealTensor &imag)
+      : m_real(real), m_imag(imag) {}
+
+  /// All components set to value
+  ComplexTensor(const std::complex<T> &value) { operator=(value); }
+  ComplexTensor &operator=(const std::complex<T> &value) {
+    m_real = value.real();
+    m_imag = value.imag();
+    return *this;
+  }
+
+  /// Evaluates a complex expression, a real one (with zero imaginary part) or
+  /// one whose components are std::complex numbers
+  template <typename T1>
+  ComplexTensor(const TensorExpression<Rank, T1, Size> &expression) {
+    operator=(expression);
+  }
+  template <typename T1>
+  ComplexTensor &operator=(const TensorExpression<Rank, T1, Size> &expression) {
+    assign(static_cast<const T1 &>(expression), is_split_complex<T1>());
+    return *this;
+  }
+
+  const RealTensor &real() const { return m_real; }
+  RealTensor &real() { return m_real; }
+  const RealTensor &imag() const { return m_imag; }
+  RealTensor &imag() { return m_imag; }
+
+  static constexpr size_t size() { return Size; }
+  static constexpr size_t rank() { return Rank; }
+
+  template <typename... Indices> std::complex<T> eval(Indices... is) const {
+    return std::complex<T>(m_real.eval(is...), m_imag.eval(is...));
+  }
+
+  template <typename T1> ComplexTensor &operator+=(T1 &&other) {
+    return *this = *this + std::forward<T1>(other);
+  }
+  template <typename T1> ComplexTensor &operator-=(T1 &&other) {
+    return *this = *this - std::forward<T1>(other);
+  }
+  template <typename T1> ComplexTensor &operator*=(T1 &&other) {
+    return *this = *this * std::forward<T1>(other);
+  }
+  template <typename T1> ComplexTensor &operator/=(T1 &&other) {
+    return *this = *this / std::forward<T1>(other);
+  }
+};
+
+// The component wise operations between two complex operands (CC), a complex
+// and a real operand (CR) and a real and a complex operand (RC), at least one
+// of which is a complex expression
+#define define_complex_op(OP, CC_REAL, CC_IMAG, CR_REAL, CR_IMAG, RC_REAL,     \
+                          RC_IMAG)                                             \
+  template <typename T1, typename T2>                                          \
+  auto operator OP(T1 &&a, T2 &&b)->std::enable_if_t<                          \
+      complex_detail::is_complex_operand<T1>::value &&                         \
+          complex_detail::is_complex_operand<T2>::value &&                     \
+          (is_split_complex<T1>::value || is_split_complex<T2>::value),        \
+      decltype(make_complex(CC_REAL, CC_IMAG))> {                              \
+    return make_complex(CC_REAL, CC_IMAG);                                     \
+  }                                                                            \
+                                                                               \
+  template <typename T1, typename T2>                                          \
+  auto operator OP(T1 &&a, T2 &&b)->std::enable_if_t<                          \
+      is_split_complex<T1>::value &&                                           \
+          complex_detail::is_real_operand<T2>::value,                          \
+      decltype(make_complex(CR_REAL, CR_IMAG))> {                              \
+    return make_complex(CR_REAL, CR_IMAG);                                     \
+  }                                                                            \
+                                                                               \
+  template <typename T1, typename T2>                                          \
+  auto operator OP(T1 &&a, T2 &&b)->std::enable_if_t<                          \
+      complex_detail::is_real_operand<T1>::value &&                            \
+          is_split_complex<T2>::value,                                         \
+      decltype(make_complex(RC_REAL, RC_IMAG))> {                              \
+    return make_complex(RC_REAL, RC_IMAG);                                     \
+  }
+
+// The parts of a complex operand x and a real operand x used more than once
+#define RE(x) complex_detail::real_part<decltype(x)>(x)
+#define IM(x) complex_detail::imag_part<decltype(x)>(x)
+#define SHARE(x) complex_detail::share<decltype(x)>(x)
+#define NORM(x) (RE(x) * RE(x) + IM(x) * IM(x))
+
+// clang-format off
+define_complex_op(+,
+                  RE(a) + RE(b), IM(a) + IM(b),
+                  RE(a) + SHARE(b), IM(a),
+                  SHARE(a) + RE(b), IM(b))
+define_complex_op(-,
+                  RE(a) - RE(b), IM(a) - IM(b),
+                  RE(a) - SHARE(b), IM(a),
+                  SHARE(a) - RE(b), complex_detail::negate(IM(b)))
+define_complex_op(*,
+                  RE(a) * RE(b) - IM(a) * IM(b), RE(a) * IM(b) + IM(a) * RE(b),
+                  RE(a) * SHARE(b), IM(a) * SHARE(b),
+                  SHARE(a) * RE(b), SHARE(a) * IM(b))
+define_complex_op(/,
+                  (RE(a) * RE(b) + IM(a) * IM(b)) / NORM(b),
+                  (IM(a) * RE(b) - RE(a) * IM(b)) / NORM(b),
+                  RE(a) / SHARE(b), IM(a) / SHARE(b),
+                  SHARE(a) * RE(b) / NORM(b),
+                  complex_detail::negate(SHARE(a) * IM(b) / NORM(b)))
+// clang-format on
+
+#undef define_complex_op
+
+/// The complex conjugate
+template <typename T1>
+auto conj(T1 &&a)
+    -> std::enable_if_t<is_split_complex<T1>::value,
+                        decltype(make_complex(RE(a),
+                                              complex_detail::negate(IM(a))))> {
+  return make_complex(RE(a), complex_detail::negate(IM(a)));
+}
+
+/// The squared absolute values of the components, a real expression
+template <typename T1>
+auto norm(T1 &&a)
+    -> std::enable_if_t<is_split_complex<T1>::value, decltype(NORM(a))> {
+  return NORM(a);
+}
+
+/// The absolute values of the components, a real expression
+template <typename T1>
+auto abs(T1 &&a)
+    -> std::enable_if_t<is_split_complex<T1>::value, decltype(sqrt(NORM(a)))> {
+  return sqrt(NORM(a));
+}
+
+/// The real and imaginary parts, real expressions
+template <typename T1>
+auto real(T1 &&a)
+    -> std::enable_if_t<is_split_complex<T1>::value, decltype(RE(a))> {
+  return RE(a);
+}
+template <typename T1>
+auto imag(T1 &&a)
+    -> std::enable_if_t<is_split_complex<T1>::value, decltype(IM(a))> {
+  return IM(a);
+}
+
+/// Contracts the last index of a with the first index of b, as dot for real
+/// tensors, where one or both of them are complex
+template <typename T1, typename T2>
+auto dot(T1 &&a, T2 &&b) -> std::enable_if_t<
+    is_split_complex<T1>::value && is_split_complex<T2>::value,
+    decltype(make_complex(dot(RE(a), RE(b)) - dot(IM(a), IM(b)),
+                          dot(RE(a), IM(b)) + dot(IM(a), RE(b))))> {
+  return make_complex(dot(RE(a), RE(b)) - dot(IM(a), IM(b)),
+                      dot(RE(a), IM(b)) + dot(IM(a), RE(b)));
+}
+
+template <typename T1, typename T2>
+auto dot(T1 &&a, T2 &&b) -> std::enable_if_t<
+    is_split_complex<T1>::value && is_tensor_expression<T2>::value &&
+        !is_split_complex<T2>::value,
+    decltype(make_complex(dot(RE(a), SHARE(b)), dot(IM(a), SHARE(b))))> {
+  return make_complex(dot(RE(a), SHARE(b)), dot(IM(a), SHARE(b)));
+}
+
+template <typename T1, typename T2>
+auto dot(T1 &&a, T2 &&b) -> std::enable_if_t<
+    is_tensor_expression<T1>::value && !is_split_complex<T1>::value &&
+        is_split_complex<T2>::value,
+    decltype(make_complex(dot(SHARE(a), RE(b)), dot(SHARE(a), IM(b))))> {
+  return make_complex(dot(SHARE(a), RE(b)), dot(SHARE(a), IM(b)));
+}
+
+#undef RE
+#undef IM
+#undef SHARE
+#undef NORM
+
+} // namespace tensoralgebra
+
+#endif
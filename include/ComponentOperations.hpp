@@ -1,8 +1,13 @@
 #ifndef _TENSORALGEBRA_COMPONENTOPERATIONS_HPP
 #define _TENSORALGEBRA_COMPONENTOPERATIONS_HPP
 
+#include "EvaluationCounter.hpp"
 #include "TensorExpression.hpp"
 #include "TypeChecks.hpp"
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
 
 // This file defines all component wise operations which return a tensor of the
 // same rank (as all these operations are implemented in the same way).
@@ -26,11 +31,13 @@ namespace tensoralgebra {
           any(std::forward<TAny>(any)) {}                                      \
                                                                                \
     template <typename... Indices> auto eval(Indices... js) const {            \
+      TENSORALGEBRA_COUNT_EVALUATION(#Name, 1, 0);                             \
       return expression;                                                       \
     }                                                                          \
   }
 
-#define define_unary_expression_template(Name, expression)                     \
+#define define_unary_expression_template(Name, expression, arithmetic,         \
+                                         transcendental)                       \
   /* Expression template for functions of tensors. */                          \
   template <typename TTensor>                                                  \
   class Name                                                                   \
@@ -42,6 +49,7 @@ namespace tensoralgebra {
     Name(TTensor &&t) : tensor(std::forward<TTensor>(t)) {}                    \
                                                                                \
     template <typename... Indices> auto eval(Indices... js) const {            \
+      TENSORALGEBRA_COUNT_EVALUATION(#Name, arithmetic, transcendental);       \
       return expression;                                                       \
     }                                                                          \
   }
@@ -56,7 +64,11 @@ namespace tensoralgebra {
                                     tensor.eval(js...) OP any.eval(js...));
 
 #define define_unary_template(function, Name)                                  \
-  define_unary_expression_template(Name, function(tensor.eval(js...)));
+  define_unary_expression_template(Name, function(tensor.eval(js...)), 0, 1);
+
+// abs is counted as an arithmetic operation (a sign change), not as a call
+#define define_arithmetic_unary_template(function, Name)                       \
+  define_unary_expression_template(Name, function(tensor.eval(js...)), 1, 0);
 
 // clang-format off
 define_binary_templates(+, Sum)
@@ -83,19 +95,22 @@ define_unary_template(sinh, Sinh)
 define_unary_template(cosh, Cosh)
 define_unary_template(tanh, Tanh)
 using std::abs; // Prevents bug whereby C's abs(int) is called
-define_unary_template(abs, Abs)
+define_arithmetic_unary_template(abs, Abs)
 // clang-format on
 
 #undef define_binary_expression_template
 #undef define_unary_expression_template
 #undef define_binary_templates
 #undef define_unary_template
+#undef define_arithmetic_unary_template
 
 #define define_binary_op(OP, OPName)                                           \
   /* Accepts only tensors of same rank and size */                             \
   template <typename T1, typename T2>                                          \
   std::enable_if_t<is_tensor_expression<T1>::value &&                          \
-                       is_tensor_expression<T2>::value,                        \
+                       is_tensor_expression<T2>::value &&                      \
+                       !is_split_complex<T1>::value &&                         \
+                       !is_split_complex<T2>::value,                           \
                    OPName##Tensor<T1, T2>>                                     \
   operator OP(T1 &&in1, T2 &&in2) {                                            \
     return OPName##Tensor<T1, T2>(std::forward<T1>(in1),                       \
@@ -106,7 +121,8 @@ define_unary_template(abs, Abs)
    * TScalar's size doesn't match.*/                                           \
   template <typename T, typename TScalar>                                      \
   typename std::enable_if_t<is_tensor_expression<T>::value &&                  \
-                                !are_same_size<T, TScalar>::value,             \
+                                !are_same_size<T, TScalar>::value &&           \
+                                !is_split_complex<T>::value,                   \
                             OPName##ScalarRight<T, TScalar>>                   \
   operator OP(T &&tensor, TScalar &&value) {                                   \
     return OPName##ScalarRight<T, TScalar>(std::forward<T>(tensor),            \
@@ -117,7 +133,8 @@ define_unary_template(abs, Abs)
    * TScalar's size doesn't match.*/                                           \
   template <typename T, typename TScalar>                                      \
   typename std::enable_if_t<is_tensor_expression<T>::value &&                  \
-                                !are_same_size<T, TScalar>::value,             \
+                                !are_same_size<T, TScalar>::value &&           \
+                                !is_split_complex<T>::value,                   \
                             OPName##ScalarLeft<T, TScalar>>                    \
   operator OP(TScalar &&value, T &&tensor) {                                   \
     return OPName##ScalarLeft<T, TScalar>(std::forward<T>(tensor),             \
@@ -126,8 +143,10 @@ define_unary_template(abs, Abs)
 
 #define define_unary_function(function, Name)                                  \
   template <typename T>                                                        \
-  std::enable_if_t<is_tensor_expression<T>::value, Name<T>> function(          \
-      T &&tensor) {                                                            \
+  std::enable_if_t<is_tensor_expression<T>::value &&                           \
+                       !is_split_complex<T>::value,                            \
+                   Name<T>>                                                    \
+  function(T &&tensor) {                                                       \
     return Name<T>(std::forward<T>(tensor));                                   \
   }
 
@@ -161,6 +180,105 @@ define_unary_function(abs, Abs)
 #undef define_binary_op
 #undef define_arithmetic_op
 #undef define_unary_function
+
+namespace component_operations_detail {
+/// Number of multiplications in x^n by squaring: one per squaring and one per
+/// further set bit of n (plus the division for negative n)
+constexpr size_t power_operations(int n) {
+  return n < 0 ? power_operations(-n) + 1
+               : (n < 2 ? 0 : power_operations(n / 2) + 1 + n % 2);
+}
+
+template <int N, typename T> std::enable_if_t<(N == 0), T> power(const T &) {
+  return T(1);
+}
+template <int N, typename T> std::enable_if_t<(N == 1), T> power(const T &x) {
+  return x;
+}
+template <int N, typename T> std::enable_if_t<(N > 1), T> power(const T &x) {
+  const T half = power<N / 2>(x);
+  return N % 2 == 0 ? half * half : half * half * x;
+}
+template <int N, typename T> std::enable_if_t<(N < 0), T> power(const T &x) {
+  return T(1) / power<-N>(x);
+}
+} // namespace component_operations_detail
+
+/// Expression template for integer powers of tensors
+/** The operand is evaluated once per component and raised to the power by
+ * squaring, e.g. x^5 as (x^2)^2 * x. */
+template <int N, typename TTensor>
+class Power
+    : public TensorExpression<std::decay_t<TTensor>::rank(), Power<N, TTensor>,
+                              std::decay_t<TTensor>::size()> {
+  TTensor tensor;
+
+public:
+  Power(TTensor &&t) : tensor(std::forward<TTensor>(t)) {}
+
+  template <typename... Indices> auto eval(Indices... js) const {
+    TENSORALGEBRA_COUNT_EVALUATION(
+        "Power", component_operations_detail::power_operations(N), 0);
+    return component_operations_detail::power<N>(tensor.eval(js...));
+  }
+};
+
+/// Expression template for polynomials of tensors
+/** Evaluated by Horner's scheme, with the operand evaluated once per
+ * component. */
+template <typename TTensor, typename TCoefficient, size_t NumCoefficients>
+class Polynomial
+    : public TensorExpression<
+          std::decay_t<TTensor>::rank(),
+          Polynomial<TTensor, TCoefficient, NumCoefficients>,
+          std::decay_t<TTensor>::size()> {
+  TTensor tensor;
+  std::array<TCoefficient, NumCoefficients> coefficients;
+
+public:
+  Polynomial(TTensor &&t,
+             const std::array<TCoefficient, NumCoefficients> &coefficients)
+      : tensor(std::forward<TTensor>(t)), coefficients(coefficients) {}
+
+  template <typename... Indices> auto eval(Indices... js) const {
+    TENSORALGEBRA_COUNT_EVALUATION("Polynomial", 2 * (NumCoefficients - 1), 0);
+    const auto x = tensor.eval(js...);
+    decltype(coefficients[0] * x + coefficients[0]) result = coefficients[0];
+    for (size_t k = 1; k < NumCoefficients; ++k) {
+      result = result * x + coefficients[k];
+    }
+    return result;
+  }
+};
+
+/// The components of tensor raised to the integer power N
+/** Unlike a product of N factors, the operand is evaluated only once, e.g.
+ * tensoralgebra::pow<4>(a + b) evaluates a + b once per component and squares
+ * it twice. Negative powers are the inverses of the positive ones. */
+template <int N, typename T>
+std::enable_if_t<is_tensor_expression<T>::value && !is_split_complex<T>::value,
+                 Power<N, T>>
+pow(T &&tensor) {
+  return Power<N, T>(std::forward<T>(tensor));
+}
+
+/// The polynomial with the given coefficients, highest degree first, of the
+/// components of tensor
+/** E.g. polyval(x, 2., 0., -1.) is 2 x^2 - 1 component wise, evaluated by
+ * Horner's scheme as (2 x + 0) x - 1. */
+template <typename T, typename... TCoefficients>
+std::enable_if_t<is_tensor_expression<T>::value &&
+                     !is_split_complex<T>::value &&
+                     (sizeof...(TCoefficients) > 0),
+                 Polynomial<T, std::common_type_t<TCoefficients...>,
+                            sizeof...(TCoefficients)>>
+polyval(T &&tensor, const TCoefficients &... coefficients) {
+  using TCoefficient = std::common_type_t<TCoefficients...>;
+  return Polynomial<T, TCoefficient, sizeof...(TCoefficients)>(
+      std::forward<T>(tensor),
+      std::array<TCoefficient, sizeof...(TCoefficients)>{
+          {TCoefficient(coefficients)...}});
+}
 } // namespae tensoralgebra
 
 #endif
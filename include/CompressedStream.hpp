@@ -0,0 +1,406 @@
+#ifndef _TENSORALGEBRA_COMPRESSEDSTREAM_HPP
+#define _TENSORALGEBRA_COMPRESSEDSTREAM_HPP
+
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// This file defines a streaming, lossless compressed format for sequences of
+// tensors (e.g. all the points of a field). Tensors are buffered in chunks of a
+// fixed number of points, so arbitrarily long streams can be written and read
+// with bounded memory. Within a chunk every component is encoded separately
+// as a stream over the points: each value is XORed with the value of the same
+// component at the previous point, and only the bytes of the result between
+// its leading and trailing zero bytes are stored, preceded by a header byte
+// holding the two zero counts. Smooth data shares sign, exponent and leading
+// mantissa bits between neighbouring points, so most of the XOR is zero.
+// If all tensors of a chunk are symmetric in their first two indices, only
+// the components with i <= j are stored.
+
+namespace tensoralgebra {
+
+namespace compressed_stream {
+static constexpr char magic[8] = {'T', 'E', 'N', 'S', 'A', 'L', 'G', 'Z'};
+static constexpr uint32_t version = 1;
+static constexpr uint8_t symmetric_flag = 1;
+
+/// Unsigned integer with the same size as the floating point type T
+template <typename T>
+using bits_type =
+    std::conditional_t<sizeof(T) == sizeof(uint64_t), uint64_t, uint32_t>;
+
+template <typename T> bits_type<T> to_bits(const T &value) {
+  bits_type<T> bits;
+  std::memcpy(&bits, &value, sizeof(T));
+  return bits;
+}
+
+template <typename T> T from_bits(bits_type<T> bits) {
+  T value;
+  std::memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+inline size_t leading_zero_bytes(uint64_t x) {
+  return x == 0 ? 8 : __builtin_clzll(x) / 8;
+}
+inline size_t leading_zero_bytes(uint32_t x) {
+  return x == 0 ? 4 : __builtin_clz(x) / 8;
+}
+inline size_t trailing_zero_bytes(uint64_t x) {
+  return x == 0 ? 0 : __builtin_ctzll(x) / 8;
+}
+inline size_t trailing_zero_bytes(uint32_t x) {
+  return x == 0 ? 0 : __builtin_ctz(x) / 8;
+}
+
+// Integers in the headers are always stored little endian
+inline void put_uint(std::vector<unsigned char> &buffer, uint64_t value,
+                     size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    buffer.push_back(static_cast<unsigned char>(value >> (8 * i)));
+  }
+}
+
+inline uint64_t get_uint(const unsigned char *buffer, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(buffer[i]) << (8 * i);
+  }
+  return value;
+}
+
+/// Number of components per (i, j) pair of the first two indices
+template <size_t Rank, size_t Size> constexpr size_t inner_components() {
+  return component_count(Rank >= 2 ? Rank - 2 : 0, Size);
+}
+
+/// Flat indices of the components which are stored for a chunk
+/** All components in general; only those with i <= j for the first two
+ * indices if the chunk is symmetric. */
+template <size_t Rank, size_t Size>
+std::vector<size_t> stored_components(bool symmetric) {
+  constexpr size_t num_components = component_count(Rank, Size);
+  constexpr size_t inner = inner_components<Rank, Size>();
+  std::vector<size_t> components;
+  for (size_t c = 0; c < num_components; ++c) {
+    if (!symmetric || c / (Size * inner) <= (c / inner) % Size) {
+      components.push_back(c);
+    }
+  }
+  return components;
+}
+
+/// Returns the flat index of the component with the first two indices swapped
+template <size_t Rank, size_t Size> size_t transposed_component(size_t c) {
+  constexpr size_t inner = inner_components<Rank, Size>();
+  const size_t i = c / (Size * inner);
+  const size_t j = (c / inner) % Size;
+  return (j * Size + i) * inner + c % inner;
+}
+} // namespace compressed_stream
+
+/// Writes tensors to a std::ostream in the compressed format
+/** Tensors are passed to push() one at a time (or a whole field to write());
+ * every chunk_points tensors a chunk is encoded and written. finish() (also
+ * called by the destructor) writes the last partial chunk and the end marker.
+ */
+template <size_t Rank, typename T = double, size_t Size = 3>
+class CompressedFieldWriter {
+  static_assert(std::is_floating_point<T>::value &&
+                    (sizeof(T) == 4 || sizeof(T) == 8),
+                "The compressed format supports float and double components.");
+
+public:
+  using TensorType = Tensor<Rank, T, Size>;
+
+private:
+  std::ostream &m_stream;
+  size_t m_chunk_points;
+  std::vector<TensorType> m_chunk;
+  std::vector<unsigned char> m_buffer;
+  size_t m_raw_bytes = 0;
+  size_t m_compressed_bytes = 0;
+  bool m_finished = false;
+
+  void write_buffer() {
+    m_stream.write(reinterpret_cast<const char *>(m_buffer.data()),
+                   m_buffer.size());
+    if (!m_stream) {
+      throw std::runtime_error("Could not write compressed tensor stream");
+    }
+    m_compressed_bytes += m_buffer.size();
+    m_buffer.clear();
+  }
+
+  bool chunk_is_symmetric() const {
+    if (Rank < 2) {
+      return false;
+    }
+    constexpr size_t num_components = component_count(Rank, Size);
+    for (const auto &tensor : m_chunk) {
+      const T *components = reinterpret_cast<const T *>(&tensor);
+      for (size_t c = 0; c < num_components; ++c) {
+        const size_t transposed =
+            compressed_stream::transposed_component<Rank, Size>(c);
+        if (std::memcmp(components + c, components + transposed, sizeof(T))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void encode_chunk() {
+    using namespace compressed_stream;
+    using Bits = bits_type<T>;
+    const bool symmetric = chunk_is_symmetric();
+    const size_t num_points = m_chunk.size();
+
+    // Chunk header: number of points, flags, payload size (patched below)
+    put_uint(m_buffer, num_points, 4);
+    m_buffer.push_back(symmetric ? symmetric_flag : 0);
+    const size_t payload_size_position = m_buffer.size();
+    put_uint(m_buffer, 0, 8);
+    const size_t payload_start = m_buffer.size();
+
+    for (size_t c : stored_components<Rank, Size>(symmetric)) {
+      Bits previous = 0;
+      for (size_t p = 0; p < num_points; ++p) {
+        const T *components = reinterpret_cast<const T *>(&m_chunk[p]);
+        const Bits bits = to_bits(components[c]);
+        const Bits x = bits ^ previous;
+        previous = bits;
+
+        const size_t leading = leading_zero_bytes(x);
+        const size_t trailing = trailing_zero_bytes(x);
+        m_buffer.push_back(static_cast<unsigned char>(leading << 4 | trailing));
+        for (size_t byte = trailing; byte < sizeof(Bits) - leading; ++byte) {
+          m_buffer.push_back(static_cast<unsigned char>(x >> (8 * byte)));
+        }
+      }
+    }
+
+    const uint64_t payload_size = m_buffer.size() - payload_start;
+    for (size_t i = 0; i < 8; ++i) {
+      m_buffer[payload_size_position + i] =
+          static_cast<unsigned char>(payload_size >> (8 * i));
+    }
+    m_raw_bytes += num_points * sizeof(TensorType);
+    m_chunk.clear();
+    write_buffer();
+  }
+
+public:
+  explicit CompressedFieldWriter(std::ostream &stream,
+                                 size_t chunk_points = 4096)
+      : m_stream(stream), m_chunk_points(chunk_points) {
+    if (chunk_points == 0) {
+      throw std::invalid_argument("Chunks must contain at least one point");
+    }
+    m_chunk.reserve(chunk_points);
+    m_buffer.insert(m_buffer.end(), compressed_stream::magic,
+                    compressed_stream::magic + 8);
+    compressed_stream::put_uint(m_buffer, compressed_stream::version, 4);
+    compressed_stream::put_uint(m_buffer, Rank, 4);
+    compressed_stream::put_uint(m_buffer, Size, 4);
+    compressed_stream::put_uint(m_buffer, sizeof(T), 4);
+    write_buffer();
+  }
+
+  CompressedFieldWriter(const CompressedFieldWriter &) = delete;
+  CompressedFieldWriter &operator=(const CompressedFieldWriter &) = delete;
+
+  ~CompressedFieldWriter() {
+    if (!m_finished) {
+      try {
+        finish();
+      } catch (...) {
+        // Destructors must not throw; call finish() to see the error.
+      }
+    }
+  }
+
+  template <typename T1>
+  void push(const TensorExpression<Rank, T1, Size> &tensor) {
+    m_chunk.push_back(tensor);
+    if (m_chunk.size() == m_chunk_points) {
+      encode_chunk();
+    }
+  }
+
+  template <typename Allocator>
+  void write(const TensorField<Rank, T, Size, Allocator> &field) {
+    for (const auto &tensor : field) {
+      push(tensor);
+    }
+  }
+
+  /// Encodes the tensors pushed so far, even if the chunk is not full
+  void flush() {
+    if (!m_chunk.empty()) {
+      encode_chunk();
+    }
+    m_stream.flush();
+  }
+
+  /// Flushes and writes the end marker; no tensors may be pushed afterwards
+  void finish() {
+    if (m_finished) {
+      return;
+    }
+    flush();
+    compressed_stream::put_uint(m_buffer, 0, 4); // A chunk of zero points
+    write_buffer();
+    m_stream.flush();
+    m_finished = true;
+  }
+
+  /// Uncompressed size of the tensors written so far
+  size_t raw_bytes() const { return m_raw_bytes; }
+  /// Bytes written to the stream so far (including headers)
+  size_t compressed_bytes() const { return m_compressed_bytes; }
+};
+
+/// Reads tensors written by a CompressedFieldWriter from a std::istream
+/** Decodes one chunk at a time, so memory use is bounded by the chunk size
+ * chosen by the writer. */
+template <size_t Rank, typename T = double, size_t Size = 3>
+class CompressedFieldReader {
+  static_assert(std::is_floating_point<T>::value &&
+                    (sizeof(T) == 4 || sizeof(T) == 8),
+                "The compressed format supports float and double components.");
+
+public:
+  using TensorType = Tensor<Rank, T, Size>;
+
+private:
+  std::istream &m_stream;
+  std::vector<TensorType> m_chunk;
+  std::vector<unsigned char> m_buffer;
+  size_t m_position = 0;
+  bool m_at_end = false;
+
+  void read_bytes(size_t bytes) {
+    m_buffer.resize(bytes);
+    m_stream.read(reinterpret_cast<char *>(m_buffer.data()), bytes);
+    if (static_cast<size_t>(m_stream.gcount()) != bytes) {
+      throw std::runtime_error("Truncated compressed tensor stream");
+    }
+  }
+
+  void decode_chunk() {
+    using namespace compressed_stream;
+    using Bits = bits_type<T>;
+    read_bytes(4);
+    const size_t num_points = get_uint(m_buffer.data(), 4);
+    m_chunk.clear();
+    m_position = 0;
+    if (num_points == 0) {
+      m_at_end = true;
+      return;
+    }
+    read_bytes(9);
+    const bool symmetric = (m_buffer[0] & symmetric_flag);
+    const size_t payload_size = get_uint(m_buffer.data() + 1, 8);
+    read_bytes(payload_size);
+
+    m_chunk.resize(num_points);
+    const unsigned char *in = m_buffer.data();
+    const unsigned char *in_end = in + payload_size;
+    const auto components = stored_components<Rank, Size>(symmetric);
+    for (size_t c : components) {
+      Bits previous = 0;
+      for (size_t p = 0; p < num_points; ++p) {
+        if (in == in_end) {
+          throw std::runtime_error("Corrupt compressed tensor stream");
+        }
+        const size_t leading = *in >> 4;
+        const size_t trailing = *in & 0xf;
+        ++in;
+        if (leading + trailing > sizeof(Bits) ||
+            in + (sizeof(Bits) - leading - trailing) > in_end) {
+          throw std::runtime_error("Corrupt compressed tensor stream");
+        }
+        Bits x = 0;
+        for (size_t byte = trailing; byte < sizeof(Bits) - leading; ++byte) {
+          x |= static_cast<Bits>(*in++) << (8 * byte);
+        }
+        previous ^= x;
+        reinterpret_cast<T *>(&m_chunk[p])[c] = from_bits<T>(previous);
+      }
+    }
+    if (symmetric) {
+      constexpr size_t num_components = component_count(Rank, Size);
+      for (auto &tensor : m_chunk) {
+        T *values = reinterpret_cast<T *>(&tensor);
+        for (size_t c = 0; c < num_components; ++c) {
+          const size_t transposed = transposed_component<Rank, Size>(c);
+          if (transposed < c) {
+            values[c] = values[transposed];
+          }
+        }
+      }
+    }
+  }
+
+public:
+  explicit CompressedFieldReader(std::istream &stream) : m_stream(stream) {
+    read_bytes(24);
+    if (std::memcmp(m_buffer.data(), compressed_stream::magic, 8) != 0) {
+      throw std::runtime_error("Not a compressed tensor stream");
+    }
+    const unsigned char *header = m_buffer.data() + 8;
+    if (compressed_stream::get_uint(header, 4) != compressed_stream::version) {
+      throw std::runtime_error("Unsupported compressed tensor stream version");
+    }
+    if (compressed_stream::get_uint(header + 4, 4) != Rank ||
+        compressed_stream::get_uint(header + 8, 4) != Size ||
+        compressed_stream::get_uint(header + 12, 4) != sizeof(T)) {
+      throw std::runtime_error("Compressed tensor stream has the wrong type");
+    }
+  }
+
+  /// Reads up to max_points tensors into out and returns how many were read
+  /** Returns fewer than max_points only at the end of the stream. */
+  size_t read(TensorType *out, size_t max_points) {
+    size_t num_read = 0;
+    while (num_read < max_points) {
+      if (m_position == m_chunk.size()) {
+        if (m_at_end) {
+          break;
+        }
+        decode_chunk();
+        continue;
+      }
+      const size_t num_copied =
+          std::min(max_points - num_read, m_chunk.size() - m_position);
+      std::copy(m_chunk.begin() + m_position,
+                m_chunk.begin() + m_position + num_copied, out + num_read);
+      m_position += num_copied;
+      num_read += num_copied;
+    }
+    return num_read;
+  }
+
+  /// Fills the field with the next field.num_points() tensors
+  template <typename Allocator>
+  size_t read(TensorField<Rank, T, Size, Allocator> &field) {
+    return read(field.data(), field.num_points());
+  }
+
+  bool at_end() const { return m_at_end && m_position == m_chunk.size(); }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _TENSORALGEBRA_DOT_HPP
 #define _TENSORALGEBRA_DOT_HPP
 
+#include "EvaluationCounter.hpp"
 #include "Outer.hpp"
 #include "TensorExpression.hpp"
 #include "TypeChecks.hpp"
@@ -20,6 +21,8 @@ public:
   Dot(T1 &&t1, T2 &&t2) : t1(std::forward<T1>(t1)), t2(std::forward<T2>(t2)) {}
 
   template <typename... Indices> auto eval(Indices... js) const {
+    // The multiplications are counted by the Outer node
+    TENSORALGEBRA_COUNT_EVALUATION("Dot", std::decay_t<T1>::size() - 1, 0);
     auto outer_product = outer(t1, t2);
     constexpr size_t rank_T1 = std::decay_t<T1>::rank();
     auto dot =
@@ -38,6 +41,8 @@ public:
 template <typename T1, typename T2>
 typename std::enable_if_t<
     is_tensor_expression<T1>::value && is_tensor_expression<T2>::value &&
+        !is_split_complex<T1>::value && !is_split_complex<T2>::value &&
+        !is_dynamic_size<T1>::value &&
         (std::decay_t<T1>::rank() + std::decay_t<T2>::rank() > 2),
     Dot<T1, T2>>
 dot(T1 &&t1, T2 &&t2) {
@@ -50,6 +55,7 @@ dot(T1 &&t1, T2 &&t2) {
 template <typename T1, typename T2, size_t Size>
 auto dot(const TensorExpression<1, T1, Size> &t1,
          const TensorExpression<1, T2, Size> &t2) {
+  TENSORALGEBRA_COUNT_EVALUATION("dot", 2 * Size - 1, 0);
   auto dot_product = t1[0] * t2[0];
   for (size_t i = 1; i < t1.size(); ++i) {
     dot_product += t1[i] * t2[i];
@@ -0,0 +1,244 @@
+#ifndef _TENSORALGEBRA_DUAL_HPP
+#define _TENSORALGEBRA_DUAL_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+
+// This file defines Dual<T, N>, a number carrying its derivatives with respect
+// to N independent variables (forward mode automatic differentiation). It can
+// be used as the element type of a Tensor: evaluating an expression of such
+// tensors once gives both the values and N directional derivatives, e.g. N
+// columns of a Jacobian. The derivatives are stored in an array and all
+// operations loop over it, so that the compiler can vectorize them.
+
+namespace tensoralgebra {
+
+/// Number with N derivative lanes
+/** Deliberately has no static size() so that it is treated as a scalar by the
+ * tensor expressions. */
+template <typename T, size_t N> class Dual {
+  T m_value;
+  std::array<T, N> m_derivatives;
+
+public:
+  using value_type = T;
+  static constexpr size_t num_derivatives() { return N; }
+
+  Dual() = default;
+
+  /// A constant: all derivatives are zero
+  Dual(const T &value) : m_value(value) { m_derivatives.fill(T(0)); }
+
+  Dual(const T &value, const std::array<T, N> &derivatives)
+      : m_value(value), m_derivatives(derivatives) {}
+
+  /// The independent variable number lane, i.e. derivative one in that lane
+  static Dual variable(const T &value, size_t lane) {
+    Dual dual(value);
+    dual.m_derivatives[lane] = T(1);
+    return dual;
+  }
+
+  const T &value() const { return m_value; }
+  T &value() { return m_value; }
+  const T &derivative(size_t lane) const { return m_derivatives[lane]; }
+  T &derivative(size_t lane) { return m_derivatives[lane]; }
+  const std::array<T, N> &derivatives() const { return m_derivatives; }
+
+  /// Applies a function with the given value and derivative (chain rule)
+  Dual chain(const T &value, const T &derivative) const {
+    Dual result(value, m_derivatives);
+    for (size_t i = 0; i < N; ++i) {
+      result.m_derivatives[i] *= derivative;
+    }
+    return result;
+  }
+
+  Dual operator-() const { return chain(-m_value, T(-1)); }
+  const Dual &operator+() const { return *this; }
+
+  Dual &operator+=(const Dual &other) {
+    m_value += other.m_value;
+    for (size_t i = 0; i < N; ++i) {
+      m_derivatives[i] += other.m_derivatives[i];
+    }
+    return *this;
+  }
+
+  Dual &operator-=(const Dual &other) {
+    m_value -= other.m_value;
+    for (size_t i = 0; i < N; ++i) {
+      m_derivatives[i] -= other.m_derivatives[i];
+    }
+    return *this;
+  }
+
+  Dual &operator*=(const Dual &other) {
+    for (size_t i = 0; i < N; ++i) {
+      m_derivatives[i] = m_derivatives[i] * other.m_value +
+                         m_value * other.m_derivatives[i];
+    }
+    m_value *= other.m_value;
+    return *this;
+  }
+
+  Dual &operator/=(const Dual &other) {
+    const T inverse = T(1) / other.m_value;
+    m_value *= inverse;
+    for (size_t i = 0; i < N; ++i) {
+      m_derivatives[i] =
+          (m_derivatives[i] - m_value * other.m_derivatives[i]) * inverse;
+    }
+    return *this;
+  }
+
+  // Operations with plain numbers only touch the lanes where needed
+  Dual &operator+=(const T &value) {
+    m_value += value;
+    return *this;
+  }
+  Dual &operator-=(const T &value) {
+    m_value -= value;
+    return *this;
+  }
+  Dual &operator*=(const T &value) {
+    m_value *= value;
+    for (auto &derivative : m_derivatives) {
+      derivative *= value;
+    }
+    return *this;
+  }
+  Dual &operator/=(const T &value) { return operator*=(T(1) / value); }
+};
+
+/// Compile time check whether the template parameter is a Dual
+template <typename T> struct is_dual : public std::false_type {};
+template <typename T, size_t N>
+struct is_dual<Dual<T, N>> : public std::true_type {};
+
+// Plain numbers (e.g. the literal 2 in 2 * tensor) mixed with duals
+template <typename T, typename U>
+using enable_if_plain_number_t =
+    std::enable_if_t<std::is_arithmetic<std::decay_t<U>>::value, T>;
+
+#define define_dual_arithmetic_op(OP)                                          \
+  template <typename T, size_t N>                                              \
+  Dual<T, N> operator OP(Dual<T, N> dual1, const Dual<T, N> &dual2) {          \
+    return dual1 OP## = dual2;                                                 \
+  }                                                                            \
+                                                                               \
+  template <typename T, size_t N, typename U>                                  \
+  enable_if_plain_number_t<Dual<T, N>, U> operator OP(Dual<T, N> dual,         \
+                                                      const U &value) {        \
+    return dual OP## = T(value);                                               \
+  }                                                                            \
+                                                                               \
+  template <typename T, size_t N, typename U>                                  \
+  enable_if_plain_number_t<Dual<T, N>, U> operator OP(const U &value,          \
+                                                      const Dual<T, N> &dual) {\
+    return Dual<T, N>(T(value)) OP## = dual;                                   \
+  }
+
+// Relational operators compare the values only
+#define define_dual_relational_op(OP)                                          \
+  template <typename T, size_t N>                                              \
+  bool operator OP(const Dual<T, N> &dual1, const Dual<T, N> &dual2) {         \
+    return dual1.value() OP dual2.value();                                     \
+  }                                                                            \
+                                                                               \
+  template <typename T, size_t N, typename U>                                  \
+  enable_if_plain_number_t<bool, U> operator OP(const Dual<T, N> &dual,        \
+                                                const U &value) {              \
+    return dual.value() OP value;                                              \
+  }                                                                            \
+                                                                               \
+  template <typename T, size_t N, typename U>                                  \
+  enable_if_plain_number_t<bool, U> operator OP(const U &value,                \
+                                                const Dual<T, N> &dual) {      \
+    return value OP dual.value();                                              \
+  }
+
+// clang-format off
+define_dual_arithmetic_op(+)
+define_dual_arithmetic_op(-)
+define_dual_arithmetic_op(*)
+define_dual_arithmetic_op(/)
+
+define_dual_relational_op(>=)
+define_dual_relational_op(<=)
+define_dual_relational_op(>)
+define_dual_relational_op(<)
+// clang-format on
+
+#undef define_dual_arithmetic_op
+#undef define_dual_relational_op
+
+/// Equality compares values and all derivatives
+template <typename T, size_t N>
+bool operator==(const Dual<T, N> &dual1, const Dual<T, N> &dual2) {
+  return dual1.value() == dual2.value() &&
+         dual1.derivatives() == dual2.derivatives();
+}
+
+template <typename T, size_t N>
+bool operator!=(const Dual<T, N> &dual1, const Dual<T, N> &dual2) {
+  return !(dual1 == dual2);
+}
+
+// The functions supported by tensor expressions (see ComponentOperations.hpp),
+// found by argument dependent lookup. Each one is given by its value and its
+// derivative in terms of the argument x and the value f.
+#define define_dual_function(function, derivative_expression)                 \
+  template <typename T, size_t N>                                              \
+  Dual<T, N> function(const Dual<T, N> &dual) {                                \
+    using std::function;                                                       \
+    const T &x = dual.value();                                                 \
+    const T f = function(x);                                                   \
+    (void)f;                                                                   \
+    return dual.chain(f, derivative_expression);                               \
+  }
+
+// clang-format off
+define_dual_function(exp, f)
+define_dual_function(log, T(1) / x)
+define_dual_function(log10, T(1) / (x * std::log(T(10))))
+define_dual_function(sqrt, T(0.5) / f)
+define_dual_function(sin, std::cos(x))
+define_dual_function(cos, -std::sin(x))
+define_dual_function(tan, T(1) + f * f)
+define_dual_function(asin, T(1) / std::sqrt(T(1) - x * x))
+define_dual_function(acos, T(-1) / std::sqrt(T(1) - x * x))
+define_dual_function(atan, T(1) / (T(1) + x * x))
+define_dual_function(sinh, std::cosh(x))
+define_dual_function(cosh, std::sinh(x))
+define_dual_function(tanh, T(1) - f * f)
+define_dual_function(abs, x < T(0) ? T(-1) : T(1))
+// clang-format on
+
+#undef define_dual_function
+
+/// Power with a constant exponent
+template <typename T, size_t N, typename U>
+enable_if_plain_number_t<Dual<T, N>, U> pow(const Dual<T, N> &dual,
+                                            const U &exponent) {
+  const T &x = dual.value();
+  return dual.chain(std::pow(x, T(exponent)),
+                    T(exponent) * std::pow(x, T(exponent) - T(1)));
+}
+
+template <typename T, size_t N>
+std::ostream &operator<<(std::ostream &os, const Dual<T, N> &dual) {
+  os << dual.value() << "[";
+  for (size_t i = 0; i < N; ++i) {
+    os << (i == 0 ? "" : ",") << dual.derivative(i);
+  }
+  os << "]";
+  return os;
+}
+
+} // namespace tensoralgebra
+
+#endif
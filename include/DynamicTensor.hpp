@@ -0,0 +1,498 @@
+#ifndef _TENSORALGEBRA_DYNAMICTENSOR_HPP
+#define _TENSORALGEBRA_DYNAMICTENSOR_HPP
+
+#include "EvaluationCounter.hpp"
+#include "Parallel.hpp"
+#include "TensorExpression.hpp"
+#include "TensorOperations.hpp"
+#include "TypeChecks.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// This file defines DynamicTensor, a tensor whose size is chosen at runtime,
+// for the (rare) cases where the size is too large to be fixed at compile time,
+// e.g. couplings between thousands of spectral modes. Component wise
+// operations and outer products are lazy expressions just as for Tensor and are
+// evaluated in parallel on assignment. The dot product and the trace are
+// evaluated immediately by cache blocked, multithreaded kernels: for large
+// sizes a lazy dot product would recompute each sum for every component. The
+// outer product has no sums, so its lazy evaluation already reads each factor
+// component from the cache and writes each result component once; it has no
+// kernel of its own.
+//
+// Expressions of dynamic tensors do not know their size, so they can only be
+// evaluated into a DynamicTensor of known size. Before the evaluation the
+// expression is evaluated once with DimensionProbe indices, for which each
+// DynamicTensor in it compares its dimension instead of reading a component.
+
+namespace tensoralgebra {
+
+namespace dynamic_detail {
+constexpr size_t power(size_t base, size_t exponent) {
+  return exponent == 0 ? 1 : base * power(base, exponent - 1);
+}
+
+// Calls function(indices..., i_1, ..., i_Remaining) for all values of the
+// remaining indices in row-major order
+template <size_t Remaining> struct IndexLoop {
+  template <typename Function, typename... Indices>
+  static void run(size_t size, Function &function, Indices... is) {
+    for (size_t i = 0; i < size; ++i) {
+      IndexLoop<Remaining - 1>::run(size, function, is..., i);
+    }
+  }
+};
+
+template <> struct IndexLoop<0> {
+  template <typename Function, typename... Indices>
+  static void run(size_t, Function &function, Indices... is) {
+    function(is...);
+  }
+};
+
+/// Index passed to all ranks of an expression to check that the dynamic
+/// tensors in it have the given dimension
+struct DimensionProbe {
+  size_t dimension;
+  bool *mismatch;
+};
+
+/// Whether any of the indices is a DimensionProbe (fixed indices, e.g. the i
+/// of tensor[i], come before the probes)
+template <typename... Indices> struct contains_probe : std::false_type {};
+template <typename Index, typename... Indices>
+struct contains_probe<Index, Indices...>
+    : std::integral_constant<
+          bool, std::is_same<std::decay_t<Index>, DimensionProbe>::value ||
+                    contains_probe<Indices...>::value> {};
+
+template <typename... Indices>
+const DimensionProbe &find_probe(const DimensionProbe &probe,
+                                 const Indices &...) {
+  return probe;
+}
+template <typename Index, typename... Indices>
+const DimensionProbe &find_probe(const Index &, const Indices &... indices) {
+  return find_probe(indices...);
+}
+
+/// Sets *probe.mismatch if a dynamic tensor in expression has a different
+/// dimension than probe.dimension
+template <typename TExpression, size_t... Is>
+void probe_dimensions(const TExpression &expression,
+                      const DimensionProbe &probe, std::index_sequence<Is...>) {
+  static_cast<void>(expression.eval((static_cast<void>(Is), probe)...));
+}
+
+// Block sizes of the matrix multiplication: a block of rows of the result
+// with the corresponding rows of the first factor and a block of the second
+// factor (block_k x block_n) fit into the L2 cache.
+constexpr size_t block_m = 64;
+constexpr size_t block_n = 256;
+constexpr size_t block_k = 128;
+
+template <typename T>
+T dot_product(const T *__restrict__ a, const T *__restrict__ b, size_t size) {
+  // Independent partial sums so that consecutive additions do not wait for
+  // each other
+  T sum[4] = {T(0), T(0), T(0), T(0)};
+  size_t k = 0;
+  for (; k + 4 <= size; k += 4) {
+    for (size_t l = 0; l < 4; ++l) {
+      sum[l] += a[k + l] * b[k + l];
+    }
+  }
+  for (; k < size; ++k) {
+    sum[0] += a[k] * b[k];
+  }
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/// c (m x n) = a (m x k) . b (k x n), all row-major
+template <typename T>
+void multiply_matrices(const T *a, const T *b, T *c, size_t m, size_t k,
+                       size_t n) {
+  if (n == 1) {
+    // Matrix times vector: one dot product per row
+    parallel_for(0, m,
+                 [=](size_t begin, size_t end) {
+                   for (size_t i = begin; i < end; ++i) {
+                     c[i] = dot_product(a + i * k, b, k);
+                   }
+                 },
+                 num_threads_for_work(m * k));
+    return;
+  }
+
+  // The result is split into tiles which are computed independently
+  const size_t tiles_m = (m + block_m - 1) / block_m;
+  const size_t tiles_n = (n + block_n - 1) / block_n;
+  auto compute_tiles = [=](size_t tile_begin, size_t tile_end) {
+    for (size_t tile = tile_begin; tile < tile_end; ++tile) {
+      const size_t i0 = (tile / tiles_n) * block_m;
+      const size_t j0 = (tile % tiles_n) * block_n;
+      const size_t i1 = std::min(i0 + block_m, m);
+      const size_t width = std::min(j0 + block_n, n) - j0;
+      for (size_t i = i0; i < i1; ++i) {
+        std::fill(c + i * n + j0, c + i * n + j0 + width, T(0));
+      }
+      for (size_t k0 = 0; k0 < k; k0 += block_k) {
+        const size_t k1 = std::min(k0 + block_k, k);
+        for (size_t i = i0; i < i1; ++i) {
+          T *__restrict__ c_row = c + i * n + j0;
+          for (size_t l = k0; l < k1; ++l) {
+            const T a_il = a[i * k + l];
+            const T *__restrict__ b_row = b + l * n + j0;
+            for (size_t j = 0; j < width; ++j) {
+              c_row[j] += a_il * b_row[j];
+            }
+          }
+        }
+      }
+    }
+  };
+  parallel_for(0, tiles_m * tiles_n, compute_tiles,
+               num_threads_for_work(m * n * k));
+}
+
+// Writes the components of a tensor of the given rank in the same nested
+// format as operator<< for Tensor
+template <typename T>
+void write_components(std::ostream &os, const T *&component, size_t dimension,
+                      size_t rank) {
+  os << "{";
+  for (size_t i = 0; i < dimension; ++i) {
+    if (i > 0) {
+      os << ",";
+    }
+    if (rank == 1) {
+      os << *component++;
+    } else {
+      write_components(os, component, dimension, rank - 1);
+    }
+  }
+  os << "}";
+}
+
+/// Sums function(begin, end) over the chunks of [0, size) computed in parallel
+template <typename T, typename Function>
+T parallel_sum(size_t size, size_t work, const Function &function) {
+  const size_t num_threads = num_threads_for_work(work);
+  std::vector<T> partial_sums(num_threads, T(0));
+  parallel_for(0, num_threads,
+               [&](size_t thread_begin, size_t thread_end) {
+                 for (size_t t = thread_begin; t < thread_end; ++t) {
+                   partial_sums[t] = function(t * size / num_threads,
+                                              (t + 1) * size / num_threads);
+                 }
+               },
+               num_threads);
+  T sum = partial_sums[0];
+  for (size_t t = 1; t < num_threads; ++t) {
+    sum += partial_sums[t];
+  }
+  return sum;
+}
+} // namespace dynamic_detail
+
+/// DynamicTensor<Rank, T> represents a tensor of rank Rank and element type T
+/// whose size is set at runtime
+/** The components are stored contiguously in row-major order. As size() has to
+ * be a compile time constant for all tensor expressions it returns
+ * dynamic_size; the actual size is returned by dimension(). */
+template <size_t Rank, typename T = double>
+class DynamicTensor
+    : public TensorExpression<Rank, DynamicTensor<Rank, T>, dynamic_size> {
+  size_t m_dimension = 0;
+  std::vector<T> m_data;
+
+  template <typename TExpression, typename Operation>
+  void apply(const TExpression &expression, Operation operation) {
+    bool mismatch = false;
+    {
+      // The check is no evaluation of the expression
+      const PausedEvaluationCounts paused;
+      dynamic_detail::probe_dimensions(
+          expression, dynamic_detail::DimensionProbe{m_dimension, &mismatch},
+          std::make_index_sequence<Rank>());
+    }
+    if (mismatch) {
+      throw std::invalid_argument(
+          "DynamicTensor: expression of a different dimension");
+    }
+    const size_t dimension = m_dimension;
+    const size_t row_stride = dynamic_detail::power(dimension, Rank - 1);
+    T *data = m_data.data();
+    parallel_for(
+        0, dimension,
+        [&](size_t begin, size_t end) {
+          T *out = data + begin * row_stride;
+          auto evaluate = [&](auto... is) {
+            operation(*out, expression.eval(is...));
+            ++out;
+          };
+          for (size_t i = begin; i < end; ++i) {
+            dynamic_detail::IndexLoop<Rank - 1>::run(dimension, evaluate, i);
+          }
+        },
+        num_threads_for_work(m_data.size()));
+  }
+
+public:
+  static_assert(Rank > 0, "Rank zero tensors are forbidden.");
+
+  DynamicTensor() = default;
+
+  explicit DynamicTensor(size_t dimension, const T &value = T())
+      : m_dimension(dimension),
+        m_data(dynamic_detail::power(dimension, Rank), value) {}
+
+  /// Create a DynamicTensor of the given dimension by evaluating an expression
+  template <typename T1>
+  DynamicTensor(size_t dimension,
+                const TensorExpression<Rank, T1, dynamic_size> &expression)
+      : DynamicTensor(dimension) {
+    operator=(expression);
+  }
+
+  /// Evaluates an expression; the dimension of the tensor is unchanged
+  /** Throws std::invalid_argument if a tensor in the expression has a
+   * different dimension. */
+  template <typename T1>
+  DynamicTensor &
+  operator=(const TensorExpression<Rank, T1, dynamic_size> &expression) {
+    apply(static_cast<const T1 &>(expression),
+          [](T &component, const auto &value) { component = value; });
+    return *this;
+  }
+
+  DynamicTensor &operator=(const T &value) {
+    std::fill(m_data.begin(), m_data.end(), value);
+    return *this;
+  }
+
+  static constexpr size_t size() { return dynamic_size; }
+  static constexpr size_t rank() { return Rank; }
+
+  /// The number of values each index can take
+  size_t dimension() const { return m_dimension; }
+  size_t num_components() const { return m_data.size(); }
+
+  template <typename... Indices> size_t offset(Indices... is) const {
+    static_assert(sizeof...(Indices) == Rank,
+                  "DynamicTensor needs one index per rank.");
+    const size_t indices[] = {static_cast<size_t>(is)...};
+    size_t offset = 0;
+    for (size_t index : indices) {
+      offset = offset * m_dimension + index;
+    }
+    return offset;
+  }
+
+  template <typename... Indices>
+  std::enable_if_t<!dynamic_detail::contains_probe<Indices...>::value,
+                   const T &>
+  eval(Indices... is) const {
+    return m_data[offset(is...)];
+  }
+
+  /// Checks the dimension (see DimensionProbe); returns one, which keeps
+  /// quotients of integers defined
+  template <typename... Indices>
+  std::enable_if_t<dynamic_detail::contains_probe<Indices...>::value, T>
+  eval(const Indices &... is) const {
+    const dynamic_detail::DimensionProbe &probe =
+        dynamic_detail::find_probe(is...);
+    *probe.mismatch |= (probe.dimension != m_dimension);
+    return T(1);
+  }
+
+  /// Component access with all indices at once (e.g. tensor(i, j))
+  template <typename... Indices> const T &operator()(Indices... is) const {
+    return m_data[offset(is...)];
+  }
+  template <typename... Indices> T &operator()(Indices... is) {
+    return m_data[offset(is...)];
+  }
+
+  using iterator = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  const T *data() const { return m_data.data(); }
+  T *data() { return m_data.data(); }
+
+  iterator begin() { return m_data.begin(); }
+  iterator end() { return m_data.end(); }
+  const_iterator begin() const { return m_data.begin(); }
+  const_iterator end() const { return m_data.end(); }
+
+  template <typename T1>
+  DynamicTensor &
+  operator+=(const TensorExpression<Rank, T1, dynamic_size> &expression) {
+    apply(static_cast<const T1 &>(expression),
+          [](T &component, const auto &value) { component += value; });
+    return *this;
+  }
+
+  template <typename T1>
+  DynamicTensor &
+  operator-=(const TensorExpression<Rank, T1, dynamic_size> &expression) {
+    apply(static_cast<const T1 &>(expression),
+          [](T &component, const auto &value) { component -= value; });
+    return *this;
+  }
+
+  DynamicTensor &operator*=(const T &value) {
+    for (auto &component : m_data) {
+      component *= value;
+    }
+    return *this;
+  }
+
+  DynamicTensor &operator/=(const T &value) {
+    for (auto &component : m_data) {
+      component /= value;
+    }
+    return *this;
+  }
+};
+
+template <size_t Rank, typename T>
+bool operator==(const DynamicTensor<Rank, T> &t1,
+                const DynamicTensor<Rank, T> &t2) {
+  return t1.dimension() == t2.dimension() &&
+         std::equal(t1.begin(), t1.end(), t2.begin());
+}
+
+template <size_t Rank, typename T>
+bool operator!=(const DynamicTensor<Rank, T> &t1,
+                const DynamicTensor<Rank, T> &t2) {
+  return !(t1 == t2);
+}
+
+// Unevaluated expressions of dynamic tensors cannot be compared or written as
+// they do not know their size; assign them to a DynamicTensor first.
+template <size_t Rank, typename T1, typename T2>
+bool operator==(const TensorExpression<Rank, T1, dynamic_size> &,
+                const TensorExpression<Rank, T2, dynamic_size> &) = delete;
+template <size_t Rank, typename T1, typename T2>
+bool operator!=(const TensorExpression<Rank, T1, dynamic_size> &,
+                const TensorExpression<Rank, T2, dynamic_size> &) = delete;
+template <size_t Rank, typename T>
+std::ostream &operator<<(std::ostream &,
+                         const TensorExpression<Rank, T, dynamic_size> &) =
+    delete;
+
+template <size_t Rank, typename T>
+std::ostream &operator<<(std::ostream &os,
+                         const DynamicTensor<Rank, T> &tensor) {
+  const T *component = tensor.data();
+  dynamic_detail::write_components(os, component, tensor.dimension(), Rank);
+  return os;
+}
+
+/// Dot product of two dynamic tensors (contracts the last index of the first
+/// with the first index of the second)
+/** Evaluated immediately by a blocked, multithreaded matrix multiplication. */
+template <size_t Rank1, size_t Rank2, typename T>
+std::enable_if_t<(Rank1 + Rank2 > 2), DynamicTensor<Rank1 + Rank2 - 2, T>>
+dot(const DynamicTensor<Rank1, T> &t1, const DynamicTensor<Rank2, T> &t2) {
+  const size_t dimension = t1.dimension();
+  if (t2.dimension() != dimension) {
+    throw std::invalid_argument("dot: tensors of different dimension");
+  }
+  DynamicTensor<Rank1 + Rank2 - 2, T> result(dimension);
+  dynamic_detail::multiply_matrices(
+      t1.data(), t2.data(), result.data(),
+      dynamic_detail::power(dimension, Rank1 - 1), dimension,
+      dynamic_detail::power(dimension, Rank2 - 1));
+  return result;
+}
+
+/// Dot product of two dynamic vectors
+template <typename T>
+T dot(const DynamicTensor<1, T> &t1, const DynamicTensor<1, T> &t2) {
+  const size_t dimension = t1.dimension();
+  if (t2.dimension() != dimension) {
+    throw std::invalid_argument("dot: tensors of different dimension");
+  }
+  const T *data1 = t1.data();
+  const T *data2 = t2.data();
+  return dynamic_detail::parallel_sum<T>(
+      dimension, dimension, [=](size_t begin, size_t end) {
+        return dynamic_detail::dot_product(data1 + begin, data2 + begin,
+                                           end - begin);
+      });
+}
+
+// The generic scalar dot product loops up to size(); not usable here
+template <typename T1, typename T2>
+auto dot(const TensorExpression<1, T1, dynamic_size> &,
+         const TensorExpression<1, T2, dynamic_size> &) = delete;
+
+/// Computes the trace of a dynamic matrix
+template <typename T> T trace(const DynamicTensor<2, T> &matrix) {
+  const size_t dimension = matrix.dimension();
+  const T *data = matrix.data();
+  return dynamic_detail::parallel_sum<T>(
+      dimension, dimension, [=](size_t begin, size_t end) {
+        T trace = T(0);
+        for (size_t i = begin; i < end; ++i) {
+          trace += data[i * (dimension + 1)];
+        }
+        return trace;
+      });
+}
+
+/// Computes the trace of a dynamic 2-tensor with lower indices given an
+/// inverse metric
+/** Equal to trace(dot(inverse_metric, tensor_LL)), but only needs the diagonal
+ * of the product and hence O(dimension^2) operations. */
+template <typename T>
+T trace(const DynamicTensor<2, T> &tensor_LL,
+        const DynamicTensor<2, T> &inverse_metric) {
+  const size_t dimension = tensor_LL.dimension();
+  if (inverse_metric.dimension() != dimension) {
+    throw std::invalid_argument("trace: tensors of different dimension");
+  }
+  const T *tensor = tensor_LL.data();
+  const T *metric = inverse_metric.data();
+  return dynamic_detail::parallel_sum<T>(
+      dimension, dimension * dimension, [=](size_t begin, size_t end) {
+        // sum_ij metric[i][j] * tensor[j][i]; the transposed access is done
+        // in square blocks so that the columns of tensor stay in the cache.
+        // One partial sum per column avoids a chain of dependent additions.
+        constexpr size_t block = 32;
+        T partial_sums[block] = {};
+        for (size_t i0 = begin; i0 < end; i0 += block) {
+          const size_t i1 = std::min(i0 + block, end);
+          for (size_t j0 = 0; j0 < dimension; j0 += block) {
+            const size_t width = std::min(j0 + block, dimension) - j0;
+            for (size_t i = i0; i < i1; ++i) {
+              const T *metric_row = metric + i * dimension + j0;
+              const T *tensor_column = tensor + j0 * dimension + i;
+              for (size_t j = 0; j < width; ++j) {
+                partial_sums[j] += metric_row[j] * tensor_column[j * dimension];
+              }
+            }
+          }
+        }
+        T trace = T(0);
+        for (size_t j = 0; j < block; ++j) {
+          trace += partial_sums[j];
+        }
+        return trace;
+      });
+}
+
+template <typename T>
+auto trace(const TensorExpression<2, T, dynamic_size> &) = delete;
+
+} // namespace tensoralgebra
+
+#endif
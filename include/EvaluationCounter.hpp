@@ -0,0 +1,209 @@
+#ifndef _TENSORALGEBRA_EVALUATIONCOUNTER_HPP
+#define _TENSORALGEBRA_EVALUATIONCOUNTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// This file defines the optional instrumentation of the expression templates.
+// If TENSORALGEBRA_COUNT_EVALUATIONS is defined before the first include of a
+// tensoralgebra header, every expression node counts (per node type, e.g. Sum,
+// Dot, Exp) how often it is evaluated and how many arithmetic operations and
+// function calls (exp, sqrt, ...) on components this involves. Evaluations of
+// tensors themselves are counted as reads of the node Tensor. This shows
+// redundant recomputation (e.g. a Dot nested in a Dot is evaluated once for
+// every component of the outer one) without changing the kernels. Without the
+// macro the instrumentation compiles to nothing.
+//
+// The counters are global and atomic, so they can be used from several
+// threads; they must be reset between measurements. Evaluations which only
+// inspect an expression (such as the dimension check of DynamicTensor) are
+// made while a PausedEvaluationCounts exists and are not counted.
+
+namespace tensoralgebra {
+
+/// Number of evaluations of one type of expression node, and the component
+/// operations carried out by it
+struct EvaluationCount {
+  std::string node;
+  uint64_t evaluations = 0;
+  uint64_t arithmetic = 0;
+  uint64_t transcendental = 0;
+};
+
+namespace evaluation_counter_detail {
+struct Counters {
+  std::atomic<uint64_t> evaluations{0};
+  std::atomic<uint64_t> arithmetic{0};
+  std::atomic<uint64_t> transcendental{0};
+
+  void add(uint64_t num_arithmetic, uint64_t num_transcendental) {
+    evaluations.fetch_add(1, std::memory_order_relaxed);
+    arithmetic.fetch_add(num_arithmetic, std::memory_order_relaxed);
+    transcendental.fetch_add(num_transcendental, std::memory_order_relaxed);
+  }
+};
+
+class Registry {
+  std::mutex m_mutex;
+  std::map<std::string, std::unique_ptr<Counters>> m_counters;
+
+public:
+  // Only called once per node type and call site, the result is cached
+  Counters &counters(const char *node) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &counters = m_counters[node];
+    if (!counters) {
+      counters = std::make_unique<Counters>();
+    }
+    return *counters;
+  }
+
+  std::vector<EvaluationCount> report() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<EvaluationCount> result;
+    for (const auto &entry : m_counters) {
+      EvaluationCount count;
+      count.node = entry.first;
+      count.evaluations = entry.second->evaluations.load();
+      count.arithmetic = entry.second->arithmetic.load();
+      count.transcendental = entry.second->transcendental.load();
+      if (count.evaluations > 0) {
+        result.push_back(count);
+      }
+    }
+    return result;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &entry : m_counters) {
+      entry.second->evaluations = 0;
+      entry.second->arithmetic = 0;
+      entry.second->transcendental = 0;
+    }
+  }
+};
+
+inline Registry &registry() {
+  static Registry registry;
+  return registry;
+}
+
+/// Whether counting is paused on the calling thread
+inline bool &paused() {
+  thread_local bool paused = false;
+  return paused;
+}
+} // namespace evaluation_counter_detail
+
+/// Pauses counting on the calling thread for its lifetime
+#ifdef TENSORALGEBRA_COUNT_EVALUATIONS
+class PausedEvaluationCounts {
+  bool m_was_paused;
+
+public:
+  PausedEvaluationCounts()
+      : m_was_paused(evaluation_counter_detail::paused()) {
+    evaluation_counter_detail::paused() = true;
+  }
+  ~PausedEvaluationCounts() {
+    evaluation_counter_detail::paused() = m_was_paused;
+  }
+  PausedEvaluationCounts(const PausedEvaluationCounts &) = delete;
+  PausedEvaluationCounts &operator=(const PausedEvaluationCounts &) = delete;
+};
+#else
+class PausedEvaluationCounts {
+public:
+  PausedEvaluationCounts() {} // User provided, so that it isn't "unused"
+};
+#endif
+
+/// Whether the expression templates have been compiled with instrumentation
+constexpr bool counts_evaluations() {
+#ifdef TENSORALGEBRA_COUNT_EVALUATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// The counts of all node types evaluated since the last reset, sorted by name
+inline std::vector<EvaluationCount> evaluation_report() {
+  return evaluation_counter_detail::registry().report();
+}
+
+/// Sets all counts to zero
+inline void reset_evaluation_counts() {
+  evaluation_counter_detail::registry().reset();
+}
+
+/// Resets the counts, calls f (e.g. a lambda containing an assignment) and
+/// returns the counts for it
+template <typename F> std::vector<EvaluationCount> count_evaluations(F &&f) {
+  reset_evaluation_counts();
+  f();
+  return evaluation_report();
+}
+
+/// Writes a report as a table, with the totals in the last line
+inline void
+write_evaluation_report(std::ostream &os,
+                        const std::vector<EvaluationCount> &report) {
+  size_t width = 5;
+  for (const auto &count : report) {
+    width = std::max(width, count.node.size());
+  }
+  const std::ios_base::fmtflags flags = os.flags();
+  auto write_line = [&os, width](const std::string &node,
+                                 const auto &evaluations,
+                                 const auto &arithmetic,
+                                 const auto &transcendental) {
+    os << std::left << std::setw(width) << node << std::right << std::setw(14)
+       << evaluations << std::setw(14) << arithmetic << std::setw(16)
+       << transcendental << "\n";
+  };
+  write_line("node", "evaluations", "arithmetic", "transcendental");
+  EvaluationCount total;
+  for (const auto &count : report) {
+    write_line(count.node, count.evaluations, count.arithmetic,
+               count.transcendental);
+    total.evaluations += count.evaluations;
+    total.arithmetic += count.arithmetic;
+    total.transcendental += count.transcendental;
+  }
+  write_line("total", total.evaluations, total.arithmetic,
+             total.transcendental);
+  os.flags(flags);
+}
+
+} // namespace tensoralgebra
+
+/// Records one evaluation of the expression node `node` (a string literal)
+/// involving `arithmetic` arithmetic operations and `transcendental` function
+/// calls on components, unless counting is paused on the calling thread.
+/// Expands to nothing unless TENSORALGEBRA_COUNT_EVALUATIONS is defined.
+#ifdef TENSORALGEBRA_COUNT_EVALUATIONS
+#define TENSORALGEBRA_COUNT_EVALUATION(node, arithmetic, transcendental)       \
+  do {                                                                         \
+    static auto &tensoralgebra_counters =                                      \
+        ::tensoralgebra::evaluation_counter_detail::registry().counters(node); \
+    if (!::tensoralgebra::evaluation_counter_detail::paused()) {               \
+      tensoralgebra_counters.add(arithmetic, transcendental);                  \
+    }                                                                          \
+  } while (false)
+#else
+#define TENSORALGEBRA_COUNT_EVALUATION(node, arithmetic, transcendental)       \
+  do {                                                                         \
+  } while (false)
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef _TENSORALGEBRA_FIRSTTOUCH_HPP
+#define _TENSORALGEBRA_FIRSTTOUCH_HPP
+
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include <cstddef>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// This file defines allocation of fields for machines with several memory
+// (NUMA) nodes, e.g. dual socket nodes. Linux places a page on the node of the
+// CPU which first writes to it, so memory initialised by a single thread ends
+// up on a single node and parallel sweeps over it only get that node's
+// bandwidth.
+//
+// FirstTouchAllocator maps fresh pages and has them first written by
+// parallel_for, with the same static partition (and the same number of
+// threads) as the sweeps over the field, so each thread's range of points lies
+// on its own node. Threads are only guaranteed to stay next to their memory if
+// they are bound to CPUs, e.g. node by node:
+//
+//   tensoralgebra::set_thread_cpus(tensoralgebra::cpus_by_numa_node());
+//   tensoralgebra::FirstTouchTensorField<2> metric(128, 128, 128);
+//   tensoralgebra::parallel_for(0, metric.num_points(), ...);
+
+namespace tensoralgebra {
+
+namespace first_touch_detail {
+// Parses a Linux CPU list such as "0-3,8,10-11"
+inline std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    const int first = std::stoi(range.substr(0, dash));
+    const int last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+} // namespace first_touch_detail
+
+/// The CPUs of each NUMA node, read from /sys/devices/system/node
+/** Returns a single node with all hardware threads if the information is not
+ * available. */
+inline std::vector<std::vector<int>> numa_node_cpus() {
+  std::vector<std::vector<int>> nodes;
+  for (int node = 0;; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" +
+                       std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!file || !std::getline(file, list)) {
+      break;
+    }
+    nodes.push_back(first_touch_detail::parse_cpu_list(list));
+  }
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+      nodes.back().push_back(int(cpu));
+    }
+  }
+  return nodes;
+}
+
+/// All CPUs, node after node, for set_thread_cpus: consecutive chunks of
+/// parallel_for then run on the same node
+inline std::vector<int> cpus_by_numa_node() {
+  std::vector<int> cpus;
+  for (const std::vector<int> &node : numa_node_cpus()) {
+    cpus.insert(cpus.end(), node.begin(), node.end());
+  }
+  return cpus;
+}
+
+/// Allocator whose pages are first touched by the threads of parallel_for
+/** Element n of an allocation of count elements is touched by the thread
+ * which runs it in parallel_for(0, count, ..., num_threads). The memory is
+ * mapped directly from the system and is page aligned. */
+template <typename T> class FirstTouchAllocator {
+  size_t m_num_threads;
+
+  template <typename U> friend class FirstTouchAllocator;
+
+public:
+  using value_type = T;
+
+  explicit FirstTouchAllocator(size_t num_threads = default_num_threads())
+      : m_num_threads(num_threads) {}
+  template <typename U>
+  FirstTouchAllocator(const FirstTouchAllocator<U> &other)
+      : m_num_threads(other.m_num_threads) {}
+
+  size_t num_threads() const { return m_num_threads; }
+
+  T *allocate(size_t n) {
+    if (n == 0) {
+      return nullptr;
+    }
+    const size_t bytes = n * sizeof(T);
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    // Touch every page in the chunk of the thread which will use it
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    char *bytes_begin = static_cast<char *>(memory);
+    parallel_for(
+        0, n,
+        [&](size_t begin, size_t end) {
+          const size_t first = (begin * sizeof(T) + page - 1) / page * page;
+          for (size_t byte = first; byte < end * sizeof(T); byte += page) {
+            bytes_begin[byte] = 0;
+          }
+        },
+        m_num_threads);
+    return static_cast<T *>(memory);
+  }
+
+  void deallocate(T *pointer, size_t n) noexcept {
+    if (pointer != nullptr) {
+      munmap(pointer, n * sizeof(T));
+    }
+  }
+
+  // Any allocator can release the memory of any other
+  template <typename U>
+  bool operator==(const FirstTouchAllocator<U> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const FirstTouchAllocator<U> &) const {
+    return false;
+  }
+};
+
+/// A TensorField whose pages are first touched by the threads of parallel_for
+template <size_t Rank, typename T = double, size_t Size = 3>
+using FirstTouchTensorField =
+    TensorField<Rank, T, Size, FirstTouchAllocator<Tensor<Rank, T, Size>>>;
+
+} // namespace tensoralgebra
+
+#endif
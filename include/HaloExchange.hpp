@@ -0,0 +1,459 @@
+#ifndef _TENSORALGEBRA_HALOEXCHANGE_HPP
+#define _TENSORALGEBRA_HALOEXCHANGE_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// This file defines the decomposition of a box of grid points into slabs along
+// z, one for each of several processes on the same machine (e.g. one per
+// socket), and the exchange of the ghost planes of their tensor fields through
+// POSIX shared memory. A slab owns all points of its planes, so its halo is
+// a few whole z planes, which are contiguous in a TensorField: packing copies
+// them, for all components of all tensors of all fields of a rank, into one
+// contiguous buffer with one memcpy per field and direction.
+//
+// The exchange is split into start(), which packs, and finish(), which waits
+// and unpacks. The points which don't depend on the ghost planes are evaluated
+// in between; this only hides the time the neighbours take to pack (or to
+// reach start()), not the copies of the rank itself:
+//
+//   tensoralgebra::SlabDecomposition slabs({{128, 128, 128}}, 2, 3);
+//   tensoralgebra::TensorField<2> metric(slabs.local_extent(rank));
+//   tensoralgebra::HaloExchange halo("/evolution", slabs, rank, metric);
+//   halo.exchange([&](size_t begin, size_t end) {
+//     rhs.assign(begin, end, [&](size_t p) { return ...; });
+//   });
+//   for (auto range : halo.boundary_points()) {
+//     rhs.assign(range.begin, range.end, [&](size_t p) { return ...; });
+//   }
+//
+// All processes construct their HaloExchange with the same name, decomposition
+// and field types; the constructor returns once all of them are attached. On
+// glibc older than 2.34, link with -lrt.
+
+namespace tensoralgebra {
+
+/// A contiguous range [begin, end) of points of a field
+struct PointRange {
+  size_t begin;
+  size_t end;
+};
+
+/// Decomposition of a box of grid points into one slab along z per rank
+/** Each rank owns the z planes [z_begin(rank), z_end(rank)) of the global box,
+ * split as evenly as possible, and stores them in a field of extent
+ * local_extent(rank) with ghosts() additional planes on either side. Ranks
+ * without a neighbour on a side (only at the ends of a non-periodic box) keep
+ * the ghost planes on that side for boundary conditions. */
+class SlabDecomposition {
+  std::array<size_t, 3> m_global_extent;
+  size_t m_num_ranks;
+  size_t m_ghosts;
+  bool m_periodic;
+
+public:
+  /// Returned by lower_neighbour() and upper_neighbour() if there is none
+  static constexpr size_t no_neighbour = static_cast<size_t>(-1);
+
+  SlabDecomposition(const std::array<size_t, 3> &global_extent,
+                    size_t num_ranks, size_t ghosts, bool periodic = false)
+      : m_global_extent(global_extent), m_num_ranks(num_ranks),
+        m_ghosts(ghosts), m_periodic(periodic) {
+    if (num_ranks == 0 || ghosts == 0) {
+      throw std::invalid_argument(
+          "SlabDecomposition: needs at least one rank and one ghost plane");
+    }
+    if (global_extent[2] / num_ranks < ghosts) {
+      throw std::invalid_argument(
+          "SlabDecomposition: every slab must be at least as thick as the "
+          "ghost region");
+    }
+  }
+
+  const std::array<size_t, 3> &global_extent() const {
+    return m_global_extent;
+  }
+  size_t num_ranks() const { return m_num_ranks; }
+  size_t ghosts() const { return m_ghosts; }
+  bool periodic() const { return m_periodic; }
+
+  /// The global z planes owned by rank
+  size_t z_begin(size_t rank) const {
+    const size_t nz = m_global_extent[2];
+    return rank * (nz / m_num_ranks) + std::min(rank, nz % m_num_ranks);
+  }
+  size_t z_end(size_t rank) const { return z_begin(rank + 1); }
+  size_t num_planes(size_t rank) const { return z_end(rank) - z_begin(rank); }
+
+  /// The extent of the field of rank, including the ghost planes
+  std::array<size_t, 3> local_extent(size_t rank) const {
+    return {{m_global_extent[0], m_global_extent[1],
+             num_planes(rank) + 2 * m_ghosts}};
+  }
+
+  /// The rank owning the planes below (above) those of rank
+  size_t lower_neighbour(size_t rank) const {
+    if (rank > 0) {
+      return rank - 1;
+    }
+    return m_periodic ? m_num_ranks - 1 : no_neighbour;
+  }
+  size_t upper_neighbour(size_t rank) const {
+    if (rank + 1 < m_num_ranks) {
+      return rank + 1;
+    }
+    return m_periodic ? 0 : no_neighbour;
+  }
+};
+
+/// Statistics of a HaloExchange
+struct HaloExchangeStatistics {
+  size_t exchanges = 0;       // number of completed exchanges
+  size_t bytes_sent = 0;      // bytes packed for the neighbours
+  double pack_seconds = 0.;   // time spent packing in start()
+  double wait_seconds = 0.;   // time spent in finish() waiting for neighbours
+  double unpack_seconds = 0.; // time spent unpacking in finish()
+};
+
+namespace halo_exchange_detail {
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "Shared memory synchronisation needs lock-free 64 bit atomics.");
+
+constexpr size_t cache_line = 64;
+
+inline size_t round_up(size_t bytes) {
+  return (bytes + cache_line - 1) / cache_line * cache_line;
+}
+
+// At the start of the segment, followed by one Slot per rank and the buffers
+struct Header {
+  std::atomic<uint64_t> layout;   // identifies the configuration
+  std::atomic<uint64_t> attached; // number of ranks which have attached
+};
+
+// The last exchange for which the buffers of a rank are packed
+struct alignas(cache_line) Slot {
+  std::atomic<uint64_t> posted;
+};
+
+inline uint64_t combine(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 1099511628211ull;
+}
+
+// A field as a number of contiguous z planes of plane_bytes bytes
+struct FieldPlanes {
+  char *data;
+  size_t plane_bytes;
+};
+} // namespace halo_exchange_detail
+
+/// Exchanges the ghost planes of the fields of one rank of a
+/// SlabDecomposition with its neighbours through POSIX shared memory
+/** Every rank packs its outermost owned planes into buffers in a shared memory
+ * segment and copies its ghost planes from the buffers of its neighbours.
+ * The buffers are double buffered and each rank announces a packed exchange
+ * with a counter, so the ranks only wait for their neighbours, never for all
+ * ranks, and need no acknowledgement before reusing a buffer (a neighbour
+ * can't be more than one exchange ahead).
+ * The segment is unlinked once all ranks are attached, so no name is left
+ * behind if a rank fails later. Waiting for a neighbour throws a
+ * std::runtime_error after timeout().
+ */
+class HaloExchange {
+  using clock = std::chrono::steady_clock;
+  using Header = halo_exchange_detail::Header;
+  using Slot = halo_exchange_detail::Slot;
+
+  SlabDecomposition m_slabs;
+  size_t m_rank;
+  std::vector<halo_exchange_detail::FieldPlanes> m_fields;
+  size_t m_packed_bytes = 0; // bytes packed per direction
+  size_t m_buffer_bytes = 0; // m_packed_bytes rounded up to cache lines
+  void *m_segment = nullptr;
+  size_t m_segment_bytes = 0;
+  uint64_t m_exchange = 0;
+  bool m_started = false;
+  std::chrono::milliseconds m_timeout = std::chrono::seconds(60);
+  HaloExchangeStatistics m_statistics;
+
+  static double seconds_since(clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  template <size_t Rank, typename T, size_t Size, typename Allocator,
+            typename... Fields>
+  void add_fields(TensorField<Rank, T, Size, Allocator> &field,
+                  Fields &... fields) {
+    if (field.extent() != m_slabs.local_extent(m_rank)) {
+      throw std::invalid_argument(
+          "HaloExchange: field extent does not match the local extent of the "
+          "slab");
+    }
+    m_fields.push_back({reinterpret_cast<char *>(field.data()),
+                        field.extent(0) * field.extent(1) *
+                            sizeof(Tensor<Rank, T, Size>)});
+    add_fields(fields...);
+  }
+  void add_fields() {}
+
+  Header &header() const { return *static_cast<Header *>(m_segment); }
+  Slot &slot(size_t rank) const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(m_segment) +
+                                    halo_exchange_detail::cache_line)[rank];
+  }
+  // The buffer of rank for the neighbour below (direction 0) or above (1)
+  char *buffer(size_t rank, size_t direction, uint64_t exchange) const {
+    const size_t index = (rank * 2 + direction) * 2 + exchange % 2;
+    return static_cast<char *>(m_segment) +
+           halo_exchange_detail::cache_line * (1 + m_slabs.num_ranks()) +
+           index * m_buffer_bytes;
+  }
+
+  uint64_t layout() const {
+    using halo_exchange_detail::combine;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t dir = 0; dir < 3; ++dir) {
+      hash = combine(hash, m_slabs.global_extent()[dir]);
+    }
+    hash = combine(hash, m_slabs.num_ranks());
+    hash = combine(hash, m_slabs.ghosts());
+    hash = combine(hash, m_slabs.periodic());
+    for (const auto &field : m_fields) {
+      hash = combine(hash, field.plane_bytes);
+    }
+    return hash | 1; // Zero means not yet set
+  }
+
+  template <typename Predicate>
+  void wait_for(Predicate &&predicate, const char *what) const {
+    const auto start = clock::now();
+    for (size_t spins = 0; !predicate(); ++spins) {
+      if (spins > 64) {
+        std::this_thread::yield();
+      }
+      if (spins % 1024 == 0 && clock::now() - start > m_timeout) {
+        throw std::runtime_error(std::string("HaloExchange: timed out ") +
+                                 what);
+      }
+    }
+  }
+
+  void attach(const std::string &name) {
+    if (name.size() < 2 || name[0] != '/' ||
+        name.find('/', 1) != std::string::npos) {
+      throw std::invalid_argument("HaloExchange: the shared memory name must "
+                                  "be of the form /name");
+    }
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("HaloExchange: could not open shared memory " +
+                               name);
+    }
+    // Every rank sets the same size; new pages are zero
+    if (ftruncate(fd, m_segment_bytes) != 0) {
+      close(fd);
+      throw std::runtime_error("HaloExchange: could not resize shared memory " +
+                               name);
+    }
+    m_segment = mmap(nullptr, m_segment_bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid after closing the file
+    if (m_segment == MAP_FAILED) {
+      m_segment = nullptr;
+      throw std::runtime_error("HaloExchange: could not map shared memory " +
+                               name);
+    }
+
+    uint64_t expected = 0;
+    const uint64_t own_layout = layout();
+    if (!header().layout.compare_exchange_strong(expected, own_layout) &&
+        expected != own_layout) {
+      detach();
+      throw std::invalid_argument(
+          "HaloExchange: the ranks attached to " + name +
+          " use different decompositions or fields");
+    }
+    const size_t num_ranks = m_slabs.num_ranks();
+    if (header().attached.fetch_add(1) >= num_ranks) {
+      detach();
+      throw std::runtime_error("HaloExchange: shared memory " + name +
+                               " is left over from an earlier run");
+    }
+    try {
+      wait_for([&] { return header().attached.load() >= num_ranks; },
+               "waiting for all ranks to attach");
+    } catch (...) {
+      detach();
+      throw;
+    }
+    if (m_rank == 0) {
+      shm_unlink(name.c_str());
+    }
+  }
+
+  void detach() {
+    if (m_segment) {
+      munmap(m_segment, m_segment_bytes);
+    }
+    m_segment = nullptr;
+  }
+
+  // Copies planes [first, first + ghosts) of all fields to or from buffer
+  void pack(char *buffer, size_t first) const {
+    for (const auto &field : m_fields) {
+      const size_t bytes = m_slabs.ghosts() * field.plane_bytes;
+      std::memcpy(buffer, field.data + first * field.plane_bytes, bytes);
+      buffer += bytes;
+    }
+  }
+  void unpack(const char *buffer, size_t first) const {
+    for (const auto &field : m_fields) {
+      const size_t bytes = m_slabs.ghosts() * field.plane_bytes;
+      std::memcpy(field.data + first * field.plane_bytes, buffer, bytes);
+      buffer += bytes;
+    }
+  }
+
+public:
+  /// Attaches rank to the shared memory segment name (of the form /name) and
+  /// waits for the other ranks
+  /** The fields are those of this rank, of extent slabs.local_extent(rank),
+   * and must be of the same types and in the same order on all ranks. They
+   * must not be moved or resized while the HaloExchange exists. */
+  template <typename... Fields>
+  HaloExchange(const std::string &name, const SlabDecomposition &slabs,
+               size_t rank, Fields &... fields)
+      : m_slabs(slabs), m_rank(rank) {
+    static_assert(sizeof...(Fields) > 0, "Nothing to exchange.");
+    if (rank >= slabs.num_ranks()) {
+      throw std::out_of_range("HaloExchange: rank out of range");
+    }
+    add_fields(fields...);
+    for (const auto &field : m_fields) {
+      m_packed_bytes += slabs.ghosts() * field.plane_bytes;
+    }
+    m_buffer_bytes = halo_exchange_detail::round_up(m_packed_bytes);
+    m_segment_bytes = halo_exchange_detail::cache_line *
+                          (1 + slabs.num_ranks()) +
+                      4 * slabs.num_ranks() * m_buffer_bytes;
+    attach(name);
+  }
+
+  HaloExchange(const HaloExchange &) = delete;
+  HaloExchange &operator=(const HaloExchange &) = delete;
+
+  ~HaloExchange() { detach(); }
+
+  const SlabDecomposition &decomposition() const { return m_slabs; }
+  size_t rank() const { return m_rank; }
+  const HaloExchangeStatistics &statistics() const { return m_statistics; }
+
+  std::chrono::milliseconds timeout() const { return m_timeout; }
+  void set_timeout(std::chrono::milliseconds timeout) { m_timeout = timeout; }
+
+  /// The points of the local fields whose neighbours up to ghosts() planes
+  /// away are all owned, i.e. which can be evaluated before finish()
+  PointRange interior_points() const {
+    const size_t g = m_slabs.ghosts();
+    const size_t plane = m_slabs.global_extent()[0] *
+                         m_slabs.global_extent()[1];
+    const size_t last = m_slabs.num_planes(m_rank);
+    return {2 * g * plane, std::max(2 * g, last) * plane};
+  }
+
+  /// The owned points which are not interior points (below and above them)
+  std::array<PointRange, 2> boundary_points() const {
+    const size_t g = m_slabs.ghosts();
+    const size_t plane = m_slabs.global_extent()[0] *
+                         m_slabs.global_extent()[1];
+    const size_t last = m_slabs.num_planes(m_rank);
+    return {{{g * plane, std::min(2 * g, last + g) * plane},
+             {std::max(2 * g, last) * plane, (last + g) * plane}}};
+  }
+
+  /// Packs the outermost owned planes for the neighbours; doesn't wait
+  void start() {
+    if (m_started) {
+      throw std::logic_error("HaloExchange: start() called twice");
+    }
+    const auto start_time = clock::now();
+    m_started = true;
+    ++m_exchange;
+    const size_t g = m_slabs.ghosts();
+    if (m_slabs.lower_neighbour(m_rank) != SlabDecomposition::no_neighbour) {
+      pack(buffer(m_rank, 0, m_exchange), g);
+      m_statistics.bytes_sent += m_packed_bytes;
+    }
+    if (m_slabs.upper_neighbour(m_rank) != SlabDecomposition::no_neighbour) {
+      pack(buffer(m_rank, 1, m_exchange), m_slabs.num_planes(m_rank));
+      m_statistics.bytes_sent += m_packed_bytes;
+    }
+    slot(m_rank).posted.store(m_exchange, std::memory_order_release);
+    m_statistics.pack_seconds += seconds_since(start_time);
+  }
+
+  /// Waits for the neighbours and copies their planes to the ghost planes
+  void finish() {
+    if (!m_started) {
+      throw std::logic_error("HaloExchange: finish() called before start()");
+    }
+    const size_t lower = m_slabs.lower_neighbour(m_rank);
+    const size_t upper = m_slabs.upper_neighbour(m_rank);
+    const auto receive = [&](size_t neighbour, size_t direction,
+                             size_t first) {
+      const auto wait_time = clock::now();
+      wait_for(
+          [&] {
+            return slot(neighbour).posted.load(std::memory_order_acquire) >=
+                   m_exchange;
+          },
+          "waiting for a neighbour");
+      const auto unpack_time = clock::now();
+      m_statistics.wait_seconds += seconds_since(wait_time);
+      unpack(buffer(neighbour, direction, m_exchange), first);
+      m_statistics.unpack_seconds += seconds_since(unpack_time);
+    };
+    if (lower != SlabDecomposition::no_neighbour) {
+      receive(lower, 1, 0);
+    }
+    if (upper != SlabDecomposition::no_neighbour) {
+      receive(upper, 0, m_slabs.num_planes(m_rank) + m_slabs.ghosts());
+    }
+    m_started = false;
+    ++m_statistics.exchanges;
+  }
+
+  /// start(), then interior(begin, end) for the interior points, then
+  /// finish()
+  /** The interior evaluation overlaps the packing of the neighbours only. */
+  template <typename F> void exchange(F &&interior) {
+    start();
+    const PointRange range = interior_points();
+    interior(range.begin, range.end);
+    finish();
+  }
+
+  void exchange() {
+    start();
+    finish();
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
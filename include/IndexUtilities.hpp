@@ -15,42 +15,52 @@ decltype(auto) apply_indices(T &&obj, size_t dir, IndexTs... dirs) {
   return apply_indices(std::forward<T>(obj)[dir], dirs...);
 }
 
+// Position (counting from 0) in the original index list of the index which
+// ends up at position (counting from 1) once indices have been inserted at
+// positions insert1 < insert2
+constexpr size_t original_position(size_t position, size_t insert1,
+                                   size_t insert2) {
+  return position - 1 - (position > insert1) - (position > insert2);
+}
+
+// Evaluates obj with inserted_dir inserted into dirs at positions Insert1 and
+// Insert2 (counting from 1). The indices are passed to eval in one go rather
+// than one by one via operator[], so no intermediate expressions (or template
+// instantiations) are created.
+template <size_t Insert1, size_t Insert2, typename T, size_t... Positions>
+decltype(auto) eval_with_inserted_index(const T &obj, size_t inserted_dir,
+                                        const size_t *dirs,
+                                        std::index_sequence<Positions...>) {
+  return obj.eval((Positions + 1 == Insert1 || Positions + 1 == Insert2
+                       ? inserted_dir
+                       : dirs[original_position(Positions + 1, Insert1,
+                                                Insert2)])...);
+}
+
 /// Inserts the index given by insert_dir at the location given by Position
-// Note: all the eval functions below will generate a new value - no need to
-// worry about allowing return by reference.
 template <size_t Position> struct IndexInserter {
-  template <typename T, typename... IndexTs>
-  static auto eval(const T &obj, size_t insert_dir, size_t dir,
-                   IndexTs... dirs) {
-    return IndexInserter<Position - 1>::eval(obj[dir], insert_dir, dirs...);
-  }
-};
-
-template <> struct IndexInserter<1> {
   template <typename T, typename... IndexTs>
   static decltype(auto) eval(const T &obj, size_t insert_dir, IndexTs... dirs) {
-    return obj.eval(insert_dir, dirs...);
+    const size_t indices[] = {static_cast<size_t>(dirs)..., 0};
+    return eval_with_inserted_index<Position, size_t(-1)>(
+        obj, insert_dir, indices,
+        std::make_index_sequence<sizeof...(IndexTs) + 1>());
   }
 };
 
 /// Inserts the index given by contract_dir into two locations given
 /// by Position1 and Position2.
 template <size_t Position1, size_t Position2> struct IndexContracter {
-  template <typename T, typename... IndexTs>
-  static auto eval(const T &obj, size_t contract_dir, size_t dir,
-                   IndexTs... dirs) {
-    static_assert(Position1 < Position2,
-                  "First index must be smaller than second");
-    return IndexContracter<Position1 - 1, Position2 - 1>::eval(
-        obj[dir], contract_dir, dirs...);
-  }
-};
+  static_assert(Position1 < Position2,
+                "First index must be smaller than second");
 
-template <size_t Position2> struct IndexContracter<1, Position2> {
   template <typename T, typename... IndexTs>
-  static auto eval(const T &obj, size_t contract_dir, IndexTs... dirs) {
-    return IndexInserter<Position2 - 1>::eval(obj[contract_dir], contract_dir,
-                                              dirs...);
+  static decltype(auto) eval(const T &obj, size_t contract_dir,
+                             IndexTs... dirs) {
+    const size_t indices[] = {static_cast<size_t>(dirs)..., 0};
+    return eval_with_inserted_index<Position1, Position2>(
+        obj, contract_dir, indices,
+        std::make_index_sequence<sizeof...(IndexTs) + 2>());
   }
 };
 
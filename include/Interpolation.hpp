@@ -0,0 +1,228 @@
+#ifndef _TENSORALGEBRA_INTERPOLATION_HPP
+#define _TENSORALGEBRA_INTERPOLATION_HPP
+
+#include "Parallel.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// This file defines the interpolation of tensor fields on uniform grids at
+// arbitrary points, e.g. on wave extraction spheres or at particle positions.
+// LagrangeInterpolator<Order> uses Order points per direction (2 for trilinear,
+// 4 for cubic interpolation). The stencil is centred on the point where
+// possible and shifted inwards at the boundaries.
+//
+// Points are processed in batches. For each batch the stencil positions and
+// the weights are computed for all points and directions at once, in loops
+// over the points which the compiler vectorizes. The weights are then shared
+// by all components: the tensors of Order neighbouring points in x are
+// contiguous, so each stencil row is accumulated with contiguous vector loads.
+// (Vectorizing the accumulation across points instead needs a gather per
+// component, which was several times slower in
+// benchmark/InterpolationBenchmark.cpp.)
+//
+//   tensoralgebra::LagrangeInterpolator<4> interpolator(origin, spacing);
+//   std::vector<tensoralgebra::Tensor<2>> metric_on_sphere =
+//       interpolator.interpolate(metric, sphere_points);
+
+namespace tensoralgebra {
+
+/// Interpolates tensor fields at arbitrary points with Lagrange polynomials
+/// through Order points per direction
+/** The point (i, j, k) of a field lies at origin + (i, j, k) * spacing.
+ * Directions in which the field has a single point are ignored. */
+template <size_t Order> class LagrangeInterpolator {
+  static_assert(Order >= 2, "At least two points per direction are needed.");
+
+public:
+  /// Number of points interpolated together
+  static constexpr size_t batch_size = 32;
+
+  using Point = std::array<double, 3>;
+
+private:
+  Point m_origin;
+  Point m_spacing;
+
+  // 1 / prod_{m != k} (k - m), the denominators of the Lagrange polynomials
+  static double inverse_denominator(size_t k) {
+    double denominator = 1.;
+    for (size_t m = 0; m < Order; ++m) {
+      if (m != k) {
+        denominator *= double(k) - double(m);
+      }
+    }
+    return 1. / denominator;
+  }
+
+  // The stencils and weights of one direction for a batch of points
+  struct Direction {
+    size_t num_points; // 1 for ignored directions, Order otherwise
+    size_t stride;     // in components
+    size_t first[batch_size];
+    double weights[Order][batch_size];
+  };
+
+  void stencils(Direction &direction, size_t dir, size_t extent,
+                size_t stride, const Point *points, size_t count) const {
+    direction.stride = stride;
+    if (extent == 1) {
+      direction.num_points = 1;
+      for (size_t b = 0; b < batch_size; ++b) {
+        direction.first[b] = 0;
+        direction.weights[0][b] = 1.;
+      }
+      return;
+    }
+    direction.num_points = Order;
+    std::array<double, Order> inverse_denominators;
+    for (size_t k = 0; k < Order; ++k) {
+      inverse_denominators[k] = inverse_denominator(k);
+    }
+    const double origin = m_origin[dir];
+    const double inverse_spacing = 1. / m_spacing[dir];
+    const double last_first = double(extent - Order);
+    for (size_t b = 0; b < count; ++b) {
+      const double u = (points[b][dir] - origin) * inverse_spacing;
+      const double first = std::min(
+          std::max(std::floor(u) - double(Order / 2 - 1), 0.), last_first);
+      const double t = u - first;
+      direction.first[b] = static_cast<size_t>(first);
+      for (size_t k = 0; k < Order; ++k) {
+        double weight = inverse_denominators[k];
+        for (size_t m = 0; m < Order; ++m) {
+          if (m != k) {
+            weight *= t - double(m);
+          }
+        }
+        direction.weights[k][b] = weight;
+      }
+    }
+  }
+
+  void check_point(const Point &point, size_t index,
+                   const std::array<size_t, 3> &extent) const {
+    for (size_t dir = 0; dir < 3; ++dir) {
+      if (extent[dir] == 1) {
+        continue;
+      }
+      const double u = (point[dir] - m_origin[dir]) / m_spacing[dir];
+      const double tolerance = 1e-10 * double(extent[dir]);
+      if (!(u >= -tolerance && u <= double(extent[dir] - 1) + tolerance)) {
+        throw std::out_of_range("LagrangeInterpolator: point " +
+                                std::to_string(index) +
+                                " lies outside the grid");
+      }
+    }
+  }
+
+  template <size_t Rank, typename T, size_t Size, typename Allocator>
+  void interpolate_batch(const TensorField<Rank, T, Size, Allocator> &field,
+                         const Point *points, size_t count,
+                         Tensor<Rank, T, Size> *values) const {
+    constexpr size_t num_components = component_count(Rank, Size);
+    Direction directions[3];
+    size_t stride = num_components;
+    for (size_t dir = 0; dir < 3; ++dir) {
+      stencils(directions[dir], dir, field.extent(dir), stride, points,
+               count);
+      stride *= field.extent(dir);
+    }
+
+    const T *components = field.components();
+    const Direction &x = directions[0], &y = directions[1],
+                    &z = directions[2];
+    for (size_t b = 0; b < count; ++b) {
+      const T *first = components + x.first[b] * x.stride +
+                       y.first[b] * y.stride + z.first[b] * z.stride;
+      T sums[num_components] = {};
+      for (size_t k = 0; k < z.num_points; ++k) {
+        for (size_t j = 0; j < y.num_points; ++j) {
+          const T *row = first + j * y.stride + k * z.stride;
+          const T yz_weight = y.weights[j][b] * z.weights[k][b];
+          for (size_t i = 0; i < x.num_points; ++i) {
+            const T weight = yz_weight * x.weights[i][b];
+            for (size_t c = 0; c < num_components; ++c) {
+              sums[c] += weight * row[i * x.stride + c];
+            }
+          }
+        }
+      }
+      T *value = reinterpret_cast<T *>(&values[b]);
+      for (size_t c = 0; c < num_components; ++c) {
+        value[c] = sums[c];
+      }
+    }
+  }
+
+public:
+  LagrangeInterpolator(const Point &origin, const Point &spacing)
+      : m_origin(origin), m_spacing(spacing) {}
+
+  const Point &origin() const { return m_origin; }
+  const Point &spacing() const { return m_spacing; }
+
+  /// Sets values[n] to the field interpolated at points[n]
+  /** Throws std::out_of_range if a point lies outside the grid and
+   * std::invalid_argument if the field has fewer than Order (but more than
+   * one) points in some direction. By default the batches are split between
+   * threads if there is enough work. */
+  template <size_t Rank, typename T, size_t Size, typename Allocator>
+  void interpolate(const TensorField<Rank, T, Size, Allocator> &field,
+                   const std::vector<Point> &points,
+                   std::vector<Tensor<Rank, T, Size>> &values,
+                   size_t num_threads = 0) const {
+    for (size_t dir = 0; dir < 3; ++dir) {
+      if (field.extent(dir) != 1 && field.extent(dir) < Order) {
+        throw std::invalid_argument(
+            "LagrangeInterpolator: the field has fewer points than the "
+            "interpolation order in direction " +
+            std::to_string(dir));
+      }
+    }
+    for (size_t n = 0; n < points.size(); ++n) {
+      check_point(points[n], n, field.extent());
+    }
+    values.resize(points.size());
+    const size_t num_batches = (points.size() + batch_size - 1) / batch_size;
+    if (num_threads == 0) {
+      num_threads = num_threads_for_work(points.size() * Order * Order *
+                                         Order * component_count(Rank, Size));
+    }
+    parallel_for(
+        0, num_batches,
+        [&](size_t batch_begin, size_t batch_end) {
+          for (size_t batch = batch_begin; batch < batch_end; ++batch) {
+            const size_t first = batch * batch_size;
+            const size_t remaining = points.size() - first;
+            const size_t count =
+                remaining < batch_size ? remaining : batch_size;
+            interpolate_batch(field, &points[first], count, &values[first]);
+          }
+        },
+        num_threads);
+  }
+
+  template <size_t Rank, typename T, size_t Size, typename Allocator>
+  std::vector<Tensor<Rank, T, Size>>
+  interpolate(const TensorField<Rank, T, Size, Allocator> &field,
+              const std::vector<Point> &points,
+              size_t num_threads = 0) const {
+    std::vector<Tensor<Rank, T, Size>> values;
+    interpolate(field, points, values, num_threads);
+    return values;
+  }
+};
+
+/// Trilinear interpolation
+using TrilinearInterpolator = LagrangeInterpolator<2>;
+
+} // namespace tensoralgebra
+
+#endif
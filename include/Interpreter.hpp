@@ -0,0 +1,957 @@
+#ifndef _TENSORALGEBRA_INTERPRETER_HPP
+#define _TENSORALGEBRA_INTERPRETER_HPP
+
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// This file defines an interpreter for tensor expressions which are only known
+// at run time, e.g. diagnostic quantities given in an input file:
+//
+//   tensoralgebra::Interpreter<3> interpreter;
+//   interpreter.bind("g_inv", inverse_metric_field);
+//   interpreter.bind("K", extrinsic_curvature_field);
+//   auto program = interpreter.compile("dot(K, raise_all(K, g_inv)) - "
+//                                      "trace(K, g_inv) * K");
+//   program.run(result_field);
+//
+// An expression is compiled once into a short list of instructions. Each
+// instruction is executed for a whole chunk of points before the next one, so
+// that the cost of decoding it is shared by all points of the chunk. Registers
+// store the tensors of a chunk like a field does, so fields are read in place,
+// the last instruction writes directly into the result, and the component
+// wise operations are single loops over all components of the chunk, which
+// the compiler vectorizes. Contractions are instantiated for the common ranks.
+//
+// The syntax is that of C++ expressions of this library:
+//   numbers, names of bound fields and constants, ( ), unary -, + - * /,
+//   the comparisons < > <= >= (giving 0 or 1), the component wise functions
+//   exp log log10 sqrt sin cos tan asin acos atan sinh cosh tanh abs,
+//   dot(a, b), dot(a, b, metric), outer(a, b), trace(a), trace(a, inverse),
+//   raise_all(a, inverse_metric) and lower_all(a, metric) for rank 1 and 2.
+// Scalars are tensors of rank 0; they can be combined with tensors of any rank
+// like the scalars of the expression templates. Errors are reported by
+// std::invalid_argument with the position in the expression.
+
+namespace tensoralgebra {
+
+namespace interpreter_detail {
+enum class OpCode : uint8_t {
+  copy,
+  add,
+  subtract,
+  multiply,
+  divide,
+  greater_equal,
+  less_equal,
+  greater,
+  less,
+  negate,
+  function,
+  dot,
+  outer,
+  trace
+};
+
+enum class Function : uint8_t {
+  exp,
+  log,
+  log10,
+  sqrt,
+  sin,
+  cos,
+  tan,
+  asin,
+  acos,
+  atan,
+  sinh,
+  cosh,
+  tanh,
+  abs
+};
+
+inline const std::map<std::string, Function> &function_names() {
+  static const std::map<std::string, Function> names = {
+      {"exp", Function::exp},     {"log", Function::log},
+      {"log10", Function::log10}, {"sqrt", Function::sqrt},
+      {"sin", Function::sin},     {"cos", Function::cos},
+      {"tan", Function::tan},     {"asin", Function::asin},
+      {"acos", Function::acos},   {"atan", Function::atan},
+      {"sinh", Function::sinh},   {"cosh", Function::cosh},
+      {"tanh", Function::tanh},   {"abs", Function::abs}};
+  return names;
+}
+
+template <typename T> T apply(Function function, T x) {
+  using std::abs;
+  switch (function) {
+  case Function::exp:
+    return std::exp(x);
+  case Function::log:
+    return std::log(x);
+  case Function::log10:
+    return std::log10(x);
+  case Function::sqrt:
+    return std::sqrt(x);
+  case Function::sin:
+    return std::sin(x);
+  case Function::cos:
+    return std::cos(x);
+  case Function::tan:
+    return std::tan(x);
+  case Function::asin:
+    return std::asin(x);
+  case Function::acos:
+    return std::acos(x);
+  case Function::atan:
+    return std::atan(x);
+  case Function::sinh:
+    return std::sinh(x);
+  case Function::cosh:
+    return std::cosh(x);
+  case Function::tanh:
+    return std::tanh(x);
+  case Function::abs:
+    return abs(x);
+  }
+  return x;
+}
+
+enum class Source : uint8_t { reg, input, constant };
+
+// An operand of an instruction: a register, a bound field or a constant
+struct Operand {
+  Source source;
+  uint8_t rank;
+  uint32_t index;
+};
+
+struct Instruction {
+  OpCode op;
+  Function function;
+  Operand a;
+  Operand b;
+  uint32_t result; // A register, or output_register
+};
+
+constexpr uint32_t output_register = uint32_t(-1);
+
+// A bound field, accessed through its current data pointer when run
+template <typename T> struct Input {
+  const void *field;
+  const T *(*components)(const void *);
+  size_t (*num_points)(const void *);
+  size_t rank;
+};
+
+template <typename T, typename Field>
+const T *field_components(const void *field) {
+  return static_cast<const Field *>(field)->components();
+}
+
+template <typename Field> size_t field_num_points(const void *field) {
+  return static_cast<const Field *>(field)->num_points();
+}
+
+// The operations on n points whose tensors are stored contiguously
+template <size_t Size, typename T> struct Kernels {
+  static size_t components(size_t rank) { return component_count(rank, Size); }
+
+  // A scalar per point combined with a tensor of Components per point
+  template <size_t Components, bool ScalarLeft, typename Op>
+  static inline __attribute__((always_inline)) void
+  broadcast_kernel(T *__restrict__ out, const T *__restrict__ scalars,
+                   const T *__restrict__ tensors, size_t n, Op op) {
+    for (size_t p = 0; p < n; ++p) {
+      const T scalar = scalars[p];
+      for (size_t c = 0; c < Components; ++c) {
+        const T component = tensors[p * Components + c];
+        out[p * Components + c] =
+            ScalarLeft ? op(scalar, component) : op(component, scalar);
+      }
+    }
+  }
+
+  template <bool ScalarLeft, typename Op>
+  static void broadcast(T *out, const T *scalars, const T *tensors,
+                        size_t rank, size_t n, Op op) {
+    switch (rank) {
+    case 1:
+      return broadcast_kernel<Size, ScalarLeft>(out, scalars, tensors, n, op);
+    case 2:
+      return broadcast_kernel<Size * Size, ScalarLeft>(out, scalars, tensors,
+                                                       n, op);
+    }
+    const size_t num_components = components(rank);
+    for (size_t p = 0; p < n; ++p) {
+      for (size_t c = 0; c < num_components; ++c) {
+        const T component = tensors[p * num_components + c];
+        out[p * num_components + c] =
+            ScalarLeft ? op(scalars[p], component) : op(component, scalars[p]);
+      }
+    }
+  }
+
+  template <typename Op>
+  static void binary(T *__restrict__ out, const T *__restrict__ a,
+                     const Operand &operand_a, const T *__restrict__ b,
+                     const Operand &operand_b, size_t n, Op op) {
+    const size_t rank = std::max(operand_a.rank, operand_b.rank);
+    const size_t count = n * components(rank);
+    if (operand_a.source == Source::constant) {
+      const T x = *a;
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = op(x, b[i]);
+      }
+    } else if (operand_b.source == Source::constant) {
+      const T y = *b;
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = op(a[i], y);
+      }
+    } else if (operand_a.rank == operand_b.rank) {
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = op(a[i], b[i]);
+      }
+    } else if (operand_a.rank == 0) {
+      broadcast<true>(out, a, b, rank, n, op);
+    } else {
+      broadcast<false>(out, b, a, rank, n, op);
+    }
+  }
+
+  static void negate(T *__restrict__ out, const T *__restrict__ a,
+                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = -a[i];
+    }
+  }
+
+  static void function(T *__restrict__ out, const T *__restrict__ a,
+                       size_t count, Function function) {
+#define define_function_case(name)                                             \
+  case Function::name:                                                         \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = name(a[i]);                                                     \
+    }                                                                          \
+    return;
+
+    using std::abs;
+    using std::acos;
+    using std::asin;
+    using std::atan;
+    using std::cos;
+    using std::cosh;
+    using std::exp;
+    using std::log;
+    using std::log10;
+    using std::sin;
+    using std::sinh;
+    using std::sqrt;
+    using std::tan;
+    using std::tanh;
+    switch (function) {
+      define_function_case(exp);
+      define_function_case(log);
+      define_function_case(log10);
+      define_function_case(sqrt);
+      define_function_case(sin);
+      define_function_case(cos);
+      define_function_case(tan);
+      define_function_case(asin);
+      define_function_case(acos);
+      define_function_case(atan);
+      define_function_case(sinh);
+      define_function_case(cosh);
+      define_function_case(tanh);
+      define_function_case(abs);
+    }
+#undef define_function_case
+  }
+
+  // out[i..., j...] = sum_k a[i..., k] * b[k, j...] at every point; inlined
+  // into the instantiations below, where rows and columns are constants
+  static inline __attribute__((always_inline)) void
+  dot_kernel(T *__restrict__ out, const T *__restrict__ a,
+             const T *__restrict__ b, size_t rows, size_t columns, size_t n) {
+    for (size_t p = 0; p < n; ++p) {
+      const T *a_p = a + p * rows * Size;
+      const T *b_p = b + p * Size * columns;
+      T *out_p = out + p * rows * columns;
+      for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < columns; ++j) {
+          T sum = a_p[i * Size] * b_p[j];
+          for (size_t k = 1; k < Size; ++k) {
+            sum += a_p[i * Size + k] * b_p[k * columns + j];
+          }
+          out_p[i * columns + j] = sum;
+        }
+      }
+    }
+  }
+
+  template <size_t RankA, size_t RankB>
+  static void dot(T *out, const T *a, const T *b, size_t n) {
+    dot_kernel(out, a, b, component_count(RankA - 1, Size),
+               component_count(RankB - 1, Size), n);
+  }
+
+  template <size_t RankA>
+  static void dot(T *out, const T *a, const T *b, size_t rank_b, size_t n) {
+    switch (rank_b) {
+    case 1:
+      return dot<RankA, 1>(out, a, b, n);
+    case 2:
+      return dot<RankA, 2>(out, a, b, n);
+    case 3:
+      return dot<RankA, 3>(out, a, b, n);
+    }
+    dot_kernel(out, a, b, components(RankA - 1), components(rank_b - 1), n);
+  }
+
+  static void dot(T *out, const T *a, const T *b, size_t rank_a,
+                  size_t rank_b, size_t n) {
+    switch (rank_a) {
+    case 1:
+      return dot<1>(out, a, b, rank_b, n);
+    case 2:
+      return dot<2>(out, a, b, rank_b, n);
+    case 3:
+      return dot<3>(out, a, b, rank_b, n);
+    }
+    dot_kernel(out, a, b, components(rank_a - 1), components(rank_b - 1), n);
+  }
+
+  static inline __attribute__((always_inline)) void
+  outer_kernel(T *__restrict__ out, const T *__restrict__ a,
+               const T *__restrict__ b, size_t rows, size_t columns,
+               size_t n) {
+    for (size_t p = 0; p < n; ++p) {
+      for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < columns; ++j) {
+          out[(p * rows + i) * columns + j] =
+              a[p * rows + i] * b[p * columns + j];
+        }
+      }
+    }
+  }
+
+  static void outer(T *out, const T *a, const T *b, size_t rank_a,
+                    size_t rank_b, size_t n) {
+    if (rank_a == 1 && rank_b == 1) {
+      outer_kernel(out, a, b, Size, Size, n);
+    } else if (rank_a == 1 && rank_b == 2) {
+      outer_kernel(out, a, b, Size, Size * Size, n);
+    } else if (rank_a == 2 && rank_b == 1) {
+      outer_kernel(out, a, b, Size * Size, Size, n);
+    } else {
+      outer_kernel(out, a, b, components(rank_a), components(rank_b), n);
+    }
+  }
+
+  static void trace(T *__restrict__ out, const T *__restrict__ a, size_t n) {
+    for (size_t p = 0; p < n; ++p) {
+      T sum = a[p * Size * Size];
+      for (size_t i = 1; i < Size; ++i) {
+        sum += a[p * Size * Size + i * (Size + 1)];
+      }
+      out[p] = sum;
+    }
+  }
+};
+
+template <size_t Size, typename T, typename Input> class Compiler;
+} // namespace interpreter_detail
+
+/// Compiles tensor expressions given as strings and evaluates them over fields
+/** Size is the dimension of all tensors, T their component type. Fields and
+ * constants are bound to names before compiling; a compiled Program refers to
+ * the bound fields (not to the interpreter), which must outlive it. */
+template <size_t Size = 3, typename T = double> class Interpreter {
+  using Input = interpreter_detail::Input<T>;
+
+  std::map<std::string, Input> m_fields;
+  std::map<std::string, T> m_constants;
+
+public:
+  /// Number of points for which an instruction is executed at once
+  static constexpr size_t chunk_points() { return 128; }
+
+  class Program;
+
+  /// Makes field available under name
+  template <size_t Rank, typename Allocator>
+  void bind(const std::string &name,
+            const TensorField<Rank, T, Size, Allocator> &field) {
+    using Field = TensorField<Rank, T, Size, Allocator>;
+    m_constants.erase(name);
+    m_fields[name] = {&field, &interpreter_detail::field_components<T, Field>,
+                      &interpreter_detail::field_num_points<Field>, Rank};
+  }
+
+  /// Makes a scalar constant available under name
+  void bind(const std::string &name, T value) {
+    m_fields.erase(name);
+    m_constants[name] = value;
+  }
+
+  /// Compiles expression; throws std::invalid_argument for syntax errors,
+  /// unknown names and incompatible ranks
+  Program compile(const std::string &expression) const;
+};
+
+/// A compiled expression
+template <size_t Size, typename T> class Interpreter<Size, T>::Program {
+  friend class interpreter_detail::Compiler<Size, T, Input>;
+  using Instruction = interpreter_detail::Instruction;
+  using Operand = interpreter_detail::Operand;
+  using OpCode = interpreter_detail::OpCode;
+  using Source = interpreter_detail::Source;
+  using Kernels = interpreter_detail::Kernels<Size, T>;
+
+  std::vector<Instruction> m_instructions;
+  std::vector<Input> m_inputs;
+  std::vector<T> m_constants;
+  // Offset of each register in a chunk's register storage
+  std::vector<size_t> m_register_offsets;
+  size_t m_register_size = 0;
+  size_t m_rank = 0;
+
+  static size_t components(size_t rank) { return component_count(rank, Size); }
+
+  void execute(T *registers, T *result, size_t begin, size_t n) const {
+    auto pointer = [&](const Operand &operand) -> const T * {
+      switch (operand.source) {
+      case Source::reg:
+        return registers + m_register_offsets[operand.index];
+      case Source::input: {
+        const Input &input = m_inputs[operand.index];
+        return input.components(input.field) + begin * components(input.rank);
+      }
+      case Source::constant:
+        return &m_constants[operand.index];
+      }
+      return nullptr;
+    };
+
+    for (const Instruction &instruction : m_instructions) {
+      T *out = (instruction.result == interpreter_detail::output_register
+                    ? result + begin * components(m_rank)
+                    : registers + m_register_offsets[instruction.result]);
+      const T *a = pointer(instruction.a);
+      const T *b = pointer(instruction.b);
+      const size_t rank_a = instruction.a.rank;
+      const size_t rank_b = instruction.b.rank;
+      switch (instruction.op) {
+      case OpCode::copy:
+        if (instruction.a.source == Source::constant) {
+          std::fill_n(out, n, *a);
+        } else {
+          std::copy_n(a, n * components(rank_a), out);
+        }
+        break;
+      case OpCode::add:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return x + y; });
+        break;
+      case OpCode::subtract:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return x - y; });
+        break;
+      case OpCode::multiply:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return x * y; });
+        break;
+      case OpCode::divide:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return x / y; });
+        break;
+      case OpCode::greater_equal:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return T(x >= y); });
+        break;
+      case OpCode::less_equal:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return T(x <= y); });
+        break;
+      case OpCode::greater:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return T(x > y); });
+        break;
+      case OpCode::less:
+        Kernels::binary(out, a, instruction.a, b, instruction.b, n,
+                        [](T x, T y) { return T(x < y); });
+        break;
+      case OpCode::negate:
+        Kernels::negate(out, a, n * components(rank_a));
+        break;
+      case OpCode::function:
+        Kernels::function(out, a, n * components(rank_a),
+                          instruction.function);
+        break;
+      case OpCode::dot:
+        Kernels::dot(out, a, b, rank_a, rank_b, n);
+        break;
+      case OpCode::outer:
+        Kernels::outer(out, a, b, rank_a, rank_b, n);
+        break;
+      case OpCode::trace:
+        Kernels::trace(out, a, n);
+        break;
+      }
+    }
+  }
+
+  void run(T *result, size_t num_points, size_t num_threads) const {
+    for (const Input &input : m_inputs) {
+      if (input.num_points(input.field) != num_points) {
+        throw std::invalid_argument(
+            "Program::run: fields have different numbers of points");
+      }
+      if (input.components(input.field) == result) {
+        throw std::invalid_argument(
+            "Program::run: the result must not be used in the expression");
+      }
+    }
+    const size_t chunk_points = Interpreter::chunk_points();
+    const size_t num_chunks = (num_points + chunk_points - 1) / chunk_points;
+    if (num_threads == 0) {
+      // Per point: the register components written and the instructions
+      // dispatched (m_register_size holds a whole chunk of points)
+      num_threads = num_threads_for_work(
+          num_points *
+          (m_register_size / chunk_points + m_instructions.size()));
+    }
+    parallel_for(
+        0, num_chunks,
+        [&](size_t chunk_begin, size_t chunk_end) {
+          std::vector<T> registers(m_register_size);
+          for (size_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+            const size_t begin = chunk * chunk_points;
+            execute(registers.data(), result, begin,
+                    std::min(chunk_points, num_points - begin));
+          }
+        },
+        num_threads);
+  }
+
+public:
+  /// Rank of the result (0 for scalars)
+  size_t rank() const { return m_rank; }
+
+  /// Number of instructions executed per chunk of points
+  size_t num_instructions() const { return m_instructions.size(); }
+
+  /// Evaluates the expression at all points and stores it in result
+  /** The fields used by the expression must have as many points as result,
+   * and result must not be one of them. By default the points are split
+   * between threads if there are enough of them. */
+  template <size_t Rank, typename Allocator>
+  void run(TensorField<Rank, T, Size, Allocator> &result,
+           size_t num_threads = 0) const {
+    if (Rank != m_rank) {
+      throw std::invalid_argument("Program::run: result has rank " +
+                                  std::to_string(Rank) + ", expression has " +
+                                  std::to_string(m_rank));
+    }
+    run(result.components(), result.num_points(), num_threads);
+  }
+
+  /// Evaluates a scalar expression at all points; result must have one
+  /// element per point
+  void run(std::vector<T> &result, size_t num_threads = 0) const {
+    if (m_rank != 0) {
+      throw std::invalid_argument("Program::run: expression is not a scalar");
+    }
+    run(result.data(), result.size(), num_threads);
+  }
+};
+
+namespace interpreter_detail {
+// Recursive descent parser generating instructions on virtual registers,
+// which are then mapped to as few registers as possible
+template <size_t Size, typename T, typename Input> class Compiler {
+  const std::string &m_source;
+  size_t m_position = 0;
+  const std::map<std::string, Input> &m_fields;
+  const std::map<std::string, T> &m_constants;
+
+  std::vector<uint8_t> m_register_ranks;
+  std::vector<Instruction> m_instructions;
+  std::vector<Input> m_inputs;
+  std::vector<T> m_constant_values;
+  std::map<std::string, Operand> m_variables;
+
+  [[noreturn]] void error(const std::string &message) const {
+    throw std::invalid_argument("Interpreter: " + message + " at position " +
+                                std::to_string(m_position) + " of \"" +
+                                m_source + "\"");
+  }
+
+  void skip_whitespace() {
+    while (m_position < m_source.size() &&
+           std::isspace(static_cast<unsigned char>(m_source[m_position]))) {
+      ++m_position;
+    }
+  }
+
+  bool accept(const char *token) {
+    skip_whitespace();
+    const std::string string(token);
+    if (m_source.compare(m_position, string.size(), string) == 0) {
+      m_position += string.size();
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const char *token) {
+    if (!accept(token)) {
+      error(std::string("expected '") + token + "'");
+    }
+  }
+
+  Operand constant(T value) {
+    m_constant_values.push_back(value);
+    return {Source::constant, 0,
+            static_cast<uint32_t>(m_constant_values.size() - 1)};
+  }
+
+  bool is_constant(const Operand &operand) const {
+    return operand.source == Source::constant;
+  }
+
+  T value(const Operand &operand) const {
+    return m_constant_values[operand.index];
+  }
+
+  Operand emit(OpCode op, const Operand &a, const Operand &b, size_t rank,
+               Function function = Function::exp) {
+    m_register_ranks.push_back(static_cast<uint8_t>(rank));
+    const Operand result = {Source::reg, static_cast<uint8_t>(rank),
+                            static_cast<uint32_t>(m_register_ranks.size() - 1)};
+    m_instructions.push_back({op, function, a, b, result.index});
+    return result;
+  }
+
+  Operand binary(OpCode op, const Operand &a, const Operand &b) {
+    if (a.rank != b.rank && a.rank != 0 && b.rank != 0) {
+      error("ranks " + std::to_string(a.rank) + " and " +
+            std::to_string(b.rank) + " don't match");
+    }
+    if (is_constant(a) && is_constant(b)) {
+      const T x = value(a), y = value(b);
+      switch (op) {
+      case OpCode::add:
+        return constant(x + y);
+      case OpCode::subtract:
+        return constant(x - y);
+      case OpCode::multiply:
+        return constant(x * y);
+      case OpCode::divide:
+        return constant(x / y);
+      case OpCode::greater_equal:
+        return constant(T(x >= y));
+      case OpCode::less_equal:
+        return constant(T(x <= y));
+      case OpCode::greater:
+        return constant(T(x > y));
+      case OpCode::less:
+        return constant(T(x < y));
+      default:
+        break;
+      }
+    }
+    return emit(op, a, b, std::max(a.rank, b.rank));
+  }
+
+  Operand dot(const Operand &a, const Operand &b) {
+    if (a.rank == 0 || b.rank == 0) {
+      error("dot needs tensors of rank 1 or more");
+    }
+    return emit(OpCode::dot, a, b, a.rank + b.rank - 2);
+  }
+
+  Operand trace(const Operand &a) {
+    if (a.rank != 2) {
+      error("trace needs a tensor of rank 2");
+    }
+    return emit(OpCode::trace, a, a, 0);
+  }
+
+  // raise_all and lower_all contract every index with metric
+  Operand contract_all(const Operand &a, const Operand &metric) {
+    if (metric.rank != 2 || (a.rank != 1 && a.rank != 2)) {
+      error("raise_all/lower_all need a tensor of rank 1 or 2 and a metric");
+    }
+    if (a.rank == 1) {
+      return dot(metric, a);
+    }
+    return dot(metric, dot(a, metric));
+  }
+
+  std::vector<Operand> arguments() {
+    std::vector<Operand> operands;
+    expect("(");
+    if (!accept(")")) {
+      do {
+        operands.push_back(comparison());
+      } while (accept(","));
+      expect(")");
+    }
+    return operands;
+  }
+
+  Operand call(const std::string &name) {
+    const size_t position = m_position;
+    const std::vector<Operand> args = arguments();
+    auto check_arguments = [&](size_t min, size_t max) {
+      if (args.size() < min || args.size() > max) {
+        m_position = position;
+        error("wrong number of arguments for " + name);
+      }
+    };
+    const auto function = function_names().find(name);
+    if (function != function_names().end()) {
+      check_arguments(1, 1);
+      if (is_constant(args[0])) {
+        return constant(apply(function->second, value(args[0])));
+      }
+      return emit(OpCode::function, args[0], args[0], args[0].rank,
+                  function->second);
+    }
+    if (name == "dot") {
+      check_arguments(2, 3);
+      return args.size() == 2 ? dot(args[0], args[1])
+                              : dot(args[0], dot(args[2], args[1]));
+    }
+    if (name == "outer") {
+      check_arguments(2, 2);
+      if (args[0].rank == 0 || args[1].rank == 0) {
+        error("outer needs tensors of rank 1 or more");
+      }
+      return emit(OpCode::outer, args[0], args[1],
+                  args[0].rank + args[1].rank);
+    }
+    if (name == "trace") {
+      check_arguments(1, 2);
+      return args.size() == 1 ? trace(args[0]) : trace(dot(args[1], args[0]));
+    }
+    if (name == "raise_all" || name == "lower_all") {
+      check_arguments(2, 2);
+      return contract_all(args[0], args[1]);
+    }
+    m_position = position;
+    error("unknown function " + name);
+  }
+
+  Operand variable(const std::string &name) {
+    const auto known = m_variables.find(name);
+    if (known != m_variables.end()) {
+      return known->second;
+    }
+    const auto constant_value = m_constants.find(name);
+    if (constant_value != m_constants.end()) {
+      return m_variables[name] = constant(constant_value->second);
+    }
+    const auto field = m_fields.find(name);
+    if (field == m_fields.end()) {
+      error("unknown name " + name);
+    }
+    m_inputs.push_back(field->second);
+    return m_variables[name] = {Source::input,
+                                static_cast<uint8_t>(field->second.rank),
+                                static_cast<uint32_t>(m_inputs.size() - 1)};
+  }
+
+  Operand primary() {
+    skip_whitespace();
+    if (accept("(")) {
+      const Operand operand = comparison();
+      expect(")");
+      return operand;
+    }
+    const char *begin = m_source.c_str() + m_position;
+    if (std::isdigit(static_cast<unsigned char>(*begin)) || *begin == '.') {
+      char *end;
+      const T number = T(std::strtod(begin, &end));
+      if (end == begin) {
+        error("invalid number");
+      }
+      m_position += end - begin;
+      return constant(number);
+    }
+    if (std::isalpha(static_cast<unsigned char>(*begin)) || *begin == '_') {
+      const size_t start = m_position;
+      while (m_position < m_source.size() &&
+             (std::isalnum(static_cast<unsigned char>(m_source[m_position])) ||
+              m_source[m_position] == '_')) {
+        ++m_position;
+      }
+      const std::string name = m_source.substr(start, m_position - start);
+      skip_whitespace();
+      if (m_position < m_source.size() && m_source[m_position] == '(') {
+        return call(name);
+      }
+      return variable(name);
+    }
+    error(m_position < m_source.size() ? "unexpected character"
+                                       : "unexpected end");
+  }
+
+  Operand unary() {
+    if (accept("-")) {
+      const Operand operand = unary();
+      if (is_constant(operand)) {
+        return constant(-value(operand));
+      }
+      return emit(OpCode::negate, operand, operand, operand.rank);
+    }
+    if (accept("+")) {
+      return unary();
+    }
+    return primary();
+  }
+
+  Operand product() {
+    Operand operand = unary();
+    while (true) {
+      if (accept("*")) {
+        operand = binary(OpCode::multiply, operand, unary());
+      } else if (accept("/")) {
+        operand = binary(OpCode::divide, operand, unary());
+      } else {
+        return operand;
+      }
+    }
+  }
+
+  Operand sum() {
+    Operand operand = product();
+    while (true) {
+      if (accept("+")) {
+        operand = binary(OpCode::add, operand, product());
+      } else if (accept("-")) {
+        operand = binary(OpCode::subtract, operand, product());
+      } else {
+        return operand;
+      }
+    }
+  }
+
+  Operand comparison() {
+    const Operand operand = sum();
+    // Two character operators first
+    if (accept(">=")) {
+      return binary(OpCode::greater_equal, operand, sum());
+    }
+    if (accept("<=")) {
+      return binary(OpCode::less_equal, operand, sum());
+    }
+    if (accept(">")) {
+      return binary(OpCode::greater, operand, sum());
+    }
+    if (accept("<")) {
+      return binary(OpCode::less, operand, sum());
+    }
+    return operand;
+  }
+
+  // Linear scan: a register is reused (for a value with the same number of
+  // components) once the last instruction reading it has been emitted. The
+  // result of an instruction never shares a register with its operands.
+  template <typename Program> void allocate_registers(Program &program) {
+    std::vector<size_t> last_use(m_register_ranks.size(), 0);
+    for (size_t i = 0; i < m_instructions.size(); ++i) {
+      for (const Operand &operand :
+           {m_instructions[i].a, m_instructions[i].b}) {
+        if (operand.source == Source::reg) {
+          last_use[operand.index] = i;
+        }
+      }
+    }
+
+    std::vector<uint32_t> physical(m_register_ranks.size(), 0);
+    std::map<size_t, std::vector<uint32_t>> free_registers;
+    for (size_t i = 0; i < m_instructions.size(); ++i) {
+      Instruction instruction = m_instructions[i];
+      if (instruction.result != output_register) {
+        const size_t size =
+            Interpreter<Size, T>::chunk_points() *
+            component_count(m_register_ranks[instruction.result], Size);
+        auto &available = free_registers[size];
+        if (available.empty()) {
+          program.m_register_offsets.push_back(program.m_register_size);
+          program.m_register_size += size;
+          available.push_back(
+              static_cast<uint32_t>(program.m_register_offsets.size() - 1));
+        }
+        physical[instruction.result] = available.back();
+        available.pop_back();
+        instruction.result = physical[instruction.result];
+      }
+      for (Operand *operand : {&instruction.a, &instruction.b}) {
+        if (operand->source != Source::reg) {
+          continue;
+        }
+        const uint32_t virtual_register = operand->index;
+        operand->index = physical[virtual_register];
+        if (last_use[virtual_register] == i) {
+          free_registers[Interpreter<Size, T>::chunk_points() *
+                         component_count(operand->rank, Size)]
+              .push_back(physical[virtual_register]);
+          last_use[virtual_register] = size_t(-1); // a and b may be the same
+        }
+      }
+      program.m_instructions.push_back(instruction);
+    }
+  }
+
+public:
+  Compiler(const std::string &source,
+           const std::map<std::string, Input> &fields,
+           const std::map<std::string, T> &constants)
+      : m_source(source), m_fields(fields), m_constants(constants) {}
+
+  template <typename Program> void compile(Program &program) {
+    const Operand result = comparison();
+    skip_whitespace();
+    if (m_position != m_source.size()) {
+      error("unexpected character");
+    }
+    if (result.source == Source::reg) {
+      // The last instruction computes the result: write it to the output
+      m_instructions.back().result = output_register;
+    } else {
+      m_instructions.push_back(
+          {OpCode::copy, Function::exp, result, result, output_register});
+    }
+    allocate_registers(program);
+    program.m_inputs = m_inputs;
+    program.m_constants = m_constant_values;
+    program.m_rank = result.rank;
+  }
+};
+} // namespace interpreter_detail
+
+template <size_t Size, typename T>
+typename Interpreter<Size, T>::Program
+Interpreter<Size, T>::compile(const std::string &expression) const {
+  Program program;
+  interpreter_detail::Compiler<Size, T, Input> compiler(expression, m_fields,
+                                                        m_constants);
+  compiler.compile(program);
+  return program;
+}
+
+} // namespace tensoralgebra
+
+#endif
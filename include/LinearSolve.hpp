@@ -0,0 +1,332 @@
+#ifndef _TENSORALGEBRA_LINEARSOLVE_HPP
+#define _TENSORALGEBRA_LINEARSOLVE_HPP
+
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TensorField.hpp"
+#include "TypeChecks.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+// This file defines direct solvers for small linear systems, e.g. one 3x3 or
+// 4x4 system per grid point. All loops have compile time bounds, so they are
+// unrolled for small sizes, and there is no pivoting: the only branches depend
+// on the size, never on the values. The solvers therefore also work for
+// element types such as Dual, and the batched versions for arrays and fields
+// process a block of systems at a time with the loop over the systems
+// innermost, which the compiler vectorizes.
+//
+// Without pivoting, LU decomposition requires all leading minors to be
+// non-zero (e.g. diagonally dominant matrices, as for gauge conditions) and
+// Cholesky decomposition a symmetric positive definite matrix.
+
+namespace tensoralgebra {
+
+/// Cholesky decomposition of a symmetric positive definite matrix
+/** Returns the lower triangular L with matrix = L.L^T; the upper triangle of
+ * L is zero. Only the lower triangle of matrix is used. */
+template <typename T, size_t Size>
+auto cholesky(const TensorExpression<2, T, Size> &matrix) {
+  using std::sqrt;
+  using Value = expression_value_t<T>;
+  const Tensor<2, Value, Size> a = matrix;
+  Tensor<2, Value, Size> lower = Value(0);
+  for (size_t j = 0; j < Size; ++j) {
+    Value diagonal = a[j][j];
+    for (size_t k = 0; k < j; ++k) {
+      diagonal -= lower[j][k] * lower[j][k];
+    }
+    lower[j][j] = sqrt(diagonal);
+    const Value inverse = Value(1) / lower[j][j];
+    for (size_t i = j + 1; i < Size; ++i) {
+      Value sum = a[i][j];
+      for (size_t k = 0; k < j; ++k) {
+        sum -= lower[i][k] * lower[j][k];
+      }
+      lower[i][j] = sum * inverse;
+    }
+  }
+  return lower;
+}
+
+/// Solves L.L^T.x = rhs given the Cholesky factor L
+template <typename T1, typename T2, size_t Size>
+auto cholesky_solve(const TensorExpression<2, T1, Size> &cholesky_factor,
+                    const TensorExpression<1, T2, Size> &rhs) {
+  using Value = expression_value_t<T1>;
+  const Tensor<2, Value, Size> lower = cholesky_factor;
+  Tensor<1, Value, Size> x = rhs;
+  for (size_t i = 0; i < Size; ++i) {
+    for (size_t k = 0; k < i; ++k) {
+      x[i] -= lower[i][k] * x[k];
+    }
+    x[i] /= lower[i][i];
+  }
+  for (size_t i = Size; i-- > 0;) {
+    for (size_t k = i + 1; k < Size; ++k) {
+      x[i] -= lower[k][i] * x[k];
+    }
+    x[i] /= lower[i][i];
+  }
+  return x;
+}
+
+/// LU decomposition without pivoting (Doolittle)
+/** Returns L and U packed into one matrix: U is the upper triangle including
+ * the diagonal, L (whose diagonal is one) the strict lower triangle. */
+template <typename T, size_t Size>
+auto lu_decompose(const TensorExpression<2, T, Size> &matrix) {
+  using Value = expression_value_t<T>;
+  Tensor<2, Value, Size> lu = matrix;
+  for (size_t k = 0; k < Size; ++k) {
+    const Value inverse = Value(1) / lu[k][k];
+    for (size_t i = k + 1; i < Size; ++i) {
+      lu[i][k] *= inverse;
+      for (size_t j = k + 1; j < Size; ++j) {
+        lu[i][j] -= lu[i][k] * lu[k][j];
+      }
+    }
+  }
+  return lu;
+}
+
+/// Solves L.U.x = rhs given the packed LU decomposition from lu_decompose
+template <typename T1, typename T2, size_t Size>
+auto lu_solve(const TensorExpression<2, T1, Size> &lu_decomposition,
+              const TensorExpression<1, T2, Size> &rhs) {
+  using Value = expression_value_t<T1>;
+  const Tensor<2, Value, Size> lu = lu_decomposition;
+  Tensor<1, Value, Size> x = rhs;
+  for (size_t i = 1; i < Size; ++i) {
+    for (size_t k = 0; k < i; ++k) {
+      x[i] -= lu[i][k] * x[k];
+    }
+  }
+  for (size_t i = Size; i-- > 0;) {
+    for (size_t k = i + 1; k < Size; ++k) {
+      x[i] -= lu[i][k] * x[k];
+    }
+    x[i] /= lu[i][i];
+  }
+  return x;
+}
+
+/// Solves matrix.x = rhs by LU decomposition without pivoting
+template <typename T1, typename T2, size_t Size>
+auto solve(const TensorExpression<2, T1, Size> &matrix,
+           const TensorExpression<1, T2, Size> &rhs) {
+  return lu_solve(lu_decompose(matrix), rhs);
+}
+
+/// Solves matrix.x = rhs for a symmetric positive definite matrix by Cholesky
+/// decomposition
+template <typename T1, typename T2, size_t Size>
+auto solve_spd(const TensorExpression<2, T1, Size> &matrix,
+               const TensorExpression<1, T2, Size> &rhs) {
+  return cholesky_solve(cholesky(matrix), rhs);
+}
+
+namespace linear_solve_detail {
+// Number of systems solved together by the batched solvers; the working set
+// of a block (Size^2 + Size values per system) stays in the L1 cache.
+constexpr size_t batch_block = 16;
+
+// A block of systems in structure of arrays layout: component [i][j] of all
+// systems of the block is contiguous
+template <typename T, size_t Size> struct SystemBlock {
+  T a[Size][Size][batch_block];
+  T x[Size][batch_block];
+  // Divisions are the bottleneck, so each diagonal element is inverted once
+  T inverse_diagonal[Size][batch_block];
+
+  void load(const Tensor<2, T, Size> *matrices, const Tensor<1, T, Size> *rhs,
+            size_t count) {
+    for (size_t p = 0; p < count; ++p) {
+      for (size_t i = 0; i < Size; ++i) {
+        x[i][p] = rhs[p][i];
+        for (size_t j = 0; j < Size; ++j) {
+          a[i][j][p] = matrices[p][i][j];
+        }
+      }
+    }
+    // Pad incomplete blocks with identity systems
+    for (size_t p = count; p < batch_block; ++p) {
+      for (size_t i = 0; i < Size; ++i) {
+        x[i][p] = T(0);
+        for (size_t j = 0; j < Size; ++j) {
+          a[i][j][p] = T(i == j);
+        }
+      }
+    }
+  }
+
+  void store(Tensor<1, T, Size> *solutions, size_t count) const {
+    for (size_t p = 0; p < count; ++p) {
+      for (size_t i = 0; i < Size; ++i) {
+        solutions[p][i] = x[i][p];
+      }
+    }
+  }
+
+  // Same steps as lu_decompose and lu_solve
+  void solve_lu() {
+    for (size_t k = 0; k < Size; ++k) {
+      auto &inverse = inverse_diagonal[k];
+      for (size_t p = 0; p < batch_block; ++p) {
+        inverse[p] = T(1) / a[k][k][p];
+      }
+      for (size_t i = k + 1; i < Size; ++i) {
+        for (size_t p = 0; p < batch_block; ++p) {
+          a[i][k][p] *= inverse[p];
+        }
+        for (size_t j = k + 1; j < Size; ++j) {
+          for (size_t p = 0; p < batch_block; ++p) {
+            a[i][j][p] -= a[i][k][p] * a[k][j][p];
+          }
+        }
+      }
+    }
+    for (size_t i = 1; i < Size; ++i) {
+      for (size_t k = 0; k < i; ++k) {
+        for (size_t p = 0; p < batch_block; ++p) {
+          x[i][p] -= a[i][k][p] * x[k][p];
+        }
+      }
+    }
+    back_substitute();
+  }
+
+  // Same steps as cholesky and cholesky_solve; the factor L is stored in the
+  // lower triangle and L^T in the upper triangle
+  void solve_cholesky() {
+    using std::sqrt;
+    for (size_t j = 0; j < Size; ++j) {
+      for (size_t k = 0; k < j; ++k) {
+        for (size_t p = 0; p < batch_block; ++p) {
+          a[j][j][p] -= a[j][k][p] * a[j][k][p];
+        }
+      }
+      auto &inverse = inverse_diagonal[j];
+      for (size_t p = 0; p < batch_block; ++p) {
+        a[j][j][p] = sqrt(a[j][j][p]);
+        inverse[p] = T(1) / a[j][j][p];
+      }
+      for (size_t i = j + 1; i < Size; ++i) {
+        for (size_t k = 0; k < j; ++k) {
+          for (size_t p = 0; p < batch_block; ++p) {
+            a[i][j][p] -= a[i][k][p] * a[j][k][p];
+          }
+        }
+        for (size_t p = 0; p < batch_block; ++p) {
+          a[i][j][p] *= inverse[p];
+          a[j][i][p] = a[i][j][p];
+        }
+      }
+    }
+    for (size_t i = 0; i < Size; ++i) {
+      for (size_t k = 0; k < i; ++k) {
+        for (size_t p = 0; p < batch_block; ++p) {
+          x[i][p] -= a[i][k][p] * x[k][p];
+        }
+      }
+      for (size_t p = 0; p < batch_block; ++p) {
+        x[i][p] *= inverse_diagonal[i][p];
+      }
+    }
+    back_substitute();
+  }
+
+  // Solves with the upper triangle of a (including the diagonal)
+  void back_substitute() {
+    for (size_t i = Size; i-- > 0;) {
+      for (size_t k = i + 1; k < Size; ++k) {
+        for (size_t p = 0; p < batch_block; ++p) {
+          x[i][p] -= a[i][k][p] * x[k][p];
+        }
+      }
+      for (size_t p = 0; p < batch_block; ++p) {
+        x[i][p] *= inverse_diagonal[i][p];
+      }
+    }
+  }
+};
+
+template <typename T, size_t Size, typename Method>
+void solve_batched(const Tensor<2, T, Size> *matrices,
+                   const Tensor<1, T, Size> *rhs,
+                   Tensor<1, T, Size> *solutions, size_t num_systems,
+                   Method method) {
+  SystemBlock<T, Size> block;
+  for (size_t begin = 0; begin < num_systems; begin += batch_block) {
+    const size_t count = std::min(batch_block, num_systems - begin);
+    block.load(matrices + begin, rhs + begin, count);
+    method(block);
+    block.store(solutions + begin, count);
+  }
+}
+
+inline void check_same_points(size_t points1, size_t points2) {
+  if (points1 != points2) {
+    throw std::invalid_argument("Fields have different numbers of points.");
+  }
+}
+} // namespace linear_solve_detail
+
+/// Solves num_systems independent systems matrices[p].x = rhs[p] by LU
+/// decomposition, writing x to solutions[p]
+/** Same result as solve() for each system, but many times faster for large
+ * numbers of systems. solutions may alias rhs. */
+template <typename T, size_t Size>
+void solve(const Tensor<2, T, Size> *matrices, const Tensor<1, T, Size> *rhs,
+           Tensor<1, T, Size> *solutions, size_t num_systems) {
+  linear_solve_detail::solve_batched(
+      matrices, rhs, solutions, num_systems,
+      [](linear_solve_detail::SystemBlock<T, Size> &block) {
+        block.solve_lu();
+      });
+}
+
+/// Batched version of solve_spd (see solve above)
+template <typename T, size_t Size>
+void solve_spd(const Tensor<2, T, Size> *matrices,
+               const Tensor<1, T, Size> *rhs, Tensor<1, T, Size> *solutions,
+               size_t num_systems) {
+  linear_solve_detail::solve_batched(
+      matrices, rhs, solutions, num_systems,
+      [](linear_solve_detail::SystemBlock<T, Size> &block) {
+        block.solve_cholesky();
+      });
+}
+
+/// Solves the system at every point of a field
+template <typename T, size_t Size, typename Allocator1, typename Allocator2,
+          typename Allocator3>
+void solve(const TensorField<2, T, Size, Allocator1> &matrices,
+           const TensorField<1, T, Size, Allocator2> &rhs,
+           TensorField<1, T, Size, Allocator3> &solutions) {
+  linear_solve_detail::check_same_points(matrices.num_points(),
+                                         rhs.num_points());
+  linear_solve_detail::check_same_points(matrices.num_points(),
+                                         solutions.num_points());
+  solve(matrices.data(), rhs.data(), solutions.data(), matrices.num_points());
+}
+
+/// Solves the symmetric positive definite system at every point of a field
+template <typename T, size_t Size, typename Allocator1, typename Allocator2,
+          typename Allocator3>
+void solve_spd(const TensorField<2, T, Size, Allocator1> &matrices,
+               const TensorField<1, T, Size, Allocator2> &rhs,
+               TensorField<1, T, Size, Allocator3> &solutions) {
+  linear_solve_detail::check_same_points(matrices.num_points(),
+                                         rhs.num_points());
+  linear_solve_detail::check_same_points(matrices.num_points(),
+                                         solutions.num_points());
+  solve_spd(matrices.data(), rhs.data(), solutions.data(),
+            matrices.num_points());
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef _TENSORALGEBRA_LOWSTORAGERK_HPP
+#define _TENSORALGEBRA_LOWSTORAGERK_HPP
+
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// This file defines the time integration of tensor fields with low-storage
+// Runge-Kutta schemes in Williamson's 2N form. Each evolved field u needs a
+// single additional field du, instead of one per stage as for the classic RK4
+// scheme. Stage i of a scheme with coefficients a, b and c is
+//
+//   du = a[i] du + dt rhs(u, t + c[i] dt)
+//   u  = u + b[i] du
+//
+// where the right hand side is a point expression built from the fields, as
+// for TensorField::assign. Both updates are single in-place sweeps over the
+// points, and the right hand side is evaluated directly into du without a
+// temporary field. All du are computed before any u is updated, so the right
+// hand side of each field can depend on all evolved fields:
+//
+//   tensoralgebra::LowStorageRungeKutta integrator;
+//   integrator.add(metric, [&](size_t p) { return -2. * lapse[p] * k[p]; });
+//   integrator.add(k, [&](size_t p) { return ricci[p] + ...; });
+//   integrator.set_prepare_stage([&](double time) { compute_ricci(metric); });
+//   integrator.step(time, dt);
+
+namespace tensoralgebra {
+
+/// The coefficients of a low-storage Runge-Kutta scheme in 2N form
+struct LowStorageScheme {
+  std::vector<double> a; // a[0] must be zero
+  std::vector<double> b;
+  std::vector<double> c; // stage times as fractions of the time step
+  size_t order;
+
+  size_t num_stages() const { return a.size(); }
+
+  /// Williamson's three stage, third order scheme
+  static LowStorageScheme williamson3() {
+    return {{0., -5. / 9., -153. / 128.},
+            {1. / 3., 15. / 16., 8. / 15.},
+            {0., 1. / 3., 3. / 4.},
+            3};
+  }
+
+  /// Carpenter and Kennedy's five stage, fourth order scheme
+  static LowStorageScheme carpenter_kennedy4() {
+    return {{0., -567301805773. / 1357537059087.,
+             -2404267990393. / 2016746695238.,
+             -3550918686646. / 2091501179385.,
+             -1275806237668. / 842570457699.},
+            {1432997174477. / 9575080441755., 5161836677717. / 13612068292357.,
+             1720146321549. / 2090206949498., 3134564353537. / 4481467310338.,
+             2277821191437. / 14882151754819.},
+            {0., 1432997174477. / 9575080441755.,
+             2526269341429. / 6820363962896., 2006345519317. / 3224310063776.,
+             2802321613138. / 2924317926251.},
+            4};
+  }
+};
+
+/// Advances a set of tensor fields in time with a low-storage Runge-Kutta
+/// scheme
+class LowStorageRungeKutta {
+  // One evolved field: computes du = a du + dt rhs for a range of points,
+  // and u = u + b du for a range of components
+  struct Register {
+    size_t num_points;
+    size_t num_components;
+    std::function<void(double, double, size_t, size_t)> evaluate;
+    std::function<void(double, size_t, size_t)> update;
+  };
+
+  LowStorageScheme m_scheme;
+  std::vector<Register> m_registers;
+  std::function<void(double)> m_prepare_stage;
+
+public:
+  explicit LowStorageRungeKutta(
+      LowStorageScheme scheme = LowStorageScheme::carpenter_kennedy4())
+      : m_scheme(std::move(scheme)) {
+    if (m_scheme.num_stages() == 0 ||
+        m_scheme.b.size() != m_scheme.num_stages() ||
+        m_scheme.c.size() != m_scheme.num_stages() || m_scheme.a[0] != 0.) {
+      throw std::invalid_argument("LowStorageRungeKutta: the coefficients "
+                                  "do not form a 2N scheme");
+    }
+  }
+
+  const LowStorageScheme &scheme() const { return m_scheme; }
+  size_t num_fields() const { return m_registers.size(); }
+
+  /// Evolves field with the right hand side rhs(point)
+  /** rhs returns a tensor expression for the given point, e.g. built from the
+   * tensors of the evolved fields at that point; it is evaluated for all
+   * points before any field is updated. field must outlive the integrator. The
+   * additional field (the second register) is allocated here with the
+   * allocator of field. */
+  template <size_t Rank, typename T, size_t Size, typename Allocator,
+            typename F>
+  void add(TensorField<Rank, T, Size, Allocator> &field, F rhs) {
+    using Field = TensorField<Rank, T, Size, Allocator>;
+    auto increment = std::make_shared<Field>(
+        field.extent(), field.get_allocator());
+    Register entry;
+    entry.num_points = field.num_points();
+    entry.num_components = field.num_points() * Field::num_components();
+    entry.evaluate = [increment, rhs](double a, double dt, size_t begin,
+                                      size_t end) {
+      Field &du = *increment;
+      if (a == 0.) {
+        du.assign(begin, end, [&](size_t p) { return dt * rhs(p); });
+      } else {
+        du.assign(begin, end,
+                  [&](size_t p) { return a * du[p] + dt * rhs(p); });
+      }
+    };
+    entry.update = [&field, increment](double b, size_t begin, size_t end) {
+      T *u = field.components();
+      const T *du = increment->components();
+      for (size_t i = begin; i < end; ++i) {
+        u[i] += b * du[i];
+      }
+    };
+    m_registers.push_back(std::move(entry));
+  }
+
+  /// Sets a function called with the stage time before the right hand sides
+  /// of each stage are evaluated, e.g. to fill ghost points or compute
+  /// derivatives
+  void set_prepare_stage(std::function<void(double)> prepare_stage) {
+    m_prepare_stage = std::move(prepare_stage);
+  }
+
+  /// Advances all fields from time to time + dt, and time with them
+  /** By default the points are split between threads if there is enough
+   * work. */
+  void step(double &time, double dt, size_t num_threads = 0) {
+    size_t total_points = 0;
+    for (const Register &entry : m_registers) {
+      total_points += entry.num_points;
+    }
+    if (num_threads == 0) {
+      num_threads = num_threads_for_work(total_points * 32);
+    }
+    for (size_t stage = 0; stage < m_scheme.num_stages(); ++stage) {
+      if (m_prepare_stage) {
+        m_prepare_stage(time + m_scheme.c[stage] * dt);
+      }
+      const double a = m_scheme.a[stage], b = m_scheme.b[stage];
+      for (const Register &entry : m_registers) {
+        parallel_for(
+            0, entry.num_points,
+            [&](size_t begin, size_t end) {
+              entry.evaluate(a, dt, begin, end);
+            },
+            num_threads);
+      }
+      for (const Register &entry : m_registers) {
+        parallel_for(
+            0, entry.num_components,
+            [&](size_t begin, size_t end) { entry.update(b, begin, end); },
+            num_threads);
+      }
+    }
+    time += dt;
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -1,26 +1,14 @@
 #ifndef _TENSORALGEBRA_OUTER_HPP
 #define _TENSORALGEBRA_OUTER_HPP
 
+#include "EvaluationCounter.hpp"
 #include "Tensor.hpp"
 #include "TensorExpression.hpp"
 #include <cstddef>
+#include <tuple>
 #include <utility>
 
 namespace tensoralgebra {
-template <size_t Position> struct OuterHelper {
-  template <typename T1, typename T2, typename... IndexTs>
-  static auto eval(const T1 &t1, const T2 &t2, size_t dir, IndexTs... dirs) {
-    return OuterHelper<Position - 1>::eval(t1[dir], t2, dirs...);
-  }
-};
-
-template <> struct OuterHelper<0> {
-  template <typename T1, typename T2, typename... IndexTs>
-  static auto eval(const T1 &t1, const T2 &t2, IndexTs... dirs) {
-    return t1 * t2.eval(dirs...);
-  }
-};
-
 template <typename T1, typename T2>
 class Outer : public TensorExpression<std::decay_t<T1>::rank() +
                                           std::decay_t<T2>::rank(),
@@ -33,7 +21,21 @@ public:
       : t1(std::forward<T1>(t1)), t2(std::forward<T2>(t2)) {}
 
   template <typename... Indices> auto eval(Indices... dirs) const {
-    return OuterHelper<std::decay_t<T1>::rank()>::eval(t1, t2, dirs...);
+    TENSORALGEBRA_COUNT_EVALUATION("Outer", 1, 0);
+    constexpr size_t rank_T1 = std::decay_t<T1>::rank();
+    // A tuple rather than an array keeps the index types (see DynamicTensor)
+    const auto indices = std::make_tuple(dirs...);
+    return eval_split(indices, std::make_index_sequence<rank_T1>(),
+                      std::make_index_sequence<sizeof...(Indices) - rank_T1>());
+  }
+
+private:
+  // The first rank(T1) indices go to t1, the remaining ones to t2
+  template <typename Indices, size_t... Is, size_t... Js>
+  auto eval_split(const Indices &indices, std::index_sequence<Is...>,
+                  std::index_sequence<Js...>) const {
+    return t1.eval(std::get<Is>(indices)...) *
+           t2.eval(std::get<sizeof...(Is) + Js>(indices)...);
   }
 };
 
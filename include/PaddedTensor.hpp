@@ -0,0 +1,294 @@
+#ifndef _TENSORALGEBRA_PADDEDTENSOR_HPP
+#define _TENSORALGEBRA_PADDEDTENSOR_HPP
+
+#include "ComponentOperations.hpp"
+#include "Dot.hpp"
+#include "EvaluationCounter.hpp"
+#include "NestedInitializerList.hpp"
+#include "Outer.hpp"
+#include "TensorExpression.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// This file defines an opt-in padded layout for tensors. A
+// Tensor<1, double, 3> (and each row of a higher rank tensor) occupies 24
+// bytes, so consecutive rows straddle vector registers and cache lines. In a
+// PaddedTensor each row is padded to a multiple of 32 bytes (4 doubles or 8
+// floats) and aligned to 32 bytes. Rows can then be loaded and stored as whole
+// vectors, at the cost of a third more memory for Size 3.
+//
+// Expressions whose rows only come from padded tensors (component wise
+// operations of padded tensors and scalars, outer products with a padded
+// second factor and dot products with a padded second factor of rank 2 or
+// more) are evaluated for all elements of a padded row, including the padding,
+// so the compiler can vectorize each row without a remainder. The padding then
+// holds the operations applied to the padding of the operands (possibly
+// infinite or NaN for quotients); it is never visible through the index
+// operators. Other expressions are evaluated element by element as for Tensor.
+//
+// Padding pays off for contractions, where rows are combined with each other.
+// A component wise expression over a whole array of unpadded tensors is already
+// vectorized across tensors, and there the padding only adds memory traffic
+// (see benchmark/PaddedTensorBenchmark.cpp).
+//
+// Containers of padded tensors need an allocator which respects their
+// alignment, such as AlignedAllocator (C++14's operator new only guarantees the
+// alignment of std::max_align_t):
+//
+//   tensoralgebra::PaddedArray<2> metrics(num_points), curvatures(num_points);
+//   metrics[p] = 2. * curvatures[p] + metrics[p];
+
+namespace tensoralgebra {
+
+/// Number of elements a row of Size elements of type T is padded to
+template <typename T, size_t Size> constexpr size_t padded_row_size() {
+  return (Size * sizeof(T) + 31) / 32 * 32 / sizeof(T);
+}
+
+/// Allocator returning memory aligned to Alignment bytes (a power of two)
+template <typename T, size_t Alignment = 64> class AlignedAllocator {
+  static_assert((Alignment & (Alignment - 1)) == 0 &&
+                    Alignment >= alignof(void *),
+                "Alignment must be a power of two");
+
+public:
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+  T *allocate(size_t n) {
+    // Room for the alignment and for the pointer returned by operator new,
+    // which is stored just before the aligned memory
+    void *memory = ::operator new(n * sizeof(T) + Alignment + sizeof(void *));
+    const uintptr_t start =
+        reinterpret_cast<uintptr_t>(memory) + sizeof(void *);
+    const uintptr_t aligned =
+        (start + Alignment - 1) & ~(uintptr_t(Alignment) - 1);
+    reinterpret_cast<void **>(aligned)[-1] = memory;
+    return reinterpret_cast<T *>(aligned);
+  }
+
+  void deallocate(T *pointer, size_t) {
+    ::operator delete(reinterpret_cast<void **>(pointer)[-1]);
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+    return false;
+  }
+};
+
+template <size_t Rank, typename T = double, size_t Size = 3>
+class PaddedTensor;
+
+/// Whether all rows of an expression can be evaluated including their padding
+template <typename T> struct is_padded_expression : std::false_type {};
+
+template <typename T>
+constexpr bool is_padded() {
+  return is_padded_expression<std::decay_t<T>>::value;
+}
+
+template <size_t Rank, typename T, size_t Size>
+struct is_padded_expression<PaddedTensor<Rank, T, Size>> : std::true_type {};
+
+template <typename T>
+struct is_padded_expression<SquareBracket<T>>
+    : std::integral_constant<bool, is_padded<T>()> {};
+
+// The last index of a dot or outer product is the last index of the second
+// factor, unless that is a vector contracted with the first factor
+template <typename T1, typename T2>
+struct is_padded_expression<Dot<T1, T2>>
+    : std::integral_constant<bool, (std::decay_t<T2>::rank() > 1 &&
+                                    is_padded<T2>())> {};
+
+template <typename T1, typename T2>
+struct is_padded_expression<Outer<T1, T2>>
+    : std::integral_constant<bool, is_padded<T2>()> {};
+
+#define define_padded_binary_expressions(OPName)                               \
+  template <typename T1, typename T2>                                          \
+  struct is_padded_expression<OPName##Tensor<T1, T2>>                          \
+      : std::integral_constant<bool, is_padded<T1>() && is_padded<T2>()> {};   \
+  template <typename TTensor, typename TScalar>                                \
+  struct is_padded_expression<OPName##ScalarLeft<TTensor, TScalar>>            \
+      : std::integral_constant<bool, is_padded<TTensor>()> {};                 \
+  template <typename TTensor, typename TScalar>                                \
+  struct is_padded_expression<OPName##ScalarRight<TTensor, TScalar>>           \
+      : std::integral_constant<bool, is_padded<TTensor>()> {};
+
+#define define_padded_unary_expression(Name)                                   \
+  template <typename TTensor>                                                  \
+  struct is_padded_expression<Name<TTensor>>                                   \
+      : std::integral_constant<bool, is_padded<TTensor>()> {};
+
+// clang-format off
+define_padded_binary_expressions(Sum)
+define_padded_binary_expressions(Difference)
+define_padded_binary_expressions(Product)
+define_padded_binary_expressions(Quotient)
+define_padded_binary_expressions(IsGreaterEqual)
+define_padded_binary_expressions(IsLessEqual)
+define_padded_binary_expressions(IsGreater)
+define_padded_binary_expressions(IsLess)
+
+define_padded_unary_expression(Exp)
+define_padded_unary_expression(Log)
+define_padded_unary_expression(Log10)
+define_padded_unary_expression(Sqrt)
+define_padded_unary_expression(Sin)
+define_padded_unary_expression(Cos)
+define_padded_unary_expression(Tan)
+define_padded_unary_expression(Asin)
+define_padded_unary_expression(Acos)
+define_padded_unary_expression(Atan)
+define_padded_unary_expression(Sinh)
+define_padded_unary_expression(Cosh)
+define_padded_unary_expression(Tanh)
+define_padded_unary_expression(Abs)
+// clang-format on
+
+#undef define_padded_binary_expressions
+#undef define_padded_unary_expression
+
+template <size_t Rank, typename T, size_t Size> struct padded_type_recursion {
+  using type = std::array<PaddedTensor<Rank - 1, T, Size>, Size>;
+};
+
+// The base case: a padded row
+template <typename T, size_t Size> struct padded_type_recursion<1, T, Size> {
+  using type = std::array<T, padded_row_size<T, Size>()>;
+};
+
+/// A tensor like Tensor<Rank, T, Size> whose rows are padded to a multiple of
+/// 32 bytes and aligned to 32 bytes
+/** T must be an arithmetic type whose size divides 32. A default constructed
+ * PaddedTensor is zero. */
+template <size_t Rank, typename T, size_t Size>
+class PaddedTensor
+    : public TensorExpression<Rank, PaddedTensor<Rank, T, Size>, Size> {
+  static_assert(Rank > 0, "Rank zero tensors are forbidden.");
+  static_assert(std::is_arithmetic<T>::value && 32 % sizeof(T) == 0,
+                "Padded tensors need an arithmetic type whose size "
+                "divides 32.");
+
+  using ContainedType = typename padded_type_recursion<Rank, T, Size>::type;
+  alignas(32) ContainedType data;
+
+  // Tensors of rank 1 and 2 (at most a few vector registers) are evaluated
+  // into a local array and stored at once: the destination may alias an
+  // operand, which would otherwise keep the compiler from vectorizing the rows.
+  // Higher ranks are assigned one such block at a time.
+  template <typename T1, size_t R = Rank>
+  static inline __attribute__((always_inline))
+  std::enable_if_t<R == 1, ContainedType>
+  evaluate(const TensorExpression<1, T1, Size> &row) {
+    ContainedType values;
+    if (is_padded<T1>()) {
+      for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = row.eval(i);
+      }
+    } else {
+      for (size_t i = 0; i < Size; ++i) {
+        values[i] = row.eval(i);
+      }
+      std::fill(values.begin() + Size, values.end(), T(0));
+    }
+    return values;
+  }
+
+  template <typename T1, size_t R = Rank>
+  static inline __attribute__((always_inline))
+  std::enable_if_t<R == 2, ContainedType>
+  evaluate(const TensorExpression<2, T1, Size> &expression) {
+    ContainedType values;
+    for (size_t i = 0; i < Size; ++i) {
+      values[i] = expression[i];
+    }
+    return values;
+  }
+
+  template <typename T1, size_t R = Rank>
+  inline __attribute__((always_inline)) std::enable_if_t<(R <= 2)>
+  assign(const TensorExpression<Rank, T1, Size> &expression) {
+    data = evaluate(expression);
+  }
+
+  template <typename T1, size_t R = Rank>
+  inline __attribute__((always_inline)) std::enable_if_t<(R > 2)>
+  assign(const TensorExpression<Rank, T1, Size> &expression) {
+    for (size_t i = 0; i < Size; ++i) {
+      data[i] = expression[i];
+    }
+  }
+
+public:
+  PaddedTensor() : data() {}
+
+  /// Create a PaddedTensor by evaluating an expression (implicit conversion
+  /// allowed)
+  template <typename T1>
+  inline __attribute__((always_inline))
+  PaddedTensor(const TensorExpression<Rank, T1, Size> &expression) {
+    assign(expression);
+  }
+
+  template <typename T1>
+  inline __attribute__((always_inline)) PaddedTensor &
+  operator=(const TensorExpression<Rank, T1, Size> &expression) {
+    assign(expression);
+    return *this;
+  }
+
+  PaddedTensor(const T &value) : data() { operator=(value); }
+  PaddedTensor &operator=(const T &value) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = value;
+    }
+    return *this;
+  }
+
+  PaddedTensor(const NestedInitializerList<T, Rank> &list) : data() {
+    std::copy(list.begin(), list.end(), data.begin());
+  }
+
+  static constexpr size_t size() { return Size; }
+  static constexpr size_t rank() { return Rank; }
+
+  /// Number of elements of each row including the padding
+  static constexpr size_t row_size() { return padded_row_size<T, Size>(); }
+
+  const auto &operator[](size_t i) const { return data[i]; }
+
+  auto &operator[](size_t i) { return data[i]; }
+
+  template <typename... Indices> const auto &eval(Indices... is) const {
+    TENSORALGEBRA_COUNT_EVALUATION("PaddedTensor", 0, 0);
+    return apply_indices(*this, is...);
+  }
+};
+
+/// An array of padded tensors with suitably aligned storage
+template <size_t Rank, typename T = double, size_t Size = 3>
+using PaddedArray =
+    std::vector<PaddedTensor<Rank, T, Size>,
+                AlignedAllocator<PaddedTensor<Rank, T, Size>, 64>>;
+
+} // namespace tensoralgebra
+
+#endif
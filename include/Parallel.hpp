@@ -0,0 +1,167 @@
+#ifndef _TENSORALGEBRA_PARALLEL_HPP
+#define _TENSORALGEBRA_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// This file defines the minimal threading support used by the kernels for
+// large tensors: a loop whose iterations are split statically into one
+// contiguous range per thread. Optionally the thread running each range is
+// bound to a given CPU (Linux only), so that the same range always runs on the
+// same CPU, e.g. next to the memory it first touched (see FirstTouch.hpp).
+
+namespace tensoralgebra {
+
+namespace parallel_detail {
+inline std::atomic<size_t> &num_threads_setting() {
+  static std::atomic<size_t> num_threads(
+      std::max<size_t>(1, std::thread::hardware_concurrency()));
+  return num_threads;
+}
+
+inline std::vector<int> &thread_cpus_setting() {
+  static std::vector<int> cpus;
+  return cpus;
+}
+
+// Binds the calling thread to cpu; returns false if that is not supported
+inline bool bind_to_cpu(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+// Binds the calling thread to the CPU of the given chunk, if CPUs are set
+inline void bind_chunk(size_t chunk) {
+  const std::vector<int> &cpus = thread_cpus_setting();
+  if (!cpus.empty()) {
+    bind_to_cpu(cpus[chunk % cpus.size()]);
+  }
+}
+
+#ifdef __linux__
+// Restores the CPUs the calling thread may run on when it goes out of scope
+class AffinityGuard {
+  cpu_set_t m_set;
+  bool m_saved = false;
+
+public:
+  AffinityGuard() {
+    if (!thread_cpus_setting().empty()) {
+      m_saved = pthread_getaffinity_np(pthread_self(), sizeof(m_set),
+                                       &m_set) == 0;
+    }
+  }
+  AffinityGuard(const AffinityGuard &) = delete;
+  AffinityGuard &operator=(const AffinityGuard &) = delete;
+  ~AffinityGuard() {
+    if (m_saved) {
+      pthread_setaffinity_np(pthread_self(), sizeof(m_set), &m_set);
+    }
+  }
+};
+#else
+struct AffinityGuard {};
+#endif
+} // namespace parallel_detail
+
+/// Maximum number of threads used by parallel kernels
+/** Defaults to the number of hardware threads. */
+inline size_t default_num_threads() {
+  return parallel_detail::num_threads_setting().load();
+}
+
+inline void set_default_num_threads(size_t num_threads) {
+  parallel_detail::num_threads_setting().store(
+      std::max<size_t>(1, num_threads));
+}
+
+/// Binds the thread running chunk c of parallel_for to cpus[c % cpus.size()]
+/** An empty list (the default) leaves the threads unbound. The calling
+ * thread, which runs chunk 0, gets its previous CPUs back afterwards. Must not
+ * be called while parallel_for runs. */
+inline void set_thread_cpus(std::vector<int> cpus) {
+  parallel_detail::thread_cpus_setting() = std::move(cpus);
+}
+
+inline const std::vector<int> &thread_cpus() {
+  return parallel_detail::thread_cpus_setting();
+}
+
+/// Number of threads worth starting for the given amount of work
+/** Starting a thread costs about as much as some 10^5 floating point
+ * operations, so small problems are run on the calling thread only. */
+inline size_t num_threads_for_work(size_t work,
+                                   size_t min_work_per_thread = 1 << 16) {
+  const size_t useful = std::max<size_t>(1, work / min_work_per_thread);
+  return std::min(default_num_threads(), useful);
+}
+
+/// Calls function(chunk_begin, chunk_end) on num_threads contiguous chunks of
+/// [begin, end) concurrently
+/** The calling thread processes the first chunk. The first exception thrown by
+ * any chunk is rethrown once all threads have finished. */
+template <typename Function>
+void parallel_for(size_t begin, size_t end, Function &&function,
+                  size_t num_threads = default_num_threads()) {
+  if (end <= begin) {
+    return;
+  }
+  const size_t count = end - begin;
+  num_threads = std::max<size_t>(1, std::min(num_threads, count));
+  if (num_threads == 1) {
+    function(begin, end);
+    return;
+  }
+
+  auto chunk_begin = [&](size_t chunk) {
+    return begin + chunk * count / num_threads;
+  };
+  std::vector<std::exception_ptr> errors(num_threads);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t chunk = 1; chunk < num_threads; ++chunk) {
+    threads.emplace_back([&, chunk]() {
+      parallel_detail::bind_chunk(chunk);
+      try {
+        function(chunk_begin(chunk), chunk_begin(chunk + 1));
+      } catch (...) {
+        errors[chunk] = std::current_exception();
+      }
+    });
+  }
+  parallel_detail::AffinityGuard guard;
+  parallel_detail::bind_chunk(0);
+  try {
+    function(chunk_begin(0), chunk_begin(1));
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef _TENSORALGEBRA_REDUCTION_HPP
+#define _TENSORALGEBRA_REDUCTION_HPP
+
+#include "Parallel.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TypeChecks.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// This file defines parallel reductions over the points of a field: sums, the
+// L2 and maximum norms and the minimum and maximum with their location, of
+// point expressions (as for TensorField::assign) or of fields. Summing in
+// parallel usually gives results which depend on the number of threads, as
+// each thread sums its own share of the points. Here the points are split into
+// blocks of a fixed number of points instead, each summed in a fixed order,
+// and the block results are combined pairwise in a fixed tree. The threads
+// only decide who computes which blocks, so the results are bit-identical for
+// any number of threads (and pairwise summation is more accurate than a
+// single running sum):
+//
+//   double norm = tensoralgebra::field_l2_norm(
+//       metric.num_points(),
+//       [&](size_t p) { return trace(curvature[p], inverse_metric[p]); });
+//   auto largest = tensoralgebra::field_max(
+//       metric.num_points(), [&](size_t p) { return trace(metric[p]); });
+
+namespace tensoralgebra {
+
+/// The minimum or maximum of a reduction and the first point where it is
+/// attained
+template <typename T> struct PointExtremum {
+  T value;
+  size_t point;
+};
+
+namespace reduction_detail {
+/// Number of points per block, independent of the number of threads
+constexpr size_t block_points = 4096;
+
+/// The type a point expression is evaluated into: tensors for tensor
+/// expressions, the type itself for numbers
+template <typename E, typename Helper = void> struct evaluated {
+  using type = std::decay_t<E>;
+  using component_type = std::decay_t<E>;
+};
+template <typename E>
+struct evaluated<E, std::enable_if_t<is_tensor_expression<E>::value>> {
+  using type = Tensor<std::decay_t<E>::rank(), expression_value_t<E>,
+                      std::decay_t<E>::size()>;
+  using component_type = expression_value_t<E>;
+};
+
+template <typename F>
+using point_type =
+    evaluated<decltype(std::declval<const F &>()(std::declval<size_t>()))>;
+
+/// The components of a tensor or number as an array
+template <typename T> const T *components(const T &number) { return &number; }
+template <size_t Rank, typename T, size_t Size>
+const T *components(const Tensor<Rank, T, Size> &tensor) {
+  return reinterpret_cast<const T *>(&tensor);
+}
+
+template <typename T> constexpr size_t num_components(const T &) { return 1; }
+template <size_t Rank, typename T, size_t Size>
+constexpr size_t num_components(const Tensor<Rank, T, Size> &) {
+  return component_count(Rank, Size);
+}
+
+/// Computes block(begin, end) for the blocks of [0, num_points) in parallel
+/// and combines the results pairwise, neighbouring blocks first
+template <typename R, typename Block, typename Combine>
+R reduce_blocks(size_t num_points, const Block &block, const Combine &combine,
+                size_t num_threads) {
+  const size_t num_blocks = (num_points + block_points - 1) / block_points;
+  std::vector<R> results(num_blocks, block(0, 0));
+  parallel_for(0, num_blocks,
+               [&](size_t first_block, size_t end_block) {
+                 for (size_t b = first_block; b < end_block; ++b) {
+                   results[b] = block(b * block_points,
+                                      std::min(num_points,
+                                               (b + 1) * block_points));
+                 }
+               },
+               num_threads);
+  for (size_t stride = 1; stride < num_blocks; stride *= 2) {
+    for (size_t b = 0; b + stride < num_blocks; b += 2 * stride) {
+      results[b] = combine(results[b], results[b + stride]);
+    }
+  }
+  return num_blocks == 0 ? block(0, 0) : results[0];
+}
+
+/// Sums value(point) over [begin, end) in four interleaved partial sums
+template <typename R, typename F>
+R block_sum(size_t begin, size_t end, const F &value) {
+  using T = typename point_type<F>::component_type;
+  R sums[4] = {R(T(0)), R(T(0)), R(T(0)), R(T(0))};
+  size_t point = begin;
+  for (; point + 4 <= end; point += 4) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      sums[lane] += value(point + lane);
+    }
+  }
+  for (; point < end; ++point) {
+    sums[(point - begin) % 4] += value(point);
+  }
+  return R((sums[0] + sums[1]) + (sums[2] + sums[3]));
+}
+
+/// Whether a number is NaN (false for integers)
+template <typename T> bool is_nan(const T &value) { return value != value; }
+
+/// The larger of a and b, or NaN if either of them is NaN (std::max drops a
+/// NaN in its second argument, which would hide a diverging field)
+template <typename T> T larger(const T &a, const T &b) {
+  return (b <= a || is_nan(a)) ? a : b;
+}
+
+template <typename F>
+using sum_type = std::decay_t<decltype(std::sqrt(
+    std::declval<typename point_type<F>::component_type>()))>;
+
+template <bool Maximum, typename F>
+PointExtremum<typename point_type<F>::type>
+find_extremum(size_t num_points, F &&point_expression, size_t num_threads) {
+  using T = typename point_type<F>::type;
+  static_assert(std::is_arithmetic<T>::value,
+                "The minimum and maximum are defined for numbers only.");
+  if (num_points == 0) {
+    throw std::invalid_argument(
+        "field_min/field_max: no points to find the extremum of");
+  }
+  // Ties are resolved in favour of a, which always has the lower points. NaN
+  // wins over all numbers, so the first NaN is found if there is one
+  const auto better = [](const PointExtremum<T> &a,
+                         const PointExtremum<T> &b) {
+    if (is_nan(a.value) || is_nan(b.value)) {
+      return is_nan(a.value) ? a : b;
+    }
+    return (Maximum ? b.value > a.value : b.value < a.value) ? b : a;
+  };
+  return reduce_blocks<PointExtremum<T>>(
+      num_points,
+      [&](size_t begin, size_t end) {
+        PointExtremum<T> extremum{T(0), begin};
+        if (begin < end) {
+          extremum.value = point_expression(begin);
+          for (size_t point = begin + 1; point < end; ++point) {
+            extremum = better(extremum, {T(point_expression(point)), point});
+          }
+        }
+        return extremum;
+      },
+      better, num_threads);
+}
+} // namespace reduction_detail
+
+/// Sum of point_expression(point) over the points [0, num_points)
+/** point_expression returns a number or a tensor expression; for the latter
+ * the result is the tensor of the sums of each component. The result does not
+ * depend on num_threads. */
+template <typename F>
+typename reduction_detail::point_type<F>::type
+field_sum(size_t num_points, F &&point_expression,
+          size_t num_threads = default_num_threads()) {
+  using R = typename reduction_detail::point_type<F>::type;
+  return reduction_detail::reduce_blocks<R>(
+      num_points,
+      [&](size_t begin, size_t end) {
+        return reduction_detail::block_sum<R>(begin, end, point_expression);
+      },
+      [](const R &a, const R &b) { return R(a + b); }, num_threads);
+}
+
+/// The square root of the sum of the squares of all components of
+/// point_expression(point) over the points [0, num_points)
+/** Divide the square by num_points for the mean square. The result does not
+ * depend on num_threads. */
+template <typename F>
+reduction_detail::sum_type<F>
+field_l2_norm(size_t num_points, F &&point_expression,
+              size_t num_threads = default_num_threads()) {
+  using R = reduction_detail::sum_type<F>;
+  using T = typename reduction_detail::point_type<F>::type;
+  const auto square = [&](size_t point) {
+    const T value = point_expression(point);
+    const auto *components = reduction_detail::components(value);
+    R sum = R(0);
+    for (size_t c = 0; c < reduction_detail::num_components(value); ++c) {
+      sum += R(components[c]) * R(components[c]);
+    }
+    return sum;
+  };
+  return std::sqrt(reduction_detail::reduce_blocks<R>(
+      num_points,
+      [&](size_t begin, size_t end) {
+        return reduction_detail::block_sum<R>(begin, end, square);
+      },
+      [](R a, R b) { return a + b; }, num_threads));
+}
+
+/// The largest absolute value of all components of point_expression(point)
+/// over the points [0, num_points) (zero if there are none)
+/** NaN if any component is NaN, as for field_l2_norm. */
+template <typename F>
+reduction_detail::sum_type<F>
+field_linf_norm(size_t num_points, F &&point_expression,
+                size_t num_threads = default_num_threads()) {
+  using R = reduction_detail::sum_type<F>;
+  using T = typename reduction_detail::point_type<F>::type;
+  return reduction_detail::reduce_blocks<R>(
+      num_points,
+      [&](size_t begin, size_t end) {
+        R maximum = R(0);
+        for (size_t point = begin; point < end; ++point) {
+          const T value = point_expression(point);
+          const auto *components = reduction_detail::components(value);
+          for (size_t c = 0; c < reduction_detail::num_components(value);
+               ++c) {
+            maximum = reduction_detail::larger(maximum,
+                                               R(std::abs(components[c])));
+          }
+        }
+        return maximum;
+      },
+      [](R a, R b) { return reduction_detail::larger(a, b); }, num_threads);
+}
+
+/// The smallest (largest) value of point_expression(point), a number, over the
+/// points [0, num_points) and the first point where it is attained
+/** If any value is NaN, the result is NaN and the first point where it
+ * occurs. Throws std::invalid_argument if there are no points. */
+template <typename F>
+PointExtremum<typename reduction_detail::point_type<F>::type>
+field_min(size_t num_points, F &&point_expression,
+          size_t num_threads = default_num_threads()) {
+  return reduction_detail::find_extremum<false>(
+      num_points, std::forward<F>(point_expression), num_threads);
+}
+
+template <typename F>
+PointExtremum<typename reduction_detail::point_type<F>::type>
+field_max(size_t num_points, F &&point_expression,
+          size_t num_threads = default_num_threads()) {
+  return reduction_detail::find_extremum<true>(
+      num_points, std::forward<F>(point_expression), num_threads);
+}
+
+/// The sum and norms of the tensors of a field
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+Tensor<Rank, T, Size>
+field_sum(const TensorField<Rank, T, Size, Allocator> &field,
+          size_t num_threads = default_num_threads()) {
+  return field_sum(
+      field.num_points(), [&](size_t p) -> const Tensor<Rank, T, Size> & {
+        return field[p];
+      },
+      num_threads);
+}
+
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+auto field_l2_norm(const TensorField<Rank, T, Size, Allocator> &field,
+                   size_t num_threads = default_num_threads()) {
+  return field_l2_norm(
+      field.num_points(), [&](size_t p) -> const Tensor<Rank, T, Size> & {
+        return field[p];
+      },
+      num_threads);
+}
+
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+auto field_linf_norm(const TensorField<Rank, T, Size, Allocator> &field,
+                     size_t num_threads = default_num_threads()) {
+  return field_linf_norm(
+      field.num_points(), [&](size_t p) -> const Tensor<Rank, T, Size> & {
+        return field[p];
+      },
+      num_threads);
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,519 @@
+#ifndef _TENSORALGEBRA_REGRID_HPP
+#define _TENSORALGEBRA_REGRID_HPP
+
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// This file defines the transfer of tensor fields between the levels of an
+// adaptive mesh with a refinement ratio of 2. The grids are vertex centred:
+// every second point of a fine box coincides with a coarse point. A fine box
+// is placed in a coarse box by its offset, the index of its first point in
+// the coarse box refined by 2, so fine point i lies at coarse index
+// (offset + i) / 2.
+//
+// prolong_field interpolates with Lagrange polynomials through Order coarse
+// points per direction (fine points on coarse points are copied), and
+// restrict_field injects fine values or averages them with the full weighting
+// stencil (1/4, 1/2, 1/4) per direction. Both are separable and applied one
+// direction at a time, to all components of the tensors at once: the x pass
+// combines the contiguous components of neighbouring points, and the y and z
+// passes whole x lines and xy planes, loops which the compiler vectorizes
+// across points and components. The output is produced in chunks of z planes
+// so that the intermediate results stay in cache. With symmetric set, tensors
+// are assumed symmetric in their first two indices (see CompressedStream.hpp):
+// only the components with i <= j are interpolated and the others are copied
+// from them, which saves a third of the arithmetic for rank 2 tensors (but
+// adds a copy) and keeps the results exactly symmetric.
+//
+//   tensoralgebra::prolong_field<4>(coarse_metric, fine_metric, {{16, 8, 8}},
+//                                   true);
+//   tensoralgebra::restrict_field(fine_metric, coarse_metric, {{16, 8, 8}},
+//                                 tensoralgebra::Restriction::full_weighting,
+//                                 true);
+
+namespace tensoralgebra {
+
+/// How restrict_field computes coarse values from fine ones
+enum class Restriction {
+  injection,     // the value at the coinciding fine point
+  full_weighting // (1/4, 1/2, 1/4) in each direction, injection at the edges
+};
+
+namespace regrid_detail {
+/// Whether component c of a tensor symmetric in its first two indices is
+/// copied from another one (i > j), and from which
+template <size_t Rank, size_t Size> bool is_mirrored(size_t c) {
+  constexpr size_t inner = component_count(Rank >= 2 ? Rank - 2 : 0, Size);
+  return Rank >= 2 && c / (Size * inner) > (c / inner) % Size;
+}
+template <size_t Rank, size_t Size> size_t mirrored_component(size_t c) {
+  constexpr size_t inner = component_count(Rank >= 2 ? Rank - 2 : 0, Size);
+  const size_t i = c / (Size * inner), j = (c / inner) % Size;
+  return (j * Size + i) * inner + c % inner;
+}
+
+/// Number of components with i <= j for the first two indices
+constexpr size_t symmetric_component_count(size_t rank, size_t size) {
+  return rank < 2 ? component_count(rank, size)
+                  : size * (size + 1) / 2 * component_count(rank - 2, size);
+}
+
+/// Flat indices of the transferred components: all of them, or those with
+/// i <= j for the first two indices if symmetric
+template <size_t Rank, size_t Size>
+std::vector<size_t> transferred_components(bool symmetric) {
+  std::vector<size_t> components;
+  for (size_t c = 0; c < component_count(Rank, Size); ++c) {
+    if (!symmetric || !is_mirrored<Rank, Size>(c)) {
+      components.push_back(c);
+    }
+  }
+  return components;
+}
+
+/// A one dimensional transfer: output point i is the sum of
+/// weights[i * width + k] times input point first[i] + k, for k < width
+struct Stencils {
+  size_t width = 1;
+  std::vector<size_t> first;
+  std::vector<double> weights;
+
+  void add(size_t first_point, const double *point_weights) {
+    first.push_back(first_point);
+    weights.insert(weights.end(), point_weights, point_weights + width);
+  }
+};
+
+/// The scratch arrays of the calling thread: 0 and 1 between the passes, 2 for
+/// the result
+template <typename T> std::array<std::vector<T>, 3> &scratch_buffers() {
+  thread_local std::array<std::vector<T>, 3> buffers;
+  return buffers;
+}
+
+/// Scratch array slot of the calling thread, grown as needed
+/** The arrays live as long as the thread. The result (slot 2), which covers a
+ * whole box, is taken on the thread calling prolong_field or restrict_field
+ * and reused for box after box, until release_regrid_scratch(). Slots 0 and 1
+ * are taken on the threads of parallel_for, which are started for every
+ * transfer, so they are only reused if the transfer runs on the calling
+ * thread alone. */
+template <typename T> T *scratch(size_t slot, size_t size) {
+  std::array<std::vector<T>, 3> &buffers = scratch_buffers<T>();
+  if (buffers[slot].size() < size) {
+    buffers[slot].resize(size);
+  }
+  return buffers[slot].data();
+}
+
+/// Sets result[b] to the sum of weights[k] * first[k * stride + b] (or of
+/// first[k * stride + components[b]] if given) for b < block and k < width
+/** With Width and Block not zero the width and the block size are known at
+ * compile time: the loop over the stencil is unrolled, so each result is
+ * written once, and so are the short loops over the components of a point. */
+template <size_t Width, size_t Block, typename T>
+inline void combine(const double *weights, const T *__restrict__ first,
+                    size_t stride, T *__restrict__ result, size_t block,
+                    size_t width, const size_t *components) {
+  if (Block != 0) {
+    block = Block;
+  }
+  if (components != nullptr) {
+    for (size_t b = 0; b < block; ++b) {
+      T sum = 0;
+      for (size_t k = 0; k < width; ++k) {
+        sum += weights[k] * first[k * stride + components[b]];
+      }
+      result[b] = sum;
+    }
+  } else if (Width != 0) {
+    T w[Width > 0 ? Width : 1];
+    for (size_t k = 0; k < Width; ++k) {
+      w[k] = weights[k];
+    }
+    for (size_t b = 0; b < block; ++b) {
+      T sum = w[0] * first[b];
+      for (size_t k = 1; k < Width; ++k) {
+        sum += w[k] * first[k * stride + b];
+      }
+      result[b] = sum;
+    }
+  } else {
+    const T first_weight = weights[0];
+    for (size_t b = 0; b < block; ++b) {
+      result[b] = first_weight * first[b];
+    }
+    for (size_t k = 1; k < width; ++k) {
+      const T weight = weights[k];
+      const T *__restrict__ next = first + k * stride;
+      for (size_t b = 0; b < block; ++b) {
+        result[b] += weight * next[b];
+      }
+    }
+  }
+}
+
+/// Applies stencils to the output points [begin, end) of lines of points
+/// with block values each: output point i of line o is written to target(o) +
+/// i * block and read from source(o) + (first[i] - shift + k) * stride
+/** Block, if not zero, is the block size known at compile time, and Stride
+ * the stride between input points; otherwise both are runtime_block. If
+ * components is given, value b of an output point is computed from value
+ * components[b] of the input points. */
+template <typename T, size_t Width, size_t Block, size_t Stride,
+          typename Source, typename Target>
+void apply_width(const Stencils &stencils, Source source, Target target,
+                 size_t begin, size_t end, size_t runtime_block, size_t shift,
+                 const size_t *components) {
+  const size_t block = Block != 0 ? Block : runtime_block;
+  const size_t stride = Block != 0 ? Stride : runtime_block;
+  const size_t n_out = stencils.first.size(), width = stencils.width;
+  size_t o = begin / n_out, i = begin % n_out;
+  const T *in = source(o);
+  T *out = target(o);
+  for (size_t point = begin; point < end; ++point) {
+    combine<Width, Block>(&stencils.weights[i * width],
+                          in + (stencils.first[i] - shift) * stride, stride,
+                          out + i * block, block, width, components);
+    if (++i == n_out && point + 1 < end) {
+      i = 0;
+      ++o;
+      in = source(o);
+      out = target(o);
+    }
+  }
+}
+
+/// apply_width for the widths of the stencils of prolongation up to sixth
+/// order and of full weighting, and any other width
+template <typename T, size_t Block = 0, size_t Stride = Block,
+          typename Source, typename Target>
+void apply(const Stencils &stencils, Source source, Target target,
+           size_t begin, size_t end, size_t runtime_block, size_t shift = 0,
+           const size_t *components = nullptr) {
+  switch (stencils.width) {
+  case 1:
+    return apply_width<T, 1, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  case 2:
+    return apply_width<T, 2, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  case 3:
+    return apply_width<T, 3, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  case 4:
+    return apply_width<T, 4, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  case 6:
+    return apply_width<T, 6, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  default:
+    return apply_width<T, 0, Block, Stride>(stencils, source, target, begin,
+                                            end, runtime_block, shift,
+                                            components);
+  }
+}
+
+/// Applies stencils in x, y and z to the components (all if nullptr) of a box
+/// of extent points with Stride values each, whose x lines start at
+/// source(j + extent[1] * k), and writes the Block values per point of the
+/// result to target
+/** The output is computed in chunks of z planes, for each of which the x and
+ * y passes are applied to the input planes it needs only, so that the
+ * intermediate results stay in cache; finish(begin, end) is then called with
+ * the range of z planes written. The chunks are split between threads. */
+template <size_t Block, size_t Stride, typename T, typename Source,
+          typename Finish>
+void apply_separable(Source source, const std::array<size_t, 3> &extent,
+                     const std::array<Stencils, 3> &stencils,
+                     const size_t *components, T *target, Finish finish) {
+  const size_t block = Block;
+  const Stencils &x = stencils[0], &y = stencils[1], &z = stencils[2];
+  const size_t x_line = x.first.size() * block;
+  const size_t y_line = y.first.size() * x_line;
+  const size_t n_out = z.first.size();
+  // At least 16 planes, so that the input planes shared by neighbouring
+  // chunks are computed twice only for a small fraction of them
+  const size_t chunk = std::max(size_t(16), (size_t(1) << 18) / y_line);
+  const size_t num_chunks = (n_out + chunk - 1) / chunk;
+  auto transfer = [&](size_t chunk_begin, size_t chunk_end) {
+    for (size_t c = chunk_begin; c < chunk_end; ++c) {
+      const size_t out_begin = c * chunk;
+      const size_t out_end = std::min(n_out, out_begin + chunk);
+      size_t in_begin = z.first[out_begin], in_end = 0;
+      for (size_t i = out_begin; i < out_end; ++i) {
+        in_begin = std::min(in_begin, z.first[i]);
+        in_end = std::max(in_end, z.first[i] + z.width);
+      }
+      const size_t num_in = in_end - in_begin;
+      T *after_x = scratch<T>(0, x_line * extent[1] * num_in);
+      T *after_y = scratch<T>(1, y_line * num_in);
+      apply<T, Block, Stride>(
+          x, [&](size_t o) { return source(o + in_begin * extent[1]); },
+          [&](size_t o) { return after_x + o * x_line; }, 0,
+          extent[1] * num_in * x.first.size(), block, 0, components);
+      apply<T>(
+          y,
+          [&](size_t o) -> const T * {
+            return after_x + o * extent[1] * x_line;
+          },
+          [&](size_t o) { return after_y + o * y_line; }, 0,
+          num_in * y.first.size(), x_line);
+      apply<T>(
+          z, [&](size_t) -> const T * { return after_y; },
+          [&](size_t) { return target; }, out_begin, out_end, y_line,
+          in_begin);
+      finish(out_begin, out_end);
+    }
+  };
+  parallel_for(0, num_chunks, transfer,
+               num_threads_for_work(n_out * y_line * z.width));
+}
+
+/// Copies the transferred components of each point into the box
+/// [begin, begin + extent) of field, mirroring the others
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+void unpack(const T *source, TensorField<Rank, T, Size, Allocator> &field,
+            const std::array<size_t, 3> &begin,
+            const std::array<size_t, 3> &extent,
+            const std::vector<size_t> &components) {
+  constexpr size_t num_components = component_count(Rank, Size);
+  // The position of each component in the transferred ones
+  size_t positions[num_components];
+  for (size_t p = 0; p < components.size(); ++p) {
+    positions[components[p]] = p;
+  }
+  for (size_t c = 0; c < num_components; ++c) {
+    if (components.size() != num_components && is_mirrored<Rank, Size>(c)) {
+      positions[c] = positions[mirrored_component<Rank, Size>(c)];
+    }
+  }
+  const size_t block = components.size();
+  for (size_t k = 0; k < extent[2]; ++k) {
+    for (size_t j = 0; j < extent[1]; ++j) {
+      T *target = field.components() +
+                  field.index(begin[0], begin[1] + j, begin[2] + k) *
+                      num_components;
+      for (size_t i = 0; i < extent[0]; ++i) {
+        for (size_t c = 0; c < num_components; ++c) {
+          target[c] = source[positions[c]];
+        }
+        target += num_components;
+        source += block;
+      }
+    }
+  }
+}
+} // namespace regrid_detail
+
+/// Sets fine to the Lagrange interpolation of coarse through Order points per
+/// direction
+/** Fine point i lies at coarse index (offset + i) / 2. Fine points on coarse
+ * points are copied; the stencils of the others are centred where possible and
+ * shifted inwards at the edges of coarse. Directions in which both fields have
+ * a single point are ignored. If symmetric, the tensors are assumed symmetric
+ * in their first two indices. Throws std::invalid_argument if fine does not
+ * lie inside coarse or coarse is too small for the stencil. */
+template <size_t Order = 4, size_t Rank, typename T, size_t Size,
+          typename Allocator1, typename Allocator2>
+void prolong_field(const TensorField<Rank, T, Size, Allocator1> &coarse,
+                   TensorField<Rank, T, Size, Allocator2> &fine,
+                   const std::array<size_t, 3> &offset,
+                   bool symmetric = false) {
+  static_assert(Order >= 2, "At least two points per direction are needed.");
+  std::array<regrid_detail::Stencils, 3> stencils;
+  std::array<size_t, 3> begin, extent;
+  for (size_t dir = 0; dir < 3; ++dir) {
+    const size_t n_coarse = coarse.extent(dir), n_fine = fine.extent(dir);
+    if (n_coarse == 1 && n_fine == 1 && offset[dir] == 0) {
+      const double weight = 1.;
+      begin[dir] = 0;
+      extent[dir] = 1;
+      stencils[dir].add(0, &weight);
+      continue;
+    }
+    const size_t last = offset[dir] + n_fine - 1; // in fine points
+    if (n_fine == 0 || last / 2 + last % 2 >= n_coarse || n_coarse < Order) {
+      throw std::invalid_argument(
+          "prolong_field: the fine field does not lie inside the coarse "
+          "field, or the coarse field is smaller than the stencil, in "
+          "direction " +
+          std::to_string(dir));
+    }
+    std::vector<size_t> first(n_fine);
+    for (size_t i = 0; i < n_fine; ++i) {
+      const size_t position = (offset[dir] + i) / 2;
+      first[i] = std::min(std::max(position, Order / 2 - 1) - (Order / 2 - 1),
+                          n_coarse - Order);
+    }
+    begin[dir] = first.front();
+    extent[dir] = first.back() + Order - begin[dir];
+    stencils[dir].width = Order;
+    for (size_t i = 0; i < n_fine; ++i) {
+      const size_t twice_t = offset[dir] + i - 2 * first[i];
+      double weights[Order] = {};
+      if (twice_t % 2 == 0) {
+        weights[twice_t / 2] = 1.;
+      } else {
+        const double t = 0.5 * double(twice_t);
+        for (size_t k = 0; k < Order; ++k) {
+          double weight = 1.;
+          for (size_t m = 0; m < Order; ++m) {
+            if (m != k) {
+              weight *= (t - double(m)) / (double(k) - double(m));
+            }
+          }
+          weights[k] = weight;
+        }
+      }
+      stencils[dir].add(first[i] - begin[dir], weights);
+    }
+  }
+
+  // The x lines are read from coarse directly. Without symmetry the result is
+  // written to fine directly as well
+  constexpr size_t num_components = component_count(Rank, Size);
+  constexpr size_t num_stored =
+      regrid_detail::symmetric_component_count(Rank, Size);
+  auto source = [&](size_t o) {
+    return coarse.components() +
+           coarse.index(begin[0], begin[1] + o % extent[1],
+                        begin[2] + o / extent[1]) *
+               num_components;
+  };
+  if (!symmetric) {
+    regrid_detail::apply_separable<num_components, num_components>(
+        source, extent, stencils, nullptr, fine.components(),
+        [](size_t, size_t) {});
+    return;
+  }
+  // Otherwise each chunk of z planes is mirrored into fine while in cache
+  const std::vector<size_t> components =
+      regrid_detail::transferred_components<Rank, Size>(true);
+  const size_t plane = fine.extent(0) * fine.extent(1) * num_stored;
+  T *result = regrid_detail::scratch<T>(2, fine.num_points() * num_stored);
+  regrid_detail::apply_separable<num_stored, num_components>(
+      source, extent, stencils, components.data(), result,
+      [&](size_t z_begin, size_t z_end) {
+        regrid_detail::unpack(
+            result + z_begin * plane, fine, {{0, 0, z_begin}},
+            {{fine.extent(0), fine.extent(1), z_end - z_begin}}, components);
+      });
+}
+
+/// Frees the scratch memory for components of type T which prolong_field and
+/// restrict_field keep on the calling thread between transfers
+/** It is as large as the largest box transferred (on the fine side for
+ * prolongation, the coarse side for restriction); call this after the last
+ * transfer of a regrid. */
+template <typename T = double> void release_regrid_scratch() {
+  for (std::vector<T> &buffer : regrid_detail::scratch_buffers<T>()) {
+    std::vector<T>().swap(buffer);
+  }
+}
+
+/// Sets the points of coarse covered by fine to the restriction of fine
+/** Fine point i lies at coarse index (offset + i) / 2; the coarse points c
+ * whose fine point 2 c - offset lies inside fine are set, the others are left
+ * unchanged. Full weighting falls back to injection in a direction where a
+ * neighbouring fine point is missing. If symmetric, the tensors are assumed
+ * symmetric in their first two indices. */
+template <size_t Rank, typename T, size_t Size, typename Allocator1,
+          typename Allocator2>
+void restrict_field(const TensorField<Rank, T, Size, Allocator1> &fine,
+                    TensorField<Rank, T, Size, Allocator2> &coarse,
+                    const std::array<size_t, 3> &offset,
+                    Restriction restriction = Restriction::full_weighting,
+                    bool symmetric = false) {
+  std::array<regrid_detail::Stencils, 3> stencils;
+  std::array<size_t, 3> coarse_begin, coarse_extent, fine_begin, fine_extent;
+  for (size_t dir = 0; dir < 3; ++dir) {
+    const size_t n_fine = fine.extent(dir);
+    // The coarse points c with offset <= 2 c < offset + n_fine
+    const size_t c_begin = (offset[dir] + 1) / 2;
+    const size_t c_end =
+        std::min(coarse.extent(dir), (offset[dir] + n_fine + 1) / 2);
+    if (n_fine == 0 || c_end <= c_begin) {
+      return;
+    }
+    coarse_begin[dir] = c_begin;
+    coarse_extent[dir] = c_end - c_begin;
+    // The fine points used, including a neighbour on each side if present
+    const size_t f_first = 2 * c_begin - offset[dir];
+    const size_t f_last = 2 * (c_end - 1) - offset[dir];
+    bool average = restriction == Restriction::full_weighting;
+    fine_begin[dir] = average && f_first > 0 ? f_first - 1 : f_first;
+    size_t f_end = average && f_last + 1 < n_fine ? f_last + 2 : f_last + 1;
+    if (f_end - fine_begin[dir] < 3) {
+      // No point has both neighbours
+      average = false;
+      fine_begin[dir] = f_first;
+      f_end = f_last + 1;
+    }
+    fine_extent[dir] = f_end - fine_begin[dir];
+    stencils[dir].width = average ? 3 : 1;
+    for (size_t c = c_begin; c < c_end; ++c) {
+      const size_t f = 2 * c - offset[dir];
+      if (!average) {
+        const double weight = 1.;
+        stencils[dir].add(f - fine_begin[dir], &weight);
+      } else if (f > 0 && f + 1 < n_fine) {
+        const double weights[3] = {0.25, 0.5, 0.25};
+        stencils[dir].add(f - 1 - fine_begin[dir], weights);
+      } else {
+        // Injection, with the three points read kept inside the box
+        const size_t first = std::min(std::max(f, fine_begin[dir] + 1) - 1,
+                                      f_end - 3);
+        double weights[3] = {};
+        weights[f - first] = 1.;
+        stencils[dir].add(first - fine_begin[dir], weights);
+      }
+    }
+  }
+
+  constexpr size_t num_components = component_count(Rank, Size);
+  constexpr size_t num_stored =
+      regrid_detail::symmetric_component_count(Rank, Size);
+  const std::array<size_t, 3> &extent = fine_extent;
+  auto source = [&](size_t o) {
+    return fine.components() +
+           fine.index(fine_begin[0], fine_begin[1] + o % extent[1],
+                      fine_begin[2] + o / extent[1]) *
+               num_components;
+  };
+  // The result is copied (and mirrored) into coarse chunk by chunk
+  const std::vector<size_t> components =
+      regrid_detail::transferred_components<Rank, Size>(symmetric);
+  const size_t plane = coarse_extent[0] * coarse_extent[1] * components.size();
+  T *result = regrid_detail::scratch<T>(2, plane * coarse_extent[2]);
+  auto finish = [&](size_t z_begin, size_t z_end) {
+    regrid_detail::unpack(result + z_begin * plane, coarse,
+                          {{coarse_begin[0], coarse_begin[1],
+                            coarse_begin[2] + z_begin}},
+                          {{coarse_extent[0], coarse_extent[1],
+                            z_end - z_begin}},
+                          components);
+  };
+  if (!symmetric) {
+    regrid_detail::apply_separable<num_components, num_components>(
+        source, extent, stencils, nullptr, result, finish);
+  } else {
+    regrid_detail::apply_separable<num_stored, num_components>(
+        source, extent, stencils, components.data(), result, finish);
+  }
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef _TENSORALGEBRA_STATEMENTGRAPH_HPP
+#define _TENSORALGEBRA_STATEMENTGRAPH_HPP
+
+#include "Parallel.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// This file defines the fused execution of a sequence of assignments to fields,
+// e.g. the steps of a time step (inverse metric, Christoffel symbols, Ricci
+// tensor, right hand side). Executed one by one, every statement streams all
+// of its fields through main memory. A StatementGraph instead executes all
+// statements for one tile of points (sized to fit in the cache) before moving
+// on to the next tile, and values which are only needed within the graph are
+// stored in Intermediates, which occupy one tile of scratch memory per thread
+// instead of a whole field:
+//
+//   tensoralgebra::StatementGraph graph(num_points);
+//   auto &inverse = graph.intermediate<2>();
+//   graph.assign(inverse, {reads(metric)},
+//                [&](size_t p) { return inverse_of(metric[p]); });
+//   graph.assign(ricci, {reads(inverse), reads(christoffel)},
+//                [&](size_t p) { return ...; });
+//   graph.run();
+//
+// Statements are assumed to combine values at the assigned point, which
+// allows any sequence of them to be fused. A statement which reads a field at
+// other points (e.g. a finite difference) must declare it with
+// reads_neighbours(); if that field is assigned by an earlier statement, all
+// tiles of the earlier statements have to be completed first, so the graph is
+// split into stages there, which are fused separately.
+
+namespace tensoralgebra {
+
+/// A field or intermediate read by a statement
+struct Access {
+  const void *target;
+  size_t bytes_per_point;
+  bool neighbours; // whether points other than the assigned one are read
+};
+
+/// Declares that a statement reads field at the assigned point only
+template <typename Field> Access reads(const Field &field) {
+  return {&field, sizeof(typename Field::TensorType), false};
+}
+
+/// Declares that a statement reads field at other points, too
+template <typename Field> Access reads_neighbours(const Field &field) {
+  return {&field, sizeof(typename Field::TensorType), true};
+}
+
+namespace statement_graph_detail {
+// The tile executed by the calling thread
+struct Tile {
+  size_t begin;
+  unsigned char *const *buffers; // scratch memory of each intermediate
+};
+
+inline const Tile *&current_tile() {
+  thread_local const Tile *tile = nullptr;
+  return tile;
+}
+
+// Makes tile the current tile of the calling thread during its lifetime
+class TileScope {
+  const Tile *m_previous;
+
+public:
+  explicit TileScope(const Tile &tile) : m_previous(current_tile()) {
+    current_tile() = &tile;
+  }
+  TileScope(const TileScope &) = delete;
+  TileScope &operator=(const TileScope &) = delete;
+  ~TileScope() { current_tile() = m_previous; }
+};
+
+// The value stored per point: a tensor, or a scalar for rank 0
+template <size_t Rank, typename T, size_t Size> struct PointValue {
+  using type = Tensor<Rank, T, Size>;
+};
+
+template <typename T, size_t Size> struct PointValue<0, T, Size> {
+  using type = T;
+};
+
+struct Statement {
+  Access output;
+  std::vector<Access> inputs;
+  std::function<void(size_t, size_t)> execute; // for the points [begin, end)
+};
+} // namespace statement_graph_detail
+
+/// One tensor (or scalar, for rank 0) per point, which only exists while a
+/// StatementGraph runs
+/** Intermediates are created by StatementGraph::intermediate() and can only be
+ * accessed (with the global point index, like a field) by the statements of
+ * that graph, in the stage in which they are assigned. */
+template <size_t Rank, typename T = double, size_t Size = 3>
+class Intermediate {
+  size_t m_id;
+
+public:
+  using TensorType =
+      typename statement_graph_detail::PointValue<Rank, T, Size>::type;
+
+  explicit Intermediate(size_t id) : m_id(id) {}
+  Intermediate(const Intermediate &) = delete;
+  Intermediate &operator=(const Intermediate &) = delete;
+
+  size_t id() const { return m_id; }
+
+  TensorType &operator[](size_t point) const {
+    const statement_graph_detail::Tile *tile =
+        statement_graph_detail::current_tile();
+    return reinterpret_cast<TensorType *>(
+        tile->buffers[m_id])[point - tile->begin];
+  }
+};
+
+/// Statements [begin, end) of a StatementGraph which are executed together,
+/// tile by tile
+struct StatementStage {
+  size_t begin;
+  size_t end;
+  size_t tile_points;
+  size_t scratch_bytes; // per thread, for the intermediates of the stage
+};
+
+/// A sequence of assignments to fields and intermediates, executed fused
+class StatementGraph {
+  using Statement = statement_graph_detail::Statement;
+
+  size_t m_num_points;
+  size_t m_cache_bytes = size_t(256) << 10;
+  size_t m_tile_points = 0;
+  std::vector<Statement> m_statements;
+  std::vector<std::shared_ptr<void>> m_intermediates;
+  std::vector<size_t> m_intermediate_bytes;
+  std::map<const void *, size_t> m_intermediate_ids;
+
+  bool is_intermediate(const Access &access) const {
+    return m_intermediate_ids.count(access.target) > 0;
+  }
+
+  [[noreturn]] static void error(size_t statement, const std::string &message) {
+    throw std::invalid_argument("StatementGraph: statement " +
+                                std::to_string(statement) + " " + message);
+  }
+
+  size_t tile_points(size_t bytes_per_point) const {
+    if (m_tile_points > 0) {
+      return std::min(m_tile_points, m_num_points);
+    }
+    // A multiple of 16 points, so that tiles start on cache lines
+    const size_t points = m_cache_bytes / std::max<size_t>(1, bytes_per_point);
+    return std::max<size_t>(1, std::min(std::max<size_t>(16, points / 16 * 16),
+                                        m_num_points));
+  }
+
+  // Offsets of the intermediates assigned in stage in its scratch memory
+  // (size_t(-1) for the others); returns the size of the scratch memory
+  size_t scratch_layout(const StatementStage &stage,
+                        std::vector<size_t> &offsets) const {
+    offsets.assign(m_intermediates.size(), size_t(-1));
+    size_t size = 0;
+    for (size_t s = stage.begin; s < stage.end; ++s) {
+      const Access &output = m_statements[s].output;
+      if (is_intermediate(output)) {
+        const size_t id = m_intermediate_ids.at(output.target);
+        if (offsets[id] == size_t(-1)) {
+          offsets[id] = size;
+          // Offsets are multiples of the cache line size
+          size += (stage.tile_points * m_intermediate_bytes[id] + 63) / 64 * 64;
+        }
+      }
+    }
+    return size;
+  }
+
+  void run_stage(const StatementStage &stage, size_t num_threads) const {
+    std::vector<size_t> offsets;
+    const size_t scratch_size = scratch_layout(stage, offsets);
+    const size_t num_tiles =
+        (m_num_points + stage.tile_points - 1) / stage.tile_points;
+    parallel_for(
+        0, num_tiles,
+        [&](size_t tile_begin, size_t tile_end) {
+          std::vector<std::max_align_t> scratch(
+              scratch_size / sizeof(std::max_align_t) + 1);
+          std::vector<unsigned char *> buffers(offsets.size(), nullptr);
+          for (size_t id = 0; id < offsets.size(); ++id) {
+            if (offsets[id] != size_t(-1)) {
+              buffers[id] =
+                  reinterpret_cast<unsigned char *>(scratch.data()) +
+                  offsets[id];
+            }
+          }
+          statement_graph_detail::Tile tile = {0, buffers.data()};
+          statement_graph_detail::TileScope scope(tile);
+          for (size_t t = tile_begin; t < tile_end; ++t) {
+            tile.begin = t * stage.tile_points;
+            const size_t end =
+                std::min(tile.begin + stage.tile_points, m_num_points);
+            for (size_t s = stage.begin; s < stage.end; ++s) {
+              m_statements[s].execute(tile.begin, end);
+            }
+          }
+        },
+        num_threads);
+  }
+
+public:
+  /// A graph of statements assigning fields of num_points points
+  explicit StatementGraph(size_t num_points) : m_num_points(num_points) {}
+
+  StatementGraph(const StatementGraph &) = delete;
+  StatementGraph &operator=(const StatementGraph &) = delete;
+
+  size_t num_points() const { return m_num_points; }
+  size_t num_statements() const { return m_statements.size(); }
+
+  /// Size of the cache a tile should fit in (256 KiB by default), used to
+  /// choose the number of points per tile
+  void set_cache_bytes(size_t bytes) { m_cache_bytes = bytes; }
+
+  /// Fixes the number of points per tile (0: chosen from the cache size)
+  /** num_points() points per tile executes the statements one by one over all
+   * points, i.e. without fusion. */
+  void set_tile_points(size_t points) { m_tile_points = points; }
+
+  /// Creates an intermediate of the graph; it must be used by reference
+  template <size_t Rank, typename T = double, size_t Size = 3>
+  Intermediate<Rank, T, Size> &intermediate() {
+    auto intermediate =
+        std::make_shared<Intermediate<Rank, T, Size>>(m_intermediates.size());
+    m_intermediates.push_back(intermediate);
+    m_intermediate_bytes.push_back(
+        sizeof(typename Intermediate<Rank, T, Size>::TensorType));
+    m_intermediate_ids[intermediate.get()] = intermediate->id();
+    return *intermediate;
+  }
+
+  /// Appends the statement output[p] = point_expression(p)
+  /** inputs lists the fields and intermediates read by point_expression (see
+   * reads() and reads_neighbours()). */
+  template <size_t Rank, typename T, size_t Size, typename Allocator,
+            typename F>
+  void assign(TensorField<Rank, T, Size, Allocator> &output,
+              std::vector<Access> inputs, F point_expression) {
+    if (output.num_points() != m_num_points) {
+      error(m_statements.size(), "assigns a field of a different size");
+    }
+    m_statements.push_back(
+        {reads(output), std::move(inputs),
+         [&output, point_expression](size_t begin, size_t end) {
+           output.assign(begin, end, point_expression);
+         }});
+  }
+
+  template <size_t Rank, typename T, size_t Size, typename F>
+  void assign(Intermediate<Rank, T, Size> &output, std::vector<Access> inputs,
+              F point_expression) {
+    if (!is_intermediate(reads(output))) {
+      error(m_statements.size(), "assigns an intermediate of another graph");
+    }
+    m_statements.push_back(
+        {reads(output), std::move(inputs),
+         [&output, point_expression](size_t begin, size_t end) {
+           auto *tile = &output[begin];
+           for (size_t point = begin; point < end; ++point) {
+             tile[point - begin] = point_expression(point);
+           }
+         }});
+  }
+
+  /// The stages in which the statements are executed
+  /** A new stage starts before a statement which reads a field assigned in the
+   * current stage at neighbouring points, or which assigns a field read at
+   * neighbouring points in the current stage. Throws std::invalid_argument if
+   * an intermediate is read before it is assigned, at neighbouring points, or
+   * in another stage than the one assigning it. */
+  std::vector<StatementStage> stages() const {
+    std::vector<StatementStage> stages;
+    std::set<const void *> written, read_by_neighbours;
+    // The stage in which each intermediate is assigned
+    std::map<const void *, size_t> intermediate_stage;
+    StatementStage stage = {0, 0, 0, 0};
+    // Bytes per point of every field and intermediate used in the stage
+    std::map<const void *, size_t> used;
+
+    auto close_stage = [&](size_t end) {
+      size_t bytes_per_point = 0;
+      for (const auto &entry : used) {
+        bytes_per_point += entry.second;
+      }
+      stage.end = end;
+      stage.tile_points = tile_points(bytes_per_point);
+      std::vector<size_t> offsets;
+      stage.scratch_bytes = scratch_layout(stage, offsets);
+      stages.push_back(stage);
+      stage = {end, end, 0, 0};
+      written.clear();
+      read_by_neighbours.clear();
+      used.clear();
+    };
+
+    for (size_t s = 0; s < m_statements.size(); ++s) {
+      const Statement &statement = m_statements[s];
+      bool barrier = read_by_neighbours.count(statement.output.target) > 0;
+      for (const Access &input : statement.inputs) {
+        if (is_intermediate(input)) {
+          if (intermediate_stage.count(input.target) == 0) {
+            error(s, "reads an intermediate before it is assigned");
+          }
+          if (input.neighbours) {
+            error(s, "reads an intermediate at neighbouring points");
+          }
+        } else if (input.neighbours && written.count(input.target) > 0) {
+          barrier = true;
+        }
+      }
+      if (barrier) {
+        close_stage(s);
+      }
+      for (const Access &input : statement.inputs) {
+        if (is_intermediate(input) &&
+            intermediate_stage.at(input.target) != stages.size()) {
+          error(s, "reads an intermediate assigned in an earlier stage; "
+                   "assign it to a field instead");
+        }
+        used[input.target] = input.bytes_per_point;
+        if (input.neighbours) {
+          read_by_neighbours.insert(input.target);
+        }
+      }
+      if (is_intermediate(statement.output)) {
+        const auto assigned = intermediate_stage.find(statement.output.target);
+        if (assigned != intermediate_stage.end() &&
+            assigned->second != stages.size()) {
+          error(s, "assigns an intermediate assigned in an earlier stage");
+        }
+        intermediate_stage[statement.output.target] = stages.size();
+      }
+      written.insert(statement.output.target);
+      used[statement.output.target] = statement.output.bytes_per_point;
+    }
+    if (!m_statements.empty()) {
+      close_stage(m_statements.size());
+    }
+    return stages;
+  }
+
+  /// Executes all statements, stage by stage and tile by tile
+  /** By default the tiles are split between threads if there is enough work.
+   */
+  void run(size_t num_threads = 0) const {
+    const std::vector<StatementStage> stages = this->stages();
+    if (num_threads == 0) {
+      num_threads = num_threads_for_work(m_num_points * m_statements.size() *
+                                         16);
+    }
+    for (const StatementStage &stage : stages) {
+      run_stage(stage, num_threads);
+    }
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
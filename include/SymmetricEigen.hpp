@@ -0,0 +1,314 @@
+#ifndef _TENSORALGEBRA_SYMMETRICEIGEN_HPP
+#define _TENSORALGEBRA_SYMMETRICEIGEN_HPP
+
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TensorField.hpp"
+#include "TypeChecks.hpp"
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+// This file defines the eigenvalues and eigenvectors of symmetric 3x3 tensors
+// in closed form, without iteration. The eigenvalues are the roots of the
+// characteristic polynomial in trigonometric form; the eigenvectors follow
+// D. Eberly, "A Robust Eigensolver for 3x3 Symmetric Matrices" (2014): the
+// eigenvector of the most separated eigenvalue is the largest cross product of
+// two rows of A - lambda I, the second one is computed in the plane orthogonal
+// to it, and the third one is their cross product. All case distinctions are
+// written as selections between values which have both been computed, so that
+// the code has no data dependent branches and vectorizes over fields. The
+// selections take a bool, so the component type must be a number (vectorizing
+// over fields is left to the compiler rather than done with SIMD types).
+
+namespace tensoralgebra {
+
+/// Eigenvalues in ascending order and the corresponding (orthonormal)
+/// eigenvectors: vectors[i] belongs to values[i]
+template <typename T> struct Eigensystem {
+  Tensor<1, T, 3> values;
+  Tensor<2, T, 3> vectors;
+};
+
+namespace symmetric_eigen_detail {
+template <typename T> T select(bool condition, const T &a, const T &b) {
+  return condition ? a : b;
+}
+
+template <typename T>
+Tensor<1, T, 3> select(bool condition, const Tensor<1, T, 3> &a,
+                       const Tensor<1, T, 3> &b) {
+  Tensor<1, T, 3> result;
+  for (size_t i = 0; i < 3; ++i) {
+    result[i] = select(condition, a[i], b[i]);
+  }
+  return result;
+}
+
+template <typename T> T larger(const T &a, const T &b) {
+  return select(a < b, b, a);
+}
+
+template <typename T>
+Tensor<1, T, 3> cross(const Tensor<1, T, 3> &u, const Tensor<1, T, 3> &v) {
+  return {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+          u[0] * v[1] - u[1] * v[0]};
+}
+
+template <typename T> T norm2(const Tensor<1, T, 3> &v) {
+  return v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+}
+
+template <typename T>
+Tensor<1, T, 3> times(const Tensor<2, T, 3> &a, const Tensor<1, T, 3> &v) {
+  Tensor<1, T, 3> result;
+  for (size_t i = 0; i < 3; ++i) {
+    result[i] = a[i][0] * v[0] + a[i][1] * v[1] + a[i][2] * v[2];
+  }
+  return result;
+}
+
+template <typename T>
+T dot3(const Tensor<1, T, 3> &u, const Tensor<1, T, 3> &v) {
+  return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+// The eigenvalues of the (scaled) matrix a in ascending order, and whether the
+// largest one is the most separated one
+template <typename T>
+void compute_eigenvalues(const Tensor<2, T, 3> &a, Tensor<1, T, 3> &values,
+                         bool &largest_is_separated, T &p) {
+  using std::acos;
+  using std::cos;
+  using std::sqrt;
+  const T off_diagonal =
+      a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+  const T q = (a[0][0] + a[1][1] + a[2][2]) / T(3);
+  const T b00 = a[0][0] - q;
+  const T b11 = a[1][1] - q;
+  const T b22 = a[2][2] - q;
+  p = sqrt((b00 * b00 + b11 * b11 + b22 * b22 + T(2) * off_diagonal) / T(6));
+  // p == 0 only for multiples of the identity, which are dealt with by the
+  // caller
+  const T safe_p = select(p > T(0), p, T(1));
+  const T c00 = b11 * b22 - a[1][2] * a[1][2];
+  const T c01 = a[0][1] * b22 - a[1][2] * a[0][2];
+  const T c02 = a[0][1] * a[1][2] - b11 * a[0][2];
+  const T det = (b00 * c00 - a[0][1] * c01 + a[0][2] * c02) /
+                (safe_p * safe_p * safe_p);
+  const T half_det = larger(T(-1), select(det / T(2) > T(1), T(1), det / T(2)));
+  const T angle = acos(half_det) / T(3);
+  const T two_pi_over_3 = T(2.09439510239319549230842892218633526);
+  const T beta2 = T(2) * cos(angle);
+  const T beta0 = T(2) * cos(angle + two_pi_over_3);
+  const T beta1 = -(beta0 + beta2);
+  values = {q + p * beta0, q + p * beta1, q + p * beta2};
+  largest_is_separated = (half_det >= T(0));
+}
+
+// Unit eigenvector for a simple eigenvalue: the longest of the cross products
+// of two rows of a - value I. If rounding makes all of them vanish (only for
+// nearly equal eigenvalues, where a - value I is tiny) the x axis is returned.
+template <typename T>
+Tensor<1, T, 3> separated_eigenvector(const Tensor<2, T, 3> &a,
+                                      const T &value) {
+  using std::sqrt;
+  const Tensor<1, T, 3> row0 = {a[0][0] - value, a[0][1], a[0][2]};
+  const Tensor<1, T, 3> row1 = {a[0][1], a[1][1] - value, a[1][2]};
+  const Tensor<1, T, 3> row2 = {a[0][2], a[1][2], a[2][2] - value};
+  const Tensor<1, T, 3> r0xr1 = cross(row0, row1);
+  const Tensor<1, T, 3> r0xr2 = cross(row0, row2);
+  const Tensor<1, T, 3> r1xr2 = cross(row1, row2);
+  const T d0 = norm2(r0xr1);
+  const T d1 = norm2(r0xr2);
+  const T d2 = norm2(r1xr2);
+  const bool use0 = (d0 >= d1 && d0 >= d2);
+  const bool use1 = (!use0 && d1 >= d2);
+  const Tensor<1, T, 3> longest =
+      select(use0, r0xr1, select(use1, r0xr2, r1xr2));
+  const T d = select(use0, d0, select(use1, d1, d2));
+  const bool is_zero = !(d > T(0));
+  const T inverse_length = T(1) / sqrt(select(is_zero, T(1), d));
+  const Tensor<1, T, 3> unit_x = {T(1), T(0), T(0)};
+  Tensor<1, T, 3> result;
+  for (size_t i = 0; i < 3; ++i) {
+    result[i] = longest[i] * inverse_length;
+  }
+  return select(is_zero, unit_x, result);
+}
+
+// Unit eigenvector for value, orthogonal to the unit eigenvector w
+template <typename T>
+Tensor<1, T, 3> orthogonal_eigenvector(const Tensor<2, T, 3> &a,
+                                       const Tensor<1, T, 3> &w,
+                                       const T &value) {
+  using std::abs;
+  using std::sqrt;
+  // Orthonormal basis u, v of the plane orthogonal to w
+  const bool x_larger = abs(w[0]) > abs(w[1]);
+  const T length2 = select(x_larger, w[0] * w[0], w[1] * w[1]) + w[2] * w[2];
+  const T inverse_length = T(1) / sqrt(length2);
+  const Tensor<1, T, 3> u_x = {-w[2] * inverse_length, T(0),
+                               w[0] * inverse_length};
+  const Tensor<1, T, 3> u_y = {T(0), w[2] * inverse_length,
+                               -w[1] * inverse_length};
+  const Tensor<1, T, 3> u = select(x_larger, u_x, u_y);
+  const Tensor<1, T, 3> v = cross(w, u);
+
+  // The 2x2 matrix (a - value I) in this basis
+  const T m00 = dot3(u, times(a, u)) - value;
+  const T m01 = dot3(u, times(a, v));
+  const T m11 = dot3(v, times(a, v)) - value;
+
+  // Null vector (alpha, -beta) of the row with the larger diagonal element
+  const bool use_row0 = abs(m00) >= abs(m11);
+  const T alpha = select(use_row0, m01, m11);
+  const T beta = select(use_row0, m00, m01);
+  const T norm = alpha * alpha + beta * beta;
+  // If the matrix vanishes, the eigenvalue is double and every vector in the
+  // plane is an eigenvector
+  const bool is_zero = !(norm > T(0));
+  const T inverse_norm = T(1) / sqrt(select(is_zero, T(1), norm));
+  const T coefficient_u = select(is_zero, T(1), alpha * inverse_norm);
+  const T coefficient_v = select(is_zero, T(0), -beta * inverse_norm);
+  Tensor<1, T, 3> result;
+  for (size_t i = 0; i < 3; ++i) {
+    result[i] = coefficient_u * u[i] + coefficient_v * v[i];
+  }
+  return result;
+}
+
+// Scales the matrix so that its largest component is one (to avoid overflow
+// and underflow); returns the scale
+template <typename T, typename TExpression>
+T scaled_matrix(const TensorExpression<2, TExpression, 3> &matrix,
+                Tensor<2, T, 3> &scaled) {
+  using std::abs;
+  scaled = matrix;
+  T scale = abs(scaled[0][0]);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = i; j < 3; ++j) {
+      scale = larger(scale, T(abs(scaled[i][j])));
+    }
+  }
+  const T inverse_scale = T(1) / select(scale > T(0), scale, T(1));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      scaled[i][j] *= inverse_scale;
+    }
+  }
+  return scale;
+}
+} // namespace symmetric_eigen_detail
+
+/// Eigenvalues of a symmetric 3x3 tensor in ascending order
+/** Only the upper triangle of the tensor is used. */
+template <typename TExpression>
+auto eigenvalues(const TensorExpression<2, TExpression, 3> &symmetric) {
+  using T = expression_value_t<TExpression>;
+  Tensor<2, T, 3> a;
+  const T scale = symmetric_eigen_detail::scaled_matrix(symmetric, a);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      a[i][j] = a[j][i];
+    }
+  }
+  Tensor<1, T, 3> values;
+  bool largest_is_separated;
+  T p;
+  symmetric_eigen_detail::compute_eigenvalues(a, values, largest_is_separated,
+                                              p);
+  for (size_t i = 0; i < 3; ++i) {
+    values[i] *= scale;
+  }
+  return values;
+}
+
+/// Eigenvalues (ascending) and orthonormal eigenvectors of a symmetric 3x3
+/// tensor
+/** Only the upper triangle of the tensor is used. */
+template <typename TExpression>
+auto eigensystem(const TensorExpression<2, TExpression, 3> &symmetric) {
+  namespace detail = symmetric_eigen_detail;
+  using T = expression_value_t<TExpression>;
+  Tensor<2, T, 3> a;
+  const T scale = detail::scaled_matrix(symmetric, a);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      a[i][j] = a[j][i];
+    }
+  }
+
+  Eigensystem<T> result;
+  bool largest_is_separated;
+  T p;
+  detail::compute_eigenvalues(a, result.values, largest_is_separated, p);
+
+  // The eigenvector of the most separated eigenvalue (the largest or the
+  // smallest one) first, then the middle one
+  const T separated_value = detail::select(
+      largest_is_separated, result.values[2], result.values[0]);
+  const Tensor<1, T, 3> separated =
+      detail::separated_eigenvector(a, separated_value);
+  const Tensor<1, T, 3> middle =
+      detail::orthogonal_eigenvector(a, separated, result.values[1]);
+  // Right-handed in either case
+  const Tensor<1, T, 3> remaining = detail::select(
+      largest_is_separated, detail::cross(middle, separated),
+      detail::cross(separated, middle));
+
+  // Multiples of the identity (to rounding, as the eigenvalues of the scaled
+  // matrix are spread by p): every vector is an eigenvector
+  const bool is_multiple_of_identity =
+      !(p > std::numeric_limits<T>::epsilon());
+  const Tensor<1, T, 3> unit_x = {T(1), T(0), T(0)};
+  const Tensor<1, T, 3> unit_y = {T(0), T(1), T(0)};
+  const Tensor<1, T, 3> unit_z = {T(0), T(0), T(1)};
+  result.vectors[0] = detail::select(
+      is_multiple_of_identity, unit_x,
+      detail::select(largest_is_separated, remaining, separated));
+  result.vectors[1] =
+      detail::select(is_multiple_of_identity, unit_y, middle);
+  result.vectors[2] = detail::select(
+      is_multiple_of_identity, unit_z,
+      detail::select(largest_is_separated, separated, remaining));
+
+  for (size_t i = 0; i < 3; ++i) {
+    result.values[i] *= scale;
+  }
+  return result;
+}
+
+/// Eigenvalues at every point of a field of symmetric tensors
+template <typename T, typename Allocator1, typename Allocator2>
+void eigenvalues(const TensorField<2, T, 3, Allocator1> &symmetric,
+                 TensorField<1, T, 3, Allocator2> &values) {
+  if (values.num_points() != symmetric.num_points()) {
+    throw std::invalid_argument("Fields have different numbers of points.");
+  }
+  for (size_t p = 0; p < symmetric.num_points(); ++p) {
+    values[p] = eigenvalues(symmetric[p]);
+  }
+}
+
+/// Eigenvalues and eigenvectors at every point of a field of symmetric tensors
+template <typename T, typename Allocator1, typename Allocator2,
+          typename Allocator3>
+void eigensystem(const TensorField<2, T, 3, Allocator1> &symmetric,
+                 TensorField<1, T, 3, Allocator2> &values,
+                 TensorField<2, T, 3, Allocator3> &vectors) {
+  if (values.num_points() != symmetric.num_points() ||
+      vectors.num_points() != symmetric.num_points()) {
+    throw std::invalid_argument("Fields have different numbers of points.");
+  }
+  for (size_t p = 0; p < symmetric.num_points(); ++p) {
+    const Eigensystem<T> system = eigensystem(symmetric[p]);
+    values[p] = system.values;
+    vectors[p] = system.vectors;
+  }
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -2,6 +2,7 @@
 #define _TENSORALGEBRA_TENSOR_HPP
 
 #include "ComponentOperations.hpp"
+#include "EvaluationCounter.hpp"
 #include "NestedInitializerList.hpp"
 #include "TensorExpression.hpp"
 #include "TypeChecks.hpp"
@@ -76,6 +77,7 @@ public:
   const_iterator end() const { return data.end(); }
 
   template <typename... Indices> const auto &eval(Indices... is) const {
+    TENSORALGEBRA_COUNT_EVALUATION("Tensor", 0, 0);
     return apply_indices(*this, is...);
   }
 
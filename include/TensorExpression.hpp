@@ -1,6 +1,7 @@
 #ifndef _TENSORALGEBRA_TENSOREXPRESSION_HPP
 #define _TENSORALGEBRA_TENSOREXPRESSION_HPP
 
+#include "EvaluationCounter.hpp"
 #include "IndexUtilities.hpp"
 #include "TypeChecks.hpp"
 #include <cmath>
@@ -0,0 +1,118 @@
+#ifndef _TENSORALGEBRA_TENSORFIELD_HPP
+#define _TENSORALGEBRA_TENSORFIELD_HPP
+
+#include "Tensor.hpp"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tensoralgebra {
+
+/// Number of components of a tensor of rank Rank and size Size, i.e. Size^Rank
+constexpr size_t component_count(size_t rank, size_t size) {
+  size_t components = 1;
+  for (size_t i = 0; i < rank; ++i) {
+    components *= size;
+  }
+  return components;
+}
+
+/// TensorField<Rank, T, Size> stores one Tensor<Rank, T, Size> per point of a
+/// (up to) three dimensional box of grid points
+/** Points are stored contiguously with x running fastest, i.e. the tensor at
+ * (i, j, k) is element (k * ny + j) * nx + i. Each tensor is a contiguous block
+ * of Size^Rank components in row-major order, so the whole field is a single
+ * contiguous array of num_points() * num_components() elements of type T.
+ * The storage is obtained from Allocator (see e.g. ArenaAllocator).
+ */
+template <size_t Rank, typename T = double, size_t Size = 3,
+          typename Allocator = std::allocator<Tensor<Rank, T, Size>>>
+class TensorField {
+public:
+  using TensorType = Tensor<Rank, T, Size>;
+  using ContainedType = std::vector<TensorType, Allocator>;
+  using allocator_type = Allocator;
+  using iterator = typename ContainedType::iterator;
+  using const_iterator = typename ContainedType::const_iterator;
+
+  static_assert(sizeof(TensorType) == component_count(Rank, Size) * sizeof(T),
+                "Tensor components must be stored without padding.");
+
+private:
+  std::array<size_t, 3> m_extent = {{0, 0, 0}};
+  ContainedType m_data;
+
+public:
+  TensorField() = default;
+
+  explicit TensorField(size_t nx, size_t ny = 1, size_t nz = 1,
+                       const Allocator &allocator = Allocator())
+      : m_extent{{nx, ny, nz}}, m_data(nx * ny * nz, allocator) {}
+
+  explicit TensorField(const std::array<size_t, 3> &extent,
+                       const Allocator &allocator = Allocator())
+      : TensorField(extent[0], extent[1], extent[2], allocator) {}
+
+  static constexpr size_t rank() { return Rank; }
+  static constexpr size_t tensor_size() { return Size; }
+  static constexpr size_t num_components() {
+    return component_count(Rank, Size);
+  }
+
+  size_t num_points() const { return m_data.size(); }
+  const std::array<size_t, 3> &extent() const { return m_extent; }
+  size_t extent(size_t dir) const { return m_extent[dir]; }
+  allocator_type get_allocator() const { return m_data.get_allocator(); }
+
+  size_t index(size_t i, size_t j = 0, size_t k = 0) const {
+    return (k * m_extent[1] + j) * m_extent[0] + i;
+  }
+
+  const TensorType &operator[](size_t point) const { return m_data[point]; }
+  TensorType &operator[](size_t point) { return m_data[point]; }
+
+  const TensorType &operator()(size_t i, size_t j = 0, size_t k = 0) const {
+    return m_data[index(i, j, k)];
+  }
+  TensorType &operator()(size_t i, size_t j = 0, size_t k = 0) {
+    return m_data[index(i, j, k)];
+  }
+
+  const TensorType *data() const { return m_data.data(); }
+  TensorType *data() { return m_data.data(); }
+
+  /// The components of all tensors as one flat array
+  const T *components() const {
+    return reinterpret_cast<const T *>(m_data.data());
+  }
+  T *components() { return reinterpret_cast<T *>(m_data.data()); }
+
+  iterator begin() { return m_data.begin(); }
+  iterator end() { return m_data.end(); }
+  const_iterator begin() const { return m_data.begin(); }
+  const_iterator end() const { return m_data.end(); }
+
+  /// Evaluates point_expression(point) for the points in [begin, end) and
+  /// assigns the result to the tensor at that point
+  /** point_expression can return any tensor expression built from the
+   * tensors at the given point, e.g.
+   * field.assign([&](size_t p) { return dot(metric[p], vector[p]); });
+   */
+  template <typename F>
+  void assign(size_t begin, size_t end, F &&point_expression) {
+    for (size_t point = begin; point < end; ++point) {
+      m_data[point] = point_expression(point);
+    }
+  }
+
+  template <typename F> void assign(F &&point_expression) {
+    assign(0, num_points(), std::forward<F>(point_expression));
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _TENSORALGEBRA_TENSOROPERATIONS_HPP
 #define _TENSORALGEBRA_TENSOROPERATIONS_HPP
 
+#include "EvaluationCounter.hpp"
 #include "TensorExpression.hpp"
 
 // Defines the outer product using expression templates
@@ -23,6 +24,7 @@ auto trace(const TensorExpression<2, T, N> &tensor_LL,
 // Always returns an evaluated expression so it is safe to take a const &
 template <class T, size_t N>
 auto trace(const TensorExpression<2, T, N> &matrix) {
+  TENSORALGEBRA_COUNT_EVALUATION("trace", N - 1, 0);
   auto trace = matrix[0][0];
   for (size_t i = 1; i < N; ++i) {
     trace += matrix[i][i];
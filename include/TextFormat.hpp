@@ -0,0 +1,672 @@
+#ifndef _TENSORALGEBRA_TEXTFORMAT_HPP
+#define _TENSORALGEBRA_TEXTFORMAT_HPP
+
+#include "Tensor.hpp"
+#include "TensorExpression.hpp"
+#include "TensorField.hpp"
+#include "TypeChecks.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// This file defines a fast text formatter and parser for tensors and tensor
+// fields. Unlike operator<<, it writes into a caller supplied buffer, uses no
+// iostreams, and by default writes the shortest representation of each
+// component which reads back to exactly the same value.
+
+namespace tensoralgebra {
+
+/// Delimiters and precision used for formatting tensors as text
+/** open/separator/close are used for every dimension of a tensor, field_open/
+ * point_separator/field_close for the list of tensors in a field. When parsing,
+ * whitespace in the input and in the delimiters is ignored. */
+struct TextFormat {
+  const char *open;
+  const char *separator;
+  const char *close;
+  const char *field_open;
+  const char *point_separator;
+  const char *field_close;
+  /// Significant digits of floating point components; 0 means the shortest
+  /// representation which round-trips exactly.
+  int precision;
+
+  /// {{1,2},{3,4}}, as written by operator<<; one tensor per line
+  static TextFormat braces(int precision = 0) {
+    return {"{", ",", "}", "", "\n", "\n", precision};
+  }
+  /// 1,2,3,4; one tensor per line
+  static TextFormat csv(int precision = 0) {
+    return {"", ",", "", "", "\n", "\n", precision};
+  }
+  /// [[1,2],[3,4]]; a field is an array of tensors
+  static TextFormat json(int precision = 0) {
+    return {"[", ",", "]", "[\n", ",\n", "\n]\n", precision};
+  }
+};
+
+namespace text_format {
+inline float string_to(const char *string, char **end, float) {
+  return std::strtof(string, end);
+}
+inline double string_to(const char *string, char **end, double) {
+  return std::strtod(string, end);
+}
+inline long double string_to(const char *string, char **end, long double) {
+  return std::strtold(string, end);
+}
+
+/// Bounds checked output into a caller supplied buffer
+struct Output {
+  char *position;
+  char *end;
+
+  bool put(const char *string) {
+    const size_t length = std::strlen(string);
+    if (static_cast<size_t>(end - position) < length) {
+      return false;
+    }
+    std::memcpy(position, string, length);
+    position += length;
+    return true;
+  }
+};
+
+// Writes the decimal digits of value (if it fits), returns the new end
+inline char *write_integer(char *out, char *end, uint64_t value,
+                           bool negative) {
+  char digits[20];
+  size_t num_digits = 0;
+  do {
+    digits[num_digits++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  if (static_cast<size_t>(end - out) < num_digits + negative) {
+    return nullptr;
+  }
+  if (negative) {
+    *out++ = '-';
+  }
+  while (num_digits > 0) {
+    *out++ = digits[--num_digits];
+  }
+  return out;
+}
+
+template <typename T>
+std::enable_if_t<std::is_integral<T>::value, char *>
+write_number(char *out, char *end, T value, int) {
+  const bool negative = (value < 0);
+  const uint64_t magnitude =
+      negative ? uint64_t(0) - static_cast<uint64_t>(value)
+               : static_cast<uint64_t>(value);
+  return write_integer(out, end, magnitude, negative);
+}
+
+// Shortest round-trip digits using the Grisu2 algorithm (F. Loitsch,
+// "Printing floating-point numbers quickly and accurately with integers",
+// PLDI 2010). The result always reads back to the same value and is the
+// shortest such representation in all but very few cases.
+namespace grisu {
+/// A floating point number f * 2^e with a 64 bit significand
+struct DiyFp {
+  uint64_t f;
+  int e;
+};
+
+inline DiyFp multiply(DiyFp x, DiyFp y) {
+  // Upper 64 bits of the 128 bit product, rounded, from 32 bit halves
+  const uint64_t mask = 0xffffffff;
+  const uint64_t low_low = (x.f & mask) * (y.f & mask);
+  const uint64_t low_high = (x.f & mask) * (y.f >> 32);
+  const uint64_t high_low = (x.f >> 32) * (y.f & mask);
+  const uint64_t high_high = (x.f >> 32) * (y.f >> 32);
+  const uint64_t middle = (low_low >> 32) + (low_high & mask) +
+                          (high_low & mask) + (uint64_t(1) << 31);
+  return {high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32),
+          x.e + y.e + 64};
+}
+
+inline DiyFp normalize(DiyFp x) {
+  if (x.f == 0) { // Has no leading one (zeros are written before Grisu)
+    return x;
+  }
+  const int shift = __builtin_clzll(x.f);
+  return {x.f << shift, x.e - shift};
+}
+
+/// A cached power of ten 10^k = f * 2^e
+struct CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
+
+/// Computes 10^k rounded to a normalised 64 bit significand
+// Uses exact multi-word arithmetic; only called to fill the table below.
+inline CachedPower compute_power_of_ten(int k) {
+  std::vector<uint32_t> limbs; // little endian
+  int exponent = 0;
+  if (k >= 0) {
+    limbs.push_back(1);
+    for (int i = 0; i < k; ++i) {
+      uint64_t carry = 0;
+      for (auto &limb : limbs) {
+        carry += uint64_t(limb) * 10;
+        limb = static_cast<uint32_t>(carry);
+        carry >>= 32;
+      }
+      if (carry) {
+        limbs.push_back(static_cast<uint32_t>(carry));
+      }
+    }
+  } else {
+    // floor(2^shift / 10^-k) keeps at least 128 significant bits
+    const int shift = 128 - 4 * k;
+    limbs.assign(shift / 32 + 1, 0);
+    limbs.back() = uint32_t(1) << (shift % 32);
+    for (int i = 0; i < -k; ++i) {
+      uint64_t remainder = 0;
+      for (size_t j = limbs.size(); j-- > 0;) {
+        const uint64_t current = (remainder << 32) | limbs[j];
+        limbs[j] = static_cast<uint32_t>(current / 10);
+        remainder = current % 10;
+      }
+    }
+    exponent = -shift;
+  }
+  while (limbs.back() == 0) {
+    limbs.pop_back();
+  }
+  auto bit = [&limbs](int i) {
+    return i < 0 ? 0 : (limbs[i / 32] >> (i % 32)) & 1;
+  };
+  const int num_bits = 32 * static_cast<int>(limbs.size()) -
+                       __builtin_clz(limbs.back());
+  uint64_t f = 0;
+  for (int i = num_bits - 1; i >= num_bits - 64; --i) {
+    f = (f << 1) | bit(i);
+  }
+  exponent += num_bits - 64;
+  if (bit(num_bits - 65)) {
+    ++f;
+    if (f == 0) { // Rounding overflowed
+      f = uint64_t(1) << 63;
+      ++exponent;
+    }
+  }
+  return {f, exponent, k};
+}
+
+static constexpr int alpha = -60;
+static constexpr int gamma = -32;
+static constexpr int min_cached_exponent = -300;
+static constexpr int cached_exponent_step = 8;
+static constexpr int num_cached_powers = 79;
+
+/// Returns a power of ten c such that w * c has an exponent in [alpha, gamma]
+/// for any normalised w with exponent e
+inline const CachedPower &cached_power_for_binary_exponent(int e) {
+  static const std::vector<CachedPower> powers = [] {
+    std::vector<CachedPower> table;
+    for (int i = 0; i < num_cached_powers; ++i) {
+      table.push_back(compute_power_of_ten(min_cached_exponent +
+                                           i * cached_exponent_step));
+    }
+    return table;
+  }();
+  // k = ceil((alpha - e - 1) * log10(2))
+  const int f = alpha - e - 1;
+  const int k = (f * 78913) / (1 << 18) + (f > 0);
+  const int index =
+      (-min_cached_exponent + k + (cached_exponent_step - 1)) /
+      cached_exponent_step;
+  return powers[index];
+}
+
+/// Returns the number of decimal digits of n and sets power to 10^(digits-1)
+inline int count_digits(uint32_t n, uint32_t &power) {
+  int digits = 1;
+  power = 1;
+  while (n / power >= 10) {
+    power *= 10;
+    ++digits;
+  }
+  return digits;
+}
+
+inline void round_last_digit(char *digits, int length, uint64_t distance,
+                             uint64_t delta, uint64_t rest, uint64_t ten_k) {
+  while (rest < distance && delta - rest >= ten_k &&
+         (rest + ten_k < distance ||
+          distance - rest > rest + ten_k - distance)) {
+    --digits[length - 1];
+    rest += ten_k;
+  }
+}
+
+/// Generates the digits of a number in [minus, plus], close to w
+inline void generate_digits(char *digits, int &length, int &decimal_exponent,
+                            DiyFp minus, DiyFp w, DiyFp plus) {
+  uint64_t delta = plus.f - minus.f;
+  uint64_t distance = plus.f - w.f;
+  const int shift = -plus.e;
+  const uint64_t one = uint64_t(1) << shift;
+
+  uint32_t integral = static_cast<uint32_t>(plus.f >> shift);
+  uint64_t fractional = plus.f & (one - 1);
+
+  uint32_t power;
+  int n = count_digits(integral, power);
+  while (n > 0) {
+    digits[length++] = static_cast<char>('0' + integral / power);
+    integral %= power;
+    --n;
+    const uint64_t rest = (uint64_t(integral) << shift) + fractional;
+    if (rest <= delta) {
+      decimal_exponent += n;
+      round_last_digit(digits, length, distance, delta, rest,
+                       uint64_t(power) << shift);
+      return;
+    }
+    power /= 10;
+  }
+
+  int m = 0;
+  while (true) {
+    fractional *= 10;
+    digits[length++] = static_cast<char>('0' + (fractional >> shift));
+    fractional &= one - 1;
+    ++m;
+    delta *= 10;
+    distance *= 10;
+    if (fractional <= delta) {
+      break;
+    }
+  }
+  decimal_exponent -= m;
+  round_last_digit(digits, length, distance, delta, fractional, one);
+}
+
+/// Writes the shortest digits of the positive, finite value to digits
+/** The value is digits * 10^decimal_exponent; returns the number of digits. */
+template <typename T>
+int shortest_digits(T value, char *digits, int &decimal_exponent) {
+  static_assert(std::numeric_limits<T>::is_iec559 &&
+                    (sizeof(T) == 4 || sizeof(T) == 8),
+                "Grisu is implemented for IEEE float and double.");
+  using Bits = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+  constexpr int precision = std::numeric_limits<T>::digits; // incl. hidden bit
+  constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + precision - 1;
+  constexpr Bits hidden_bit = Bits(1) << (precision - 1);
+
+  Bits bits;
+  std::memcpy(&bits, &value, sizeof(T));
+  const Bits fraction = bits & (hidden_bit - 1);
+  const int biased_exponent = static_cast<int>(bits >> (precision - 1));
+
+  // The value and the boundaries half way to its neighbours
+  const DiyFp v = (biased_exponent == 0)
+                      ? DiyFp{fraction, 1 - bias}
+                      : DiyFp{fraction + hidden_bit, biased_exponent - bias};
+  const bool lower_boundary_is_closer =
+      (fraction == 0 && biased_exponent > 1);
+  const DiyFp plus = normalize({2 * v.f + 1, v.e - 1});
+  DiyFp minus = lower_boundary_is_closer ? DiyFp{4 * v.f - 1, v.e - 2}
+                                         : DiyFp{2 * v.f - 1, v.e - 1};
+  minus = {minus.f << (minus.e - plus.e), plus.e};
+
+  const CachedPower &cached = cached_power_for_binary_exponent(plus.e);
+  const DiyFp c = {cached.f, cached.e};
+  const DiyFp w = multiply(normalize(v), c);
+  const DiyFp w_minus = multiply(minus, c);
+  const DiyFp w_plus = multiply(plus, c);
+
+  // Shrink the interval by one unit to account for the rounding errors
+  int length = 0;
+  decimal_exponent = -cached.k;
+  generate_digits(digits, length, decimal_exponent, {w_minus.f + 1, w_minus.e},
+                  w, {w_plus.f - 1, w_plus.e});
+  return length;
+}
+} // namespace grisu
+
+/// Writes value = digits * 10^decimal_exponent in %g-like notation
+inline char *write_digits(char *out, char *end, const char *digits,
+                          int length, int decimal_exponent, bool negative) {
+  char buffer[48];
+  char *position = buffer;
+  if (negative) {
+    *position++ = '-';
+  }
+  // Position of the decimal point relative to the first digit
+  const int point = length + decimal_exponent;
+  if (point > 0 && point <= 17) {
+    for (int i = 0; i < point; ++i) {
+      *position++ = (i < length) ? digits[i] : '0';
+    }
+    if (point < length) {
+      *position++ = '.';
+      for (int i = point; i < length; ++i) {
+        *position++ = digits[i];
+      }
+    }
+  } else if (point <= 0 && point > -5) {
+    *position++ = '0';
+    *position++ = '.';
+    for (int i = point; i < 0; ++i) {
+      *position++ = '0';
+    }
+    for (int i = 0; i < length; ++i) {
+      *position++ = digits[i];
+    }
+  } else {
+    *position++ = digits[0];
+    if (length > 1) {
+      *position++ = '.';
+      for (int i = 1; i < length; ++i) {
+        *position++ = digits[i];
+      }
+    }
+    const int exponent = point - 1;
+    *position++ = 'e';
+    *position++ = (exponent < 0) ? '-' : '+';
+    position = write_integer(position, buffer + sizeof(buffer),
+                             exponent < 0 ? -exponent : exponent, false);
+  }
+  const size_t num_chars = position - buffer;
+  if (static_cast<size_t>(end - out) < num_chars) {
+    return nullptr;
+  }
+  std::memcpy(out, buffer, num_chars);
+  return out + num_chars;
+}
+
+template <typename T>
+using has_grisu =
+    std::integral_constant<bool, std::numeric_limits<T>::is_iec559 &&
+                                     (sizeof(T) == 4 || sizeof(T) == 8)>;
+
+template <typename T>
+char *write_shortest(char *out, char *end, T value, std::true_type) {
+  char digits[24];
+  int decimal_exponent;
+  const int length =
+      grisu::shortest_digits(std::abs(value), digits, decimal_exponent);
+  return write_digits(out, end, digits, length, decimal_exponent,
+                      std::signbit(value));
+}
+
+// Fallback for other types: increase the number of digits until the value
+// reads back exactly
+template <typename T>
+char *write_shortest(char *out, char *end, T value, std::false_type) {
+  char buffer[64];
+  int length;
+  for (int digits = std::numeric_limits<T>::digits10;; ++digits) {
+    length = std::snprintf(buffer, sizeof(buffer), "%.*Lg", digits,
+                           static_cast<long double>(value));
+    if (digits >= std::numeric_limits<T>::max_digits10 ||
+        string_to(buffer, nullptr, value) == value) {
+      break;
+    }
+  }
+  if (length < 0 || end - out < length) {
+    return nullptr;
+  }
+  std::memcpy(out, buffer, length);
+  return out + length;
+}
+
+template <typename T>
+std::enable_if_t<std::is_floating_point<T>::value, char *>
+write_number(char *out, char *end, T value, int precision) {
+  // Zeros are written directly, keeping the sign of -0 (which the integer
+  // path would lose and Grisu can't handle)
+  if (value == 0) {
+    const bool negative = std::signbit(value);
+    if (end - out < (negative ? 2 : 1)) {
+      return nullptr;
+    }
+    if (negative) {
+      *out++ = '-';
+    }
+    *out++ = '0';
+    return out;
+  }
+
+  // Fast path for integral values, which are common (e.g. 1)
+  const T max_exact = T(1) / std::numeric_limits<T>::epsilon();
+  if (value < max_exact && value > -max_exact &&
+      value == static_cast<T>(static_cast<int64_t>(value))) {
+    const int64_t integer = static_cast<int64_t>(value);
+    return write_number(out, end, integer, 0);
+  }
+
+  if (precision == 0 && std::isfinite(value)) {
+    return write_shortest(out, end, value, has_grisu<T>());
+  }
+  char buffer[64];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%.*Lg",
+                                   precision > 0 ? precision : 1,
+                                   static_cast<long double>(value));
+  if (length < 0 || end - out < length) {
+    return nullptr;
+  }
+  std::memcpy(out, buffer, length);
+  return out + length;
+}
+
+template <size_t Rank, typename T, size_t Size> struct TensorWriter {
+  static bool write(Output &output, const Tensor<Rank, T, Size> &tensor,
+                    const TextFormat &format) {
+    if (!output.put(format.open)) {
+      return false;
+    }
+    for (size_t i = 0; i < Size; ++i) {
+      if ((i > 0 && !output.put(format.separator)) ||
+          !TensorWriter<Rank - 1, T, Size>::write(output, tensor[i], format)) {
+        return false;
+      }
+    }
+    return output.put(format.close);
+  }
+};
+
+template <typename T, size_t Size> struct TensorWriter<0, T, Size> {
+  static bool write(Output &output, const T &value, const TextFormat &format) {
+    char *position =
+        write_number(output.position, output.end, value, format.precision);
+    if (!position) {
+      return false;
+    }
+    output.position = position;
+    return true;
+  }
+};
+
+/// Bounds checked input from a character range
+struct Input {
+  const char *position;
+  const char *end;
+
+  void skip_whitespace() {
+    while (position != end &&
+           std::isspace(static_cast<unsigned char>(*position))) {
+      ++position;
+    }
+  }
+
+  /// Consumes the delimiter, ignoring whitespace
+  bool match(const char *delimiter) {
+    for (; *delimiter; ++delimiter) {
+      if (std::isspace(static_cast<unsigned char>(*delimiter))) {
+        continue;
+      }
+      skip_whitespace();
+      if (position == end || *position != *delimiter) {
+        return false;
+      }
+      ++position;
+    }
+    return true;
+  }
+
+  template <typename T> bool read_number(T &value) {
+    skip_whitespace();
+    // Copy the token so that the conversion can't read past the end
+    char token[64];
+    size_t length = 0;
+    while (position + length != end && length + 1 < sizeof(token)) {
+      const char c = position[length];
+      if (!std::isalnum(static_cast<unsigned char>(c)) && c != '+' &&
+          c != '-' && c != '.') {
+        break;
+      }
+      token[length++] = c;
+    }
+    token[length] = '\0';
+    using Floating =
+        std::conditional_t<std::is_floating_point<T>::value, T, double>;
+    char *token_end;
+    if (std::is_floating_point<T>::value) {
+      value = static_cast<T>(string_to(token, &token_end, Floating()));
+    } else if (std::is_signed<T>::value) {
+      value = static_cast<T>(std::strtoll(token, &token_end, 10));
+    } else {
+      value = static_cast<T>(std::strtoull(token, &token_end, 10));
+    }
+    if (token_end == token) {
+      return false;
+    }
+    position += token_end - token;
+    return true;
+  }
+};
+
+template <size_t Rank, typename T, size_t Size> struct TensorReader {
+  static bool read(Input &input, Tensor<Rank, T, Size> &tensor,
+                   const TextFormat &format) {
+    if (!input.match(format.open)) {
+      return false;
+    }
+    for (size_t i = 0; i < Size; ++i) {
+      if ((i > 0 && !input.match(format.separator)) ||
+          !TensorReader<Rank - 1, T, Size>::read(input, tensor[i], format)) {
+        return false;
+      }
+    }
+    return input.match(format.close);
+  }
+};
+
+template <typename T, size_t Size> struct TensorReader<0, T, Size> {
+  static bool read(Input &input, T &value, const TextFormat &) {
+    return input.read_number(value);
+  }
+};
+} // namespace text_format
+
+/// Formats a tensor into the buffer [begin, end)
+/** Returns a pointer one past the last character written, or nullptr if the
+ * buffer is too small (in which case its contents are unspecified). No
+ * terminating null character is written. */
+template <size_t Rank, typename T, size_t Size>
+char *format_tensor(char *begin, char *end,
+                    const Tensor<Rank, T, Size> &tensor,
+                    const TextFormat &format = TextFormat::braces()) {
+  static_assert(std::is_arithmetic<T>::value,
+                "Only arithmetic components can be formatted.");
+  text_format::Output output{begin, end};
+  if (!text_format::TensorWriter<Rank, T, Size>::write(output, tensor,
+                                                       format)) {
+    return nullptr;
+  }
+  return output.position;
+}
+
+/// Evaluates the expression and formats the result
+template <size_t Rank, typename T, size_t Size>
+char *format_tensor(char *begin, char *end,
+                    const TensorExpression<Rank, T, Size> &expression,
+                    const TextFormat &format = TextFormat::braces()) {
+  const Tensor<Rank, expression_value_t<T>, Size> tensor = expression;
+  return format_tensor(begin, end, tensor, format);
+}
+
+/// Formats all tensors of a field into the buffer [begin, end)
+/** Return value as for format_tensor. */
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+char *format_field(char *begin, char *end,
+                   const TensorField<Rank, T, Size, Allocator> &field,
+                   const TextFormat &format = TextFormat::braces()) {
+  text_format::Output output{begin, end};
+  if (!output.put(format.field_open)) {
+    return nullptr;
+  }
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    if (p > 0 && !output.put(format.point_separator)) {
+      return nullptr;
+    }
+    output.position = format_tensor(output.position, output.end, field[p],
+                                    format);
+    if (!output.position) {
+      return nullptr;
+    }
+  }
+  if (!output.put(format.field_close)) {
+    return nullptr;
+  }
+  return output.position;
+}
+
+/// Parses a tensor written by format_tensor (or operator<<) from [begin, end)
+/** Returns a pointer one past the last character parsed, or nullptr if the
+ * input is not a tensor in the given format. */
+template <size_t Rank, typename T, size_t Size>
+const char *parse_tensor(const char *begin, const char *end,
+                         Tensor<Rank, T, Size> &tensor,
+                         const TextFormat &format = TextFormat::braces()) {
+  text_format::Input input{begin, end};
+  if (!text_format::TensorReader<Rank, T, Size>::read(input, tensor, format)) {
+    return nullptr;
+  }
+  return input.position;
+}
+
+/// Parses field.num_points() tensors written by format_field
+/** Return value as for parse_tensor; trailing whitespace is consumed. */
+template <size_t Rank, typename T, size_t Size, typename Allocator>
+const char *parse_field(const char *begin, const char *end,
+                        TensorField<Rank, T, Size, Allocator> &field,
+                        const TextFormat &format = TextFormat::braces()) {
+  text_format::Input input{begin, end};
+  if (!input.match(format.field_open)) {
+    return nullptr;
+  }
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    if (p > 0 && !input.match(format.point_separator)) {
+      return nullptr;
+    }
+    input.position = parse_tensor(input.position, input.end, field[p], format);
+    if (!input.position) {
+      return nullptr;
+    }
+  }
+  if (!input.match(format.field_close)) {
+    return nullptr;
+  }
+  input.skip_whitespace();
+  return input.position;
+}
+
+} // namespace tensoralgebra
+
+#endif
@@ -1,10 +1,14 @@
 #ifndef _TENSORALGEBRA_TYPECHECKS_HPP
 #define _TENSORALGEBRA_TYPECHECKS_HPP
 
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
 namespace tensoralgebra {
+/// Size of tensors whose size is only known at runtime (see DynamicTensor)
+constexpr size_t dynamic_size = static_cast<size_t>(-1);
+
 /// make_void is just C++17's std::void - included to be C++14 compatible.
 template <typename...> using make_void = void;
 
@@ -17,6 +21,18 @@ struct is_tensor_expression<
     T, make_void<typename std::decay_t<T>::TensorExpressionType>>
     : public std::true_type {};
 
+/// Check whether a given template argument is a complex tensor expression with
+/// separate real and imaginary parts (see Complex.hpp)
+/** The component wise operations, functions and contractions of such
+ * expressions are defined in Complex.hpp rather than by the generic ones. */
+template <typename T, typename Helper = void>
+struct is_split_complex : public std::false_type {};
+
+template <typename T>
+struct is_split_complex<T,
+                        make_void<typename std::decay_t<T>::SplitComplexType>>
+    : public std::true_type {};
+
 /// Compile time check whether the template parameter has a given size
 /** Member "value" is false if the size doesn't match or the template parameter
  * has no size() function defined. Otherwise it is true. */
@@ -29,6 +45,10 @@ struct has_size<T1, Size, make_void<decltype(std::decay_t<T1>::size())>> {
 };
 // End: compile time check whether the template parameters have the same size
 
+/// Compile time check whether the template parameter is a tensor expression
+/// whose size is only known at runtime
+template <typename T> using is_dynamic_size = has_size<T, dynamic_size>;
+
 /// Compile time check whether the template parameter has a given rank
 /** Member "value" is false if the rank doesn't match or the template parameter
  * has no size() function defined. Otherwise it is true. */
@@ -70,6 +90,22 @@ struct are_same_rank<T1, T2,
       (std::decay_t<T1>::rank() == std::decay_t<T2>::rank());
 };
 // End: compile time check whether the template parameters have the same rank
+
+/// The type of a single component of a tensor expression
+/** I.e. the decayed type returned by eval() given as many indices as the rank
+ * of the expression. */
+template <typename T> struct expression_value {
+  template <size_t... Is>
+  static std::decay_t<decltype(std::declval<const std::decay_t<T> &>().eval(
+      ((void)Is, size_t(0))...))>
+      helper(std::index_sequence<Is...>);
+
+  using type = decltype(
+      helper(std::make_index_sequence<std::decay_t<T>::rank()>()));
+};
+
+template <typename T>
+using expression_value_t = typename expression_value<T>::type;
 } // namespace tensoralgebra
 
 #endif
@@ -0,0 +1,284 @@
+#ifndef _TENSORALGEBRA_WORKSTEALING_HPP
+#define _TENSORALGEBRA_WORKSTEALING_HPP
+
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// This file defines a work stealing scheduler for evaluations over a list of
+// boxes of very different sizes, e.g. the boxes of one level of an adaptive
+// mesh, for which the static split of parallel_for leaves threads idle.
+//
+// Each thread owns a deque of tasks (a range of points of one box). The boxes
+// are dealt to the threads, largest first, to balance the initial load. A
+// thread takes its tasks from the back of its own deque; a task with more than
+// twice the minimum number of points is split in half, and the second half is
+// pushed back for later or for other threads. A thread whose deque is empty
+// steals from the front of another thread's deque, where the largest tasks
+// are. Tasks cover thousands of points, so the deques are simply protected by
+// a mutex each.
+//
+//   tensoralgebra::WorkStealingScheduler scheduler;
+//   scheduler.assign(ricci_boxes, [&](size_t box, size_t p) {
+//     return dot(christoffel_boxes[box][p], ...);
+//   });
+//   std::cout << scheduler.statistics().steals() << " steals\n";
+
+namespace tensoralgebra {
+
+/// What one thread did during a run of a WorkStealingScheduler
+struct WorkerStatistics {
+  size_t tasks = 0;         // ranges of points evaluated
+  size_t points = 0;        // points evaluated
+  size_t splits = 0;        // tasks split in half
+  size_t steals = 0;        // tasks taken from other threads
+  size_t failed_steals = 0; // attempts which found all other deques empty
+  double idle_seconds = 0.; // time spent without work
+  double busy_seconds = 0.; // time spent evaluating tasks
+};
+
+/// The statistics of all threads of the last run
+struct SchedulerStatistics {
+  std::vector<WorkerStatistics> workers;
+
+  size_t tasks() const { return sum(&WorkerStatistics::tasks); }
+  size_t points() const { return sum(&WorkerStatistics::points); }
+  size_t splits() const { return sum(&WorkerStatistics::splits); }
+  size_t steals() const { return sum(&WorkerStatistics::steals); }
+  size_t failed_steals() const { return sum(&WorkerStatistics::failed_steals); }
+  double idle_seconds() const { return sum(&WorkerStatistics::idle_seconds); }
+  double busy_seconds() const { return sum(&WorkerStatistics::busy_seconds); }
+
+  /// Fraction of the threads' time spent idle
+  double idle_fraction() const {
+    const double total = idle_seconds() + busy_seconds();
+    return total > 0. ? idle_seconds() / total : 0.;
+  }
+
+private:
+  template <typename Value>
+  Value sum(Value WorkerStatistics::*member) const {
+    Value total = Value();
+    for (const WorkerStatistics &worker : workers) {
+      total += worker.*member;
+    }
+    return total;
+  }
+};
+
+namespace work_stealing_detail {
+struct Task {
+  size_t box;
+  size_t begin;
+  size_t end;
+};
+
+class TaskDeque {
+  std::mutex m_mutex;
+  std::deque<Task> m_tasks;
+
+public:
+  void push(const Task &task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(task);
+  }
+
+  // The owner takes the most recently pushed (smallest) task
+  bool pop(Task &task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tasks.empty()) {
+      return false;
+    }
+    task = m_tasks.back();
+    m_tasks.pop_back();
+    return true;
+  }
+
+  // Thieves take the oldest (largest) task
+  bool steal(Task &task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tasks.empty()) {
+      return false;
+    }
+    task = m_tasks.front();
+    m_tasks.pop_front();
+    return true;
+  }
+};
+} // namespace work_stealing_detail
+
+/// Evaluates functions over lists of boxes of points with work stealing
+class WorkStealingScheduler {
+  using Task = work_stealing_detail::Task;
+  using TaskDeque = work_stealing_detail::TaskDeque;
+  using Clock = std::chrono::steady_clock;
+
+  size_t m_num_threads;
+  size_t m_min_task_points;
+  SchedulerStatistics m_statistics;
+
+  static double seconds(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+  }
+
+public:
+  /// A scheduler using num_threads threads, which splits tasks down to
+  /// min_task_points points
+  explicit WorkStealingScheduler(size_t num_threads = default_num_threads(),
+                                 size_t min_task_points = 1024)
+      : m_num_threads(std::max<size_t>(1, num_threads)),
+        m_min_task_points(std::max<size_t>(1, min_task_points)) {}
+
+  size_t num_threads() const { return m_num_threads; }
+  size_t min_task_points() const { return m_min_task_points; }
+
+  /// Statistics of the last run
+  const SchedulerStatistics &statistics() const { return m_statistics; }
+
+  /// Calls function(box, begin, end) for disjoint ranges of points covering
+  /// [0, box_points[box]) for every box
+  /** The first exception thrown by function is rethrown once all threads have
+   * stopped; the remaining tasks are skipped. */
+  template <typename Function>
+  void run(const std::vector<size_t> &box_points, Function &&function) {
+    const size_t num_threads = m_num_threads;
+    m_statistics.workers.assign(num_threads, WorkerStatistics());
+    std::vector<TaskDeque> deques(num_threads);
+
+    // Deal the boxes, largest first, to the thread with the least work; the
+    // smallest boxes end up at the back of the deques, where their owners
+    // start
+    std::vector<size_t> order(box_points.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return box_points[a] > box_points[b];
+    });
+    std::vector<size_t> load(num_threads, 0);
+    std::atomic<size_t> remaining_points(0);
+    for (size_t box : order) {
+      if (box_points[box] == 0) {
+        continue;
+      }
+      const size_t thread =
+          std::min_element(load.begin(), load.end()) - load.begin();
+      deques[thread].push({box, 0, box_points[box]});
+      load[thread] += box_points[box];
+      remaining_points += box_points[box];
+    }
+
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&](size_t thread) {
+      WorkerStatistics &statistics = m_statistics.workers[thread];
+      uint32_t random = static_cast<uint32_t>(thread) * 2654435761u + 1;
+      Clock::time_point idle_since = Clock::now();
+      bool idle = false;
+      while (remaining_points.load(std::memory_order_acquire) > 0) {
+        Task task;
+        bool found = deques[thread].pop(task);
+        if (!found && num_threads > 1) {
+          // Try all other threads, starting at a random one
+          random ^= random << 13;
+          random ^= random >> 17;
+          random ^= random << 5;
+          const size_t first = random % (num_threads - 1);
+          for (size_t i = 0; i < num_threads - 1 && !found; ++i) {
+            const size_t victim =
+                (thread + 1 + (first + i) % (num_threads - 1)) % num_threads;
+            found = deques[victim].steal(task);
+          }
+          if (found) {
+            ++statistics.steals;
+          } else {
+            ++statistics.failed_steals;
+          }
+        }
+        if (!found) {
+          if (!idle) {
+            idle = true;
+            idle_since = Clock::now();
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        const Clock::time_point start = Clock::now();
+        if (idle) {
+          statistics.idle_seconds += seconds(idle_since, start);
+          idle = false;
+        }
+
+        // Split off halves for later (or for thieves) while the task is large
+        while (task.end - task.begin >= 2 * m_min_task_points) {
+          const size_t middle = task.begin + (task.end - task.begin) / 2;
+          deques[thread].push({task.box, middle, task.end});
+          task.end = middle;
+          ++statistics.splits;
+        }
+        if (!failed.load(std::memory_order_relaxed)) {
+          try {
+            function(task.box, task.begin, task.end);
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+              error = std::current_exception();
+            }
+            failed = true;
+          }
+        }
+        ++statistics.tasks;
+        statistics.points += task.end - task.begin;
+        remaining_points.fetch_sub(task.end - task.begin,
+                                   std::memory_order_acq_rel);
+        statistics.busy_seconds += seconds(start, Clock::now());
+      }
+      if (idle) {
+        statistics.idle_seconds += seconds(idle_since, Clock::now());
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t thread = 1; thread < num_threads; ++thread) {
+      threads.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  /// Evaluates boxes[box][p] = point_expression(box, p) for all boxes
+  template <size_t Rank, typename T, size_t Size, typename Allocator,
+            typename F>
+  void assign(std::vector<TensorField<Rank, T, Size, Allocator>> &boxes,
+              F &&point_expression) {
+    std::vector<size_t> box_points(boxes.size());
+    for (size_t box = 0; box < boxes.size(); ++box) {
+      box_points[box] = boxes[box].num_points();
+    }
+    run(box_points, [&](size_t box, size_t begin, size_t end) {
+      boxes[box].assign(begin, end, [&](size_t point) {
+        return point_expression(box, point);
+      });
+    });
+  }
+};
+
+} // namespace tensoralgebra
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _TENSORALGEBRA_TESTS_ARENATEST_HPP
+#define _TENSORALGEBRA_TESTS_ARENATEST_HPP
+
+#include "Arena.hpp"
+#include "Tensor.hpp"
+#include "TestingUtilities.hpp"
+#include <cstdint>
+#include <thread>
+
+// This file tests the arena allocator: allocations are aligned, a reset makes
+// the same memory available again without requesting new blocks, and fields
+// using the arena behave like ordinary fields.
+
+bool test_arena() {
+  using Vector = tensoralgebra::Tensor<1, double, 3>;
+  bool failed = false;
+
+  tensoralgebra::Arena arena(1024);
+  void *first = arena.allocate(3, 1);
+  void *aligned = arena.allocate(8, 64);
+  failed |= (reinterpret_cast<uintptr_t>(aligned) % 64 != 0);
+  failed |= (static_cast<char *>(aligned) <= static_cast<char *>(first));
+
+  // Requests larger than a block get a block of their own
+  arena.allocate(4096);
+  failed |= (arena.statistics().num_blocks != 2);
+  failed |= (arena.statistics().high_water_mark != 3 + 8 + 4096);
+
+  // After a reset the same memory is handed out again
+  arena.reset();
+  failed |= (arena.allocate(3, 1) != first);
+  arena.allocate(8, 64);
+  arena.allocate(4096);
+  failed |= (arena.statistics().num_blocks != 2);
+  failed |= (arena.statistics().bytes_in_use != 3 + 8 + 4096);
+  failed |= (arena.statistics().num_resets != 1);
+
+  // Tensors evaluated from expressions
+  Vector vector = {1., 2., 3.};
+  Vector *stored = arena.construct<Vector>(2. * vector);
+  failed |= (reinterpret_cast<uintptr_t>(stored) % alignof(Vector) != 0);
+  failed |= (*stored != vector + vector);
+
+  // Fields drawn from the arena
+  {
+    tensoralgebra::ArenaAllocator<Vector> allocator(arena);
+    tensoralgebra::ArenaTensorField<1, double, 3> field(4, 2, 1, allocator);
+    field.assign([&vector](size_t p) { return 1. * p * vector; });
+    failed |= (field(3, 1, 0) != 7. * vector);
+    failed |= (&field.get_allocator().arena() != &arena);
+  }
+  arena.release();
+  failed |= (arena.statistics().bytes_reserved != 0);
+
+  // Every thread has its own default arena
+  tensoralgebra::Arena *main_arena = &tensoralgebra::thread_arena();
+  tensoralgebra::Arena *other_arena = nullptr;
+  std::thread thread(
+      [&other_arena]() { other_arena = &tensoralgebra::thread_arena(); });
+  thread.join();
+  failed |= (main_arena == other_arena);
+  failed |= (tensoralgebra::ArenaAllocator<double>() !=
+             tensoralgebra::ArenaAllocator<Vector>(*main_arena));
+
+  print_result("Arena test", !failed);
+
+  return failed;
+}
+
+#endif
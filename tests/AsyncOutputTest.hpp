@@ -0,0 +1,81 @@
+#ifndef _TENSORALGEBRA_TESTS_ASYNCOUTPUTTEST_HPP
+#define _TENSORALGEBRA_TESTS_ASYNCOUTPUTTEST_HPP
+
+#include "AsyncOutput.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// This file tests that the asynchronous writer hands every snapshot to the sink
+// exactly as it was at the time of submission, even if the field is modified
+// straight afterwards, and that it applies back-pressure when it runs out of
+// buffers. The sink only returns once the next submission waits for its
+// buffer, so that every submission stalls without relying on timing.
+
+bool test_async_output() {
+  using Field = tensoralgebra::TensorField<1, double, 3>;
+  Field field(100);
+  std::vector<Field> written;
+
+  bool failed = false;
+  {
+    tensoralgebra::AsyncFieldWriter<1, double, 3> *writer_pointer = nullptr;
+    auto sink = [&written, &writer_pointer](const Field::TensorType *tensors,
+                                            size_t num_points, size_t tag) {
+      // A writer which is slower than the evaluation: the buffer of all but
+      // the last snapshot is held until the next submission waits for it
+      const size_t index = written.size();
+      while (index + 1 < 5 && writer_pointer->statistics().stalls <= index) {
+        std::this_thread::yield();
+      }
+      Field snapshot(num_points);
+      std::copy(tensors, tensors + num_points, snapshot.begin());
+      snapshot[0][0] += tag; // Check the tag arrives too
+      written.push_back(snapshot);
+    };
+    tensoralgebra::AsyncFieldWriter<1, double, 3> writer(sink, 100, 1);
+    writer_pointer = &writer;
+    for (size_t step = 0; step < 5; ++step) {
+      field.assign([step](size_t p) {
+        return tensoralgebra::Tensor<1, double, 3>(1. * step * p);
+      });
+      writer.submit(field, 1000 * step);
+    }
+    writer.flush();
+    // With a single buffer and a slow sink, submissions must have waited
+    failed |= (writer.statistics().snapshots != 5);
+    failed |= (writer.statistics().stalls != 4);
+  }
+
+  failed |= (written.size() != 5);
+  for (size_t step = 0; step < written.size(); ++step) {
+    for (size_t p = 0; p < field.num_points(); ++p) {
+      const double expected = 1. * step * p + (p == 0 ? 1000. * step : 0.);
+      failed |= (written[step][p][0] != expected);
+      failed |= (written[step][p][2] != 1. * step * p);
+    }
+  }
+
+  // Errors in the sink are reported on the evaluation thread
+  {
+    auto failing_sink = [](const Field::TensorType *, size_t, size_t) {
+      throw std::runtime_error("Disk full");
+    };
+    tensoralgebra::AsyncFieldWriter<1, double, 3> writer(failing_sink, 100);
+    writer.submit(field);
+    try {
+      writer.flush();
+      failed = true;
+    } catch (const std::runtime_error &) {
+    }
+  }
+
+  print_result("Asynchronous output test", !failed);
+
+  return failed;
+}
+
+#endif
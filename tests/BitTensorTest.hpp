@@ -0,0 +1,106 @@
+#ifndef _TENSORALGEBRA_TESTS_BITTENSORTEST_HPP
+#define _TENSORALGEBRA_TESTS_BITTENSORTEST_HPP
+
+#include "BitTensor.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+
+// This file tests that bit tensors and fields hold the same values as the
+// relational expressions they are packed from, including tensors and fields
+// whose bits straddle words, and masked assignment.
+
+bool test_bit_tensor() {
+  using tensoralgebra::BitField;
+  using tensoralgebra::BitTensor;
+  using tensoralgebra::Tensor;
+  bool failed = false;
+
+  // Packing and the logical operations, for 9 and 81 (two words) components
+  const Tensor<2> a = {{1., -2., 3.}, {0., 5., -6.}, {-7., 8., 0.5}};
+  const BitTensor<2> positive = a > 0.;
+  const BitTensor<2> large = a * a >= 9.;
+  failed |= !(positive == (a > 0.)) || !(large == (a * a >= 9.));
+  failed |= (positive.count() != 5 || large.count() != 5);
+  failed |= ((positive & large).count() != 3 ||
+             (positive | large).count() != 7 ||
+             (positive ^ large).count() != 4);
+  failed |= ((~positive).count() != 4 || !(~positive == (a <= 0.)));
+  failed |= !(positive.eval(2, 2) && !positive.eval(2, 0) &&
+              positive.test(4) && !positive.test(3));
+  failed |= !(BitTensor<2>(true).all() && BitTensor<2>().none() &&
+              positive.any() && !positive.all());
+
+  Tensor<4> b;
+  for (size_t i = 0; i < 81; ++i) {
+    reinterpret_cast<double *>(&b)[i] = (i % 3 == 0 || i > 70 ? 1. : -1.);
+  }
+  const BitTensor<4> packed = b > 0.;
+  failed |= (BitTensor<4>::num_words() != 2 || packed.count() != 27 + 7);
+  failed |= ((~packed).count() != 81 - 34 || !BitTensor<4>(true).all());
+  failed |= !(packed.test(63) && packed.test(80) && !packed.test(64));
+
+  // Masked assignment: the other components are neither changed nor evaluated
+  Tensor<2> result = -1.;
+  tensoralgebra::assign_where(result, positive, sqrt(a));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      failed |= (result[i][j] != (a[i][j] > 0. ? std::sqrt(a[i][j]) : -1.));
+    }
+  }
+
+  // Fields: point masks and masks of rank 2 (9 bits per point, straddling
+  // words), with a number of points which is not a multiple of 64
+  const size_t nx = 7, ny = 5, nz = 3;
+  tensoralgebra::TensorField<2> field(nx, ny, nz);
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    field[p] = (double(p) - 50.) * a;
+  }
+  BitField<0> inner(nx, ny, nz), even(nx, ny, nz);
+  inner.assign([&](size_t p) { return p >= 20 && p < 90; });
+  even.assign([](size_t p) { return p % 2 == 0; });
+  failed |= (inner.count() != 70 || even.count() != 53);
+  failed |= ((inner & even).count() != 35 || (inner | even).count() != 88 ||
+             (~inner).count() != 35 || (inner ^ even).count() != 53);
+  failed |= !(inner.test(20) && !inner.test(19) && even.any() &&
+              (~(inner | ~inner)).none() && (inner | ~inner).all());
+
+  BitField<2> signs(nx, ny, nz);
+  signs.assign([&](size_t p) { return field[p] > 0.; });
+  size_t count = 0;
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    failed |= !(signs[p] == (field[p] > 0.));
+    for (size_t c = 0; c < 9; ++c) {
+      count += signs.test(p, c);
+    }
+  }
+  failed |= (signs.count() != count || signs.words().size() != 15);
+
+  // Masked assignment into fields, evaluating only the masked points
+  tensoralgebra::TensorField<2> copy(nx, ny, nz);
+  size_t evaluations = 0;
+  tensoralgebra::assign_where(copy, inner, [&](size_t p) {
+    ++evaluations;
+    return 2. * field[p];
+  });
+  failed |= (evaluations != 70 || copy[19] != Tensor<2>(0.) ||
+             copy[20] != 2. * field[20]);
+  tensoralgebra::TensorField<2> absolute = field;
+  tensoralgebra::assign_where(absolute, ~signs,
+                              [&](size_t p) { return -1. * field[p]; });
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    failed |= !BitTensor<2>(absolute[p] >= 0.).all();
+  }
+  bool threw = false;
+  try {
+    inner &= BitField<0>(nx, ny);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+
+  print_result("Bit tensor test", !failed);
+  return failed;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _TENSORALGEBRA_TESTS_CHECKPOINTTEST_HPP
+#define _TENSORALGEBRA_TESTS_CHECKPOINTTEST_HPP
+
+#include "Checkpoint.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+// This file tests writing tensor fields to binary checkpoints and reading them
+// back, both by mapping them into memory and by loading them into a field.
+
+std::string temporary_filename() {
+  char name[] = "/tmp/tensoralgebra_testXXXXXX";
+  const int fd = mkstemp(name);
+  close(fd);
+  return name;
+}
+
+bool test_checkpoint() {
+  using Field = tensoralgebra::TensorField<2, double, 3>;
+  Field field(4, 3, 2);
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        field[p][i][j] = 0.1 * p + i - 1. / (j + 1.);
+      }
+    }
+  }
+  const std::string filename = temporary_filename();
+  tensoralgebra::write_checkpoint(filename, field);
+
+  bool failed = false;
+  {
+    // The mapped tensors should be identical to the original ones
+    tensoralgebra::MappedCheckpoint<2, double, 3> checkpoint(filename);
+    failed |= (checkpoint.extent() != field.extent());
+    for (size_t p = 0; p < field.num_points(); ++p) {
+      failed |= (checkpoint[p] != field[p]);
+    }
+    failed |= (checkpoint(3, 2, 1) != field(3, 2, 1));
+
+    // ... and they can be used in expressions without copying them first
+    tensoralgebra::Tensor<2, double, 3> sum = checkpoint[5] + field[5];
+    tensoralgebra::Tensor<2, double, 3> correct_sum = 2. * field[5];
+    failed |= (sum != correct_sum);
+  }
+
+  Field loaded = tensoralgebra::load_checkpoint<2, double, 3>(filename);
+  failed |= (loaded.extent() != field.extent());
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    failed |= (loaded[p] != field[p]);
+  }
+
+  // Reading the checkpoint as the wrong type must fail
+  try {
+    tensoralgebra::MappedCheckpoint<2, float, 3> wrong_type(filename);
+    failed = true;
+  } catch (const std::runtime_error &) {
+  }
+
+  // Corrupting a single byte of the payload must be detected
+  std::FILE *file = std::fopen(filename.c_str(), "r+b");
+  const long offset = sizeof(tensoralgebra::CheckpointHeader) + 17;
+  std::fseek(file, offset, SEEK_SET);
+  const int byte = std::fgetc(file);
+  std::fseek(file, offset, SEEK_SET);
+  std::fputc(byte ^ 0xff, file);
+  std::fclose(file);
+  try {
+    tensoralgebra::MappedCheckpoint<2, double, 3> corrupted(filename);
+    failed = true;
+  } catch (const std::runtime_error &) {
+  }
+  std::remove(filename.c_str());
+
+  print_result("Checkpoint test", !failed);
+
+  return failed;
+}
+
+#endif
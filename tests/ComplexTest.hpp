@@ -0,0 +1,210 @@
+#ifndef _TENSORALGEBRA_TESTS_COMPLEXTEST_HPP
+#define _TENSORALGEBRA_TESTS_COMPLEXTEST_HPP
+
+#include "Complex.hpp"
+#include "Tensor.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+#include <complex>
+
+// This file tests the arithmetic operations, functions and contractions of
+// complex tensors with split real and imaginary parts, with each other, with
+// real tensors and with numbers, against the same computations on tensors of
+// std::complex numbers, as well as assignments (also to an operand) and the
+// components of complex expressions.
+
+namespace complex_test {
+using Complex = std::complex<double>;
+using ComplexTensor2 = tensoralgebra::ComplexTensor<2>;
+using Interleaved2 = tensoralgebra::Tensor<2, Complex>;
+
+Complex value(size_t i, size_t j, double seed) {
+  return Complex(seed + 0.3 * i - 0.7 * j, 1. - seed * j + 0.2 * i * i);
+}
+
+ComplexTensor2 split_tensor(double seed) {
+  ComplexTensor2 tensor;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      tensor.real()[i][j] = value(i, j, seed).real();
+      tensor.imag()[i][j] = value(i, j, seed).imag();
+    }
+  }
+  return tensor;
+}
+
+Interleaved2 interleaved_tensor(double seed) {
+  Interleaved2 tensor;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      tensor[i][j] = value(i, j, seed);
+    }
+  }
+  return tensor;
+}
+
+bool differs(const Complex &value, const Complex &expected) {
+  return std::abs(value - expected) > 1e-12 * (1. + std::abs(expected));
+}
+
+template <typename T1>
+bool differs(const T1 &expression, const Interleaved2 &expected) {
+  const ComplexTensor2 value = expression;
+  bool failed = false;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      failed |= differs(value[i][j], expected[i][j]);
+      failed |= differs(expression[i][j], expected[i][j]);
+    }
+  }
+  return failed;
+}
+} // namespace complex_test
+
+bool test_complex() {
+  using namespace complex_test;
+  using tensoralgebra::Tensor;
+  bool failed = false;
+
+  const ComplexTensor2 a = split_tensor(0.5);
+  const ComplexTensor2 b = split_tensor(2.);
+  const Interleaved2 a_reference = interleaved_tensor(0.5);
+  const Interleaved2 b_reference = interleaved_tensor(2.);
+  Tensor<2> r;
+  Tensor<1> v;
+  for (size_t i = 0; i < 3; ++i) {
+    v[i] = 1.5 - i;
+    for (size_t j = 0; j < 3; ++j) {
+      r[i][j] = 0.25 + i * j;
+    }
+  }
+  const Complex s(0.5, -2.);
+
+  Interleaved2 expected;
+  const auto reference = [&](auto f) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        expected[i][j] =
+            f(a_reference[i][j], b_reference[i][j], Complex(r[i][j]));
+      }
+    }
+    return expected;
+  };
+
+  // Complex with complex
+  failed |= differs(a + b, reference([](Complex x, Complex y, Complex) {
+                      return x + y;
+                    }));
+  failed |= differs(a - b, reference([](Complex x, Complex y, Complex) {
+                      return x - y;
+                    }));
+  failed |= differs(a * b, reference([](Complex x, Complex y, Complex) {
+                      return x * y;
+                    }));
+  failed |= differs(a / b, reference([](Complex x, Complex y, Complex) {
+                      return x / y;
+                    }));
+
+  // Complex with real tensors and real and complex numbers
+  failed |= differs(a + r, reference([](Complex x, Complex, Complex z) {
+                      return x + z;
+                    }));
+  failed |= differs(r - a, reference([](Complex x, Complex, Complex z) {
+                      return z - x;
+                    }));
+  failed |= differs(a * r, reference([](Complex x, Complex, Complex z) {
+                      return x * z;
+                    }));
+  failed |= differs(r / a, reference([](Complex x, Complex, Complex z) {
+                      return z / x;
+                    }));
+  failed |= differs(a / r, reference([](Complex x, Complex, Complex z) {
+                      return x / z;
+                    }));
+  failed |= differs(2. * a - 1., reference([](Complex x, Complex, Complex) {
+                      return 2. * x - 1.;
+                    }));
+  failed |= differs(s * a, reference([&](Complex x, Complex, Complex) {
+                      return s * x;
+                    }));
+  failed |= differs(b / s - s, reference([&](Complex, Complex y, Complex) {
+                      return y / s - s;
+                    }));
+
+  // Functions and nested expressions with temporary operands
+  failed |= differs(conj(a), reference([](Complex x, Complex, Complex) {
+                      return std::conj(x);
+                    }));
+  failed |= differs(conj(a * b) + a * 3., reference([](Complex x, Complex y,
+                                                       Complex) {
+                      return std::conj(x * y) + x * 3.;
+                    }));
+  const Tensor<2> absolute = abs(a - b);
+  const Tensor<2> squared = norm(a);
+  const Tensor<2> real_part = real(a * b);
+  const Tensor<2> imag_part = imag(split_tensor(0.5) * b);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      const Complex x = a_reference[i][j], y = b_reference[i][j];
+      failed |= differs(absolute[i][j], std::abs(x - y));
+      failed |= differs(squared[i][j], std::norm(x));
+      failed |= differs(real_part[i][j], (x * y).real());
+      failed |= differs(imag_part[i][j], (x * y).imag());
+    }
+  }
+
+  // Contractions
+  Interleaved2 product(Complex(0.));
+  tensoralgebra::Tensor<1, Complex> left(Complex(0.)), right(Complex(0.));
+  Complex scalar(0.);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      for (size_t k = 0; k < 3; ++k) {
+        product[i][j] += a_reference[i][k] * b_reference[k][j];
+      }
+      left[i] += a_reference[i][j] * v[j];
+      right[j] += v[i] * a_reference[i][j];
+    }
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    scalar += left[i] * std::conj(right[i]);
+  }
+  failed |= differs(dot(a, b), product);
+  const tensoralgebra::ComplexTensor<1> a_v = dot(a, v);
+  const tensoralgebra::ComplexTensor<1> v_a = dot(v, a);
+  for (size_t i = 0; i < 3; ++i) {
+    failed |= differs(a_v[i], left[i]);
+    failed |= differs(v_a[i], right[i]);
+  }
+  failed |= differs(dot(a_v, conj(v_a)), scalar);
+
+  // Assignments from interleaved and real expressions, to an operand and
+  // compound assignments
+  ComplexTensor2 c = a_reference * b_reference;
+  failed |= differs(c, reference([](Complex x, Complex y, Complex) {
+                      return x * y;
+                    }));
+  c = r;
+  failed |= differs(c, reference([](Complex, Complex, Complex z) {
+                      return z;
+                    }));
+  c = a;
+  c = c * conj(c) + c;
+  failed |= differs(c, reference([](Complex x, Complex, Complex) {
+                      return x * std::conj(x) + x;
+                    }));
+  c = a;
+  c *= b;
+  c -= r;
+  c /= s;
+  failed |= differs(c, reference([&](Complex x, Complex y, Complex z) {
+                      return (x * y - z) / s;
+                    }));
+  c = s;
+  failed |= differs(c[2][1], s);
+
+  print_result("Complex test", !failed);
+  return failed;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _TENSORALGEBRA_TESTS_COMPRESSEDSTREAMTEST_HPP
+#define _TENSORALGEBRA_TESTS_COMPRESSEDSTREAMTEST_HPP
+
+#include "CompressedStream.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+#include <sstream>
+
+// This file tests that tensor fields survive a round trip through the
+// compressed stream format bit for bit, for symmetric and non-symmetric
+// tensors and for chunk sizes which do not divide the number of points.
+
+template <size_t Rank, typename T, size_t Size>
+bool compressed_round_trip_fails(
+    const tensoralgebra::TensorField<Rank, T, Size> &field,
+    size_t chunk_points, size_t *compressed_bytes = nullptr) {
+  std::stringstream stream;
+  {
+    tensoralgebra::CompressedFieldWriter<Rank, T, Size> writer(stream,
+                                                               chunk_points);
+    writer.write(field);
+    writer.finish();
+    if (compressed_bytes) {
+      *compressed_bytes = writer.compressed_bytes();
+    }
+  }
+
+  tensoralgebra::CompressedFieldReader<Rank, T, Size> reader(stream);
+  tensoralgebra::TensorField<Rank, T, Size> read_field(field.extent());
+  bool failed = (reader.read(read_field) != field.num_points());
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    failed |= (read_field[p] != field[p]);
+  }
+  // Nothing should be left in the stream
+  tensoralgebra::Tensor<Rank, T, Size> extra;
+  failed |= (reader.read(&extra, 1) != 0) || !reader.at_end();
+  return failed;
+}
+
+bool test_compressed_stream() {
+  bool failed = false;
+
+  // A smooth, symmetric field; should compress well
+  tensoralgebra::TensorField<2, double, 3> metric(10, 10, 10);
+  for (size_t p = 0; p < metric.num_points(); ++p) {
+    const double x = 0.01 * p;
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = i; j < 3; ++j) {
+        metric[p][i][j] = (i == j) ? 1. + 0.1 * std::sin(x) : 0.;
+        metric[p][j][i] = metric[p][i][j];
+      }
+    }
+  }
+  metric[17][0][0] = -0.;
+  size_t compressed_bytes = 0;
+  failed |= compressed_round_trip_fails(metric, 64, &compressed_bytes);
+  failed |= (compressed_bytes >= metric.num_points() * sizeof(metric[0]) / 2);
+
+  // Not symmetric everywhere, so some chunks must store all components
+  metric[500][0][1] = 3.;
+  failed |= compressed_round_trip_fails(metric, 7);
+
+  // Rank 3, single precision
+  tensoralgebra::TensorField<3, float, 2> field(33);
+  for (size_t p = 0; p < field.num_points(); ++p) {
+    field[p] = {{{1.f * p, 2.f}, {-3.f, 1.f / (p + 1)}},
+                {{5.5f, 0.f}, {1e30f, -1e-30f}}};
+  }
+  failed |= compressed_round_trip_fails(field, 1);
+  failed |= compressed_round_trip_fails(field, 1000);
+
+  print_result("Compressed stream test", !failed);
+
+  return failed;
+}
+
+#endif
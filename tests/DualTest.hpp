@@ -0,0 +1,100 @@
+#ifndef _TENSORALGEBRA_TESTS_DUALTEST_HPP
+#define _TENSORALGEBRA_TESTS_DUALTEST_HPP
+
+#include "Dual.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+
+// This file tests that tensors of dual numbers give the same values as tensors
+// of doubles and the correct derivatives: for each function the derivative is
+// compared to a central finite difference, and for dot, outer and trace to the
+// analytic result.
+
+bool test_dual() {
+  using Dual = tensoralgebra::Dual<double, 2>;
+  using DualMatrix = tensoralgebra::Tensor<2, Dual, 2>;
+  bool failed = false;
+
+  auto derivative_is_close = [](const Dual &dual, double derivative) {
+    return std::abs(dual.derivative(0) - derivative) <
+           1e-6 * (1. + std::abs(derivative));
+  };
+
+  // All functions of ComponentOperations.hpp, applied to x = 0.3 + t
+  const double x = 0.3;
+  const Dual dual_x = Dual::variable(x, 0);
+  tensoralgebra::Tensor<1, Dual, 2> vector = {dual_x, Dual(x)};
+  const double h = 1e-6;
+#define check_function(function)                                               \
+  {                                                                            \
+    tensoralgebra::Tensor<1, Dual, 2> result = function(vector);               \
+    const double finite_difference =                                           \
+        (std::function(x + h) - std::function(x - h)) / (2. * h);              \
+    failed |= (result[0].value() != std::function(x));                         \
+    failed |= !derivative_is_close(result[0], finite_difference);              \
+    failed |= (result[1].derivative(0) != 0.);                                 \
+  }
+  check_function(exp);
+  check_function(log);
+  check_function(log10);
+  check_function(sqrt);
+  check_function(sin);
+  check_function(cos);
+  check_function(tan);
+  check_function(asin);
+  check_function(acos);
+  check_function(atan);
+  check_function(sinh);
+  check_function(cosh);
+  check_function(tanh);
+  check_function(abs);
+#undef check_function
+
+  // Arithmetic with plain numbers and quotient rule
+  Dual y = Dual::variable(2., 1);
+  Dual quotient = (3 * dual_x + 1.) / (y * y);
+  failed |= !derivative_is_close(quotient, 3. / 4.);
+  failed |= (std::abs(quotient.derivative(1) - (-2. * 1.9 / 8.)) > 1e-15);
+  failed |= !(dual_x < y && y >= 2. && 1 < y);
+
+  // Matrices depending on t (lane 0) and s (lane 1):
+  // A = {{t, 1}, {2, s}}, B = {{1, t}, {s, 3}}
+  const double t = 0.5, s = -1.5;
+  const Dual dual_t = Dual::variable(t, 0);
+  const Dual dual_s = Dual::variable(s, 1);
+  DualMatrix matrix_a = {{dual_t, Dual(1.)}, {Dual(2.), dual_s}};
+  DualMatrix matrix_b = {{Dual(1.), dual_t}, {dual_s, Dual(3.)}};
+
+  // trace(A.B) = t + s + 2t + 3s, so d/dt = 3 and d/ds = 4
+  Dual trace_ab = trace(tensoralgebra::dot(matrix_a, matrix_b));
+  failed |= (trace_ab.value() != 3. * t + 4. * s);
+  failed |= (trace_ab.derivative(0) != 3. || trace_ab.derivative(1) != 4.);
+
+  // (A.B)[0][1] = t^2 + 3, (A.B)[1][0] = 2 + s^2
+  DualMatrix product = tensoralgebra::dot(matrix_a, matrix_b);
+  failed |= (product[0][1].derivative(0) != 2. * t);
+  failed |= (product[1][0].derivative(1) != 2. * s);
+
+  // outer(v, v)[0][0] = t^2 for v = {t, s}; the same values as for doubles
+  tensoralgebra::Tensor<1, Dual, 2> v = {dual_t, dual_s};
+  tensoralgebra::Tensor<1, double, 2> v_double = {t, s};
+  DualMatrix outer_product = 2. * tensoralgebra::outer(v, v);
+  tensoralgebra::Tensor<2, double, 2> outer_double =
+      2. * tensoralgebra::outer(v_double, v_double);
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 2; ++j) {
+      failed |= (outer_product[i][j].value() != outer_double[i][j]);
+    }
+  }
+  failed |= (outer_product[0][1].derivative(0) != 2. * s);
+  failed |= (outer_product[0][1].derivative(1) != 2. * t);
+  failed |= (tensoralgebra::dot(v, v).derivative(1) != 2. * s);
+
+  print_result("Dual number test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef _TENSORALGEBRA_TESTS_DYNAMICTENSORTEST_HPP
+#define _TENSORALGEBRA_TESTS_DYNAMICTENSORTEST_HPP
+
+#include "DynamicTensor.hpp"
+#include "Parallel.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <sstream>
+#include <stdexcept>
+
+// This file tests DynamicTensor against Tensor for small sizes and the blocked,
+// multithreaded kernels against plain loops for sizes which are not multiples
+// of the block sizes. All values are small integers so that the results are
+// exact irrespective of the order of summation. Expressions mixing dimensions
+// must be rejected.
+
+namespace dynamic_tensor_test {
+template <typename F> bool throws_invalid_argument(F &&f) {
+  try {
+    f();
+  } catch (const std::invalid_argument &) {
+    return true;
+  }
+  return false;
+}
+} // namespace dynamic_tensor_test
+
+bool test_dynamic_tensor() {
+  bool failed = false;
+
+  // Same results as Tensor
+  tensoralgebra::Tensor<2, double, 3> matrix = {
+      {1., 2., 3.}, {4., 5., 6.}, {7., 8., 10.}};
+  tensoralgebra::Tensor<1, double, 3> vector = {1., -2., 3.};
+  tensoralgebra::DynamicTensor<2> dynamic_matrix(3);
+  tensoralgebra::DynamicTensor<1> dynamic_vector(3);
+  for (size_t i = 0; i < 3; ++i) {
+    dynamic_vector(i) = vector[i];
+    for (size_t j = 0; j < 3; ++j) {
+      dynamic_matrix(i, j) = matrix[i][j];
+    }
+  }
+
+  tensoralgebra::Tensor<2, double, 3> expected_matrix =
+      3. * matrix + exp(matrix) - tensoralgebra::outer(vector, vector);
+  tensoralgebra::DynamicTensor<2> result_matrix(
+      3, 3. * dynamic_matrix + exp(dynamic_matrix) -
+             tensoralgebra::outer(dynamic_vector, dynamic_vector));
+  tensoralgebra::Tensor<2, double, 3> product = dot(matrix, matrix);
+  auto dynamic_product = dot(dynamic_matrix, dynamic_matrix);
+  tensoralgebra::Tensor<1, double, 3> matrix_vector = dot(matrix, vector);
+  auto dynamic_matrix_vector = dot(dynamic_matrix, dynamic_vector);
+  for (size_t i = 0; i < 3; ++i) {
+    failed |= (dynamic_matrix_vector[i] != matrix_vector[i]);
+    for (size_t j = 0; j < 3; ++j) {
+      failed |= (result_matrix(i, j) != expected_matrix[i][j]);
+      failed |= (dynamic_product[i][j] != product[i][j]);
+    }
+  }
+  failed |= (dot(dynamic_vector, dynamic_vector) != dot(vector, vector));
+  failed |= (trace(dynamic_matrix) != trace(matrix));
+  failed |= (trace(dynamic_matrix, dynamic_product) !=
+             trace(matrix, tensoralgebra::Tensor<2, double, 3>(product)));
+
+  // Output in the same format as for Tensor
+  std::ostringstream stream, dynamic_stream;
+  stream << matrix;
+  dynamic_stream << dynamic_matrix;
+  failed |= (stream.str() != dynamic_stream.str());
+
+  // Larger sizes, split over several threads and several blocks
+  const size_t saved_num_threads = tensoralgebra::default_num_threads();
+  tensoralgebra::set_default_num_threads(3);
+  const size_t n = 301;
+  tensoralgebra::DynamicTensor<2, double> a(n), b(n);
+  tensoralgebra::DynamicTensor<1, double> v(n);
+  for (size_t i = 0; i < n; ++i) {
+    v(i) = double(i % 7) - 3.;
+    for (size_t j = 0; j < n; ++j) {
+      a(i, j) = double((i + 2 * j) % 5) - 2.;
+      b(i, j) = double((3 * i + j) % 4) - 1.;
+    }
+  }
+  auto c = dot(a, b);
+  auto av = dot(a, v);
+  auto va = dot(v, a);
+  double expected_trace = 0.;
+  for (size_t i = 0; i < n; i += 17) {
+    for (size_t j = 0; j < n; ++j) {
+      double c_ij = 0., av_i = 0., va_j = 0.;
+      for (size_t k = 0; k < n; ++k) {
+        c_ij += a(i, k) * b(k, j);
+        av_i += a(i, k) * v(k);
+        va_j += v(k) * a(k, j);
+      }
+      failed |= (c(i, j) != c_ij || av(i) != av_i || va(j) != va_j);
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      expected_trace += b(i, j) * a(j, i);
+    }
+  }
+  failed |= (trace(a, b) != expected_trace);
+
+  tensoralgebra::DynamicTensor<3, double> outer_product(
+      n, tensoralgebra::outer(a, v));
+  outer_product -= tensoralgebra::outer(a, v);
+  for (auto component : outer_product) {
+    failed |= (component != 0.);
+  }
+  tensoralgebra::set_default_num_threads(saved_num_threads);
+
+  // Expressions of tensors of different dimensions
+  using dynamic_tensor_test::throws_invalid_argument;
+  failed |= !throws_invalid_argument([&] {
+    tensoralgebra::DynamicTensor<2> sum(3, dynamic_matrix + a);
+  });
+  failed |= !throws_invalid_argument(
+      [&] { result_matrix = tensoralgebra::outer(v, dynamic_vector); });
+  failed |= !throws_invalid_argument([&] { result_matrix += 2. * a; });
+  failed |= !throws_invalid_argument(
+      [&] { tensoralgebra::DynamicTensor<2>() = exp(dynamic_matrix); });
+  tensoralgebra::DynamicTensor<1, int> integers(4, 6), zeros(4, 0);
+  failed |= !throws_invalid_argument(
+      [&] { zeros = integers / tensoralgebra::DynamicTensor<1, int>(5, 2); });
+  zeros = integers / tensoralgebra::DynamicTensor<1, int>(4, 2);
+  failed |= (zeros != tensoralgebra::DynamicTensor<1, int>(4, 3));
+
+  // Rows of dynamic tensors, in expressions with the right and a wrong
+  // dimension
+  tensoralgebra::DynamicTensor<1> row(3);
+  row = dynamic_matrix[1] + dynamic_vector;
+  for (size_t i = 0; i < 3; ++i) {
+    failed |= (row(i) != matrix[1][i] + vector[i]);
+  }
+  failed |= !throws_invalid_argument([&] { row = a[1] + dynamic_vector; });
+  failed |= !throws_invalid_argument([&] { row = dynamic_matrix[1] + v; });
+
+  print_result("Dynamic tensor test", !failed);
+
+  return failed;
+}
+
+#endif
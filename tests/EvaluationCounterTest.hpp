@@ -0,0 +1,95 @@
+#ifndef _TENSORALGEBRA_TESTS_EVALUATIONCOUNTERTEST_HPP
+#define _TENSORALGEBRA_TESTS_EVALUATIONCOUNTERTEST_HPP
+
+#include "DynamicTensor.hpp"
+#include "EvaluationCounter.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+// This file tests the evaluation counters. Without
+// TENSORALGEBRA_COUNT_EVALUATIONS nothing may be counted; with it (compile the
+// tests with -DTENSORALGEBRA_COUNT_EVALUATIONS) the counts must match the
+// number of evaluations and operations of simple expressions, including the
+// recomputation of an inner Dot for every component of an outer one, abs as
+// an arithmetic operation, and no evaluations for the dimension check of
+// dynamic tensors.
+
+// The counts for node in report, zero if the node isn't in the report
+tensoralgebra::EvaluationCount
+find_count(const std::vector<tensoralgebra::EvaluationCount> &report,
+           const std::string &node) {
+  for (const auto &count : report) {
+    if (count.node == node) {
+      return count;
+    }
+  }
+  tensoralgebra::EvaluationCount count;
+  count.node = node;
+  return count;
+}
+
+bool test_evaluation_counter() {
+  bool failed = false;
+
+  tensoralgebra::Tensor<1, double, 3> a = {1., 2., 3.};
+  tensoralgebra::Tensor<1, double, 3> b = {4., 5., 6.};
+  tensoralgebra::Tensor<2, double, 3> m = {
+      {1., 0., 2.}, {0., 1., 0.}, {3., 0., 1.}};
+  tensoralgebra::Tensor<1, double, 3> result;
+
+  const auto sum_report =
+      tensoralgebra::count_evaluations([&] { result = a + 2. * exp(b); });
+  const auto nested_report = tensoralgebra::count_evaluations(
+      [&] { result = tensoralgebra::dot(m, tensoralgebra::dot(m, a)); });
+  tensoralgebra::DynamicTensor<1> dynamic(3, -2.), dynamic_result(3);
+  const auto dynamic_report = tensoralgebra::count_evaluations(
+      [&] { dynamic_result = abs(dynamic) + dynamic; });
+
+  if (!tensoralgebra::counts_evaluations()) {
+    failed |= !sum_report.empty() || !nested_report.empty() ||
+              !dynamic_report.empty();
+  } else {
+    // a + 2 * exp(b): every node is evaluated once per component
+    const auto sum = find_count(sum_report, "SumTensor");
+    const auto product = find_count(sum_report, "ProductScalarLeft");
+    const auto exponential = find_count(sum_report, "Exp");
+    failed |= (sum.evaluations != 3 || sum.arithmetic != 3);
+    failed |= (product.evaluations != 3 || product.arithmetic != 3);
+    failed |= (exponential.evaluations != 3 ||
+               exponential.transcendental != 3 || exponential.arithmetic != 0);
+    failed |= (find_count(sum_report, "Tensor").evaluations != 6);
+
+    // The inner Dot is evaluated for every term of every component of the
+    // outer one: 3 * 3 times instead of 3 times
+    const auto dot = find_count(nested_report, "Dot");
+    const auto outer = find_count(nested_report, "Outer");
+    failed |= (dot.evaluations != 3 + 9 || dot.arithmetic != 2 * (3 + 9));
+    failed |= (outer.evaluations != 9 + 27 || outer.arithmetic != 9 + 27);
+    failed |= (find_count(nested_report, "Tensor").evaluations != 9 + 2 * 27);
+
+    // Three components, the dimension check not counted
+    const auto absolute = find_count(dynamic_report, "Abs");
+    failed |= (find_count(dynamic_report, "SumTensor").evaluations != 3);
+    failed |= (absolute.evaluations != 3 || absolute.arithmetic != 3 ||
+               absolute.transcendental != 0);
+
+    std::ostringstream table;
+    tensoralgebra::write_evaluation_report(table, nested_report);
+    failed |= (table.str().find("total") == std::string::npos);
+
+    tensoralgebra::reset_evaluation_counts();
+    failed |= !tensoralgebra::evaluation_report().empty();
+  }
+  failed |= (result[0] != 19. || result[1] != 2. || result[2] != 27.);
+  failed |= (dynamic_result != tensoralgebra::DynamicTensor<1>(3, 0.));
+
+  print_result("Evaluation counter test", !failed);
+
+  return failed;
+}
+
+#endif
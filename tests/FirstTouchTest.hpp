@@ -0,0 +1,74 @@
+#ifndef _TENSORALGEBRA_TESTS_FIRSTTOUCHTEST_HPP
+#define _TENSORALGEBRA_TESTS_FIRSTTOUCHTEST_HPP
+
+#include "FirstTouch.hpp"
+#include "Parallel.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <cstdint>
+#include <vector>
+
+// This file tests the first touch allocator and the binding of the threads of
+// parallel_for to CPUs (as far as possible on a machine with a single memory
+// node): fields allocated with it behave like other fields, and each chunk runs
+// on its CPU while the calling thread gets its CPUs back afterwards.
+
+bool test_first_touch() {
+  bool failed = false;
+
+  using tensoralgebra::first_touch_detail::parse_cpu_list;
+  failed |= (parse_cpu_list("0-3,8,10-11\n") !=
+             std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  const std::vector<std::vector<int>> nodes = tensoralgebra::numa_node_cpus();
+  failed |= (nodes.empty() || nodes[0].empty() ||
+             tensoralgebra::cpus_by_numa_node().size() < nodes[0].size());
+
+  // Fields with first touched pages, touched by several threads
+  tensoralgebra::FirstTouchAllocator<tensoralgebra::Tensor<2>> allocator(3);
+  tensoralgebra::FirstTouchTensorField<2> a(50, 40, 30, allocator);
+  tensoralgebra::FirstTouchTensorField<2> b(a.extent(), allocator);
+  failed |= (reinterpret_cast<uintptr_t>(a.data()) % 4096 != 0 ||
+             a.get_allocator().num_threads() != 3);
+  for (size_t p = 0; p < a.num_points(); ++p) {
+    failed |= (a[p] != tensoralgebra::Tensor<2>(0.));
+    a[p] = double(p);
+  }
+  tensoralgebra::parallel_for(
+      0, b.num_points(),
+      [&](size_t begin, size_t end) {
+        b.assign(begin, end, [&](size_t p) { return 2. * a[p] + 1.; });
+      },
+      3);
+  for (size_t p = 0; p < b.num_points(); ++p) {
+    failed |= (b[p] != tensoralgebra::Tensor<2>(2. * p + 1.));
+  }
+  tensoralgebra::FirstTouchTensorField<2> copy = b;
+  failed |= (copy[123] != b[123]);
+
+#ifdef __linux__
+  // Bind all chunks to the first CPU this thread may run on
+  cpu_set_t before;
+  sched_getaffinity(0, sizeof(before), &before);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &before)) {
+    ++cpu;
+  }
+  tensoralgebra::set_thread_cpus({cpu});
+  std::vector<int> chunk_cpus(4, -1);
+  tensoralgebra::parallel_for(
+      0, 4, [&](size_t begin, size_t) { chunk_cpus[begin] = sched_getcpu(); },
+      4);
+  tensoralgebra::set_thread_cpus({});
+  for (int chunk_cpu : chunk_cpus) {
+    failed |= (chunk_cpu != cpu);
+  }
+  cpu_set_t after;
+  sched_getaffinity(0, sizeof(after), &after);
+  failed |= !CPU_EQUAL(&before, &after);
+#endif
+
+  print_result("First touch test", !failed);
+  return failed;
+}
+
+#endif
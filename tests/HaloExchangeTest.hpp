@@ -0,0 +1,247 @@
+#ifndef _TENSORALGEBRA_TESTS_HALOEXCHANGETEST_HPP
+#define _TENSORALGEBRA_TESTS_HALOEXCHANGETEST_HPP
+
+#include "HaloExchange.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// This file tests the halo exchange between slabs, with one forked process per
+// rank: that after every one of several exchanges the ghost planes of two
+// fields of different types hold the planes of the neighbours (across the
+// ends of periodic boxes, in place of unfilled ghost planes otherwise), that a
+// stencil evaluated on the interior points between packing and unpacking and
+// on the boundary points after the exchange is correct, that the bytes sent
+// are those packed, and that invalid decompositions, fields and names as well
+// as missing neighbours are reported.
+
+namespace halo_exchange_test {
+using Metric = tensoralgebra::TensorField<2>;
+using Shift = tensoralgebra::TensorField<1, float>;
+
+// A value which is not written by the exchange
+const double unfilled = -1e30;
+
+double value(size_t i, size_t j, size_t z, size_t c, size_t step) {
+  return std::sin(0.1 * i + 0.2 * j) + z * z + 10. * c + 100. * step;
+}
+
+// The global plane stored in local plane k of rank, wrapped if periodic
+size_t global_plane(const tensoralgebra::SlabDecomposition &slabs, size_t rank,
+                    size_t k) {
+  const size_t nz = slabs.global_extent()[2];
+  return (slabs.z_begin(rank) + nz + k - slabs.ghosts()) % nz;
+}
+
+bool is_filled(const tensoralgebra::SlabDecomposition &slabs, size_t rank,
+               size_t k) {
+  const size_t g = slabs.ghosts(), last = slabs.num_planes(rank) + g;
+  if (k < g) {
+    return slabs.lower_neighbour(rank) !=
+           tensoralgebra::SlabDecomposition::no_neighbour;
+  }
+  if (k >= last) {
+    return slabs.upper_neighbour(rank) !=
+           tensoralgebra::SlabDecomposition::no_neighbour;
+  }
+  return true;
+}
+
+// Runs several exchanges as rank and checks the fields after each
+bool run_rank(const std::string &name,
+              const tensoralgebra::SlabDecomposition &slabs, size_t rank) {
+  bool failed = false;
+  const auto extent = slabs.local_extent(rank);
+  const size_t g = slabs.ghosts(), last = slabs.num_planes(rank) + g;
+  Metric metric(extent), second_difference(extent);
+  Shift shift(extent);
+  tensoralgebra::HaloExchange halo(name, slabs, rank, metric, shift);
+
+  for (size_t step = 0; step < 3; ++step) {
+    for (size_t k = 0; k < extent[2]; ++k) {
+      for (size_t j = 0; j < extent[1]; ++j) {
+        for (size_t i = 0; i < extent[0]; ++i) {
+          const bool owned = (k >= g && k < last);
+          const size_t z = global_plane(slabs, rank, k);
+          for (size_t c = 0; c < 9; ++c) {
+            metric(i, j, k)[c / 3][c % 3] =
+                owned ? value(i, j, z, c, step) : unfilled;
+          }
+          for (size_t c = 0; c < 3; ++c) {
+            shift(i, j, k)[c] = owned ? float(value(i, j, z, c, step)) : 0.f;
+          }
+        }
+      }
+    }
+
+    // The second difference along z (which reads one plane either way)
+    const size_t plane = extent[0] * extent[1];
+    const auto stencil = [&](size_t begin, size_t end) {
+      second_difference.assign(begin, end, [&](size_t p) {
+        return metric[p + plane] + metric[p - plane] - 2. * metric[p];
+      });
+    };
+    halo.exchange(stencil);
+    for (const auto &range : halo.boundary_points()) {
+      stencil(range.begin, range.end);
+    }
+
+    for (size_t k = 0; k < extent[2]; ++k) {
+      const size_t z = global_plane(slabs, rank, k);
+      const bool filled = is_filled(slabs, rank, k);
+      for (size_t j = 0; j < extent[1]; ++j) {
+        for (size_t i = 0; i < extent[0]; ++i) {
+          for (size_t c = 0; c < 9; ++c) {
+            failed |= (metric(i, j, k)[c / 3][c % 3] !=
+                       (filled ? value(i, j, z, c, step) : unfilled));
+          }
+          for (size_t c = 0; c < 3; ++c) {
+            failed |= (shift(i, j, k)[c] !=
+                       (filled ? float(value(i, j, z, c, step)) : 0.f));
+          }
+          // Second differences of z^2 are 2, except across periodic ends
+          const bool interior_z = (z > 0 && z + 1 < slabs.global_extent()[2]);
+          if (k >= g && k < last && interior_z &&
+              is_filled(slabs, rank, k - 1) && is_filled(slabs, rank, k + 1)) {
+            for (size_t c = 0; c < 9; ++c) {
+              failed |= std::abs(second_difference(i, j, k)[c / 3][c % 3] -
+                                 2.) > 1e-9 * (1. + z * z);
+            }
+          }
+        }
+      }
+    }
+  }
+  failed |= (halo.statistics().exchanges != 3);
+  // The planes of both fields for each neighbour, without the padding of the
+  // buffers to whole cache lines (which the 5x4 and 3x6 planes need)
+  const size_t neighbours =
+      (slabs.lower_neighbour(rank) !=
+       tensoralgebra::SlabDecomposition::no_neighbour) +
+      (slabs.upper_neighbour(rank) !=
+       tensoralgebra::SlabDecomposition::no_neighbour);
+  const size_t point_bytes =
+      sizeof(Metric::TensorType) + sizeof(Shift::TensorType);
+  const size_t packed = g * extent[0] * extent[1] * point_bytes;
+  failed |= (halo.statistics().bytes_sent != 3 * neighbours * packed);
+  return failed;
+}
+
+// Runs all ranks of slabs, each in its own process
+bool run_ranks(const std::string &name,
+               const tensoralgebra::SlabDecomposition &slabs) {
+  std::vector<pid_t> children;
+  for (size_t rank = 1; rank < slabs.num_ranks(); ++rank) {
+    const pid_t child = fork();
+    if (child == 0) {
+      int status = 2;
+      try {
+        status = run_rank(name, slabs, rank) ? 1 : 0;
+      } catch (...) {
+      }
+      _exit(status);
+    }
+    children.push_back(child);
+  }
+  bool failed = true;
+  try {
+    failed = run_rank(name, slabs, 0);
+  } catch (...) {
+  }
+  for (const pid_t child : children) {
+    int status = 0;
+    failed |= (child < 0 || waitpid(child, &status, 0) != child ||
+               !WIFEXITED(status) || WEXITSTATUS(status) != 0);
+  }
+  return failed;
+}
+
+template <typename Exception, typename F> bool throws(F &&f) {
+  try {
+    f();
+  } catch (const Exception &) {
+    return true;
+  }
+  return false;
+}
+
+std::string unique_name(const std::string &test) {
+  return "/tensoralgebra_halo_" + std::to_string(getpid()) + "_" + test;
+}
+} // namespace halo_exchange_test
+
+bool test_halo_exchange() {
+  using namespace halo_exchange_test;
+  using tensoralgebra::SlabDecomposition;
+  bool failed = false;
+
+  // Uneven slabs (4, 3 and 3 planes) with two ghost planes; the interior of
+  // the thinner slabs is empty
+  failed |= run_ranks(unique_name("open"),
+                      SlabDecomposition({{5, 4, 10}}, 3, 2));
+  failed |= run_ranks(unique_name("periodic"),
+                      SlabDecomposition({{3, 6, 8}}, 2, 1, true));
+  // A single periodic rank exchanges with itself
+  failed |= run_rank(unique_name("single"),
+                     SlabDecomposition({{4, 4, 6}}, 1, 3, true), 0);
+
+  const SlabDecomposition slabs({{4, 4, 8}}, 2, 2, true);
+  failed |= (slabs.z_begin(1) != 4 || slabs.local_extent(1)[2] != 8);
+  failed |= (slabs.lower_neighbour(0) != 1 || slabs.upper_neighbour(1) != 0);
+
+  // Errors: slabs thinner than the ghost region, fields of the wrong extent,
+  // invalid names and a neighbour which never packs its planes
+  failed |= !throws<std::invalid_argument>(
+      [] { SlabDecomposition({{4, 4, 10}}, 4, 3); });
+  failed |= !throws<std::invalid_argument>([] {
+    Metric wrong_extent(4, 4, 4);
+    tensoralgebra::HaloExchange(unique_name("extent"),
+                                SlabDecomposition({{4, 4, 6}}, 1, 1), 0,
+                                wrong_extent);
+  });
+  failed |= !throws<std::invalid_argument>([] {
+    Metric metric(4, 4, 8);
+    tensoralgebra::HaloExchange("no/slash",
+                                SlabDecomposition({{4, 4, 6}}, 1, 1), 0,
+                                metric);
+  });
+  failed |= !throws<std::out_of_range>([] {
+    Metric metric(4, 4, 8);
+    tensoralgebra::HaloExchange(unique_name("rank"),
+                                SlabDecomposition({{4, 4, 6}}, 1, 1), 1,
+                                metric);
+  });
+  const std::string silent_name = unique_name("silent");
+  const pid_t silent = fork();
+  if (silent == 0) {
+    // Attaches, but exits without ever starting an exchange
+    try {
+      Metric metric(slabs.local_extent(1));
+      tensoralgebra::HaloExchange halo(silent_name, slabs, 1, metric);
+    } catch (...) {
+    }
+    _exit(0);
+  }
+  failed |= !throws<std::runtime_error>([&] {
+    Metric metric(slabs.local_extent(0));
+    tensoralgebra::HaloExchange halo(silent_name, slabs, 0, metric);
+    halo.set_timeout(std::chrono::milliseconds(100));
+    halo.exchange();
+  });
+  int status = 0;
+  failed |= (silent < 0 || waitpid(silent, &status, 0) != silent);
+
+  print_result("Halo exchange test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef _TENSORALGEBRA_TESTS_INTERPOLATIONTEST_HPP
+#define _TENSORALGEBRA_TESTS_INTERPOLATIONTEST_HPP
+
+#include "Interpolation.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// This file tests that Lagrange interpolation reproduces polynomials of the
+// degree it is exact for, in the interior, next to and on the boundaries of
+// three and two dimensional grids, for batches which are not full.
+
+namespace interpolation_test {
+using Point = std::array<double, 3>;
+
+// A field whose components are polynomials of degree Degree in each direction
+template <size_t Degree> tensoralgebra::Tensor<2> polynomial(const Point &x) {
+  tensoralgebra::Tensor<2> value;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      double product = 1. + i - 0.5 * j;
+      for (size_t dir = 0; dir < 3; ++dir) {
+        product *= std::pow(x[dir] - 0.3 * (i + dir) + 0.1 * j, Degree);
+      }
+      value[i][j] = product + i * x[0] - j * x[2];
+    }
+  }
+  return value;
+}
+
+template <size_t Order>
+bool interpolation_fails(size_t nx, size_t ny, size_t nz) {
+  const Point origin = {{-1., 0.5, 2.}}, spacing = {{0.25, 0.2, 0.3}};
+  tensoralgebra::TensorField<2> field(nx, ny, nz);
+  for (size_t k = 0; k < nz; ++k) {
+    for (size_t j = 0; j < ny; ++j) {
+      for (size_t i = 0; i < nx; ++i) {
+        field(i, j, k) = polynomial<Order - 1>(
+            {{origin[0] + i * spacing[0], origin[1] + j * spacing[1],
+              nz == 1 ? 0. : origin[2] + k * spacing[2]}});
+      }
+    }
+  }
+  // Points spread over the whole grid, including its corners
+  std::vector<Point> points;
+  const size_t num_points = 101;
+  for (size_t n = 0; n < num_points; ++n) {
+    const double s = double(n) / double(num_points - 1);
+    points.push_back({{origin[0] + s * (nx - 1) * spacing[0],
+                       origin[1] + (1. - s) * (ny - 1) * spacing[1],
+                       nz == 1 ? 0.
+                               : origin[2] + std::fmod(7. * s, 1.) *
+                                                 (nz - 1) * spacing[2]}});
+  }
+  tensoralgebra::LagrangeInterpolator<Order> interpolator(origin, spacing);
+  const std::vector<tensoralgebra::Tensor<2>> values =
+      interpolator.interpolate(field, points);
+  bool failed = (values.size() != num_points);
+  for (size_t n = 0; n < num_points && !failed; ++n) {
+    const tensoralgebra::Tensor<2> expected = polynomial<Order - 1>(points[n]);
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        failed |= std::abs(values[n][i][j] - expected[i][j]) >
+                  1e-10 * (1. + std::abs(expected[i][j]));
+      }
+    }
+  }
+  return failed;
+}
+} // namespace interpolation_test
+
+bool test_interpolation() {
+  using interpolation_test::interpolation_fails;
+  bool failed = false;
+
+  // Linear functions (plus the bilinear terms of the product) for trilinear
+  // interpolation, cubic ones for four points per direction
+  failed |= interpolation_fails<2>(9, 7, 5);
+  failed |= interpolation_fails<4>(9, 7, 5);
+  failed |= interpolation_fails<4>(8, 4, 1);
+  failed |= interpolation_fails<3>(5, 6, 7);
+
+  // Points outside the grid and grids too small for the stencil
+  tensoralgebra::TensorField<1> field(6, 6, 6);
+  tensoralgebra::LagrangeInterpolator<4> interpolator({{0., 0., 0.}},
+                                                      {{1., 1., 1.}});
+  bool threw = false;
+  try {
+    interpolator.interpolate(field, {{{1., 2., 5.01}}});
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  failed |= !threw;
+  threw = false;
+  try {
+    interpolator.interpolate(tensoralgebra::TensorField<1>(6, 3, 6),
+                             {{{1., 1., 1.}}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+  failed |= (interpolator.interpolate(field, {{{5., 5., 5.}}}).size() != 1);
+
+  print_result("Interpolation test", !failed);
+  return failed;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef _TENSORALGEBRA_TESTS_INTERPRETERTEST_HPP
+#define _TENSORALGEBRA_TESTS_INTERPRETERTEST_HPP
+
+#include "Interpreter.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// This file tests the interpreter for expressions given at run time: the
+// results must agree with the same expressions compiled with the expression
+// templates (for a number of points which isn't a multiple of the chunk size),
+// and invalid expressions must be rejected with the position of the error.
+
+// Whether compiling expression throws std::invalid_argument mentioning message
+bool interpreter_rejects(const tensoralgebra::Interpreter<3> &interpreter,
+                         const std::string &expression,
+                         const std::string &message) {
+  try {
+    interpreter.compile(expression);
+  } catch (const std::invalid_argument &error) {
+    return std::string(error.what()).find(message) != std::string::npos;
+  }
+  return false;
+}
+
+double max_difference(const tensoralgebra::Tensor<1, double, 3> &a,
+                      const tensoralgebra::Tensor<1, double, 3> &b) {
+  double difference = 0.;
+  for (size_t i = 0; i < 3; ++i) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+double max_difference(const tensoralgebra::Tensor<2, double, 3> &a,
+                      const tensoralgebra::Tensor<2, double, 3> &b) {
+  double difference = 0.;
+  for (size_t i = 0; i < 3; ++i) {
+    difference = std::max(difference, max_difference(a[i], b[i]));
+  }
+  return difference;
+}
+
+bool test_interpreter() {
+  bool failed = false;
+
+  const size_t num_points =
+      2 * tensoralgebra::Interpreter<3>::chunk_points() + 5;
+  tensoralgebra::TensorField<2, double, 3> metric(num_points);
+  tensoralgebra::TensorField<2, double, 3> curvature(num_points);
+  tensoralgebra::TensorField<1, double, 3> vector(num_points);
+  tensoralgebra::TensorField<2, double, 3> result(num_points);
+  tensoralgebra::TensorField<1, double, 3> vector_result(num_points);
+  for (size_t p = 0; p < num_points; ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      vector[p][i] = 0.5 * i - 0.01 * p;
+      for (size_t j = 0; j < 3; ++j) {
+        metric[p][i][j] = (i == j ? 1. + 1e-3 * p : 0.1);
+        curvature[p][i][j] = 0.3 * i + 0.2 * j + 1e-3 * p;
+      }
+    }
+  }
+
+  tensoralgebra::Interpreter<3> interpreter;
+  interpreter.bind("g", metric);
+  interpreter.bind("K", curvature);
+  interpreter.bind("v", vector);
+  interpreter.bind("alpha", 2.);
+
+  auto contractions =
+      interpreter.compile("dot(K, raise_all(K, g)) - trace(K, g) * K + "
+                          "outer(v, v) / alpha");
+  auto functions = interpreter.compile("exp(-K) * (K > 0.5) + sqrt(g)");
+  auto vectors = interpreter.compile("lower_all(v, g) + dot(K, v, g) - v");
+  auto scalars = interpreter.compile("dot(v, v, g) + 2 * alpha - 1");
+  auto constant = interpreter.compile("-(1 + alpha) / 2");
+  failed |= (contractions.rank() != 2 || vectors.rank() != 1 ||
+             scalars.rank() != 0 || constant.rank() != 0);
+  // Constants are folded
+  failed |= (constant.num_instructions() != 1);
+
+  double error = 0.;
+  contractions.run(result);
+  for (size_t p = 0; p < num_points; ++p) {
+    const tensoralgebra::Tensor<2, double, 3> raised =
+        tensoralgebra::dot(metric[p],
+                           tensoralgebra::dot(curvature[p], metric[p]));
+    const tensoralgebra::Tensor<2, double, 3> expected =
+        tensoralgebra::dot(curvature[p], raised) -
+        tensoralgebra::trace(curvature[p], metric[p]) * curvature[p] +
+        tensoralgebra::outer(vector[p], vector[p]) / 2.;
+    error = std::max(error, max_difference(result[p], expected));
+  }
+  functions.run(result);
+  for (size_t p = 0; p < num_points; ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        const double k = curvature[p][i][j];
+        const double expected =
+            std::exp(-k) * (k > 0.5 ? 1. : 0.) + std::sqrt(metric[p][i][j]);
+        error = std::max(error, std::abs(result[p][i][j] - expected));
+      }
+    }
+  }
+  vectors.run(vector_result, 2);
+  for (size_t p = 0; p < num_points; ++p) {
+    const tensoralgebra::Tensor<1, double, 3> expected =
+        tensoralgebra::dot(metric[p], vector[p]) +
+        tensoralgebra::dot(curvature[p],
+                           tensoralgebra::Tensor<1, double, 3>(
+                               tensoralgebra::dot(metric[p], vector[p]))) -
+        vector[p];
+    error = std::max(error, max_difference(vector_result[p], expected));
+  }
+  std::vector<double> scalar_result(num_points);
+  scalars.run(scalar_result);
+  for (size_t p = 0; p < num_points; ++p) {
+    const double expected =
+        tensoralgebra::dot(vector[p], vector[p], metric[p]) + 3.;
+    error = std::max(error, std::abs(scalar_result[p] - expected));
+  }
+  constant.run(scalar_result);
+  for (size_t p = 0; p < num_points; ++p) {
+    error = std::max(error, std::abs(scalar_result[p] + 1.5));
+  }
+  failed |= (error > 1e-13);
+
+  // Invalid expressions and results
+  failed |= !interpreter_rejects(interpreter, "K + v", "ranks 2 and 1");
+  failed |= !interpreter_rejects(interpreter, "K + h", "unknown name h");
+  failed |= !interpreter_rejects(interpreter, "foo(K)", "unknown function");
+  failed |= !interpreter_rejects(interpreter, "trace(v)", "rank 2");
+  failed |= !interpreter_rejects(interpreter, "dot(K)", "number of arguments");
+  failed |= !interpreter_rejects(interpreter, "(K + g", "expected ')'");
+  failed |= !interpreter_rejects(interpreter, "K +", "at position 3");
+  bool rejected = false;
+  try {
+    contractions.run(vector_result);
+  } catch (const std::invalid_argument &) {
+    rejected = true;
+  }
+  failed |= !rejected;
+  rejected = false;
+  try {
+    contractions.run(curvature);
+  } catch (const std::invalid_argument &) {
+    rejected = true;
+  }
+  failed |= !rejected;
+
+  print_result("Interpreter test", !failed);
+
+  return failed;
+}
+
+#endif
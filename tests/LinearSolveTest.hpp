@@ -0,0 +1,106 @@
+#ifndef _TENSORALGEBRA_TESTS_LINEARSOLVETEST_HPP
+#define _TENSORALGEBRA_TESTS_LINEARSOLVETEST_HPP
+
+#include "Dual.hpp"
+#include "LinearSolve.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+
+// This file tests the small linear solvers: the factorisations must reproduce
+// the matrix, the solutions must satisfy the system, and the batched solvers
+// must agree with solving each system on its own (including for a number of
+// systems which is not a multiple of the block size).
+
+template <size_t Size>
+bool residual_is_small(const tensoralgebra::Tensor<2, double, Size> &matrix,
+                       const tensoralgebra::Tensor<1, double, Size> &x,
+                       const tensoralgebra::Tensor<1, double, Size> &rhs) {
+  tensoralgebra::Tensor<1, double, Size> residual =
+      tensoralgebra::dot(matrix, x) - rhs;
+  return std::sqrt(tensoralgebra::dot(residual, residual)) < 1e-13;
+}
+
+bool test_linear_solve() {
+  bool failed = false;
+
+  // A symmetric positive definite matrix
+  tensoralgebra::Tensor<2, double, 3> spd = {
+      {4., 2., 0.6}, {2., 5., 1.}, {0.6, 1., 3.}};
+  tensoralgebra::Tensor<1, double, 3> rhs = {1., -2., 0.5};
+
+  tensoralgebra::Tensor<2, double, 3> lower = tensoralgebra::cholesky(spd);
+  failed |= (lower[0][1] != 0. || lower[0][2] != 0. || lower[1][2] != 0.);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      double product = 0.; // (L.L^T)[i][j]
+      for (size_t k = 0; k < 3; ++k) {
+        product += lower[i][k] * lower[j][k];
+      }
+      failed |= (std::abs(product - spd[i][j]) > 1e-14);
+    }
+  }
+  failed |= !residual_is_small(spd, tensoralgebra::solve_spd(spd, rhs), rhs);
+  failed |= !residual_is_small(spd, tensoralgebra::solve(spd, rhs), rhs);
+
+  // A non-symmetric 4x4 system, given as an expression
+  tensoralgebra::Tensor<2, double, 4> matrix = {{5., 1., -1., 2.},
+                                                {1., 6., 2., 0.},
+                                                {0., -2., 7., 1.},
+                                                {2., 1., 1., 8.}};
+  tensoralgebra::Tensor<1, double, 4> rhs4 = {1., 2., 3., 4.};
+  tensoralgebra::Tensor<1, double, 4> x4 =
+      tensoralgebra::solve(2. * matrix, rhs4);
+  failed |= !residual_is_small(tensoralgebra::Tensor<2, double, 4>(2. * matrix),
+                               x4, rhs4);
+
+  // Derivative of the solution with respect to the right hand side
+  using Dual = tensoralgebra::Dual<double, 1>;
+  tensoralgebra::Tensor<2, Dual, 3> dual_spd;
+  tensoralgebra::Tensor<1, Dual, 3> dual_rhs;
+  for (size_t i = 0; i < 3; ++i) {
+    dual_rhs[i] = rhs[i];
+    for (size_t j = 0; j < 3; ++j) {
+      dual_spd[i][j] = spd[i][j];
+    }
+  }
+  dual_rhs[0] = Dual::variable(rhs[0], 0);
+  tensoralgebra::Tensor<1, Dual, 3> dual_x =
+      tensoralgebra::solve_spd(dual_spd, dual_rhs);
+  tensoralgebra::Tensor<1, double, 3> unit = {1., 0., 0.};
+  tensoralgebra::Tensor<1, double, 3> column = tensoralgebra::solve(spd, unit);
+  for (size_t i = 0; i < 3; ++i) {
+    failed |= (std::abs(dual_x[i].derivative(0) - column[i]) > 1e-14);
+  }
+
+  // Batched solvers
+  const size_t num_points = 37;
+  tensoralgebra::TensorField<2, double, 3> matrices(num_points);
+  tensoralgebra::TensorField<1, double, 3> rhs_field(num_points);
+  tensoralgebra::TensorField<1, double, 3> solutions(num_points);
+  tensoralgebra::TensorField<1, double, 3> spd_solutions(num_points);
+  for (size_t p = 0; p < num_points; ++p) {
+    matrices[p] = spd + 0.1 * p * spd * spd;
+    rhs_field[p] = (1. + p) * rhs;
+  }
+  tensoralgebra::solve(matrices, rhs_field, solutions);
+  tensoralgebra::solve_spd(matrices, rhs_field, spd_solutions);
+  for (size_t p = 0; p < num_points; ++p) {
+    tensoralgebra::Tensor<1, double, 3> x =
+        tensoralgebra::solve(matrices[p], rhs_field[p]);
+    tensoralgebra::Tensor<1, double, 3> x_spd =
+        tensoralgebra::solve_spd(matrices[p], rhs_field[p]);
+    for (size_t i = 0; i < 3; ++i) {
+      failed |= (std::abs(solutions[p][i] - x[i]) > 1e-14 * (1. + p));
+      failed |= (std::abs(spd_solutions[p][i] - x_spd[i]) > 1e-14 * (1. + p));
+    }
+  }
+
+  print_result("Linear solve test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _TENSORALGEBRA_TESTS_LOWSTORAGERKTEST_HPP
+#define _TENSORALGEBRA_TESTS_LOWSTORAGERKTEST_HPP
+
+#include "LowStorageRK.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+#include <stdexcept>
+
+// This file tests the low-storage Runge-Kutta schemes on coupled fields of
+// different ranks (a harmonic oscillator whose frequency varies from point to
+// point) and on a right hand side depending on the time, and checks that the
+// error decreases with the order of the scheme.
+
+namespace low_storage_rk_test {
+// Error at t = 1 of the oscillator x' = v, v' = -omega^2 x with x(0) = 1 and
+// v(0) = 0, plus y' = cos(t) with y(0) = 0, integrated with num_steps steps
+inline double error(const tensoralgebra::LowStorageScheme &scheme,
+                    size_t num_steps) {
+  const size_t num_points = 10;
+  tensoralgebra::TensorField<1> x(num_points);
+  tensoralgebra::TensorField<2> v(num_points);
+  tensoralgebra::TensorField<1> y(num_points);
+  tensoralgebra::TensorField<1> omega_squared(num_points);
+  for (size_t p = 0; p < num_points; ++p) {
+    x[p] = 1.;
+    v[p] = 0.;
+    y[p] = 0.;
+    omega_squared[p] = 1. + 0.5 * p;
+  }
+  double stage_time = 0.;
+  tensoralgebra::LowStorageRungeKutta integrator(scheme);
+  // The diagonal of v holds the velocity, the rest stays zero
+  integrator.add(x, [&](size_t p) {
+    return tensoralgebra::Tensor<1>({v[p][0][0], v[p][1][1], v[p][2][2]});
+  });
+  integrator.add(v, [&](size_t p) {
+    tensoralgebra::Tensor<2> acceleration = 0.;
+    for (size_t i = 0; i < 3; ++i) {
+      acceleration[i][i] = -omega_squared[p][i] * x[p][i];
+    }
+    return acceleration;
+  });
+  integrator.add(y, [&](size_t) {
+    return tensoralgebra::Tensor<1>(std::cos(stage_time));
+  });
+  integrator.set_prepare_stage([&](double time) { stage_time = time; });
+
+  double time = 0.;
+  for (size_t step = 0; step < num_steps; ++step) {
+    integrator.step(time, 1. / num_steps);
+  }
+  double max_error = std::abs(time - 1.);
+  for (size_t p = 0; p < num_points; ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      const double omega = std::sqrt(omega_squared[p][i]);
+      max_error = std::max(max_error, std::abs(x[p][i] - std::cos(omega)));
+      max_error = std::max(max_error,
+                           std::abs(v[p][i][i] + omega * std::sin(omega)));
+      max_error = std::max(max_error, std::abs(y[p][i] - std::sin(1.)));
+      max_error = std::max(max_error, std::abs(v[p][i][(i + 1) % 3]));
+    }
+  }
+  return max_error;
+}
+} // namespace low_storage_rk_test
+
+bool test_low_storage_rk() {
+  using low_storage_rk_test::error;
+  using tensoralgebra::LowStorageScheme;
+  bool failed = false;
+
+  // Halving the time step divides the error by 2^order
+  for (const LowStorageScheme &scheme :
+       {LowStorageScheme::williamson3(),
+        LowStorageScheme::carpenter_kennedy4()}) {
+    const double coarse = error(scheme, 20), fine = error(scheme, 40);
+    const double observed_order = std::log2(coarse / fine);
+    failed |= (fine > 1e-3 ||
+               std::abs(observed_order - double(scheme.order)) > 0.3);
+  }
+
+  bool threw = false;
+  try {
+    tensoralgebra::LowStorageRungeKutta integrator({{1.}, {1.}, {0.}, 1});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+
+  print_result("Low-storage Runge-Kutta test", !failed);
+  return failed;
+}
+
+#endif
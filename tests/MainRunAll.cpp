@@ -1,13 +1,36 @@
 #include <cmath>
 #include <iostream>
 
+#include "ArenaTest.hpp"
 #include "ArithmeticOperationsTest.hpp"
+#include "AsyncOutputTest.hpp"
+#include "BitTensorTest.hpp"
+#include "CheckpointTest.hpp"
+#include "ComplexTest.hpp"
+#include "CompressedStreamTest.hpp"
+#include "DualTest.hpp"
+#include "DynamicTensorTest.hpp"
+#include "EvaluationCounterTest.hpp"
+#include "FirstTouchTest.hpp"
 #include "FunctionsEvaluationOrderTest.hpp"
 #include "FunctionsTest.hpp"
+#include "HaloExchangeTest.hpp"
+#include "InterpolationTest.hpp"
+#include "InterpreterTest.hpp"
+#include "LinearSolveTest.hpp"
+#include "LowStorageRKTest.hpp"
+#include "PaddedTensorTest.hpp"
+#include "PowerTest.hpp"
+#include "ReductionTest.hpp"
+#include "RegridTest.hpp"
 #include "RelationalOperatorsTest.hpp"
+#include "StatementGraphTest.hpp"
 #include "SumEvaluationOrderTest.hpp"
+#include "SymmetricEigenTest.hpp"
 #include "Tensor.hpp"
 #include "TensorOperationsTest.hpp"
+#include "TextFormatTest.hpp"
+#include "WorkStealingTest.hpp"
 
 int main() {
   using test_tensor = tensoralgebra::Tensor<2, double, 2>;
@@ -34,6 +57,29 @@ int main() {
   failed |= test_transcendental_functions();
   failed |= test_relational_operations();
   failed |= test_rank_changing_operations();
+  failed |= test_checkpoint();
+  failed |= test_compressed_stream();
+  failed |= test_async_output();
+  failed |= test_text_format();
+  failed |= test_arena();
+  failed |= test_dynamic_tensor();
+  failed |= test_dual();
+  failed |= test_linear_solve();
+  failed |= test_symmetric_eigen();
+  failed |= test_evaluation_counter();
+  failed |= test_interpreter();
+  failed |= test_statement_graph();
+  failed |= test_work_stealing();
+  failed |= test_padded_tensor();
+  failed |= test_bit_tensor();
+  failed |= test_interpolation();
+  failed |= test_low_storage_rk();
+  failed |= test_first_touch();
+  failed |= test_regrid();
+  failed |= test_complex();
+  failed |= test_power();
+  failed |= test_halo_exchange();
+  failed |= test_reduction();
 
   return failed;
 }
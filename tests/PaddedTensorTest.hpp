@@ -0,0 +1,122 @@
+#ifndef _TENSORALGEBRA_TESTS_PADDEDTENSORTEST_HPP
+#define _TENSORALGEBRA_TESTS_PADDEDTENSORTEST_HPP
+
+#include "PaddedTensor.hpp"
+#include "Tensor.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+#include <cstdint>
+
+// This file tests that expressions of padded tensors give the same values as
+// the same expressions of unpadded tensors, whether or not their rows are
+// evaluated including the padding, and that arrays of padded tensors are
+// aligned.
+
+namespace padded_tensor_test {
+template <typename T1, typename T2>
+bool differ(const tensoralgebra::TensorExpression<1, T1, 3> &a,
+            const tensoralgebra::TensorExpression<1, T2, 3> &b) {
+  for (size_t i = 0; i < 3; ++i) {
+    if (std::abs(a.eval(i) - b.eval(i)) > 1e-14) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <size_t Rank, typename T1, typename T2>
+bool differ(const tensoralgebra::TensorExpression<Rank, T1, 3> &a,
+            const tensoralgebra::TensorExpression<Rank, T2, 3> &b) {
+  for (size_t i = 0; i < 3; ++i) {
+    if (differ(a[i], b[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace padded_tensor_test
+
+bool test_padded_tensor() {
+  using padded_tensor_test::differ;
+  using tensoralgebra::PaddedTensor;
+  using tensoralgebra::Tensor;
+  bool failed = false;
+
+  static_assert(sizeof(PaddedTensor<1>) == 32 &&
+                    alignof(PaddedTensor<1>) == 32,
+                "Rows of doubles are padded to 32 bytes.");
+  static_assert(sizeof(PaddedTensor<2>) == 96, "Only rows are padded.");
+  static_assert(PaddedTensor<1, float>::row_size() == 8 &&
+                    PaddedTensor<1, float, 5>::row_size() == 8 &&
+                    PaddedTensor<1, double, 5>::row_size() == 8,
+                "Rows are padded to a multiple of 32 bytes.");
+  static_assert(tensoralgebra::is_padded<decltype(
+                        2. * std::declval<PaddedTensor<2>>() +
+                        tensoralgebra::dot(std::declval<PaddedTensor<2>>(),
+                                           std::declval<PaddedTensor<2>>()))>(),
+                "Whole rows of padded expressions are evaluated.");
+  static_assert(!tensoralgebra::is_padded<decltype(
+                    std::declval<PaddedTensor<2>>() +
+                    std::declval<Tensor<2>>())>(),
+                "Rows involving unpadded tensors are evaluated element wise.");
+  static_assert(!tensoralgebra::is_padded<decltype(tensoralgebra::dot(
+                    std::declval<PaddedTensor<2>>(),
+                    std::declval<PaddedTensor<1>>()))>(),
+                "The padding of a contracted index is not evaluated.");
+
+  Tensor<2> a = {{1., 2., 3.}, {-4., 5., 0.5}, {7., -8., 9.}};
+  Tensor<2> b = {{0.25, -1., 2.}, {3., 1.5, -2.}, {1., 1., 4.}};
+  Tensor<1> v = {1., -2., 0.5};
+  const PaddedTensor<2> padded_a = a;
+  const PaddedTensor<2> padded_b = {{0.25, -1., 2.}, {3., 1.5, -2.},
+                                    {1., 1., 4.}};
+  const PaddedTensor<1> padded_v = v;
+  failed |= differ(padded_a, a) || differ(padded_b, b);
+
+  // Padded evaluation, including a non-zero padding from the constant term
+  PaddedTensor<2> padded_result = 2. * padded_a + padded_b * padded_a - 1.;
+  failed |= differ(padded_result, 2. * a + b * a - 1.);
+  padded_result = sqrt(abs(padded_result)) / padded_b;
+  failed |= differ(padded_result, sqrt(abs(2. * a + b * a - 1.)) / b);
+  padded_result = tensoralgebra::dot(padded_a, padded_b);
+  failed |= differ(padded_result, tensoralgebra::dot(a, b));
+  PaddedTensor<3> padded_outer = tensoralgebra::outer(padded_v, padded_b);
+  failed |= differ(padded_outer, tensoralgebra::outer(v, b));
+  PaddedTensor<3> padded_dot = tensoralgebra::dot(padded_b, padded_outer);
+  failed |=
+      differ(padded_dot, tensoralgebra::dot(b, tensoralgebra::outer(v, b)));
+
+  // The result may be an operand
+  padded_result = padded_a;
+  padded_result = tensoralgebra::dot(padded_b, padded_result) + padded_result;
+  failed |= differ(padded_result, tensoralgebra::dot(b, a) + a);
+
+  // Element wise evaluation: mixed with unpadded tensors, contractions with a
+  // vector, and unpadded results
+  padded_result = padded_a + b;
+  failed |= differ(padded_result, a + b);
+  PaddedTensor<1> padded_vector = tensoralgebra::dot(padded_a, padded_v);
+  failed |= differ(padded_vector, tensoralgebra::dot(a, v));
+  Tensor<2> result = 2. * padded_a - padded_b;
+  failed |= differ(result, 2. * a - b);
+  failed |= (tensoralgebra::trace(padded_a, padded_b) !=
+             tensoralgebra::trace(a, b));
+
+  // Assignment of a scalar and indexing
+  padded_result = 3.;
+  failed |= (padded_result[2][2] != 3. || padded_result.eval(1, 0) != 3.);
+
+  // Arrays of padded tensors are aligned to cache lines
+  tensoralgebra::PaddedArray<2> array(5, padded_a);
+  for (const PaddedTensor<2> &tensor : array) {
+    failed |= (reinterpret_cast<uintptr_t>(&tensor) % 32 != 0);
+    failed |= differ(tensor, a);
+  }
+  failed |= (reinterpret_cast<uintptr_t>(array.data()) % 64 != 0);
+
+  print_result("Padded tensor test", !failed);
+  return failed;
+}
+
+#endif
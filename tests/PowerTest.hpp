@@ -0,0 +1,93 @@
+#ifndef _TENSORALGEBRA_TESTS_POWERTEST_HPP
+#define _TENSORALGEBRA_TESTS_POWERTEST_HPP
+
+#include "EvaluationCounter.hpp"
+#include "Tensor.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+
+// This file tests integer powers and polynomials of tensor expressions against
+// std::pow and explicit sums of powers, for positive, zero and negative
+// exponents and for integer components, and (when the evaluation counters are
+// compiled in) that the operand is evaluated only once per component.
+
+namespace power_test {
+bool differs(double value, double expected) {
+  return std::abs(value - expected) > 1e-13 * (1. + std::abs(expected));
+}
+} // namespace power_test
+
+bool test_power() {
+  using power_test::differs;
+  bool failed = false;
+
+  const tensoralgebra::Tensor<2, double, 2> a = {{1.5, -0.5}, {2., 0.75}};
+  const tensoralgebra::Tensor<2, double, 2> b = {{0.25, 1.}, {-3., 0.5}};
+
+  const tensoralgebra::Tensor<2, double, 2> square = tensoralgebra::pow<2>(a);
+  const tensoralgebra::Tensor<2, double, 2> seventh =
+      tensoralgebra::pow<7>(a + b);
+  const tensoralgebra::Tensor<2, double, 2> twelfth =
+      tensoralgebra::pow<12>(a);
+  const tensoralgebra::Tensor<2, double, 2> one = tensoralgebra::pow<0>(a);
+  const tensoralgebra::Tensor<2, double, 2> inverse_cube =
+      tensoralgebra::pow<-3>(a);
+  const tensoralgebra::Tensor<2, double, 2> polynomial =
+      tensoralgebra::polyval(a - b, 2., -1, 0.5f, 3.);
+  const tensoralgebra::Tensor<2, double, 2> constant =
+      tensoralgebra::polyval(a, 4.);
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 2; ++j) {
+      const double x = a[i][j], y = a[i][j] - b[i][j];
+      failed |= differs(square[i][j], x * x);
+      failed |= differs(seventh[i][j], std::pow(x + b[i][j], 7));
+      failed |= differs(twelfth[i][j], std::pow(x, 12));
+      failed |= (one[i][j] != 1.);
+      failed |= differs(inverse_cube[i][j], 1. / (x * x * x));
+      failed |= differs(polynomial[i][j],
+                        2. * y * y * y - y * y + 0.5 * y + 3.);
+      failed |= (constant[i][j] != 4.);
+    }
+  }
+
+  // Integer components stay integers
+  const tensoralgebra::Tensor<1, int, 3> n = {2, -3, 5};
+  const tensoralgebra::Tensor<1, int, 3> cubes = tensoralgebra::pow<3>(n);
+  const tensoralgebra::Tensor<1, int, 3> values =
+      tensoralgebra::polyval(n, 1, 0, -2);
+  failed |= (cubes[0] != 8 || cubes[1] != -27 || cubes[2] != 125);
+  failed |= (values[0] != 2 || values[1] != 7 || values[2] != 23);
+
+  // Each component of the operand is read once, however large the power
+  tensoralgebra::Tensor<1, double, 3> result;
+  const tensoralgebra::Tensor<1, double, 3> v = {0.5, 1., 2.};
+  const auto report = tensoralgebra::count_evaluations([&] {
+    result = tensoralgebra::pow<5>(v) + tensoralgebra::polyval(v, 1., 2., 3.);
+  });
+  if (tensoralgebra::counts_evaluations()) {
+    size_t power_evaluations = 0, power_arithmetic = 0;
+    size_t polynomial_evaluations = 0, tensor_evaluations = 0;
+    for (const auto &count : report) {
+      if (count.node == "Power") {
+        power_evaluations = count.evaluations;
+        power_arithmetic = count.arithmetic;
+      } else if (count.node == "Polynomial") {
+        polynomial_evaluations = count.evaluations;
+      } else if (count.node == "Tensor") {
+        tensor_evaluations = count.evaluations;
+      }
+    }
+    failed |= (power_evaluations != 3 || power_arithmetic != 3 * 3);
+    failed |= (polynomial_evaluations != 3 || tensor_evaluations != 2 * 3);
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    failed |= differs(result[i], std::pow(v[i], 5) + v[i] * v[i] + 2. * v[i] +
+                                     3.);
+  }
+
+  print_result("Power test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef _TENSORALGEBRA_TESTS_REDUCTIONTEST_HPP
+#define _TENSORALGEBRA_TESTS_REDUCTIONTEST_HPP
+
+#include "Reduction.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// This file tests that the sums, norms and extrema of point expressions and
+// fields are bit-identical for different numbers of threads (including more
+// threads than blocks) and agree with the same reductions computed serially
+// in extended precision, that extrema are located at the first point where
+// they are attained, that NaN values are not lost, and the reductions of empty
+// ranges.
+
+namespace reduction_test {
+template <typename T> bool bitwise_equal(const T &a, const T &b) {
+  return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+bool differs(long double value, long double expected) {
+  return std::abs(value - expected) > 1e-12 * (1. + std::abs(expected));
+}
+} // namespace reduction_test
+
+bool test_reduction() {
+  using namespace reduction_test;
+  bool failed = false;
+
+  // Large enough for 26 blocks, with a partial last block
+  tensoralgebra::TensorField<2> curvature(47, 45, 50);
+  tensoralgebra::TensorField<2> inverse_metric(47, 45, 50);
+  for (size_t p = 0; p < curvature.num_points(); ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        curvature[p][i][j] = std::sin(1e-3 * p * (i + 1) + j) * 1e3;
+        inverse_metric[p][i][j] = (i == j ? 1. : 0.1) + 1e-7 * p;
+      }
+    }
+  }
+  const size_t n = curvature.num_points();
+  const auto constraint = [&](size_t p) {
+    return tensoralgebra::trace(curvature[p], inverse_metric[p]);
+  };
+
+  // The same value is planted twice; the first occurrence must be found
+  curvature[12345][0][0] = 1e9;
+  curvature[54321] = curvature[12345];
+  inverse_metric[54321] = inverse_metric[12345];
+
+  long double sum = 0., squares = 0., maximum_norm = 0.;
+  size_t min_point = 0, max_point = 0;
+  for (size_t p = 0; p < n; ++p) {
+    const double value = constraint(p);
+    sum += value;
+    squares += static_cast<long double>(value) * value;
+    maximum_norm = std::max<long double>(maximum_norm, std::abs(value));
+    min_point = value < constraint(min_point) ? p : min_point;
+    max_point = value > constraint(max_point) ? p : max_point;
+  }
+
+  const double sum1 = tensoralgebra::field_sum(n, constraint, 1);
+  const double l2_1 = tensoralgebra::field_l2_norm(n, constraint, 1);
+  const double linf1 = tensoralgebra::field_linf_norm(n, constraint, 1);
+  const auto min1 = tensoralgebra::field_min(n, constraint, 1);
+  const auto max1 = tensoralgebra::field_max(n, constraint, 1);
+  const tensoralgebra::Tensor<2> tensor_sum1 =
+      tensoralgebra::field_sum(curvature, 1);
+  failed |= differs(sum1, sum);
+  failed |= differs(l2_1, std::sqrt(squares));
+  failed |= differs(linf1, maximum_norm);
+  failed |= (min1.point != min_point || min1.value != constraint(min_point));
+  failed |= (max1.point != max_point || max_point != 12345);
+
+  for (size_t threads : {2, 3, 7, 64}) {
+    failed |= !bitwise_equal(tensoralgebra::field_sum(n, constraint, threads),
+                             sum1);
+    failed |= !bitwise_equal(
+        tensoralgebra::field_l2_norm(n, constraint, threads), l2_1);
+    failed |= !bitwise_equal(
+        tensoralgebra::field_linf_norm(n, constraint, threads), linf1);
+    const auto min = tensoralgebra::field_min(n, constraint, threads);
+    const auto max = tensoralgebra::field_max(n, constraint, threads);
+    failed |= !bitwise_equal(min.value, min1.value) || min.point != min1.point;
+    failed |= !bitwise_equal(max.value, max1.value) || max.point != max1.point;
+    const tensoralgebra::Tensor<2> tensor_sum =
+        tensoralgebra::field_sum(curvature, threads);
+    failed |= !bitwise_equal(tensor_sum, tensor_sum1);
+    failed |= !bitwise_equal(tensoralgebra::field_l2_norm(curvature, threads),
+                             tensoralgebra::field_l2_norm(curvature, 1));
+  }
+
+  // Sums of tensor expressions are taken component by component
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      long double component_sum = 0.;
+      for (size_t p = 0; p < n; ++p) {
+        component_sum += curvature[p][i][j];
+      }
+      failed |= differs(tensor_sum1[i][j], component_sum);
+    }
+  }
+  const tensoralgebra::Tensor<1, int, 2> counts = tensoralgebra::field_sum(
+      10000,
+      [](size_t p) { return tensoralgebra::Tensor<1, int, 2>{1, int(p % 3)}; },
+      3);
+  failed |= (counts[0] != 10000 || counts[1] != 9999);
+
+  // A NaN anywhere makes the norms NaN and is found by the extrema, at its
+  // first point, for any number of threads
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const auto with_nan = [nan](size_t p) {
+    return (p == 1 || p == 9000 || p == 9500) ? nan : 1. + p;
+  };
+  for (size_t threads : {1, 3}) {
+    for (size_t num_points : {3, 10000}) {
+      failed |= !std::isnan(
+          tensoralgebra::field_linf_norm(num_points, with_nan, threads));
+      failed |= !std::isnan(
+          tensoralgebra::field_l2_norm(num_points, with_nan, threads));
+      const auto max = tensoralgebra::field_max(num_points, with_nan, threads);
+      const auto min = tensoralgebra::field_min(num_points, with_nan, threads);
+      failed |= (!std::isnan(max.value) || max.point != 1);
+      failed |= (!std::isnan(min.value) || min.point != 1);
+    }
+    // Only in a later block
+    const auto late = [&](size_t p) { return p < 9000 ? 1. : with_nan(p); };
+    failed |= !std::isnan(tensoralgebra::field_linf_norm(10000, late, threads));
+    failed |= (tensoralgebra::field_max(10000, late, threads).point != 9000);
+  }
+
+  // Empty ranges
+  failed |= (tensoralgebra::field_sum(0, constraint) != 0.);
+  failed |= (tensoralgebra::field_l2_norm(0, constraint) != 0.);
+  bool threw = false;
+  try {
+    tensoralgebra::field_min(0, constraint);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+
+  print_result("Reduction test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef _TENSORALGEBRA_TESTS_REGRIDTEST_HPP
+#define _TENSORALGEBRA_TESTS_REGRIDTEST_HPP
+
+#include "Regrid.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+// This file tests that prolongation reproduces polynomials of the degree it is
+// exact for, for fine boxes in the interior and at the edges of three and two
+// dimensional coarse boxes, that the symmetric mode gives the same results,
+// that injection undoes prolongation and that full weighting reproduces
+// (multi)linear functions, that only the covered coarse points are set, and
+// that transfers work again after the scratch memory is released.
+
+namespace regrid_test {
+using Offset = std::array<size_t, 3>;
+
+// A symmetric tensor whose components are polynomials of degree Degree in each
+// direction, at coarse index x
+template <size_t Degree>
+tensoralgebra::Tensor<2> polynomial(double x, double y, double z) {
+  tensoralgebra::Tensor<2> value;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = i; j < 3; ++j) {
+      const double shift = 0.3 * (i + 2 * j);
+      value[i][j] = (1. + i - 0.5 * j) * std::pow(x - shift, Degree) *
+                        std::pow(y + shift, Degree) *
+                        std::pow(z - 0.5 * shift, Degree) +
+                    i * x - j * z;
+      value[j][i] = value[i][j];
+    }
+  }
+  return value;
+}
+
+template <size_t Degree>
+tensoralgebra::TensorField<2> polynomial_field(size_t nx, size_t ny,
+                                               size_t nz, double scale = 1.) {
+  tensoralgebra::TensorField<2> field(nx, ny, nz);
+  for (size_t k = 0; k < nz; ++k) {
+    for (size_t j = 0; j < ny; ++j) {
+      for (size_t i = 0; i < nx; ++i) {
+        field(i, j, k) = polynomial<Degree>(scale * i, scale * j, scale * k);
+      }
+    }
+  }
+  return field;
+}
+
+bool differs(const tensoralgebra::Tensor<2> &value,
+             const tensoralgebra::Tensor<2> &expected, double tolerance) {
+  bool failed = false;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      failed |= std::abs(value[i][j] - expected[i][j]) >
+                tolerance * (1. + std::abs(expected[i][j]));
+    }
+  }
+  return failed;
+}
+
+// Prolongs a polynomial from a coarse box of extent n to a fine box of extent
+// m at offset, in both modes
+template <size_t Order>
+bool prolongation_fails(const Offset &n, const Offset &m,
+                        const Offset &offset) {
+  const tensoralgebra::TensorField<2> coarse =
+      polynomial_field<Order - 1>(n[0], n[1], n[2]);
+  tensoralgebra::TensorField<2> fine(m), symmetric_fine(m);
+  tensoralgebra::prolong_field<Order>(coarse, fine, offset);
+  tensoralgebra::prolong_field<Order>(coarse, symmetric_fine, offset, true);
+  bool failed = false;
+  for (size_t k = 0; k < m[2]; ++k) {
+    for (size_t j = 0; j < m[1]; ++j) {
+      for (size_t i = 0; i < m[0]; ++i) {
+        const tensoralgebra::Tensor<2> expected = polynomial<Order - 1>(
+            0.5 * (offset[0] + i), 0.5 * (offset[1] + j),
+            0.5 * (offset[2] + k));
+        failed |= differs(fine(i, j, k), expected, 1e-10);
+        failed |= differs(symmetric_fine(i, j, k), fine(i, j, k), 0.);
+        // Points on coarse points are copied exactly
+        if ((offset[0] + i) % 2 == 0 && (offset[1] + j) % 2 == 0 &&
+            (offset[2] + k) % 2 == 0) {
+          failed |= differs(fine(i, j, k),
+                            coarse((offset[0] + i) / 2, (offset[1] + j) / 2,
+                                   (offset[2] + k) / 2),
+                            0.);
+        }
+      }
+    }
+  }
+  return failed;
+}
+
+// Restricts a fine box of extent m at offset, filled with a multilinear
+// function, to a coarse box of extent n whose other points are marked
+bool restriction_fails(const Offset &n, const Offset &m, const Offset &offset,
+                       tensoralgebra::Restriction restriction,
+                       bool symmetric) {
+  const tensoralgebra::TensorField<2> fine =
+      polynomial_field<1>(m[0], m[1], m[2], 0.5);
+  tensoralgebra::TensorField<2> coarse(n);
+  for (size_t p = 0; p < coarse.num_points(); ++p) {
+    coarse[p] = -1e3;
+  }
+  tensoralgebra::restrict_field(fine, coarse, offset, restriction, symmetric);
+  bool failed = false;
+  for (size_t k = 0; k < n[2]; ++k) {
+    for (size_t j = 0; j < n[1]; ++j) {
+      for (size_t i = 0; i < n[0]; ++i) {
+        const size_t f[3] = {2 * i - offset[0], 2 * j - offset[1],
+                             2 * k - offset[2]};
+        const bool covered = 2 * i >= offset[0] && f[0] < m[0] &&
+                             2 * j >= offset[1] && f[1] < m[1] &&
+                             2 * k >= offset[2] && f[2] < m[2];
+        if (covered) {
+          failed |= differs(coarse(i, j, k), fine(f[0], f[1], f[2]), 1e-12);
+        } else {
+          failed |= (coarse(i, j, k)[0][0] != -1e3);
+        }
+      }
+    }
+  }
+  return failed;
+}
+} // namespace regrid_test
+
+bool test_regrid() {
+  using regrid_test::prolongation_fails;
+  using regrid_test::restriction_fails;
+  using tensoralgebra::Restriction;
+  bool failed = false;
+
+  // Fine boxes starting on and between coarse points, in the interior and
+  // touching the edges
+  failed |= prolongation_fails<4>({{9, 8, 7}}, {{9, 8, 7}}, {{4, 3, 2}});
+  failed |= prolongation_fails<4>({{9, 8, 7}}, {{17, 15, 13}}, {{0, 0, 0}});
+  failed |= prolongation_fails<4>({{9, 8, 7}}, {{6, 5, 4}}, {{11, 9, 9}});
+  failed |= prolongation_fails<2>({{5, 6, 7}}, {{8, 9, 10}}, {{1, 2, 3}});
+  failed |= prolongation_fails<3>({{5, 6, 7}}, {{9, 11, 13}}, {{0, 0, 0}});
+  failed |= prolongation_fails<6>({{8, 8, 8}}, {{7, 6, 5}}, {{5, 4, 7}});
+  // Two dimensional boxes
+  failed |= prolongation_fails<4>({{8, 6, 1}}, {{11, 9, 1}}, {{3, 2, 0}});
+
+  for (bool symmetric : {false, true}) {
+    for (Restriction restriction :
+         {Restriction::injection, Restriction::full_weighting}) {
+      failed |= restriction_fails({{9, 8, 7}}, {{17, 15, 13}}, {{0, 0, 0}},
+                                  restriction, symmetric);
+      failed |= restriction_fails({{9, 8, 7}}, {{8, 7, 6}}, {{3, 4, 5}},
+                                  restriction, symmetric);
+      failed |= restriction_fails({{6, 6, 6}}, {{9, 2, 6}}, {{1, 0, 7}},
+                                  restriction, symmetric);
+      failed |= restriction_fails({{8, 6, 1}}, {{11, 9, 1}}, {{3, 2, 0}},
+                                  restriction, symmetric);
+    }
+  }
+
+  // Injection undoes prolongation
+  tensoralgebra::TensorField<2> coarse =
+      regrid_test::polynomial_field<5>(8, 8, 8);
+  const tensoralgebra::TensorField<2> original = coarse;
+  tensoralgebra::TensorField<2> fine(7, 8, 9);
+  tensoralgebra::prolong_field(coarse, fine, {{3, 2, 1}}, true);
+  tensoralgebra::restrict_field(fine, coarse, {{3, 2, 1}},
+                                Restriction::injection, true);
+  for (size_t p = 0; p < coarse.num_points(); ++p) {
+    failed |= regrid_test::differs(coarse[p], original[p], 0.);
+  }
+
+  // Released scratch memory is freed and allocated again by the next transfer
+  const tensoralgebra::TensorField<2> prolonged = fine;
+  tensoralgebra::release_regrid_scratch();
+  for (const auto &buffer :
+       tensoralgebra::regrid_detail::scratch_buffers<double>()) {
+    failed |= (buffer.capacity() != 0);
+  }
+  tensoralgebra::prolong_field(coarse, fine, {{3, 2, 1}}, true);
+  for (size_t p = 0; p < fine.num_points(); ++p) {
+    failed |= regrid_test::differs(fine[p], prolonged[p], 0.);
+  }
+
+  // Fine boxes which do not lie inside the coarse box, and coarse boxes too
+  // small for the stencil
+  bool threw = false;
+  try {
+    tensoralgebra::prolong_field(coarse, fine, {{9, 0, 0}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+  threw = false;
+  try {
+    tensoralgebra::TensorField<2> small(3, 8, 8);
+    tensoralgebra::prolong_field(small, fine, {{0, 0, 0}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  failed |= !threw;
+
+  print_result("Regrid test", !failed);
+  return failed;
+}
+
+#endif
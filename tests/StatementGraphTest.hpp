@@ -0,0 +1,138 @@
+#ifndef _TENSORALGEBRA_TESTS_STATEMENTGRAPHTEST_HPP
+#define _TENSORALGEBRA_TESTS_STATEMENTGRAPHTEST_HPP
+
+#include "StatementGraph.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include <stdexcept>
+#include <vector>
+
+// This file tests the fused execution of statements: the results must not
+// depend on the tile size or the number of threads and must equal those of the
+// statements executed one by one, a neighbour read of an assigned field must
+// split the graph into stages, and invalid uses of intermediates must be
+// rejected.
+
+// Whether the stages of graph can't be determined
+bool statement_graph_rejects(const tensoralgebra::StatementGraph &graph) {
+  try {
+    graph.stages();
+  } catch (const std::invalid_argument &) {
+    return true;
+  }
+  return false;
+}
+
+bool test_statement_graph() {
+  bool failed = false;
+  using tensoralgebra::reads;
+  using tensoralgebra::reads_neighbours;
+
+  const size_t num_points = 1001;
+  tensoralgebra::TensorField<2, double, 3> metric(num_points);
+  tensoralgebra::TensorField<1, double, 3> vector(num_points);
+  tensoralgebra::TensorField<1, double, 3> lowered(num_points);
+  tensoralgebra::TensorField<1, double, 3> difference(num_points);
+  tensoralgebra::TensorField<2, double, 3> result(num_points);
+  tensoralgebra::TensorField<2, double, 3> expected(num_points);
+  tensoralgebra::TensorField<1, double, 3> expected_difference(num_points);
+  for (size_t p = 0; p < num_points; ++p) {
+    for (size_t i = 0; i < 3; ++i) {
+      vector[p][i] = 1. + i + 0.01 * p;
+      for (size_t j = 0; j < 3; ++j) {
+        metric[p][i][j] = (i == j ? 2. : 0.1 * (i + j)) + 1e-3 * p;
+      }
+    }
+  }
+
+  // The statements one by one
+  for (size_t p = 0; p < num_points; ++p) {
+    const tensoralgebra::Tensor<1, double, 3> lowered_p =
+        tensoralgebra::dot(metric[p], vector[p]);
+    expected[p] = tensoralgebra::outer(lowered_p, lowered_p) -
+                  tensoralgebra::dot(lowered_p, vector[p]) * metric[p];
+    lowered[p] = lowered_p;
+  }
+  for (size_t p = 0; p + 1 < num_points; ++p) {
+    expected_difference[p] = lowered[p + 1] - lowered[p];
+  }
+  expected_difference[num_points - 1] = lowered[num_points - 1];
+
+  tensoralgebra::StatementGraph graph(num_points);
+  auto &lowered_vector = graph.intermediate<1>();
+  auto &norm = graph.intermediate<0>();
+  graph.assign(lowered_vector, {reads(metric), reads(vector)}, [&](size_t p) {
+    return tensoralgebra::dot(metric[p], vector[p]);
+  });
+  graph.assign(norm, {reads(lowered_vector), reads(vector)}, [&](size_t p) {
+    return tensoralgebra::dot(lowered_vector[p], vector[p]);
+  });
+  graph.assign(result, {reads(lowered_vector), reads(norm), reads(metric)},
+               [&](size_t p) {
+                 return tensoralgebra::outer(lowered_vector[p],
+                                             lowered_vector[p]) -
+                        norm[p] * metric[p];
+               });
+  graph.assign(lowered, {reads(lowered_vector)},
+               [&](size_t p) { return lowered_vector[p]; });
+  // A finite difference of a field assigned above starts a new stage
+  graph.assign(difference, {reads_neighbours(lowered)}, [&](size_t p) {
+    return p + 1 < num_points ? lowered[p + 1] - lowered[p] : lowered[p];
+  });
+
+  const std::vector<tensoralgebra::StatementStage> stages = graph.stages();
+  failed |= (stages.size() != 2 || stages[0].begin != 0 ||
+             stages[0].end != 4 || stages[1].begin != 4 || stages[1].end != 5);
+  failed |= (stages[0].scratch_bytes < stages[0].tile_points * 4 * 8 ||
+             stages[1].scratch_bytes != 0);
+
+  for (size_t tile_points : {0, 1, 16, 100, 1001}) {
+    for (size_t num_threads : {1, 3}) {
+      graph.set_tile_points(tile_points);
+      result.assign([](size_t) { return tensoralgebra::Tensor<2>(0.); });
+      difference.assign([](size_t) { return tensoralgebra::Tensor<1>(0.); });
+      graph.run(num_threads);
+      for (size_t p = 0; p < num_points; ++p) {
+        failed |= (result[p] != expected[p]);
+        failed |= (difference[p] != expected_difference[p]);
+      }
+    }
+  }
+  graph.set_tile_points(0);
+  graph.set_cache_bytes(16 * 1024);
+  // 224 bytes per point for the fields and intermediates of the first stage
+  failed |= (graph.stages()[0].tile_points != 16 * 1024 / 224 / 16 * 16);
+
+  // Invalid uses of intermediates
+  tensoralgebra::StatementGraph unassigned(num_points);
+  auto &never_assigned = unassigned.intermediate<1>();
+  unassigned.assign(lowered, {reads(never_assigned)},
+                    [&](size_t p) { return never_assigned[p]; });
+  failed |= !statement_graph_rejects(unassigned);
+
+  tensoralgebra::StatementGraph neighbours(num_points);
+  auto &shifted = neighbours.intermediate<1>();
+  neighbours.assign(shifted, {reads(vector)},
+                    [&](size_t p) { return vector[p]; });
+  neighbours.assign(lowered, {reads_neighbours(shifted)},
+                    [&](size_t p) { return shifted[p > 0 ? p - 1 : p]; });
+  failed |= !statement_graph_rejects(neighbours);
+
+  tensoralgebra::StatementGraph across_stages(num_points);
+  auto &saved = across_stages.intermediate<1>();
+  across_stages.assign(saved, {reads(vector)},
+                       [&](size_t p) { return vector[p]; });
+  across_stages.assign(lowered, {reads(vector)},
+                       [&](size_t p) { return vector[p]; });
+  across_stages.assign(difference, {reads_neighbours(lowered), reads(saved)},
+                       [&](size_t p) { return lowered[p] + saved[p]; });
+  failed |= !statement_graph_rejects(across_stages);
+
+  print_result("Statement graph test", !failed);
+
+  return failed;
+}
+
+#endif
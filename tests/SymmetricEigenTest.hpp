@@ -0,0 +1,147 @@
+#ifndef _TENSORALGEBRA_TESTS_SYMMETRICEIGENTEST_HPP
+#define _TENSORALGEBRA_TESTS_SYMMETRICEIGENTEST_HPP
+
+#include "SymmetricEigen.hpp"
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include <cmath>
+
+// This file tests the closed form eigensolver for symmetric 3x3 tensors: the
+// eigenvalues must be ascending, the eigenvectors orthonormal and
+// right-handed, and A.v = lambda v must hold, including for double and triple
+// eigenvalues, nearly equal eigenvalues, diagonal matrices and the zero
+// matrix.
+
+bool eigensystem_is_correct(const tensoralgebra::Tensor<2, double, 3> &matrix) {
+  const tensoralgebra::Eigensystem<double> system =
+      tensoralgebra::eigensystem(matrix);
+  const tensoralgebra::Tensor<1, double, 3> values =
+      tensoralgebra::eigenvalues(matrix);
+  double scale = 1.;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      scale = std::max(scale, std::abs(matrix[i][j]));
+    }
+  }
+  const double tolerance = 1e-13 * scale;
+
+  bool failed = false;
+  failed |= !(system.values[0] <= system.values[1] &&
+              system.values[1] <= system.values[2]);
+  for (size_t k = 0; k < 3; ++k) {
+    failed |= (values[k] != system.values[k]);
+    const tensoralgebra::Tensor<1, double, 3> &v = system.vectors[k];
+    for (size_t i = 0; i < 3; ++i) {
+      const double av = matrix[i][0] * v[0] + matrix[i][1] * v[1] +
+                        matrix[i][2] * v[2];
+      failed |= (std::abs(av - system.values[k] * v[i]) > tolerance);
+    }
+    for (size_t l = 0; l < 3; ++l) {
+      const tensoralgebra::Tensor<1, double, 3> &w = system.vectors[l];
+      const double product = v[0] * w[0] + v[1] * w[1] + v[2] * w[2];
+      failed |= (std::abs(product - (k == l ? 1. : 0.)) > 1e-13);
+    }
+  }
+  const tensoralgebra::Tensor<2, double, 3> &e = system.vectors;
+  const double determinant = e[0][0] * (e[1][1] * e[2][2] - e[1][2] * e[2][1]) -
+                             e[0][1] * (e[1][0] * e[2][2] - e[1][2] * e[2][0]) +
+                             e[0][2] * (e[1][0] * e[2][1] - e[1][1] * e[2][0]);
+  failed |= (std::abs(determinant - 1.) > 1e-13);
+  return !failed;
+}
+
+bool test_symmetric_eigen() {
+  bool failed = false;
+
+  // A general matrix, with known eigenvalues 1, 2 and 4 for a rotated diagonal
+  const double c = std::cos(0.3), s = std::sin(0.3);
+  tensoralgebra::Tensor<2, double, 3> rotation = {
+      {c, -s, 0.}, {s * c, c * c, -s}, {s * s, c * s, c}};
+  tensoralgebra::Tensor<2, double, 3> rotated;
+  const double diagonal[3] = {2., 4., 1.};
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      rotated[i][j] = 0.;
+      for (size_t k = 0; k < 3; ++k) {
+        rotated[i][j] += rotation[i][k] * diagonal[k] * rotation[j][k];
+      }
+    }
+  }
+  tensoralgebra::Tensor<1, double, 3> values =
+      tensoralgebra::eigenvalues(rotated);
+  failed |= (std::abs(values[0] - 1.) > 1e-14 ||
+             std::abs(values[1] - 2.) > 1e-14 ||
+             std::abs(values[2] - 4.) > 1e-14);
+  failed |= !eigensystem_is_correct(rotated);
+
+  // Expressions and scaling
+  failed |= !eigensystem_is_correct(1e150 * rotated);
+  failed |= !eigensystem_is_correct(1e-150 * rotated);
+  tensoralgebra::Tensor<1, double, 3> expression_values =
+      tensoralgebra::eigenvalues(2. * rotated);
+  failed |= (std::abs(expression_values[2] - 8.) > 1e-13);
+
+  // Degenerate cases
+  tensoralgebra::Tensor<2, double, 3> unsorted_diagonal = {
+      {3., 0., 0.}, {0., 1., 0.}, {0., 0., 2.}};
+  tensoralgebra::Tensor<2, double, 3> double_low = {
+      {2., 1., 0.}, {1., 2., 0.}, {0., 0., 1.}};
+  tensoralgebra::Tensor<2, double, 3> double_high = {
+      {1., 0., 0.}, {0., 2., 1.}, {0., 1., 2.}};
+  tensoralgebra::Tensor<2, double, 3> identity = {
+      {3., 0., 0.}, {0., 3., 0.}, {0., 0., 3.}};
+  tensoralgebra::Tensor<2, double, 3> zero = {
+      {0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}};
+  failed |= !eigensystem_is_correct(unsorted_diagonal);
+  failed |= !eigensystem_is_correct(double_low);
+  failed |= !eigensystem_is_correct(double_high);
+  failed |= !eigensystem_is_correct(identity);
+  failed |= !eigensystem_is_correct(zero);
+  failed |= !eigensystem_is_correct(rotated + 1e-9 * identity);
+
+  // Eigenvalues which differ in the last bits only, where rounding can make
+  // all cross products of rows vanish
+  for (const double value : {1., 2., 0.7}) {
+    const double below = std::nextafter(value, 0.);
+    const double far_below = std::nextafter(below - 4e-16 * value, 0.);
+    for (const double other : {below, far_below}) {
+      tensoralgebra::Tensor<2, double, 3> nearly_identity = {
+          {value, 0., 0.}, {0., value, 0.}, {0., 0., other}};
+      failed |= !eigensystem_is_correct(nearly_identity);
+      nearly_identity[0][0] = other;
+      nearly_identity[2][2] = value;
+      failed |= !eigensystem_is_correct(nearly_identity);
+      nearly_identity[1][1] = other;
+      failed |= !eigensystem_is_correct(nearly_identity);
+      failed |= !eigensystem_is_correct(value * identity + (other - value) *
+                                                               double_low);
+    }
+  }
+
+  // Fields, compared to point by point results
+  const size_t num_points = 23;
+  tensoralgebra::TensorField<2, double, 3> matrices(num_points);
+  tensoralgebra::TensorField<1, double, 3> field_values(num_points);
+  tensoralgebra::TensorField<1, double, 3> field_system_values(num_points);
+  tensoralgebra::TensorField<2, double, 3> field_vectors(num_points);
+  for (size_t p = 0; p < num_points; ++p) {
+    matrices[p] = rotated + (0.1 * p) * double_low;
+  }
+  tensoralgebra::eigenvalues(matrices, field_values);
+  tensoralgebra::eigensystem(matrices, field_system_values, field_vectors);
+  for (size_t p = 0; p < num_points; ++p) {
+    failed |= !eigensystem_is_correct(matrices[p]);
+    const tensoralgebra::Eigensystem<double> system =
+        tensoralgebra::eigensystem(matrices[p]);
+    failed |= (field_values[p] != system.values);
+    failed |= (field_system_values[p] != system.values);
+    failed |= (field_vectors[p] != system.vectors);
+  }
+
+  print_result("Symmetric eigen test", !failed);
+
+  return failed;
+}
+
+#endif
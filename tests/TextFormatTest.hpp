@@ -0,0 +1,99 @@
+#ifndef _TENSORALGEBRA_TESTS_TEXTFORMATTEST_HPP
+#define _TENSORALGEBRA_TESTS_TEXTFORMATTEST_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TestingUtilities.hpp"
+#include "TextFormat.hpp"
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// This file tests the bulk text formatter: the output for integral values must
+// match operator<<, and formatting followed by parsing must reproduce every
+// component exactly in all formats.
+
+bool test_text_format() {
+  using TwoTensor = tensoralgebra::Tensor<2, double, 2>;
+  bool failed = false;
+  char buffer[256];
+
+  // Same output as operator<< for values it prints exactly
+  TwoTensor tensor = {{1., -2.}, {30., 0.5}};
+  std::ostringstream stream;
+  stream << tensor;
+  char *end = tensoralgebra::format_tensor(buffer, buffer + 256, tensor);
+  failed |= (end == nullptr || std::string(buffer, end) != stream.str());
+
+  // Expressions are evaluated before formatting
+  end = tensoralgebra::format_tensor(buffer, buffer + 256, 2. * tensor);
+  failed |= (end == nullptr || std::string(buffer, end) != "{{2,-4},{60,1}}");
+
+  // Too small a buffer is reported
+  failed |= (tensoralgebra::format_tensor(buffer, buffer + 10, tensor) !=
+             nullptr);
+
+  // Round trip of a field with awkward values in all formats
+  tensoralgebra::TensorField<2, double, 2> field(4);
+  field[0] = {{0.1, 1. / 3.}, {-0., 1e300}};
+  field[1] = {{M_PI, -std::exp(1.)}, {5e-324, 123456789012345678.}};
+  field[2] = {{-1.5, 2.}, {1e-7, 4.}};
+  field[3] = {{std::nextafter(1., 2.), 0.}, {-1e22, 7.}};
+  std::vector<char> field_buffer(4096);
+  for (auto format : {tensoralgebra::TextFormat::braces(),
+                      tensoralgebra::TextFormat::csv(),
+                      tensoralgebra::TextFormat::json()}) {
+    char *field_end = tensoralgebra::format_field(
+        field_buffer.data(), field_buffer.data() + field_buffer.size(), field,
+        format);
+    failed |= (field_end == nullptr);
+    if (field_end) {
+      tensoralgebra::TensorField<2, double, 2> parsed(4);
+      const char *parsed_end = tensoralgebra::parse_field(
+          field_buffer.data(), field_end, parsed, format);
+      failed |= (parsed_end != field_end);
+      for (size_t p = 0; p < field.num_points(); ++p) {
+        failed |= (parsed[p] != field[p]);
+      }
+      failed |= (std::signbit(parsed[0][1][0]) == false);
+    }
+  }
+
+  // Negative zeros keep their sign in both precisions
+  tensoralgebra::Tensor<1, float, 2> zeros = {-0.f, 0.f};
+  end = tensoralgebra::format_tensor(buffer, buffer + 256, zeros);
+  failed |= (end == nullptr || std::string(buffer, end) != "{-0,0}");
+  tensoralgebra::Tensor<1, float, 2> parsed_zeros = {1.f, 1.f};
+  failed |= (end == nullptr ||
+             tensoralgebra::parse_tensor(buffer, end, parsed_zeros) != end);
+  failed |= (parsed_zeros[0] != 0.f || !std::signbit(parsed_zeros[0]) ||
+             parsed_zeros[1] != 0.f || std::signbit(parsed_zeros[1]));
+  tensoralgebra::Tensor<1, double, 2> double_zeros = {-0., 0.};
+  end = tensoralgebra::format_tensor(buffer, buffer + 256, double_zeros);
+  failed |= (end == nullptr || std::string(buffer, end) != "{-0,0}");
+
+  // Fixed precision output
+  tensoralgebra::Tensor<1, float, 2> vector = {0.125f, 1.f / 3.f};
+  end = tensoralgebra::format_tensor(buffer, buffer + 256, vector,
+                                     tensoralgebra::TextFormat::json(3));
+  failed |= (end == nullptr || std::string(buffer, end) != "[0.125,0.333]");
+
+  // Parsing the output of operator<< and rejecting malformed input
+  const std::string text = " { {1, 2.5} , {-3e2,4}}";
+  TwoTensor parsed_tensor;
+  TwoTensor correct_tensor = {{1., 2.5}, {-300., 4.}};
+  failed |= (tensoralgebra::parse_tensor(text.data(), text.data() + text.size(),
+                                         parsed_tensor) == nullptr);
+  failed |= (parsed_tensor != correct_tensor);
+  const std::string malformed = "{{1,2},{3 4}}";
+  failed |= (tensoralgebra::parse_tensor(malformed.data(),
+                                         malformed.data() + malformed.size(),
+                                         parsed_tensor) != nullptr);
+
+  print_result("Text format test", !failed);
+
+  return failed;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _TENSORALGEBRA_TESTS_WORKSTEALINGTEST_HPP
+#define _TENSORALGEBRA_TESTS_WORKSTEALINGTEST_HPP
+
+#include "Tensor.hpp"
+#include "TensorField.hpp"
+#include "TensorOperations.hpp"
+#include "TestingUtilities.hpp"
+#include "WorkStealing.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+// This file tests the work stealing scheduler: every point of boxes of very
+// different sizes (including empty boxes) must be evaluated exactly once, for
+// any number of threads, large boxes must be split, the statistics must add up
+// and exceptions must be passed to the caller.
+
+bool test_work_stealing() {
+  bool failed = false;
+
+  const std::vector<size_t> box_points = {5000, 1, 0, 300, 40000, 17, 2048};
+  std::vector<tensoralgebra::TensorField<1, double, 3>> vectors, results;
+  for (size_t points : box_points) {
+    vectors.emplace_back(points);
+    results.emplace_back(points);
+  }
+  for (size_t box = 0; box < box_points.size(); ++box) {
+    for (size_t p = 0; p < box_points[box]; ++p) {
+      vectors[box][p] = {1. * box, 1. * p, 2.};
+    }
+  }
+
+  for (size_t num_threads : {1, 2, 5}) {
+    tensoralgebra::WorkStealingScheduler scheduler(num_threads, 256);
+    std::vector<std::vector<std::atomic<int>>> evaluations;
+    for (size_t points : box_points) {
+      evaluations.emplace_back(points);
+    }
+    scheduler.run(box_points, [&](size_t box, size_t begin, size_t end) {
+      for (size_t p = begin; p < end; ++p) {
+        ++evaluations[box][p];
+      }
+    });
+    for (const auto &box : evaluations) {
+      for (const auto &count : box) {
+        failed |= (count != 1);
+      }
+    }
+
+    const tensoralgebra::SchedulerStatistics &statistics =
+        scheduler.statistics();
+    failed |= (statistics.workers.size() != num_threads);
+    failed |= (statistics.points() != 5000 + 1 + 300 + 40000 + 17 + 2048);
+    // The largest box alone is split into at least 40000 / 512 tasks
+    failed |= (statistics.splits() < 64 ||
+               statistics.tasks() != 6 + statistics.splits());
+    failed |= (statistics.idle_fraction() < 0. ||
+               statistics.idle_fraction() > 1.);
+    failed |= (num_threads == 1 && (statistics.steals() != 0 ||
+                                    statistics.failed_steals() != 0));
+
+    scheduler.assign(results, [&](size_t box, size_t p) {
+      return 2. * vectors[box][p] + tensoralgebra::Tensor<1>(1.);
+    });
+    for (size_t box = 0; box < box_points.size(); ++box) {
+      for (size_t p = 0; p < box_points[box]; ++p) {
+        failed |= (results[box][p][0] != 2. * box + 1. ||
+                   results[box][p][1] != 2. * p + 1. ||
+                   results[box][p][2] != 5.);
+      }
+    }
+
+    bool rejected = false;
+    try {
+      scheduler.run(box_points, [&](size_t box, size_t, size_t) {
+        if (box == 4) {
+          throw std::runtime_error("box 4");
+        }
+      });
+    } catch (const std::runtime_error &) {
+      rejected = true;
+    }
+    failed |= !rejected;
+  }
+
+  print_result("Work stealing test", !failed);
+
+  return failed;
+}
+
+#endif